@@ -9,7 +9,6 @@ kind "WindowedApp"
 defines "HB_ENTRY_WINMAIN"
 filter {}
 
-defines "TRACY_ENABLE" -- Move to AppDefines
 defines "YAML_CPP_STATIC_DEFINE" -- Move to AppDefines
 
 files
@@ -53,9 +52,13 @@ links
     "nanovg",
     "yaml",
     --"lua", 
-    --"tracy"
 }
 
+if os.isfile(path.join(_MAIN_SCRIPT_DIR, "vendor/tracy/public/TracyClient.cpp")) then
+    defines "TRACY_ENABLE" -- Move to AppDefines
+    links "tracy"
+end
+
 filter "system:linux"
 links { "pthread", "dl", "X11", "m" }
 
@@ -0,0 +1,128 @@
+#include "hb_allocations.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#	include <malloc.h> // _aligned_malloc, _aligned_free
+#endif
+
+namespace hyperbeetle::allocations {
+	namespace {
+		std::atomic<std::uint64_t> gAllocations = 0;
+		std::atomic<std::uint64_t> gBytes = 0;
+		// Trivial, so using it from operator new never runs a constructor or registers a destructor.
+		thread_local Counts tThread;
+
+		void count(std::size_t size) noexcept {
+			gAllocations.fetch_add(1, std::memory_order_relaxed);
+			gBytes.fetch_add(size, std::memory_order_relaxed);
+			++tThread.allocations;
+			tThread.bytes += size;
+		}
+
+		void* allocate(std::size_t size) noexcept {
+			void* pointer = std::malloc(size ? size : 1);
+			if (pointer) count(size);
+			return pointer;
+		}
+
+		void* allocateAligned(std::size_t size, std::align_val_t alignment) noexcept {
+			auto align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+			void* pointer = _aligned_malloc(size ? size : 1, align);
+#else
+			// aligned_alloc wants a multiple of the alignment.
+			void* pointer = std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align);
+#endif
+			if (pointer) count(size);
+			return pointer;
+		}
+
+		void freeAligned(void* pointer) noexcept {
+#ifdef _WIN32
+			_aligned_free(pointer);
+#else
+			std::free(pointer);
+#endif
+		}
+
+		// Like the standard operator new, calls the new handler after every failure until it succeeds or there is none.
+		void* allocateOrThrow(std::size_t size) {
+			while (true) {
+				if (void* pointer = allocate(size)) return pointer;
+
+				std::new_handler handler = std::get_new_handler();
+				if (!handler) throw std::bad_alloc();
+				handler();
+			}
+		}
+
+		void* allocateAlignedOrThrow(std::size_t size, std::align_val_t alignment) {
+			while (true) {
+				if (void* pointer = allocateAligned(size, alignment)) return pointer;
+
+				std::new_handler handler = std::get_new_handler();
+				if (!handler) throw std::bad_alloc();
+				handler();
+			}
+		}
+
+		// The nothrow forms also give the new handler its chance, and return null where it would throw.
+		void* allocateOrNull(std::size_t size) noexcept {
+			try {
+				return allocateOrThrow(size);
+			}
+			catch (...) {
+				return nullptr;
+			}
+		}
+
+		void* allocateAlignedOrNull(std::size_t size, std::align_val_t alignment) noexcept {
+			try {
+				return allocateAlignedOrThrow(size, alignment);
+			}
+			catch (...) {
+				return nullptr;
+			}
+		}
+	}
+
+	Counts total() noexcept {
+		return { gAllocations.load(std::memory_order_relaxed), gBytes.load(std::memory_order_relaxed) };
+	}
+
+	Counts thisThread() noexcept {
+		return tThread;
+	}
+}
+
+using hyperbeetle::allocations::allocateOrThrow;
+using hyperbeetle::allocations::allocateAlignedOrThrow;
+using hyperbeetle::allocations::allocateOrNull;
+using hyperbeetle::allocations::allocateAlignedOrNull;
+using hyperbeetle::allocations::freeAligned;
+
+void* operator new(std::size_t size) { return allocateOrThrow(size); }
+void* operator new[](std::size_t size) { return allocateOrThrow(size); }
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept { return allocateOrNull(size); }
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept { return allocateOrNull(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAlignedOrThrow(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAlignedOrThrow(size, alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept { return allocateAlignedOrNull(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept { return allocateAlignedOrNull(size, alignment); }
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::nothrow_t const&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::nothrow_t const&) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete(void* pointer, std::align_val_t, std::nothrow_t const&) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t, std::nothrow_t const&) noexcept { freeAligned(pointer); }
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace hyperbeetle::allocations {
+	// Global operator new is replaced to count every heap allocation, so a loop can check that it doesn't allocate by
+	// comparing counts before and after. Memory handed out by arenas isn't counted, only what they take from the heap.
+	struct Counts final {
+		std::uint64_t allocations = 0;
+		std::uint64_t bytes = 0;
+	};
+
+	inline Counts operator-(Counts const& a, Counts const& b) {
+		return { a.allocations - b.allocations, a.bytes - b.bytes };
+	}
+
+	// Every thread since the program started.
+	Counts total() noexcept;
+	// The calling thread since it started.
+	Counts thisThread() noexcept;
+}
@@ -0,0 +1,134 @@
+#include "hb_audio.hpp"
+
+#include "hb_audio_devices.hpp"
+#include "hb_clock.hpp"
+#include "hb_profiler.hpp"
+
+#define STB_VORBIS_HEADER_ONLY
+#include <stb_vorbis.c>
+#define MINIAUDIO_IMPLEMENTATION
+#include <miniaudio.h>
+
+namespace hyperbeetle {
+	void AudioEngine::init(std::string_view preferredDevice, SongClock& clock, Backend backend) {
+		mClock = &clock;
+#if HB_PROFILE_COMPILED
+		mProfileEvents = profiler::acquireThreadEvents("audio");
+#endif
+
+		ma_backend nullBackend = ma_backend_null;
+		bool useNull = backend == Backend::Null;
+
+		if (ma_context_init(useNull ? &nullBackend : nullptr, useNull ? 1 : 0, nullptr, &mContext) != MA_SUCCESS) {
+			// Error.
+		}
+
+		ma_device_info* pPlaybackInfos;
+		ma_uint32 playbackCount;
+		if (ma_context_get_devices(&mContext, &pPlaybackInfos, &playbackCount, nullptr, nullptr) != MA_SUCCESS) {
+			// Error.
+		}
+
+		bool isDeviceChosen = false;
+		ma_uint32 chosenPlaybackDeviceIndex = 0;
+
+		for (ma_uint32 iDevice = 0; iDevice < playbackCount; iDevice += 1) {
+			if (std::string_view(pPlaybackInfos[iDevice].name) == preferredDevice) {
+				chosenPlaybackDeviceIndex = iDevice;
+				isDeviceChosen = true;
+			}
+		}
+
+		if (!isDeviceChosen) {
+			for (ma_uint32 iDevice = 0; iDevice < playbackCount; iDevice += 1) {
+				if (pPlaybackInfos[iDevice].isDefault) {
+					chosenPlaybackDeviceIndex = iDevice;
+					isDeviceChosen = true;
+					break;
+				}
+			}
+		}
+
+		mDeviceName = pPlaybackInfos[chosenPlaybackDeviceIndex].name;
+
+		ma_device_config deviceConfig = ma_device_config_init(ma_device_type_playback);
+		deviceConfig.playback.pDeviceID = &pPlaybackInfos[chosenPlaybackDeviceIndex].id;
+		deviceConfig.pUserData = this;
+
+		deviceConfig.dataCallback = [](ma_device* pDevice, void* pOutput, void const* pInput, ma_uint32 frameCount) {
+			auto& audioEngine = *static_cast<AudioEngine*>(pDevice->pUserData);
+			HB_PROFILE_THREAD_EVENTS(audioEngine.mProfileEvents);
+			HB_PROFILE_ZONE("audio.callback");
+			dsp::DenormalGuard denormals;
+
+			std::int64_t begin = now();
+
+			ma_uint64 engineFrame = ma_engine_get_time_in_pcm_frames(&audioEngine.mEngine);
+			audioEngine.mClock->onRender(engineFrame, pDevice->sampleRate);
+
+			ma_uint64 framesRead = 0;
+			ma_engine_read_pcm_frames(&audioEngine.mEngine, pOutput, frameCount, &framesRead);
+
+			// The node graph doesn't advance while nothing is attached to it, keep engine time in step with the device
+			// so it stays usable as a clock and for scheduling sounds.
+			if (framesRead < frameCount) {
+				ma_silence_pcm_frames(ma_offset_pcm_frames_ptr(pOutput, framesRead, pDevice->playback.format, pDevice->playback.channels), frameCount - framesRead, pDevice->playback.format, pDevice->playback.channels);
+				ma_engine_set_time_in_pcm_frames(&audioEngine.mEngine, engineFrame + frameCount);
+			}
+
+			audioEngine.mCallbackCount.store(audioEngine.mCallbackCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			audioEngine.mCallbackNanoseconds.store(audioEngine.mCallbackNanoseconds.load(std::memory_order_relaxed) + now() - begin, std::memory_order_relaxed);
+		};
+
+		deviceConfig.notificationCallback = [](ma_device_notification const* pNotification) {
+			auto& audioEngine = *static_cast<AudioEngine*>(pNotification->pDevice->pUserData);
+			bool changed = pNotification->type == ma_device_notification_type_stopped || pNotification->type == ma_device_notification_type_rerouted;
+			if (changed && audioEngine.mDeviceList)
+				audioEngine.mDeviceList->requestRefresh();
+		};
+
+		if (ma_device_init(&mContext, &deviceConfig, &mDevice) != MA_SUCCESS) {
+			// Error.
+		}
+
+		ma_engine_config engineConfig = ma_engine_config_init();
+		engineConfig.pDevice = &mDevice;
+		engineConfig.noAutoStart = MA_TRUE;
+
+		if (ma_engine_init(&engineConfig, &mEngine) != MA_SUCCESS) {
+			// Error.
+		}
+
+		// Leaves nothing open behind, the caller only sees the error.
+		try {
+			mEffects.init(mEngine);
+		}
+		catch (...) {
+			ma_engine_uninit(&mEngine);
+			ma_device_uninit(&mDevice);
+			ma_context_uninit(&mContext);
+
+			profiler::releaseThreadEvents(mProfileEvents);
+			mProfileEvents = nullptr;
+			throw;
+		}
+	}
+
+	void AudioEngine::start() {
+		mClock->reset();
+
+		if (ma_engine_start(&mEngine) != MA_SUCCESS) {
+			// Error.
+		}
+	}
+
+	void AudioEngine::uninit() {
+		mEffects.uninit();
+		ma_engine_uninit(&mEngine);
+		ma_device_uninit(&mDevice);
+		ma_context_uninit(&mContext);
+
+		profiler::releaseThreadEvents(mProfileEvents);
+		mProfileEvents = nullptr;
+	}
+}
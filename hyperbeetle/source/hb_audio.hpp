@@ -0,0 +1,48 @@
+#pragma once
+
+#include "hb_effects.hpp"
+#include "hb_profiler.hpp"
+#include "hb_song_clock.hpp"
+
+#include <miniaudio.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace hyperbeetle {
+	class AudioDeviceList;
+
+	struct AudioEngine final {
+		enum class Backend {
+			Default,
+			Null, // Renders in real time without a sound card, for headless runs
+		};
+
+		// Opens the device without starting it. `clock` must outlive the engine. Throws std::runtime_error with nothing
+		// left to uninit.
+		void init(std::string_view preferredDevice, SongClock& clock, Backend backend = Backend::Default);
+		// Starts rendering and resets the clock. No other engine may be running on the same clock.
+		void start();
+		void uninit();
+
+		std::string mDeviceName;
+		ma_context mContext;
+		ma_device mDevice;
+		ma_engine mEngine;
+		// Between the engine's sounds and the device, sounds play through its groups.
+		EffectGraph mEffects;
+
+		SongClock* mClock = nullptr;
+		// Asked to refresh when the device is lost or rerouted.
+		AudioDeviceList* mDeviceList = nullptr;
+
+		// Taken before the device opens, so the callback never allocates a ring or locks to record its zones.
+		profiler::ThreadEvents* mProfileEvents = nullptr;
+
+		// Cost of the device callback, written by the audio thread.
+		std::atomic<std::uint64_t> mCallbackCount = 0;
+		std::atomic<std::int64_t> mCallbackNanoseconds = 0;
+	};
+}
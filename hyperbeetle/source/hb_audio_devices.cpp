@@ -0,0 +1,71 @@
+#include "hb_audio_devices.hpp"
+
+#include <miniaudio.h>
+
+#include <iostream>
+
+namespace hyperbeetle {
+	void AudioDeviceList::start() {
+		if (mThread.joinable()) return;
+		mRefresh = true;
+		mThread = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+	}
+
+	void AudioDeviceList::stop() {
+		if (!mThread.joinable()) return;
+		mThread.request_stop();
+		mThread.join();
+	}
+
+	void AudioDeviceList::requestRefresh() {
+		{
+			std::lock_guard lock(mMutex);
+			mRefresh = true;
+		}
+		mWake.notify_one();
+	}
+
+	std::shared_ptr<AudioDeviceList::Snapshot const> AudioDeviceList::snapshot() const {
+		std::lock_guard lock(mMutex);
+		return mSnapshot;
+	}
+
+	void AudioDeviceList::run(std::stop_token stopToken) {
+		ma_context context;
+		if (ma_context_init(nullptr, 0, nullptr, &context) != MA_SUCCESS) {
+			std::cout << "Failed to create an audio context for device enumeration" << std::endl;
+			return;
+		}
+
+		while (!stopToken.stop_requested()) {
+			{
+				std::unique_lock lock(mMutex);
+				if (!mWake.wait(lock, stopToken, [this]() { return mRefresh; }))
+					break;
+				mRefresh = false;
+			}
+
+			ma_device_info* pPlaybackInfos;
+			ma_uint32 playbackCount;
+			if (ma_context_get_devices(&context, &pPlaybackInfos, &playbackCount, nullptr, nullptr) != MA_SUCCESS)
+				continue;
+
+			auto snapshot = std::make_shared<Snapshot>();
+			for (ma_uint32 i = 0; i < playbackCount; ++i) {
+				snapshot->playback.emplace_back(pPlaybackInfos[i].name);
+				if (pPlaybackInfos[i].isDefault)
+					snapshot->defaultPlayback = pPlaybackInfos[i].name;
+			}
+
+			std::lock_guard lock(mMutex);
+			if (snapshot->playback == mSnapshot->playback && snapshot->defaultPlayback == mSnapshot->defaultPlayback)
+				continue;
+
+			snapshot->version = mSnapshot->version + 1;
+			mSnapshot = std::move(snapshot);
+			mVersion.store(mSnapshot->version, std::memory_order_release);
+		}
+
+		ma_context_uninit(&context);
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hyperbeetle {
+	// Playback devices as last seen by a background thread with its own miniaudio context.
+	// Enumerating devices is a slow round trip to the OS, so readers only ever look at a snapshot and compare versions
+	// to find out whether anything changed. Refreshes happen on request, e.g. when a device reports a change.
+	class AudioDeviceList final {
+	public:
+		struct Snapshot final {
+			std::uint64_t version = 0;
+			std::vector<std::string> playback;
+			std::string defaultPlayback;
+		};
+
+		AudioDeviceList() = default;
+		AudioDeviceList(AudioDeviceList const&) = delete;
+		AudioDeviceList& operator=(AudioDeviceList const&) = delete;
+		~AudioDeviceList() noexcept { stop(); }
+
+		// Enumerates once right away.
+		void start();
+		void stop();
+
+		// Any thread, doesn't wait for the refresh.
+		void requestRefresh();
+
+		// Bumped whenever the list changes, cheap enough to poll every frame.
+		inline std::uint64_t version() const noexcept { return mVersion.load(std::memory_order_acquire); }
+		std::shared_ptr<Snapshot const> snapshot() const;
+	private:
+		void run(std::stop_token stopToken);
+
+		mutable std::mutex mMutex;
+		std::condition_variable_any mWake;
+		bool mRefresh = false;
+		std::shared_ptr<Snapshot const> mSnapshot = std::make_shared<Snapshot>();
+		std::atomic<std::uint64_t> mVersion = 0;
+
+		std::jthread mThread;
+	};
+}
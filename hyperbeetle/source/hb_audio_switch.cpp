@@ -0,0 +1,121 @@
+#include "hb_audio_switch.hpp"
+
+#include <iostream>
+
+namespace hyperbeetle {
+	void AudioSwitcher::start() {
+		if (mThread.joinable()) return;
+		mThread = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+	}
+
+	void AudioSwitcher::stop() {
+		if (!mThread.joinable()) return;
+		mThread.request_stop();
+		mThread.join();
+
+		std::unique_lock lock(mMutex);
+		if (mRetired)
+			retire(lock);
+
+		if (mOpened) {
+			mOpened->uninit();
+			mOpened.reset();
+			mReady.store(false, std::memory_order_relaxed);
+		}
+
+		mRequest.reset();
+	}
+
+	void AudioSwitcher::request(std::string device, AudioEngine::Backend backend) {
+		{
+			std::lock_guard lock(mMutex);
+			mRequest = Request{ std::move(device), backend };
+		}
+		mWake.notify_one();
+	}
+
+	bool AudioSwitcher::busy() const {
+		std::lock_guard lock(mMutex);
+		return mRequest || mOpening || mOpened || mRetired;
+	}
+
+	AudioSwitcher::Timings AudioSwitcher::timings() const {
+		std::lock_guard lock(mMutex);
+		return mTimings;
+	}
+
+	void AudioSwitcher::retire(std::unique_lock<std::mutex>& lock) {
+		std::unique_ptr<AudioEngine> previous = std::move(mRetired);
+		AudioEngine* next = mStarting;
+		mStarting = nullptr;
+		lock.unlock();
+
+		// The previous device has to stop before the next one starts, both write the same clock.
+		std::int64_t begin = now();
+		previous->uninit();
+		next->start();
+		double close = nanosecondsToSeconds(now() - begin);
+
+		lock.lock();
+		mTimings.close = close;
+	}
+
+	void AudioSwitcher::run(std::stop_token stopToken) {
+		std::unique_lock lock(mMutex);
+
+		for (;;) {
+			// A ready engine waits to be swapped in before the next request is opened.
+			if (!mWake.wait(lock, stopToken, [this]() { return mRetired || (mRequest && !mOpened); }))
+				break;
+
+			if (mRetired) {
+				retire(lock);
+				continue;
+			}
+
+			Request request = std::move(*mRequest);
+			mRequest.reset();
+			mOpening = true;
+			lock.unlock();
+
+			std::int64_t begin = now();
+			auto engine = std::make_unique<AudioEngine>();
+			engine->mDeviceList = mDevices;
+			try {
+				engine->init(request.device, mClock, request.backend);
+				try {
+					if (mPrepare)
+						mPrepare(*engine);
+				}
+				catch (...) {
+					engine->uninit();
+					throw;
+				}
+			}
+			catch (std::exception const& e) {
+				// The active engine keeps playing.
+				std::cout << "Failed to switch to audio device " << (request.device.empty() ? "(default)" : request.device) << ": " << e.what() << '\n';
+				lock.lock();
+				mOpening = false;
+				++mTimings.failed;
+				continue;
+			}
+			double open = nanosecondsToSeconds(now() - begin);
+
+			lock.lock();
+			mOpening = false;
+			mTimings.open = open;
+
+			// Superseded while it was opening.
+			if (mRequest) {
+				lock.unlock();
+				engine->uninit();
+				lock.lock();
+				continue;
+			}
+
+			mOpened = std::move(engine);
+			mReady.store(true, std::memory_order_release);
+		}
+	}
+}
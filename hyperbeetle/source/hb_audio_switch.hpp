@@ -0,0 +1,112 @@
+#pragma once
+
+#include "hb_audio.hpp"
+#include "hb_clock.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace hyperbeetle {
+	class AudioDeviceList;
+
+	// Moves playback to another device without blocking the thread that renders frames.
+	// Opening and closing devices are slow round trips to the OS, so both happen on a worker. The caller only swaps
+	// the ready engine in between frames, which is the whole of the hitch a switch can cause.
+	class AudioSwitcher final {
+	public:
+		// Seconds, of the last switch except for the maximum.
+		struct Timings final {
+			std::uint32_t switches = 0;
+			std::uint32_t failed = 0; // devices that failed to open, the active one kept playing
+			double open = 0.0; // worker, opening the new device and preparing for it
+			double swap = 0.0; // caller, swapping engines and moving sounds over
+			double close = 0.0; // worker, closing the old device and starting the new one
+			double maxSwap = 0.0;
+		};
+
+		explicit AudioSwitcher(SongClock& clock, AudioDeviceList* devices = nullptr) : mClock(clock), mDevices(devices) {}
+		AudioSwitcher(AudioSwitcher const&) = delete;
+		AudioSwitcher& operator=(AudioSwitcher const&) = delete;
+		~AudioSwitcher() noexcept { stop(); }
+
+		void start();
+		// Finishes a switch in progress and drops one that hasn't been swapped in.
+		void stop();
+
+		// Only while stopped. Called on the worker with every engine it opened before `poll` may swap it in, for the slow
+		// part of moving things over such as decoding sounds at the new format.
+		inline void setPrepare(std::function<void(AudioEngine&)> prepare) { mPrepare = std::move(prepare); }
+
+		// Any thread. If requests arrive faster than devices open, only the latest one is opened.
+		void request(std::string device, AudioEngine::Backend backend = AudioEngine::Backend::Default);
+		bool busy() const;
+
+		// Once per frame from the thread that owns `active`. When a requested engine is ready it is swapped into `active`
+		// and `rebind(previous, next)` moves whatever was attached to the previous engine over. The worker then closes
+		// the previous device and starts the new one. Returns whether a swap happened.
+		template<class Fn>
+		bool poll(std::unique_ptr<AudioEngine>& active, Fn&& rebind) {
+			if (!mReady.load(std::memory_order_acquire)) return false;
+
+			std::int64_t begin = now();
+
+			std::unique_ptr<AudioEngine> next;
+			{
+				std::lock_guard lock(mMutex);
+				next = std::move(mOpened);
+				mReady.store(false, std::memory_order_relaxed);
+			}
+			if (!next) return false;
+
+			std::swap(active, next);
+			rebind(*next, *active);
+
+			double swap = nanosecondsToSeconds(now() - begin);
+			{
+				std::lock_guard lock(mMutex);
+				mRetired = std::move(next);
+				mStarting = active.get();
+				mTimings.swap = swap;
+				mTimings.maxSwap = std::max(mTimings.maxSwap, swap);
+				++mTimings.switches;
+			}
+			mWake.notify_one();
+			return true;
+		}
+
+		Timings timings() const;
+	private:
+		struct Request final {
+			std::string device;
+			AudioEngine::Backend backend;
+		};
+
+		void run(std::stop_token stopToken);
+		void retire(std::unique_lock<std::mutex>& lock);
+
+		SongClock& mClock;
+		AudioDeviceList* mDevices;
+		std::function<void(AudioEngine&)> mPrepare;
+
+		mutable std::mutex mMutex;
+		std::condition_variable_any mWake;
+		std::optional<Request> mRequest;
+		bool mOpening = false;
+		std::unique_ptr<AudioEngine> mOpened;
+		std::atomic_bool mReady = false;
+		std::unique_ptr<AudioEngine> mRetired;
+		AudioEngine* mStarting = nullptr;
+		Timings mTimings;
+
+		std::jthread mThread;
+	};
+}
@@ -0,0 +1,536 @@
+#include "hb_beat_analysis.hpp"
+
+#include "hb_clock.hpp"
+#include "hb_jobs.hpp"
+
+#define STB_VORBIS_HEADER_ONLY
+#include <stb_vorbis.c>
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cmath>
+#include <exception>
+#include <memory>
+#include <numbers>
+
+#if defined(__AVX2__)
+#	define HB_ANALYSIS_AVX2 1
+#	include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#	define HB_ANALYSIS_SSE2 1
+#	include <emmintrin.h>
+#endif
+
+namespace hyperbeetle {
+	namespace {
+		// Samples one decoder handles, about 20 seconds.
+		constexpr std::uint32_t kDecodeBlockSamples = 1u << 20;
+		constexpr std::size_t kDecodeChunkFrames = 4096;
+		// Spectra one job computes, it recomputes the one before to take the flux against.
+		constexpr std::size_t kSpectrumBlockFrames = 1024;
+		// Lags one autocorrelation job computes.
+		constexpr std::size_t kLagBlock = 64;
+		// Magnitudes are compressed as log(1 + k * magnitude), so quiet onsets count too.
+		constexpr float kCompression = 10.0f;
+		constexpr double kBandsPerOctave = 6.0;
+		constexpr double kLowestBand = 30.0; // Hz
+		// Half the window the detection function's local average is taken over.
+		constexpr double kLocalAverageSeconds = 0.1;
+		// Spectra a peak must be the largest within on either side to be an onset.
+		constexpr std::ptrdiff_t kPeakRadius = 3;
+		constexpr double kPriorOctaves = 1.0;
+		// Multiples of the beat period the tempo is refined over, each sharpens it further.
+		constexpr int kHarmonics = 8;
+		constexpr double kPeriodStep = 0.01; // spectra
+		constexpr double kPhaseStep = 0.1;
+
+		struct VorbisCloser final {
+			void operator()(stb_vorbis* vorbis) const { stb_vorbis_close(vorbis); }
+		};
+		using Vorbis = std::unique_ptr<stb_vorbis, VorbisCloser>;
+
+		Vorbis openVorbis(std::span<std::byte const> ogg) {
+			int error = 0;
+			Vorbis vorbis(stb_vorbis_open_memory(reinterpret_cast<unsigned char const*>(ogg.data()), static_cast<int>(std::min<std::size_t>(ogg.size(), INT_MAX)), &error, nullptr));
+			if (!vorbis)
+				throw AnalysisError("Not an Ogg Vorbis stream, stb_vorbis error " + std::to_string(error));
+			return vorbis;
+		}
+
+		// Decodes `count` samples from sample `start` on, mixed down.
+		void decodeBlock(std::span<std::byte const> ogg, std::uint32_t start, float* out, std::size_t count) {
+			Vorbis vorbis = openVorbis(ogg);
+			int channels = stb_vorbis_get_info(vorbis.get()).channels;
+			if (start && !stb_vorbis_seek(vorbis.get(), start))
+				throw AnalysisError("Failed to seek to sample " + std::to_string(start));
+
+			std::vector<float> interleaved(kDecodeChunkFrames * channels);
+			float scale = 1.0f / static_cast<float>(channels);
+			while (count) {
+				int wanted = static_cast<int>(std::min(count, kDecodeChunkFrames) * channels);
+				int frames = stb_vorbis_get_samples_float_interleaved(vorbis.get(), channels, interleaved.data(), wanted);
+				if (frames <= 0) break;
+
+				for (int i = 0; i < frames; ++i) {
+					float sum = 0.0f;
+					for (int channel = 0; channel < channels; ++channel)
+						sum += interleaved[i * channels + channel];
+					*out++ = sum * scale;
+				}
+				count -= static_cast<std::size_t>(frames);
+			}
+			// Past a stream that ended early.
+			std::fill_n(out, count, 0.0f);
+		}
+
+		// Radix 2 complex FFT on split real and imaginary arrays, so the butterflies of a stage vectorize across
+		// neighbouring elements.
+		class Fft final {
+		public:
+			explicit Fft(std::uint32_t size) : mSize(size), mReverse(size), mTwiddleReal(size), mTwiddleImaginary(size) {
+				int bits = std::countr_zero(size);
+				for (std::uint32_t i = 0; i < size; ++i)
+					mReverse[i] = bits ? (reverseBits(i) >> (32 - bits)) : 0;
+
+				// The twiddles of the stage combining halves of length `half` start at `half - 1`.
+				for (std::uint32_t half = 1; half < size; half *= 2) {
+					for (std::uint32_t k = 0; k < half; ++k) {
+						double angle = -std::numbers::pi * static_cast<double>(k) / static_cast<double>(half);
+						mTwiddleReal[half - 1 + k] = static_cast<float>(std::cos(angle));
+						mTwiddleImaginary[half - 1 + k] = static_cast<float>(std::sin(angle));
+					}
+				}
+			}
+
+			void transform(float* real, float* imaginary) const {
+				for (std::uint32_t i = 0; i < mSize; ++i) {
+					std::uint32_t j = mReverse[i];
+					if (i < j) {
+						std::swap(real[i], real[j]);
+						std::swap(imaginary[i], imaginary[j]);
+					}
+				}
+
+				for (std::uint32_t half = 1; half < mSize; half *= 2) {
+					float const* wr = mTwiddleReal.data() + half - 1;
+					float const* wi = mTwiddleImaginary.data() + half - 1;
+
+					for (std::uint32_t start = 0; start < mSize; start += 2 * half) {
+						float* ar = real + start;
+						float* ai = imaginary + start;
+						float* br = ar + half;
+						float* bi = ai + half;
+						std::uint32_t k = 0;
+#if HB_ANALYSIS_AVX2
+						for (; k + 8 <= half; k += 8) {
+							__m256 xr = _mm256_loadu_ps(br + k), xi = _mm256_loadu_ps(bi + k);
+							__m256 cr = _mm256_loadu_ps(wr + k), ci = _mm256_loadu_ps(wi + k);
+							__m256 tr = _mm256_sub_ps(_mm256_mul_ps(xr, cr), _mm256_mul_ps(xi, ci));
+							__m256 ti = _mm256_add_ps(_mm256_mul_ps(xr, ci), _mm256_mul_ps(xi, cr));
+							__m256 yr = _mm256_loadu_ps(ar + k), yi = _mm256_loadu_ps(ai + k);
+							_mm256_storeu_ps(ar + k, _mm256_add_ps(yr, tr));
+							_mm256_storeu_ps(ai + k, _mm256_add_ps(yi, ti));
+							_mm256_storeu_ps(br + k, _mm256_sub_ps(yr, tr));
+							_mm256_storeu_ps(bi + k, _mm256_sub_ps(yi, ti));
+						}
+#elif HB_ANALYSIS_SSE2
+						for (; k + 4 <= half; k += 4) {
+							__m128 xr = _mm_loadu_ps(br + k), xi = _mm_loadu_ps(bi + k);
+							__m128 cr = _mm_loadu_ps(wr + k), ci = _mm_loadu_ps(wi + k);
+							__m128 tr = _mm_sub_ps(_mm_mul_ps(xr, cr), _mm_mul_ps(xi, ci));
+							__m128 ti = _mm_add_ps(_mm_mul_ps(xr, ci), _mm_mul_ps(xi, cr));
+							__m128 yr = _mm_loadu_ps(ar + k), yi = _mm_loadu_ps(ai + k);
+							_mm_storeu_ps(ar + k, _mm_add_ps(yr, tr));
+							_mm_storeu_ps(ai + k, _mm_add_ps(yi, ti));
+							_mm_storeu_ps(br + k, _mm_sub_ps(yr, tr));
+							_mm_storeu_ps(bi + k, _mm_sub_ps(yi, ti));
+						}
+#endif
+						for (; k < half; ++k) {
+							float tr = br[k] * wr[k] - bi[k] * wi[k];
+							float ti = br[k] * wi[k] + bi[k] * wr[k];
+							br[k] = ar[k] - tr;
+							bi[k] = ai[k] - ti;
+							ar[k] += tr;
+							ai[k] += ti;
+						}
+					}
+				}
+			}
+		private:
+			static std::uint32_t reverseBits(std::uint32_t value) {
+				value = ((value >> 1) & 0x55555555u) | ((value & 0x55555555u) << 1);
+				value = ((value >> 2) & 0x33333333u) | ((value & 0x33333333u) << 2);
+				value = ((value >> 4) & 0x0F0F0F0Fu) | ((value & 0x0F0F0F0Fu) << 4);
+				value = ((value >> 8) & 0x00FF00FFu) | ((value & 0x00FF00FFu) << 8);
+				return (value >> 16) | (value << 16);
+			}
+
+			std::uint32_t mSize;
+			std::vector<std::uint32_t> mReverse;
+			std::vector<float> mTwiddleReal, mTwiddleImaginary;
+		};
+
+		// The rectified rise from one compressed spectrum to the next, and the same weighted by each band's position on a
+		// log frequency scale.
+		void flux(float const* previous, float const* current, float const* weights, std::size_t bands, float& total, float& weighted) {
+			std::size_t k = 0;
+			total = 0.0f;
+			weighted = 0.0f;
+#if HB_ANALYSIS_AVX2
+			__m256 sum = _mm256_setzero_ps(), weightedSum = _mm256_setzero_ps(), zero = _mm256_setzero_ps();
+			for (; k + 8 <= bands; k += 8) {
+				__m256 rise = _mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(current + k), _mm256_loadu_ps(previous + k)), zero);
+				sum = _mm256_add_ps(sum, rise);
+				weightedSum = _mm256_add_ps(weightedSum, _mm256_mul_ps(rise, _mm256_loadu_ps(weights + k)));
+			}
+			alignas(32) float lanes[8];
+			_mm256_store_ps(lanes, sum);
+			for (float lane : lanes) total += lane;
+			_mm256_store_ps(lanes, weightedSum);
+			for (float lane : lanes) weighted += lane;
+#elif HB_ANALYSIS_SSE2
+			__m128 sum = _mm_setzero_ps(), weightedSum = _mm_setzero_ps(), zero = _mm_setzero_ps();
+			for (; k + 4 <= bands; k += 4) {
+				__m128 rise = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(current + k), _mm_loadu_ps(previous + k)), zero);
+				sum = _mm_add_ps(sum, rise);
+				weightedSum = _mm_add_ps(weightedSum, _mm_mul_ps(rise, _mm_loadu_ps(weights + k)));
+			}
+			alignas(16) float lanes[4];
+			_mm_store_ps(lanes, sum);
+			for (float lane : lanes) total += lane;
+			_mm_store_ps(lanes, weightedSum);
+			for (float lane : lanes) weighted += lane;
+#endif
+			for (; k < bands; ++k) {
+				float rise = std::max(current[k] - previous[k], 0.0f);
+				total += rise;
+				weighted += rise * weights[k];
+			}
+		}
+
+		float dot(float const* a, float const* b, std::size_t count) {
+			std::size_t i = 0;
+			float result = 0.0f;
+#if HB_ANALYSIS_AVX2
+			__m256 x = _mm256_setzero_ps(), y = _mm256_setzero_ps();
+			for (; i + 16 <= count; i += 16) {
+				x = _mm256_add_ps(x, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+				y = _mm256_add_ps(y, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+			}
+			alignas(32) float lanes[8];
+			_mm256_store_ps(lanes, _mm256_add_ps(x, y));
+			for (float lane : lanes) result += lane;
+#elif HB_ANALYSIS_SSE2
+			__m128 x = _mm_setzero_ps(), y = _mm_setzero_ps();
+			for (; i + 8 <= count; i += 8) {
+				x = _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+				y = _mm_add_ps(y, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+			}
+			alignas(16) float lanes[4];
+			_mm_store_ps(lanes, _mm_add_ps(x, y));
+			for (float lane : lanes) result += lane;
+#endif
+			for (; i < count; ++i)
+				result += a[i] * b[i];
+			return result;
+		}
+
+		// Linear interpolation, zero outside.
+		inline double sampleAt(std::vector<float> const& values, double position) {
+			if (position < 0.0) return 0.0;
+			std::size_t index = static_cast<std::size_t>(position);
+			if (index + 1 >= values.size()) return index < values.size() ? values[index] : 0.0;
+			double t = position - static_cast<double>(index);
+			return values[index] * (1.0 - t) + values[index + 1] * t;
+		}
+
+		double seconds(std::int64_t begin) {
+			return nanosecondsToSeconds(now() - begin);
+		}
+
+		// Bins summed into bands a fixed fraction of an octave wide, so broadband noise like hats doesn't outweigh a kick
+		// only for covering more bins. Low bands that would be narrower than a bin merge.
+		struct Bands final {
+			Bands(std::uint32_t size, std::uint32_t sampleRate) : of(size / 2) {
+				int previous = -1;
+				for (std::uint32_t k = 1; k < size / 2; ++k) {
+					double hz = static_cast<double>(k) * sampleRate / size;
+					int band = std::max(0, static_cast<int>(std::floor(kBandsPerOctave * std::log2(hz / kLowestBand))));
+					if (band != previous) {
+						previous = band;
+						++count;
+					}
+					of[k] = count - 1;
+				}
+
+				// Where a band lies on a log frequency scale, for the pitch of an onset.
+				for (std::uint32_t band = 0; band < count; ++band)
+					weights.push_back(count > 1 ? static_cast<float>(band) / static_cast<float>(count - 1) : 0.0f);
+			}
+
+			std::vector<std::uint32_t> of; // by bin, the DC bin goes with the lowest band
+			std::vector<float> weights;
+			std::uint32_t count = 0;
+		};
+
+		// Computes the flux of every spectrum in a block into `novelty` and `pitch`.
+		class SpectrumBlock final {
+		public:
+			SpectrumBlock(Fft const& fft, std::vector<float> const& window, Bands const& bands, std::size_t hop)
+				: mFft(fft), mWindow(window), mBands(bands), mHop(hop), mReal(window.size()), mImaginary(window.size()),
+				mPrevious(bands.count), mFirst(bands.count), mSecond(bands.count) {}
+
+			void run(std::vector<float> const& samples, std::size_t first, std::size_t last, float* novelty, float* pitch) {
+				std::size_t frame = first;
+				if (frame == 0) {
+					// Nothing to rise from, the first spectrum only sets the baseline.
+					spectra(samples, 0, mPrevious.data(), nullptr);
+					novelty[0] = pitch[0] = 0.0f;
+					++frame;
+				}
+				else
+					spectra(samples, frame - 1, mPrevious.data(), nullptr);
+
+				// Two real frames share one complex transform, one as the real part and one as the imaginary.
+				for (; frame + 1 < last; frame += 2) {
+					spectra(samples, frame, mFirst.data(), mSecond.data());
+					store(mPrevious, mFirst, novelty[frame], pitch[frame]);
+					store(mFirst, mSecond, novelty[frame + 1], pitch[frame + 1]);
+					std::swap(mPrevious, mSecond);
+				}
+				if (frame < last) {
+					spectra(samples, frame, mFirst.data(), nullptr);
+					store(mPrevious, mFirst, novelty[frame], pitch[frame]);
+				}
+			}
+		private:
+			// Compressed magnitudes of `frame` into `first`, and of the frame after into `second` unless it is null.
+			void spectra(std::vector<float> const& samples, std::size_t frame, float* first, float* second) {
+				std::size_t size = mWindow.size();
+				float const* a = samples.data() + frame * mHop;
+				float const* b = second ? a + mHop : nullptr;
+				for (std::size_t n = 0; n < size; ++n) {
+					mReal[n] = a[n] * mWindow[n];
+					mImaginary[n] = b ? b[n] * mWindow[n] : 0.0f;
+				}
+
+				mFft.transform(mReal.data(), mImaginary.data());
+
+				std::fill_n(first, mBands.count, 0.0f);
+				if (second)
+					std::fill_n(second, mBands.count, 0.0f);
+
+				// With z = x + iy, X[k] = (Z[k] + conj(Z[N - k])) / 2 and Y[k] = (Z[k] - conj(Z[N - k])) / 2i.
+				for (std::size_t k = 0; k < size / 2; ++k) {
+					std::size_t mirror = (size - k) & (size - 1);
+					float xr = mReal[k] + mReal[mirror], xi = mImaginary[k] - mImaginary[mirror];
+					first[mBands.of[k]] += 0.5f * std::sqrt(xr * xr + xi * xi);
+					if (second) {
+						float yr = mImaginary[k] + mImaginary[mirror], yi = mReal[k] - mReal[mirror];
+						second[mBands.of[k]] += 0.5f * std::sqrt(yr * yr + yi * yi);
+					}
+				}
+
+				for (std::uint32_t band = 0; band < mBands.count; ++band) {
+					first[band] = std::log1p(kCompression * first[band]);
+					if (second)
+						second[band] = std::log1p(kCompression * second[band]);
+				}
+			}
+
+			void store(std::vector<float> const& previous, std::vector<float> const& current, float& novelty, float& pitch) {
+				float total, weighted;
+				flux(previous.data(), current.data(), mBands.weights.data(), current.size(), total, weighted);
+				novelty = total;
+				pitch = total > 0.0f ? weighted / total : 0.0f;
+			}
+
+			Fft const& mFft;
+			std::vector<float> const& mWindow;
+			Bands const& mBands;
+			std::size_t mHop;
+			std::vector<float> mReal, mImaginary;
+			std::vector<float> mPrevious, mFirst, mSecond;
+		};
+	}
+
+	MonoAudio decodeMono(std::span<std::byte const> ogg, JobSystem* jobs) {
+		MonoAudio audio;
+		{
+			Vorbis vorbis = openVorbis(ogg);
+			audio.sampleRate = stb_vorbis_get_info(vorbis.get()).sample_rate;
+			audio.samples.resize(stb_vorbis_stream_length_in_samples(vorbis.get()));
+		}
+
+		forBlocks(jobs, audio.samples.size(), kDecodeBlockSamples, [&](std::size_t first, std::size_t last) {
+			decodeBlock(ogg, static_cast<std::uint32_t>(first), audio.samples.data() + first, last - first);
+		});
+		return audio;
+	}
+
+	BeatAnalysis analyzeBeats(MonoAudio const& audio, JobSystem* jobs, AnalysisOptions const& options) {
+		std::uint32_t size = options.frameSize;
+		if (size < 64 || !std::has_single_bit(size))
+			throw AnalysisError("Frame size must be a power of two of at least 64");
+		if (audio.sampleRate == 0)
+			throw AnalysisError("No sample rate");
+
+		BeatAnalysis analysis;
+		std::size_t hop = std::max<std::size_t>(1, static_cast<std::size_t>(std::lround(options.hopSeconds * audio.sampleRate)));
+		analysis.hopSeconds = static_cast<double>(hop) / audio.sampleRate;
+		analysis.frameOffset = static_cast<double>(size) * 0.5 / audio.sampleRate;
+
+		std::size_t frames = audio.samples.size() >= size ? (audio.samples.size() - size) / hop + 1 : 0;
+		std::size_t minLag = static_cast<std::size_t>(std::floor(60.0 / options.maxBpm / analysis.hopSeconds));
+		std::size_t maxLag = static_cast<std::size_t>(std::ceil(60.0 / options.minBpm / analysis.hopSeconds));
+		if (minLag < 2 || minLag >= maxLag)
+			throw AnalysisError("Tempo range doesn't fit the hop");
+		if (frames < 2 * maxLag)
+			throw AnalysisError("Too short to find a tempo");
+
+		// Spectra.
+		std::int64_t begin = now();
+		Fft fft(size);
+		Bands bands(size, audio.sampleRate);
+		std::vector<float> window(size);
+		for (std::uint32_t n = 0; n < size; ++n)
+			window[n] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * std::numbers::pi * n / size));
+
+		std::vector<float> flux(frames), pitch(frames);
+		forBlocks(jobs, frames, kSpectrumBlockFrames, [&](std::size_t first, std::size_t last) {
+			SpectrumBlock block(fft, window, bands, hop);
+			block.run(audio.samples, first, last, flux.data(), pitch.data());
+		});
+
+		float largest = *std::max_element(flux.begin(), flux.end());
+		if (largest <= 0.0f)
+			throw AnalysisError("Silent");
+		for (float& value : flux)
+			value /= largest;
+		analysis.novelty = flux;
+
+		// The detection function: flux above its local average.
+		std::ptrdiff_t radius = std::max<std::ptrdiff_t>(1, std::lround(kLocalAverageSeconds / analysis.hopSeconds));
+		std::vector<double> prefix(frames + 1, 0.0);
+		for (std::size_t t = 0; t < frames; ++t)
+			prefix[t + 1] = prefix[t] + flux[t];
+		std::vector<float> detection(frames);
+		for (std::size_t t = 0; t < frames; ++t) {
+			std::size_t from = static_cast<std::size_t>(std::max<std::ptrdiff_t>(0, static_cast<std::ptrdiff_t>(t) - radius));
+			std::size_t to = std::min(frames, t + static_cast<std::size_t>(radius) + 1);
+			double average = (prefix[to] - prefix[from]) / static_cast<double>(to - from);
+			detection[t] = static_cast<float>(std::max(0.0, flux[t] - average));
+		}
+		analysis.timings.spectrum = seconds(begin);
+
+		// Tempo from the autocorrelation of the centered detection function, favouring tempos near the preferred one.
+		begin = now();
+		double mean = 0.0;
+		for (float value : detection)
+			mean += value;
+		mean /= static_cast<double>(frames);
+		std::vector<float> centered(frames);
+		for (std::size_t t = 0; t < frames; ++t)
+			centered[t] = detection[t] - static_cast<float>(mean);
+
+		std::size_t lags = std::min(frames - 1, kHarmonics * (maxLag + 1) + 2);
+		std::vector<float> correlation(lags);
+		forBlocks(jobs, lags, kLagBlock, [&](std::size_t first, std::size_t last) {
+			for (std::size_t lag = first; lag < last; ++lag)
+				correlation[lag] = dot(centered.data(), centered.data() + lag, frames - lag) / static_cast<float>(frames - lag);
+		});
+
+		auto bpmOf = [&](double period) { return 60.0 / (period * analysis.hopSeconds); };
+		std::size_t bestLag = minLag;
+		double bestScore = -1.0;
+		for (std::size_t lag = minLag; lag <= maxLag; ++lag) {
+			double octaves = std::log2(bpmOf(static_cast<double>(lag)) / options.preferredBpm) / kPriorOctaves;
+			double score = correlation[lag] * std::exp(-0.5 * octaves * octaves);
+			if (score > bestScore) {
+				bestScore = score;
+				bestLag = lag;
+			}
+		}
+
+		// Between whole lags, where the multiples of the period line up best.
+		double period = static_cast<double>(bestLag);
+		bestScore = -1e30;
+		for (double candidate = bestLag - 1.0; candidate <= bestLag + 1.0; candidate += kPeriodStep) {
+			double score = 0.0;
+			for (int harmonic = 1; harmonic <= kHarmonics && harmonic * candidate + 1.0 < static_cast<double>(lags); ++harmonic)
+				score += sampleAt(correlation, harmonic * candidate);
+			if (score > bestScore) {
+				bestScore = score;
+				period = candidate;
+			}
+		}
+		analysis.bpm = bpmOf(period);
+		analysis.confidence = correlation[0] > 0.0f ? std::clamp(correlation[bestLag] / correlation[0], 0.0f, 1.0f) : 0.0;
+
+		// The phase whose beats collect the most of the detection function.
+		double bestPhase = 0.0;
+		bestScore = -1.0;
+		for (double phase = 0.0; phase < period; phase += kPhaseStep) {
+			double score = 0.0;
+			for (double position = phase; position < static_cast<double>(frames); position += period)
+				score += sampleAt(detection, position);
+			if (score > bestScore) {
+				bestScore = score;
+				bestPhase = phase;
+			}
+		}
+		double beatSeconds = 60.0 / analysis.bpm;
+		analysis.offset = std::fmod(bestPhase * analysis.hopSeconds + analysis.frameOffset, beatSeconds);
+		analysis.timings.tempo = seconds(begin);
+
+		// Onsets at the peaks of the detection function.
+		begin = now();
+		float strongest = *std::max_element(detection.begin(), detection.end());
+		float threshold = static_cast<float>(options.onsetThreshold) * strongest;
+		std::ptrdiff_t gap = std::max<std::ptrdiff_t>(1, std::lround(options.minOnsetGap / analysis.hopSeconds));
+		std::ptrdiff_t last = -gap;
+		for (std::ptrdiff_t t = 0; t < static_cast<std::ptrdiff_t>(frames); ++t) {
+			float value = detection[t];
+			if (value <= threshold || t - last < gap) continue;
+
+			bool peak = true;
+			for (std::ptrdiff_t j = std::max<std::ptrdiff_t>(0, t - kPeakRadius); j <= std::min<std::ptrdiff_t>(frames - 1, t + kPeakRadius) && peak; ++j)
+				peak = j == t || detection[j] < value || (detection[j] == value && j > t);
+			if (!peak) continue;
+
+			analysis.onsets.push_back({ static_cast<double>(t) * analysis.hopSeconds + analysis.frameOffset, value / strongest, pitch[t] });
+			last = t;
+		}
+		analysis.timings.onsets = seconds(begin);
+
+		return analysis;
+	}
+
+	ChartSource makeStarterChart(BeatAnalysis const& analysis, std::string title, std::string audio, std::uint32_t lanes) {
+		ChartSource source;
+		source.title = std::move(title);
+		source.audio = std::move(audio);
+		source.author = "hbanalyze";
+		// Rounded to what an author would type, the notes are placed on the rounded grid.
+		source.bpm = std::round(analysis.bpm * 100.0) / 100.0;
+		source.offset = std::round(analysis.offset * 1000.0) / 1000.0;
+		source.lanes = std::clamp<std::uint32_t>(lanes, 1, 255);
+
+		ChartSourceSection& section = source.sections.emplace_back();
+		section.name = "analysis";
+		double beatSeconds = 60.0 / source.bpm;
+		double lastBeat = -1.0;
+		for (Onset const& onset : analysis.onsets) {
+			double beat = std::round((onset.time - source.offset) / beatSeconds * 4.0) / 4.0;
+			if (beat < 0.0 || beat <= lastBeat) continue;
+
+			ChartNote& note = section.notes.emplace_back();
+			note.beat = beat + 0.0; // an onset just before the offset rounds to -0
+			note.lane = static_cast<std::uint8_t>(std::min(source.lanes - 1, static_cast<std::uint32_t>(onset.pitch * static_cast<float>(source.lanes))));
+			lastBeat = beat;
+		}
+		return source;
+	}
+}
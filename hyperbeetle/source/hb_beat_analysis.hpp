@@ -0,0 +1,72 @@
+#pragma once
+
+#include "hb_chart_compiler.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace hyperbeetle {
+	class JobSystem;
+
+	class AnalysisError final : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	struct MonoAudio final {
+		std::vector<float> samples;
+		std::uint32_t sampleRate = 0;
+
+		inline double duration() const { return sampleRate ? static_cast<double>(samples.size()) / sampleRate : 0.0; }
+	};
+
+	// Decodes Ogg Vorbis and mixes it down to mono. With `jobs` every block of the song is decoded by its own decoder
+	// seeked to the block's start, in parallel. Throws AnalysisError.
+	MonoAudio decodeMono(std::span<std::byte const> ogg, JobSystem* jobs = nullptr);
+
+	struct AnalysisOptions final {
+		std::uint32_t frameSize = 1024; // samples per spectrum, a power of two
+		double hopSeconds = 0.01; // between spectra
+		double minBpm = 60.0;
+		double maxBpm = 200.0;
+		double preferredBpm = 120.0; // center of the tempo prior, which settles octave ambiguity
+		double onsetThreshold = 0.06; // of the strongest onset, above the local average
+		double minOnsetGap = 0.05; // seconds
+	};
+
+	struct Onset final {
+		double time = 0.0; // seconds
+		float strength = 0.0f; // 0 to 1
+		float pitch = 0.0f; // where the onset's energy rose on a log frequency scale, 0 to 1
+	};
+
+	struct BeatAnalysis final {
+		struct Timings final {
+			double spectrum = 0.0; // seconds
+			double tempo = 0.0;
+			double onsets = 0.0;
+		};
+
+		double bpm = 0.0;
+		double offset = 0.0; // seconds until the first beat
+		double confidence = 0.0; // autocorrelation at the beat period against the novelty's energy
+		std::vector<Onset> onsets;
+		// Spectral flux per hop, normalized to its largest value.
+		std::vector<float> novelty;
+		double hopSeconds = 0.0;
+		double frameOffset = 0.0; // seconds from a hop's start to the time its spectrum stands for
+		Timings timings;
+	};
+
+	// Spectral flux onset detection and tempo and beat phase estimation. The spectra are computed in parallel blocks
+	// with `jobs`, and so is the tempo's autocorrelation.
+	BeatAnalysis analyzeBeats(MonoAudio const& audio, JobSystem* jobs = nullptr, AnalysisOptions const& options = {});
+
+	// A chart to start authoring from: the tempo and offset found, and a tap on each onset snapped to sixteenths, in the
+	// lane its pitch falls in.
+	ChartSource makeStarterChart(BeatAnalysis const& analysis, std::string title, std::string audio, std::uint32_t lanes = 4);
+}
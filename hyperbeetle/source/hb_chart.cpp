@@ -0,0 +1,123 @@
+#include "hb_chart.hpp"
+
+#include "hb_chart_compiler.hpp"
+#include "hb_hash.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+namespace hyperbeetle {
+	namespace {
+		template<class T>
+		void validateTable(ChartTable const& table, std::size_t fileSize, char const* name) {
+			if (table.offset < sizeof(ChartHeader) || table.offset > fileSize || table.offset % alignof(T) != 0 || table.count > (fileSize - table.offset) / sizeof(T))
+				throw ChartError(std::string("Chart table '") + name + "' is out of bounds");
+		}
+	}
+
+	std::uint64_t chartChecksum(std::span<std::byte const> bytes) {
+		constexpr std::size_t kFirst = offsetof(ChartHeader, fileSize);
+		return hash64(bytes.data() + kFirst, bytes.size() - kFirst);
+	}
+
+	Chart Chart::open(std::filesystem::path const& path, bool verifyChecksum) {
+		Chart chart;
+		chart.mFile = MappedFile(path);
+		chart.mData = chart.mFile.data();
+		chart.mSize = chart.mFile.size();
+		chart.validate(verifyChecksum);
+		return chart;
+	}
+
+	Chart Chart::fromBytes(std::vector<std::byte> bytes, bool verifyChecksum) {
+		Chart chart;
+		chart.mOwned = std::move(bytes);
+		chart.mData = chart.mOwned.data();
+		chart.mSize = chart.mOwned.size();
+		chart.validate(verifyChecksum);
+		return chart;
+	}
+
+	Chart Chart::view(std::span<std::byte const> bytes, bool verifyChecksum) {
+		Chart chart;
+		chart.mData = bytes.data();
+		chart.mSize = bytes.size();
+		chart.validate(verifyChecksum);
+		return chart;
+	}
+
+	std::filesystem::path Chart::compiledPath(std::filesystem::path const& yamlPath) {
+		std::filesystem::path path = yamlPath;
+		path.replace_extension(".hbc");
+		return path;
+	}
+
+	Chart Chart::openSource(std::filesystem::path const& yamlPath) {
+		std::filesystem::path compiled = compiledPath(yamlPath);
+
+		std::error_code ec;
+		auto compiledTime = std::filesystem::last_write_time(compiled, ec);
+		bool stale = ec || compiledTime < std::filesystem::last_write_time(yamlPath);
+
+		if (!stale) {
+			try {
+				return open(compiled);
+			}
+			catch (ChartError const& e) {} // Written by another version, rebuild it
+		}
+
+		compileChartFile(yamlPath, compiled);
+		return open(compiled);
+	}
+
+	std::string_view Chart::string(std::uint32_t offset) const {
+		auto strings = table<char>(header().strings);
+		if (offset >= strings.size()) return {};
+		return strings.data() + offset;
+	}
+
+	void Chart::validate(bool verifyChecksum) const {
+		if (mSize < sizeof(ChartHeader))
+			throw ChartError("Chart is truncated");
+
+		ChartHeader const& h = header();
+
+		if (h.magic != kChartMagic)
+			throw ChartError("Not a compiled chart");
+
+		if (h.version != kChartVersion)
+			throw ChartError("Chart version " + std::to_string(h.version) + " is not supported, expected " + std::to_string(kChartVersion));
+
+		if (h.fileSize != mSize)
+			throw ChartError("Chart is truncated");
+
+		validateTable<ChartTime>(h.noteTime, mSize, "noteTime");
+		validateTable<ChartTime>(h.noteDuration, mSize, "noteDuration");
+		validateTable<std::uint8_t>(h.noteLane, mSize, "noteLane");
+		validateTable<NoteKind>(h.noteKind, mSize, "noteKind");
+		validateTable<ChartSection>(h.sections, mSize, "sections");
+		validateTable<ChartTime>(h.curveTime, mSize, "curveTime");
+		validateTable<float>(h.curveYaw, mSize, "curveYaw");
+		validateTable<float>(h.curvePitch, mSize, "curvePitch");
+		validateTable<char>(h.strings, mSize, "strings");
+
+		std::uint64_t notes = h.noteTime.count;
+		if (h.noteDuration.count != notes || h.noteLane.count != notes || h.noteKind.count != notes)
+			throw ChartError("Chart note tables differ in length");
+
+		std::uint64_t curvePoints = h.curveTime.count;
+		if (h.curveYaw.count != curvePoints || h.curvePitch.count != curvePoints)
+			throw ChartError("Chart curve tables differ in length");
+
+		if (h.strings.count == 0 || table<char>(h.strings).back() != '\0')
+			throw ChartError("Chart string table is not terminated");
+
+		for (auto const& section : sections()) {
+			if (std::uint64_t(section.firstNote) + section.noteCount > notes || std::uint64_t(section.firstCurvePoint) + section.curvePointCount > curvePoints)
+				throw ChartError("Chart section is out of bounds");
+		}
+
+		if (verifyChecksum && h.checksum != chartChecksum(bytes()))
+			throw ChartError("Chart checksum mismatch");
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "hb_mapped_file.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace hyperbeetle {
+	class ChartError final : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	// Microseconds from the start of the song audio.
+	using ChartTime = std::int64_t;
+
+	enum class NoteKind : std::uint8_t {
+		Tap,
+		Hold,
+		Obstacle,
+		Turn,
+	};
+
+	// Compiled chart layout. The file is used in place after mapping, so every table is an array of plain values at an
+	// aligned offset from the start of the file. Notes are sorted by time and stored as parallel arrays so gameplay can
+	// scan the columns it needs. Bump kChartVersion on any change.
+	inline constexpr std::array<char, 4> kChartMagic = { 'H', 'B', 'C', 'H' };
+	inline constexpr std::uint32_t kChartVersion = 2;
+	inline constexpr std::size_t kChartTableAlignment = 16;
+
+	struct ChartTable final {
+		std::uint64_t offset = 0;
+		std::uint64_t count = 0;
+	};
+
+	struct ChartHeader final {
+		std::array<char, 4> magic = kChartMagic;
+		std::uint32_t version = kChartVersion;
+		std::uint64_t checksum = 0; // chartChecksum of the file
+		std::uint64_t fileSize = 0;
+
+		double bpm = 0.0;
+		ChartTime offset = 0; // time of beat zero
+		ChartTime length = 0;
+		std::uint32_t lanes = 0;
+		std::uint32_t difficulty = 0;
+
+		// Offsets into the string table.
+		std::uint32_t title = 0, artist = 0, author = 0, audio = 0;
+
+		ChartTable noteTime; // ChartTime
+		ChartTable noteDuration; // ChartTime, zero unless the note is a hold
+		ChartTable noteLane; // std::uint8_t
+		ChartTable noteKind; // NoteKind
+		ChartTable sections; // ChartSection
+		ChartTable curveTime; // ChartTime
+		ChartTable curveYaw; // float, degrees
+		ChartTable curvePitch; // float, degrees
+		ChartTable strings; // char, NUL terminated UTF-8
+	};
+
+	struct ChartSection final {
+		ChartTime start = 0;
+		std::uint32_t name = 0;
+		std::uint32_t firstNote = 0, noteCount = 0;
+		std::uint32_t firstCurvePoint = 0, curvePointCount = 0;
+		std::uint32_t reserved = 0;
+	};
+
+	// hash64 of a compiled chart from the header field after the checksum to the end, so the header's values are covered
+	// along with the tables.
+	std::uint64_t chartChecksum(std::span<std::byte const> bytes);
+
+	// A validated compiled chart, mapped from disk, owning its bytes or viewing someone else's.
+	class Chart final {
+	public:
+		Chart() = default;
+
+		// Throws ChartError if the file is not a compiled chart of this version or fails validation.
+		// Skipping the checksum leaves only the structural checks, which don't read the tables.
+		static Chart open(std::filesystem::path const& path, bool verifyChecksum = true);
+		static Chart fromBytes(std::vector<std::byte> bytes, bool verifyChecksum = true);
+		// Uses bytes someone else owns in place, such as an asset pack's mapping. They must outlive the chart.
+		static Chart view(std::span<std::byte const> bytes, bool verifyChecksum = true);
+
+		// Opens the compiled chart next to a YAML chart, compiling it first if it is missing or older than the source.
+		static Chart openSource(std::filesystem::path const& yamlPath);
+		static std::filesystem::path compiledPath(std::filesystem::path const& yamlPath);
+
+		inline ChartHeader const& header() const { return *reinterpret_cast<ChartHeader const*>(mData); }
+		inline bool empty() const { return mData == nullptr; }
+		inline std::span<std::byte const> bytes() const { return { mData, mSize }; }
+
+		std::string_view string(std::uint32_t offset) const;
+		inline std::string_view title() const { return string(header().title); }
+		inline std::string_view artist() const { return string(header().artist); }
+		inline std::string_view author() const { return string(header().author); }
+		inline std::string_view audio() const { return string(header().audio); }
+
+		inline std::size_t noteCount() const { return header().noteTime.count; }
+		inline std::span<ChartTime const> noteTimes() const { return table<ChartTime>(header().noteTime); }
+		inline std::span<ChartTime const> noteDurations() const { return table<ChartTime>(header().noteDuration); }
+		inline std::span<std::uint8_t const> noteLanes() const { return table<std::uint8_t>(header().noteLane); }
+		inline std::span<NoteKind const> noteKinds() const { return table<NoteKind>(header().noteKind); }
+		inline std::span<ChartSection const> sections() const { return table<ChartSection>(header().sections); }
+		inline std::span<ChartTime const> curveTimes() const { return table<ChartTime>(header().curveTime); }
+		inline std::span<float const> curveYaw() const { return table<float>(header().curveYaw); }
+		inline std::span<float const> curvePitch() const { return table<float>(header().curvePitch); }
+	private:
+		template<class T>
+		inline std::span<T const> table(ChartTable const& table) const {
+			return { reinterpret_cast<T const*>(mData + table.offset), static_cast<std::size_t>(table.count) };
+		}
+
+		void validate(bool verifyChecksum) const;
+
+		MappedFile mFile;
+		std::vector<std::byte> mOwned;
+		std::byte const* mData = nullptr;
+		std::size_t mSize = 0;
+	};
+}
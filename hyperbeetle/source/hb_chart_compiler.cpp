@@ -0,0 +1,333 @@
+#include "hb_chart_compiler.hpp"
+
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <sstream>
+
+namespace hyperbeetle {
+	namespace {
+		NoteKind parseNoteKind(std::string const& str) {
+			if (str == "tap") return NoteKind::Tap;
+			if (str == "hold") return NoteKind::Hold;
+			if (str == "obstacle") return NoteKind::Obstacle;
+			if (str == "turn") return NoteKind::Turn;
+			throw ChartError("Unknown note kind '" + str + "'");
+		}
+
+		char const* noteKindName(NoteKind kind) {
+			switch (kind) {
+			case NoteKind::Tap: return "tap";
+			case NoteKind::Hold: return "hold";
+			case NoteKind::Obstacle: return "obstacle";
+			case NoteKind::Turn: return "turn";
+			default: return "?";
+			}
+		}
+
+		class ChartWriter final {
+		public:
+			ChartWriter() {
+				mBytes.resize(sizeof(ChartHeader));
+				mStrings.push_back('\0'); // Offset zero is the empty string
+			}
+
+			template<class T>
+			ChartTable append(std::span<T const> values) {
+				std::size_t offset = (mBytes.size() + kChartTableAlignment - 1) & ~(kChartTableAlignment - 1);
+				mBytes.resize(offset + values.size_bytes());
+				if (!values.empty())
+					std::memcpy(mBytes.data() + offset, values.data(), values.size_bytes());
+				return { offset, values.size() };
+			}
+
+			template<class T>
+			inline ChartTable append(std::vector<T> const& values) { return append(std::span<T const>(values)); }
+
+			std::uint32_t addString(std::string_view str) {
+				if (str.empty()) return 0;
+
+				std::uint32_t offset = static_cast<std::uint32_t>(mStrings.size());
+				mStrings.insert(mStrings.end(), str.begin(), str.end());
+				mStrings.push_back('\0');
+				return offset;
+			}
+
+			std::vector<std::byte> finish(ChartHeader header) {
+				header.strings = append(mStrings);
+				header.fileSize = mBytes.size();
+				std::memcpy(mBytes.data(), &header, sizeof(ChartHeader));
+
+				// The checksum covers the header after its own field.
+				header.checksum = chartChecksum(mBytes);
+				std::memcpy(mBytes.data(), &header, sizeof(ChartHeader));
+				return std::move(mBytes);
+			}
+		private:
+			std::vector<std::byte> mBytes;
+			std::vector<char> mStrings;
+		};
+	}
+
+	ChartTime ChartSource::beatToTime(double beat) const {
+		return static_cast<ChartTime>(std::llround((offset + beat * 60.0 / bpm) * 1e6));
+	}
+
+	ChartSourceSection parseChartSection(YAML::Node const& node) {
+		try {
+			ChartSourceSection section;
+			section.name = node["name"].as<std::string>("");
+			section.start = node["start"].as<double>(0.0);
+
+			if (YAML::Node notes = node["notes"]; notes && notes.IsSequence()) {
+				section.notes.reserve(notes.size());
+
+				for (YAML::Node const& entry : notes) {
+					ChartNote& note = section.notes.emplace_back();
+					note.beat = entry["beat"].as<double>();
+					note.length = entry["length"].as<double>(0.0);
+
+					int lane = entry["lane"].as<int>(0);
+					if (lane < 0 || lane > std::numeric_limits<std::uint8_t>::max())
+						throw ChartError("Lane " + std::to_string(lane) + " out of range in section '" + section.name + "'");
+					note.lane = static_cast<std::uint8_t>(lane);
+
+					if (YAML::Node kind = entry["kind"])
+						note.kind = parseNoteKind(kind.as<std::string>());
+					else if (note.length > 0.0)
+						note.kind = NoteKind::Hold;
+				}
+			}
+
+			if (YAML::Node curve = node["curve"]; curve && curve.IsSequence()) {
+				section.curve.reserve(curve.size());
+
+				for (YAML::Node const& entry : curve) {
+					ChartCurvePoint& point = section.curve.emplace_back();
+					point.beat = entry["beat"].as<double>();
+					point.yaw = entry["yaw"].as<float>(0.0f);
+					point.pitch = entry["pitch"].as<float>(0.0f);
+				}
+			}
+
+			return section;
+		}
+		catch (YAML::Exception const& e) {
+			throw ChartError(e.what());
+		}
+	}
+
+	ChartSource parseChartSource(YAML::Node const& node) {
+		try {
+			ChartSource source;
+			source.title = node["title"].as<std::string>("");
+			source.artist = node["artist"].as<std::string>("");
+			source.author = node["author"].as<std::string>("");
+			source.audio = node["audio"].as<std::string>("");
+			source.bpm = node["bpm"].as<double>(source.bpm);
+			source.offset = node["offset"].as<double>(source.offset);
+			source.lanes = node["lanes"].as<std::uint32_t>(source.lanes);
+			source.difficulty = node["difficulty"].as<std::uint32_t>(source.difficulty);
+
+			if (YAML::Node sections = node["sections"]; sections && sections.IsSequence()) {
+				source.sections.reserve(sections.size());
+				for (YAML::Node const& section : sections)
+					source.sections.push_back(parseChartSection(section));
+			}
+
+			return source;
+		}
+		catch (YAML::Exception const& e) {
+			throw ChartError(e.what());
+		}
+	}
+
+	ChartSource loadChartSource(std::filesystem::path const& path) {
+		try {
+			return parseChartSource(YAML::LoadFile(path.string()));
+		}
+		catch (YAML::Exception const& e) {
+			throw ChartError(path.string() + ": " + e.what());
+		}
+	}
+
+	std::string emitChartSource(ChartSource const& source) {
+		YAML::Emitter out;
+		out << YAML::BeginMap;
+		out << YAML::Key << "title" << YAML::Value << source.title;
+		out << YAML::Key << "artist" << YAML::Value << source.artist;
+		out << YAML::Key << "author" << YAML::Value << source.author;
+		out << YAML::Key << "audio" << YAML::Value << source.audio;
+		out << YAML::Key << "bpm" << YAML::Value << source.bpm;
+		out << YAML::Key << "offset" << YAML::Value << source.offset;
+		out << YAML::Key << "lanes" << YAML::Value << source.lanes;
+		out << YAML::Key << "difficulty" << YAML::Value << source.difficulty;
+
+		out << YAML::Key << "sections" << YAML::Value << YAML::BeginSeq;
+		for (auto const& section : source.sections) {
+			out << YAML::BeginMap;
+			out << YAML::Key << "name" << YAML::Value << section.name;
+			out << YAML::Key << "start" << YAML::Value << section.start;
+
+			// One note per line keeps charts diffable.
+			out << YAML::Key << "notes" << YAML::Value << YAML::BeginSeq;
+			for (auto const& note : section.notes) {
+				out << YAML::Flow << YAML::BeginMap;
+				out << YAML::Key << "beat" << YAML::Value << note.beat;
+				out << YAML::Key << "lane" << YAML::Value << static_cast<int>(note.lane);
+				if (note.kind != NoteKind::Tap) out << YAML::Key << "kind" << YAML::Value << noteKindName(note.kind);
+				if (note.length > 0.0) out << YAML::Key << "length" << YAML::Value << note.length;
+				out << YAML::EndMap;
+			}
+			out << YAML::EndSeq;
+
+			out << YAML::Key << "curve" << YAML::Value << YAML::BeginSeq;
+			for (auto const& point : section.curve) {
+				out << YAML::Flow << YAML::BeginMap;
+				out << YAML::Key << "beat" << YAML::Value << point.beat;
+				out << YAML::Key << "yaw" << YAML::Value << point.yaw;
+				out << YAML::Key << "pitch" << YAML::Value << point.pitch;
+				out << YAML::EndMap;
+			}
+			out << YAML::EndSeq;
+
+			out << YAML::EndMap;
+		}
+		out << YAML::EndSeq;
+
+		out << YAML::EndMap;
+		return out.c_str();
+	}
+
+	void saveChartSource(ChartSource const& source, std::filesystem::path const& path) {
+		std::ofstream file(path, std::ios::binary | std::ios::out | std::ios::trunc);
+		file << emitChartSource(source) << '\n';
+		if (!file)
+			throw ChartError("Failed to write " + path.string());
+	}
+
+	std::vector<std::byte> compileChart(ChartSource const& source) {
+		if (!(source.bpm > 0.0))
+			throw ChartError("bpm must be positive");
+
+		if (source.lanes == 0 || source.lanes > std::numeric_limits<std::uint8_t>::max())
+			throw ChartError("lanes must be between 1 and 255");
+
+		std::vector<ChartSourceSection const*> order;
+		order.reserve(source.sections.size());
+		for (auto const& section : source.sections)
+			order.push_back(&section);
+
+		std::stable_sort(order.begin(), order.end(), [](auto a, auto b) { return a->start < b->start; });
+
+		std::vector<ChartTime> noteTimes, noteDurations, curveTimes;
+		std::vector<std::uint8_t> noteLanes;
+		std::vector<NoteKind> noteKinds;
+		std::vector<float> curveYaw, curvePitch;
+		std::vector<ChartSection> sections;
+		std::vector<ChartNote> notes;
+		std::vector<ChartCurvePoint> curve;
+
+		ChartWriter writer;
+		ChartTime length = 0;
+
+		for (std::size_t i = 0; i < order.size(); ++i) {
+			ChartSourceSection const& sourceSection = *order[i];
+			double end = i + 1 < order.size() ? order[i + 1]->start : std::numeric_limits<double>::infinity();
+
+			auto outside = [&](double beat) {
+				return beat < 0.0 || sourceSection.start + beat >= end;
+			};
+
+			auto error = [&](char const* what, double beat) {
+				std::stringstream stream;
+				stream << what << " at beat " << beat << " lies outside section '" << sourceSection.name << '\'';
+				return ChartError(stream.str());
+			};
+
+			ChartSection& section = sections.emplace_back();
+			section.start = source.beatToTime(sourceSection.start);
+			section.name = writer.addString(sourceSection.name);
+			section.firstNote = static_cast<std::uint32_t>(noteTimes.size());
+			section.firstCurvePoint = static_cast<std::uint32_t>(curveTimes.size());
+
+			notes.assign(sourceSection.notes.begin(), sourceSection.notes.end());
+			std::stable_sort(notes.begin(), notes.end(), [](auto const& a, auto const& b) {
+				return a.beat < b.beat || (a.beat == b.beat && a.lane < b.lane);
+			});
+
+			for (auto const& note : notes) {
+				if (outside(note.beat)) throw error("Note", note.beat);
+				if (note.lane >= source.lanes) throw ChartError("Note lane " + std::to_string(note.lane) + " out of range in section '" + sourceSection.name + "'");
+
+				ChartTime time = source.beatToTime(sourceSection.start + note.beat);
+				ChartTime duration = note.kind == NoteKind::Hold ? source.beatToTime(sourceSection.start + note.beat + note.length) - time : 0;
+
+				noteTimes.push_back(time);
+				noteDurations.push_back(duration);
+				noteLanes.push_back(note.lane);
+				noteKinds.push_back(note.kind);
+				length = std::max(length, time + duration);
+			}
+
+			curve.assign(sourceSection.curve.begin(), sourceSection.curve.end());
+			std::stable_sort(curve.begin(), curve.end(), [](auto const& a, auto const& b) { return a.beat < b.beat; });
+
+			for (auto const& point : curve) {
+				if (outside(point.beat)) throw error("Curve point", point.beat);
+
+				ChartTime time = source.beatToTime(sourceSection.start + point.beat);
+				curveTimes.push_back(time);
+				curveYaw.push_back(point.yaw);
+				curvePitch.push_back(point.pitch);
+				length = std::max(length, time);
+			}
+
+			section.noteCount = static_cast<std::uint32_t>(noteTimes.size()) - section.firstNote;
+			section.curvePointCount = static_cast<std::uint32_t>(curveTimes.size()) - section.firstCurvePoint;
+		}
+
+		ChartHeader header;
+		header.bpm = source.bpm;
+		header.offset = source.beatToTime(0.0);
+		header.length = length;
+		header.lanes = source.lanes;
+		header.difficulty = source.difficulty;
+		header.title = writer.addString(source.title);
+		header.artist = writer.addString(source.artist);
+		header.author = writer.addString(source.author);
+		header.audio = writer.addString(source.audio);
+
+		header.noteTime = writer.append(noteTimes);
+		header.noteDuration = writer.append(noteDurations);
+		header.noteLane = writer.append(noteLanes);
+		header.noteKind = writer.append(noteKinds);
+		header.sections = writer.append(sections);
+		header.curveTime = writer.append(curveTimes);
+		header.curveYaw = writer.append(curveYaw);
+		header.curvePitch = writer.append(curvePitch);
+
+		return writer.finish(header);
+	}
+
+	void compileChartFile(std::filesystem::path const& yamlPath, std::filesystem::path const& outputPath) {
+		std::vector<std::byte> bytes = compileChart(loadChartSource(yamlPath));
+
+		std::filesystem::path temporaryPath = outputPath;
+		temporaryPath += ".tmp";
+
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::out | std::ios::trunc);
+			file.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+			if (!file)
+				throw ChartError("Failed to write " + temporaryPath.string());
+		}
+
+		std::filesystem::rename(temporaryPath, outputPath);
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "hb_chart.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace YAML { class Node; }
+
+namespace hyperbeetle {
+	// Authoring representation of a chart, as written in YAML:
+	//
+	//   title: ...            artist: ...          author: ...
+	//   audio: song.ogg       bpm: 128             offset: 0.25 (seconds until beat zero)
+	//   lanes: 4              difficulty: 3
+	//   sections:
+	//     - name: intro
+	//       start: 0          (beat)
+	//       notes:            (beats relative to the section start)
+	//         - { beat: 0, lane: 1 }
+	//         - { beat: 2, lane: 0, kind: hold, length: 1.5 }
+	//       curve:
+	//         - { beat: 0, yaw: 0, pitch: 0 }
+	//
+	// Notes and curve points must lie before the start of the next section.
+	struct ChartNote final {
+		double beat = 0.0;
+		double length = 0.0;
+		std::uint8_t lane = 0;
+		NoteKind kind = NoteKind::Tap;
+	};
+
+	struct ChartCurvePoint final {
+		double beat = 0.0;
+		float yaw = 0.0f;
+		float pitch = 0.0f;
+	};
+
+	struct ChartSourceSection final {
+		std::string name;
+		double start = 0.0;
+		std::vector<ChartNote> notes;
+		std::vector<ChartCurvePoint> curve;
+	};
+
+	struct ChartSource final {
+		std::string title, artist, author, audio;
+		double bpm = 120.0;
+		double offset = 0.0;
+		std::uint32_t lanes = 4;
+		std::uint32_t difficulty = 1;
+		std::vector<ChartSourceSection> sections;
+
+		ChartTime beatToTime(double beat) const;
+	};
+
+	// All of these throw ChartError with a description of what is wrong with the chart.
+	ChartSource parseChartSource(YAML::Node const& node);
+	ChartSource loadChartSource(std::filesystem::path const& path);
+	ChartSourceSection parseChartSection(YAML::Node const& node);
+
+	std::string emitChartSource(ChartSource const& source);
+	void saveChartSource(ChartSource const& source, std::filesystem::path const& path);
+
+	std::vector<std::byte> compileChart(ChartSource const& source);
+
+	// Writes through a temporary file so a reader never sees a partially written chart.
+	void compileChartFile(std::filesystem::path const& yamlPath, std::filesystem::path const& outputPath);
+}
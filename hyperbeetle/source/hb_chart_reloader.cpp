@@ -0,0 +1,186 @@
+#include "hb_chart_reloader.hpp"
+
+#include "hb_clock.hpp"
+#include "hb_hash.hpp"
+#include "hb_jobs.hpp"
+#include "hb_profiler.hpp"
+
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hyperbeetle {
+	namespace {
+		struct SplitChart final {
+			std::string head; // every line but the sections
+			std::vector<std::string_view> sections; // each a one entry block sequence
+		};
+
+		// Finds a top level `sections:` followed by a block sequence by its lines and indentation. Returns nothing if the
+		// sequence is written some other way.
+		std::optional<SplitChart> splitSections(std::string_view text) {
+			SplitChart split;
+
+			auto lineEnd = [&](std::size_t begin) {
+				std::size_t end = text.find('\n', begin);
+				return end == std::string_view::npos ? text.size() : end + 1;
+			};
+
+			std::size_t key = std::string_view::npos;
+			for (std::size_t begin = 0; begin < text.size(); begin = lineEnd(begin)) {
+				if (text.compare(begin, 9, "sections:") == 0) {
+					key = begin;
+					break;
+				}
+			}
+			if (key == std::string_view::npos) {
+				split.head = text;
+				return split;
+			}
+
+			std::size_t afterKey = lineEnd(key);
+			std::string_view rest = text.substr(key + 9, afterKey - key - 9);
+			std::size_t value = rest.find_first_not_of(" \t\r\n");
+			if (value != std::string_view::npos && rest[value] != '#')
+				return std::nullopt;
+
+			std::size_t indent = std::string_view::npos; // of the entries' dashes
+			std::size_t piece = std::string_view::npos, end = afterKey;
+			for (std::size_t begin = afterKey; begin < text.size(); begin = lineEnd(begin)) {
+				std::string_view line = text.substr(begin, lineEnd(begin) - begin);
+				std::size_t column = line.find_first_not_of(' ');
+				if (column == std::string_view::npos || line[column] == '\r' || line[column] == '\n' || line[column] == '#') {
+					end = lineEnd(begin);
+					continue;
+				}
+				if (line[column] == '\t')
+					return std::nullopt;
+
+				bool entry = line[column] == '-' && (column + 1 == line.size() || line[column + 1] == ' ' || line[column + 1] == '\r' || line[column + 1] == '\n');
+				if (indent == std::string_view::npos) {
+					if (!entry) break;
+					indent = column;
+				}
+
+				if (column < indent || (column == indent && !entry))
+					break;
+
+				if (column == indent) {
+					if (piece != std::string_view::npos)
+						split.sections.push_back(text.substr(piece, begin - piece));
+					piece = begin;
+				}
+				end = lineEnd(begin);
+			}
+			if (piece != std::string_view::npos)
+				split.sections.push_back(text.substr(piece, end - piece));
+
+			split.head.reserve(text.size() - (end - key));
+			split.head.append(text.substr(0, key));
+			split.head.append(text.substr(end));
+			return split;
+		}
+	}
+
+	std::shared_ptr<Chart const> ChartReloader::load(JobSystem* jobs) {
+		HB_PROFILE_ZONE("chart.reload");
+		std::int64_t begin = now();
+
+		std::string text;
+		{
+			std::ifstream file(mPath, std::ios::binary);
+			if (!file)
+				throw ChartError("Failed to read " + mPath.string());
+			text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+
+		Stats stats;
+		ChartSource source;
+		std::unordered_map<std::uint64_t, ChartSourceSection> sections;
+		std::shared_ptr<Chart const> chart;
+
+		try {
+			std::optional<SplitChart> split = splitSections(text);
+			if (split) {
+				YAML::Node head = YAML::Load(split->head);
+				if (!head.IsMap() || head["sections"])
+					split.reset();
+				else
+					source = parseChartSource(head);
+			}
+
+			if (split) {
+				std::vector<std::uint64_t> hashes(split->sections.size());
+				std::vector<std::size_t> changed;
+				for (std::size_t i = 0; i < hashes.size(); ++i) {
+					hashes[i] = hash64(split->sections[i]);
+					if (!mSections.contains(hashes[i]))
+						changed.push_back(i);
+				}
+
+				// A piece that isn't a section on its own, an alias to another one say, makes the whole chart parse instead.
+				std::vector<std::optional<ChartSourceSection>> parsed(changed.size());
+				std::atomic_bool failed = false;
+				forBlocks(jobs, changed.size(), 1, [&](std::size_t first, std::size_t last) {
+					for (std::size_t i = first; i < last && !failed.load(std::memory_order_relaxed); ++i) {
+						try {
+							YAML::Node node = YAML::Load(std::string(split->sections[changed[i]]));
+							if (!node.IsSequence() || node.size() != 1)
+								failed = true;
+							else
+								parsed[i] = parseChartSection(node[0]);
+						}
+						catch (std::exception const&) {
+							failed = true;
+						}
+					}
+				});
+
+				if (failed)
+					split.reset();
+				else {
+					for (std::size_t i = 0; i < changed.size(); ++i)
+						sections.try_emplace(hashes[changed[i]], std::move(*parsed[i]));
+
+					source.sections.reserve(hashes.size());
+					for (std::uint64_t hash : hashes) {
+						auto reused = sections.find(hash);
+						if (reused == sections.end())
+							reused = sections.emplace(hash, mSections.at(hash)).first;
+						source.sections.push_back(reused->second);
+					}
+					stats.sections = hashes.size();
+					stats.parsed = changed.size();
+				}
+			}
+
+			if (!split) {
+				source = parseChartSource(YAML::Load(text));
+				sections.clear();
+				stats.whole = true;
+				stats.sections = stats.parsed = source.sections.size();
+			}
+
+			chart = std::make_shared<Chart const>(Chart::fromBytes(compileChart(source), false));
+		}
+		catch (YAML::Exception const& e) {
+			throw ChartError(mPath.string() + ": " + e.what());
+		}
+		catch (ChartError const& e) {
+			throw ChartError(mPath.string() + ": " + e.what());
+		}
+
+		// Only once the chart compiled, a broken edit keeps the sections of the last good load.
+		mSections = std::move(sections);
+		stats.seconds = nanosecondsToSeconds(now() - begin);
+		mStats = stats;
+		return chart;
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "hb_chart.hpp"
+#include "hb_chart_compiler.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+
+namespace hyperbeetle {
+	class JobSystem;
+
+	// Loads a YAML chart again and again while it is being edited, parsing only the sections whose text changed.
+	// The text is split into the top level fields and one piece per entry of `sections`, and each piece is parsed on its
+	// own. That skips most of the YAML parser, which is where loading a long chart spends its time. A chart the split
+	// doesn't understand, say one with a flow style `sections` or aliases between sections, is parsed whole.
+	class ChartReloader final {
+	public:
+		struct Stats final {
+			std::size_t sections = 0;
+			std::size_t parsed = 0; // the rest were unchanged since the last load
+			bool whole = false; // couldn't be split, parsed as one document
+			double seconds = 0.0; // reading, parsing and compiling
+		};
+
+		explicit ChartReloader(std::filesystem::path path) : mPath(std::move(path)) {}
+
+		// One load at a time. Changed sections are parsed on `jobs` if there are any. Throws ChartError.
+		std::shared_ptr<Chart const> load(JobSystem* jobs = nullptr);
+
+		inline std::filesystem::path const& path() const { return mPath; }
+		inline Stats const& lastLoad() const { return mStats; }
+	private:
+		std::filesystem::path mPath;
+		std::unordered_map<std::uint64_t, ChartSourceSection> mSections; // the last load's, by hash64 of their text
+		Stats mStats;
+	};
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace hyperbeetle {
+	using Clock = std::chrono::steady_clock;
+
+	// Nanoseconds on the monotonic clock. Every timestamp in the game uses this so they compare across threads.
+	inline std::int64_t now() noexcept {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+	}
+
+	inline constexpr double nanosecondsToSeconds(std::int64_t ns) noexcept {
+		return static_cast<double>(ns) * 1e-9;
+	}
+}
@@ -0,0 +1,105 @@
+#include "hb_config.hpp"
+
+#include "hb_hash.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace hyperbeetle {
+	YAML::Node loadConfig(std::filesystem::path const& path) {
+		try {
+			return YAML::LoadFile(path.string());
+		}
+		catch (YAML::BadFile const& e) {}
+
+		return YAML::Node();
+	}
+
+	void ConfigWriter::start() {
+		if (mThread.joinable()) return;
+		mThread = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+	}
+
+	void ConfigWriter::stop() {
+		if (!mThread.joinable()) return;
+		mThread.request_stop();
+		mThread.join();
+
+		std::unique_lock lock(mMutex);
+		if (mPending)
+			flush(lock);
+	}
+
+	void ConfigWriter::write(YAML::Node const& config) {
+		{
+			std::lock_guard lock(mMutex);
+			mPending = YAML::Clone(config);
+		}
+		mWake.notify_one();
+	}
+
+	std::uint64_t ConfigWriter::writes() const {
+		std::lock_guard lock(mMutex);
+		return mWrites;
+	}
+
+	std::uint64_t ConfigWriter::lastWrite() const {
+		std::lock_guard lock(mMutex);
+		return mLastWrite;
+	}
+
+	void ConfigWriter::flush(std::unique_lock<std::mutex>& lock) {
+		YAML::Node config = std::move(*mPending);
+		mPending.reset();
+		lock.unlock();
+
+		std::filesystem::path temporaryPath = mPath;
+		temporaryPath += ".tmp";
+
+		YAML::Emitter emitter;
+		emitter << config;
+		std::string text = emitter.c_str();
+
+		bool written;
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::out | std::ios::trunc);
+			file << text;
+			written = static_cast<bool>(file);
+		}
+
+		// Before the rename, which is what a watcher sees.
+		if (written) {
+			lock.lock();
+			mLastWrite = hash64(text);
+			lock.unlock();
+		}
+
+		std::error_code error;
+		if (written)
+			std::filesystem::rename(temporaryPath, mPath, error);
+
+		bool failed = !written || error;
+		if (failed)
+			std::cout << "Failed to write " << mPath.string() << std::endl;
+
+		lock.lock();
+		if (!failed) ++mWrites;
+	}
+
+	void ConfigWriter::run(std::stop_token stopToken) {
+		std::unique_lock lock(mMutex);
+
+		for (;;) {
+			if (!mWake.wait(lock, stopToken, [this]() { return mPending.has_value(); }))
+				break;
+
+			// Let a burst of changes settle, `stop` flushes whatever is left.
+			mWake.wait_for(lock, stopToken, kCoalesceDelay, []() { return false; });
+			if (stopToken.stop_requested())
+				break;
+
+			flush(lock);
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <yaml-cpp/yaml.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+namespace hyperbeetle {
+	// An empty node if the file doesn't exist.
+	YAML::Node loadConfig(std::filesystem::path const& path);
+
+	// Saves the config from a background thread so changing a setting never waits on the filesystem.
+	// Writes that arrive close together are coalesced into one, and the file is replaced through a temporary so a crash
+	// mid-write can't leave it truncated.
+	class ConfigWriter final {
+	public:
+		static constexpr std::chrono::milliseconds kCoalesceDelay{ 250 };
+
+		explicit ConfigWriter(std::filesystem::path path) : mPath(std::move(path)) {}
+		ConfigWriter(ConfigWriter const&) = delete;
+		ConfigWriter& operator=(ConfigWriter const&) = delete;
+		~ConfigWriter() noexcept { stop(); }
+
+		void start();
+		// Flushes a pending write.
+		void stop();
+
+		// Any thread. Takes a deep copy, `config` can be modified right after.
+		void write(YAML::Node const& config);
+
+		std::uint64_t writes() const;
+		// hash64 of the text last written, to tell the writer's own changes to the file from anyone else's.
+		std::uint64_t lastWrite() const;
+	private:
+		void run(std::stop_token stopToken);
+		void flush(std::unique_lock<std::mutex>& lock);
+
+		std::filesystem::path mPath;
+
+		mutable std::mutex mMutex;
+		std::condition_variable_any mWake;
+		std::optional<YAML::Node> mPending;
+		std::uint64_t mWrites = 0;
+		std::uint64_t mLastWrite = 0;
+
+		std::jthread mThread;
+	};
+}
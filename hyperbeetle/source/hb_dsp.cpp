@@ -0,0 +1,332 @@
+#include "hb_dsp.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#if defined(__AVX2__)
+#	define HB_DSP_AVX2 1
+#	include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#	define HB_DSP_SSE2 1
+#	include <emmintrin.h>
+#endif
+
+#if defined(__SSE__) || defined(_M_X64)
+#	include <xmmintrin.h>
+#	define HB_DSP_MXCSR 1
+#endif
+
+namespace hyperbeetle::dsp {
+	namespace {
+		inline void biquadStep(Biquad const& c, BiquadState& s, float& sample) {
+			float x = sample;
+			float y = c.b0 * x + s.s1;
+			s.s1 = c.b1 * x - c.a1 * y + s.s2;
+			s.s2 = c.b2 * x - c.a2 * y;
+			sample = y;
+		}
+
+		// Channel counts whose frames tile a vector of `lanes` floats, so every lane keeps the same frame offset.
+		inline bool tiles(std::uint32_t channels, std::uint32_t lanes) {
+			return channels != 0 && channels <= lanes && lanes % channels == 0;
+		}
+
+#if HB_DSP_AVX2
+		inline __m256 madd(__m256 a, __m256 b, __m256 c) {
+#	if defined(__FMA__)
+			return _mm256_fmadd_ps(a, b, c);
+#	else
+			return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#	endif
+		}
+
+		// One block of one channel: outputs in lanes 0 to 3 and the next state in lanes 4 and 5. The inputs don't
+		// depend on the previous block, only the last additions wait for the state.
+		inline __m256 biquadBlock(__m256 const* columns, __m256 s1, __m256 s2, float const* x, std::uint32_t stride) {
+			__m256 u = madd(_mm256_broadcast_ss(x), columns[2], _mm256_mul_ps(_mm256_broadcast_ss(x + stride), columns[3]));
+			__m256 v = madd(_mm256_broadcast_ss(x + 2 * stride), columns[4], _mm256_mul_ps(_mm256_broadcast_ss(x + 3 * stride), columns[5]));
+			return madd(s1, columns[0], madd(s2, columns[1], _mm256_add_ps(u, v)));
+		}
+
+		inline void storeBlock(__m256 y, float* x, std::uint32_t stride) {
+			if (stride == 1) {
+				_mm_storeu_ps(x, _mm256_castps256_ps128(y));
+				return;
+			}
+			alignas(32) float lanes[8];
+			_mm256_store_ps(lanes, y);
+			x[0] = lanes[0];
+			x[stride] = lanes[1];
+			x[2 * stride] = lanes[2];
+			x[3 * stride] = lanes[3];
+		}
+
+		// Two channels at once when there is a pair, their chains are independent and overlap.
+		template<bool Pair>
+		void biquadChannels(BiquadBlock const& block, BiquadState* states, float* samples, std::size_t blocks, std::uint32_t channels) {
+			__m256 columns[6];
+			for (int i = 0; i < 6; ++i)
+				columns[i] = _mm256_load_ps(block.columns[i]);
+			__m256i const s1Lane = _mm256_set1_epi32(4), s2Lane = _mm256_set1_epi32(5);
+
+			__m256 s1a = _mm256_set1_ps(states[0].s1), s2a = _mm256_set1_ps(states[0].s2);
+			__m256 s1b = _mm256_setzero_ps(), s2b = _mm256_setzero_ps();
+			if constexpr (Pair) {
+				s1b = _mm256_set1_ps(states[1].s1);
+				s2b = _mm256_set1_ps(states[1].s2);
+			}
+
+			for (std::size_t b = 0; b < blocks; ++b) {
+				float* x = samples + b * 4 * channels;
+				__m256 ya = biquadBlock(columns, s1a, s2a, x, channels);
+				s1a = _mm256_permutevar8x32_ps(ya, s1Lane);
+				s2a = _mm256_permutevar8x32_ps(ya, s2Lane);
+				if constexpr (Pair) {
+					__m256 yb = biquadBlock(columns, s1b, s2b, x + 1, channels);
+					s1b = _mm256_permutevar8x32_ps(yb, s1Lane);
+					s2b = _mm256_permutevar8x32_ps(yb, s2Lane);
+					storeBlock(yb, x + 1, channels);
+				}
+				storeBlock(ya, x, channels);
+			}
+
+			states[0] = { _mm256_cvtss_f32(s1a), _mm256_cvtss_f32(s2a) };
+			if constexpr (Pair)
+				states[1] = { _mm256_cvtss_f32(s1b), _mm256_cvtss_f32(s2b) };
+		}
+#elif HB_DSP_SSE2
+		// The AVX2 block split in two: outputs in `y` and the next state in the first two lanes of `s`.
+		inline void biquadBlock(__m128 const* outputs, __m128 const* nextState, __m128 s1, __m128 s2, float const* x, std::uint32_t stride, __m128& y, __m128& s) {
+			__m128 x0 = _mm_set1_ps(x[0]), x1 = _mm_set1_ps(x[stride]), x2 = _mm_set1_ps(x[2 * stride]), x3 = _mm_set1_ps(x[3 * stride]);
+			y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s1, outputs[0]), _mm_mul_ps(s2, outputs[1])),
+				_mm_add_ps(_mm_add_ps(_mm_mul_ps(x0, outputs[2]), _mm_mul_ps(x1, outputs[3])), _mm_add_ps(_mm_mul_ps(x2, outputs[4]), _mm_mul_ps(x3, outputs[5]))));
+			s = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s1, nextState[0]), _mm_mul_ps(s2, nextState[1])),
+				_mm_add_ps(_mm_add_ps(_mm_mul_ps(x0, nextState[2]), _mm_mul_ps(x1, nextState[3])), _mm_add_ps(_mm_mul_ps(x2, nextState[4]), _mm_mul_ps(x3, nextState[5]))));
+		}
+
+		inline void storeBlock(__m128 y, float* x, std::uint32_t stride) {
+			if (stride == 1) {
+				_mm_storeu_ps(x, y);
+				return;
+			}
+			alignas(16) float lanes[4];
+			_mm_store_ps(lanes, y);
+			x[0] = lanes[0];
+			x[stride] = lanes[1];
+			x[2 * stride] = lanes[2];
+			x[3 * stride] = lanes[3];
+		}
+
+		template<bool Pair>
+		void biquadChannels(BiquadBlock const& block, BiquadState* states, float* samples, std::size_t blocks, std::uint32_t channels) {
+			__m128 outputs[6], nextState[6];
+			for (int i = 0; i < 6; ++i) {
+				outputs[i] = _mm_load_ps(block.columns[i]);
+				nextState[i] = _mm_load_ps(block.columns[i] + 4);
+			}
+
+			__m128 s1a = _mm_set1_ps(states[0].s1), s2a = _mm_set1_ps(states[0].s2);
+			__m128 s1b = _mm_setzero_ps(), s2b = _mm_setzero_ps();
+			if constexpr (Pair) {
+				s1b = _mm_set1_ps(states[1].s1);
+				s2b = _mm_set1_ps(states[1].s2);
+			}
+
+			for (std::size_t b = 0; b < blocks; ++b) {
+				float* x = samples + b * 4 * channels;
+				__m128 ya, sa;
+				biquadBlock(outputs, nextState, s1a, s2a, x, channels, ya, sa);
+				s1a = _mm_shuffle_ps(sa, sa, 0x00);
+				s2a = _mm_shuffle_ps(sa, sa, 0x55);
+				if constexpr (Pair) {
+					__m128 yb, sb;
+					biquadBlock(outputs, nextState, s1b, s2b, x + 1, channels, yb, sb);
+					s1b = _mm_shuffle_ps(sb, sb, 0x00);
+					s2b = _mm_shuffle_ps(sb, sb, 0x55);
+					storeBlock(yb, x + 1, channels);
+				}
+				storeBlock(ya, x, channels);
+			}
+
+			states[0] = { _mm_cvtss_f32(s1a), _mm_cvtss_f32(s2a) };
+			if constexpr (Pair)
+				states[1] = { _mm_cvtss_f32(s1b), _mm_cvtss_f32(s2b) };
+		}
+#endif
+	}
+
+	Biquad makeBiquad(FilterShape shape, float cutoff, float q, float sampleRate) {
+		double w0 = 2.0 * std::numbers::pi * std::clamp<double>(cutoff, 1.0, 0.49 * sampleRate) / sampleRate;
+		double cosW0 = std::cos(w0);
+		double alpha = std::sin(w0) / (2.0 * std::max(q, 0.05f));
+
+		double b0, b1, b2;
+		switch (shape) {
+		case FilterShape::HighPass:
+			b0 = (1.0 + cosW0) / 2.0;
+			b1 = -(1.0 + cosW0);
+			b2 = b0;
+			break;
+		case FilterShape::BandPass:
+			b0 = alpha;
+			b1 = 0.0;
+			b2 = -alpha;
+			break;
+		default:
+			b0 = (1.0 - cosW0) / 2.0;
+			b1 = 1.0 - cosW0;
+			b2 = b0;
+			break;
+		}
+
+		double a0 = 1.0 + alpha;
+		return {
+			static_cast<float>(b0 / a0), static_cast<float>(b1 / a0), static_cast<float>(b2 / a0),
+			static_cast<float>(-2.0 * cosW0 / a0), static_cast<float>((1.0 - alpha) / a0),
+		};
+	}
+
+	BiquadBlock makeBiquadBlock(Biquad const& biquad) {
+		BiquadBlock block;
+		for (int input = 0; input < 6; ++input) {
+			BiquadState state;
+			float x[4] = {};
+			if (input == 0) state.s1 = 1.0f;
+			else if (input == 1) state.s2 = 1.0f;
+			else x[input - 2] = 1.0f;
+
+			for (int i = 0; i < 4; ++i) {
+				biquadStep(biquad, state, x[i]);
+				block.columns[input][i] = x[i];
+			}
+			block.columns[input][4] = state.s1;
+			block.columns[input][5] = state.s2;
+		}
+		return block;
+	}
+
+	void biquad(Biquad const& biquad, BiquadBlock const& block, BiquadState* states, float* samples, std::size_t frames, std::uint32_t channels) {
+#if HB_DSP_AVX2 || HB_DSP_SSE2
+		std::size_t blocks = frames / 4;
+		std::uint32_t channel = 0;
+		for (; channel + 1 < channels; channel += 2)
+			biquadChannels<true>(block, states + channel, samples + channel, blocks, channels);
+		if (channel < channels)
+			biquadChannels<false>(block, states + channel, samples + channel, blocks, channels);
+
+		biquadScalar(biquad, states, samples + blocks * 4 * channels, frames - blocks * 4, channels);
+#else
+		static_cast<void>(block);
+		biquadScalar(biquad, states, samples, frames, channels);
+#endif
+	}
+
+	void biquadScalar(Biquad const& biquad, BiquadState* states, float* samples, std::size_t frames, std::uint32_t channels) {
+		for (std::uint32_t channel = 0; channel < channels; ++channel) {
+			BiquadState state = states[channel];
+			for (std::size_t i = 0; i < frames; ++i)
+				biquadStep(biquad, state, samples[i * channels + channel]);
+			states[channel] = state;
+		}
+	}
+
+	void gainRamp(float* samples, std::size_t frames, std::uint32_t channels, float from, float to) {
+		if (frames == 0) return;
+		float step = (to - from) / static_cast<float>(frames);
+		std::size_t count = frames * channels;
+		std::size_t i = 0;
+
+#if HB_DSP_AVX2
+		if (tiles(channels, 8)) {
+			alignas(32) float offsets[8];
+			for (std::uint32_t lane = 0; lane < 8; ++lane)
+				offsets[lane] = static_cast<float>(lane / channels);
+			__m256 gain = _mm256_add_ps(_mm256_set1_ps(from), _mm256_mul_ps(_mm256_set1_ps(step), _mm256_load_ps(offsets)));
+			__m256 increment = _mm256_set1_ps(step * static_cast<float>(8 / channels));
+			for (; i + 8 <= count; i += 8) {
+				_mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), gain));
+				gain = _mm256_add_ps(gain, increment);
+			}
+		}
+#elif HB_DSP_SSE2
+		if (tiles(channels, 4)) {
+			alignas(16) float offsets[4];
+			for (std::uint32_t lane = 0; lane < 4; ++lane)
+				offsets[lane] = static_cast<float>(lane / channels);
+			__m128 gain = _mm_add_ps(_mm_set1_ps(from), _mm_mul_ps(_mm_set1_ps(step), _mm_load_ps(offsets)));
+			__m128 increment = _mm_set1_ps(step * static_cast<float>(4 / channels));
+			for (; i + 4 <= count; i += 4) {
+				_mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), gain));
+				gain = _mm_add_ps(gain, increment);
+			}
+		}
+#endif
+
+		for (; i < count; ++i)
+			samples[i] *= from + step * static_cast<float>(i / channels);
+	}
+
+	void gainRampScalar(float* samples, std::size_t frames, std::uint32_t channels, float from, float to) {
+		if (frames == 0) return;
+		float step = (to - from) / static_cast<float>(frames);
+		for (std::size_t frame = 0; frame < frames; ++frame) {
+			float gain = from + step * static_cast<float>(frame);
+			for (std::uint32_t channel = 0; channel < channels; ++channel)
+				samples[frame * channels + channel] *= gain;
+		}
+	}
+
+	float peak(float const* samples, std::size_t count) {
+		std::size_t i = 0;
+		float result = 0.0f;
+
+#if HB_DSP_AVX2
+		__m256 const magnitude = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+		__m256 a = _mm256_setzero_ps(), b = _mm256_setzero_ps();
+		for (; i + 16 <= count; i += 16) {
+			a = _mm256_max_ps(a, _mm256_and_ps(_mm256_loadu_ps(samples + i), magnitude));
+			b = _mm256_max_ps(b, _mm256_and_ps(_mm256_loadu_ps(samples + i + 8), magnitude));
+		}
+		__m128 m = _mm_max_ps(_mm256_castps256_ps128(_mm256_max_ps(a, b)), _mm256_extractf128_ps(_mm256_max_ps(a, b), 1));
+		m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+		m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 0x55));
+		result = _mm_cvtss_f32(m);
+#elif HB_DSP_SSE2
+		__m128 const magnitude = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		__m128 a = _mm_setzero_ps(), b = _mm_setzero_ps();
+		for (; i + 8 <= count; i += 8) {
+			a = _mm_max_ps(a, _mm_and_ps(_mm_loadu_ps(samples + i), magnitude));
+			b = _mm_max_ps(b, _mm_and_ps(_mm_loadu_ps(samples + i + 4), magnitude));
+		}
+		__m128 m = _mm_max_ps(a, b);
+		m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+		m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 0x55));
+		result = _mm_cvtss_f32(m);
+#endif
+
+		for (; i < count; ++i)
+			result = std::max(result, std::abs(samples[i]));
+		return result;
+	}
+
+	float peakScalar(float const* samples, std::size_t count) {
+		float result = 0.0f;
+		for (std::size_t i = 0; i < count; ++i)
+			result = std::max(result, std::abs(samples[i]));
+		return result;
+	}
+
+#if HB_DSP_MXCSR
+	DenormalGuard::DenormalGuard() : mSaved(_mm_getcsr()) {
+		_mm_setcsr(mSaved | 0x8040); // flush to zero, denormals are zero
+	}
+
+	DenormalGuard::~DenormalGuard() {
+		_mm_setcsr(mSaved);
+	}
+#else
+	DenormalGuard::DenormalGuard() = default;
+	DenormalGuard::~DenormalGuard() = default;
+#endif
+}
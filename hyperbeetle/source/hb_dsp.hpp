@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hyperbeetle::dsp {
+	// Kernels of the audio effects, on interleaved float frames in place. Each has a vectorized path picked at compile
+	// time, AVX2 in dist builds and SSE2 on any other x64 build, and a scalar reference the benchmarks compare against.
+	// None allocate or block, they run on the audio thread.
+
+	enum class FilterShape : std::uint8_t {
+		LowPass,
+		HighPass,
+		BandPass, // constant peak gain
+	};
+
+	// Normalized so a0 is 1.
+	struct Biquad final {
+		float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f;
+		float a1 = 0.0f, a2 = 0.0f;
+	};
+
+	// From the Audio EQ Cookbook. The cutoff is clamped below Nyquist.
+	Biquad makeBiquad(FilterShape shape, float cutoff, float q, float sampleRate);
+
+	// A biquad stepped four frames at a time. The outputs of a block and the state after it are linear in the state
+	// before and the block's inputs, so each block is a sum of six precomputed columns, one per input, scaled by it:
+	// y0 to y3 in the first four lanes and the next state in the two after. Only the state carries from block to block,
+	// which leaves a much shorter dependency chain than going sample by sample.
+	struct BiquadBlock final {
+		alignas(32) float columns[6][8] = {}; // by input: s1, s2, x0 to x3
+	};
+
+	BiquadBlock makeBiquadBlock(Biquad const& biquad);
+
+	// Transposed direct form II.
+	struct BiquadState final {
+		float s1 = 0.0f, s2 = 0.0f;
+	};
+
+	// Filters every channel, each with its own state in `states`.
+	void biquad(Biquad const& biquad, BiquadBlock const& block, BiquadState* states, float* samples, std::size_t frames, std::uint32_t channels);
+	void biquadScalar(Biquad const& biquad, BiquadState* states, float* samples, std::size_t frames, std::uint32_t channels);
+
+	// Multiplies by a gain moving linearly from `from` on the first frame towards `to`, which the frame after the last
+	// would have.
+	void gainRamp(float* samples, std::size_t frames, std::uint32_t channels, float from, float to);
+	void gainRampScalar(float* samples, std::size_t frames, std::uint32_t channels, float from, float to);
+
+	// Largest absolute value among `count` samples.
+	float peak(float const* samples, std::size_t count);
+	float peakScalar(float const* samples, std::size_t count);
+
+	// Flushes denormals to zero on this thread while alive, filter tails would otherwise slow down to a crawl as they
+	// decay. Does nothing off x86.
+	class DenormalGuard final {
+	public:
+		DenormalGuard();
+		DenormalGuard(DenormalGuard const&) = delete;
+		DenormalGuard& operator=(DenormalGuard const&) = delete;
+		~DenormalGuard();
+	private:
+		unsigned mSaved = 0;
+	};
+}
@@ -0,0 +1,291 @@
+#include "hb_effects.hpp"
+
+#include "hb_clock.hpp"
+#include "hb_profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace hyperbeetle {
+	namespace {
+		// Frames the filter glides and recomputes its coefficients across.
+		constexpr ma_uint32 kFilterBlockFrames = 64;
+		// Octaves the cutoff may drift before the coefficients are recomputed, or snaps to its target within.
+		constexpr float kCutoffTolerance = 1.0f / 1024.0f;
+
+		void initNode(ma_node_graph& graph, ma_node_vtable const& vtable, ma_uint32 const* inputChannels, ma_uint32 const* outputChannels, ma_node_base& node, char const* error) {
+			ma_node_config config = ma_node_config_init();
+			config.vtable = &vtable;
+			config.pInputChannels = inputChannels;
+			config.pOutputChannels = outputChannels;
+
+			if (ma_node_init(&graph, &config, nullptr, &node) != MA_SUCCESS)
+				throw std::runtime_error(error);
+		}
+
+		// Effects process in place on the output, which miniaudio may or may not have pointed at the input.
+		ma_uint32 copyInput(float const* in, float* out, ma_uint32* pFrameCountIn, ma_uint32* pFrameCountOut, ma_uint32 channels) {
+			ma_uint32 frames = std::min(*pFrameCountIn, *pFrameCountOut);
+			if (in != out)
+				std::memcpy(out, in, static_cast<std::size_t>(frames) * channels * sizeof(float));
+			*pFrameCountIn = frames;
+			*pFrameCountOut = frames;
+			return frames;
+		}
+
+		inline void addTime(std::atomic<std::int64_t>& total, std::int64_t begin) {
+			total.store(total.load(std::memory_order_relaxed) + now() - begin, std::memory_order_relaxed);
+		}
+
+		inline float decibelsToGain(float db) {
+			return std::pow(10.0f, db / 20.0f);
+		}
+	}
+
+	ma_node_vtable const FilterNode::kVtable = { &FilterNode::onProcess, nullptr, 1, 1, 0 };
+	ma_node_vtable const GainNode::kVtable = { &GainNode::onProcess, nullptr, 1, 1, 0 };
+	ma_node_vtable const CompressorNode::kVtable = { &CompressorNode::onProcess, nullptr, 2, 1, 0 };
+
+	void FilterNode::init(ma_node_graph& graph, ma_uint32 channels, ma_uint32 sampleRate) {
+		mChannels = channels;
+		mSampleRate = sampleRate;
+		mStates.assign(channels, {});
+		mLogCutoff = std::log2(std::max(mCutoff.load(std::memory_order_relaxed), 1.0f));
+		mBiquadLogCutoff = mLogCutoff;
+		mAppliedShape = mShape.load(std::memory_order_relaxed);
+		mAppliedResonance = mResonance.load(std::memory_order_relaxed);
+		mBiquad = dsp::makeBiquad(mAppliedShape, std::exp2(mLogCutoff), mAppliedResonance, static_cast<float>(sampleRate));
+		mBlock = dsp::makeBiquadBlock(mBiquad);
+		mSweepSeen = mSweepSequence.load(std::memory_order_relaxed);
+		mSweepPending = false;
+		mTime = mTimeOffset = 0;
+
+		mNode.self = this;
+		initNode(graph, kVtable, &channels, &channels, mNode.base, "Failed to initialize filter node");
+	}
+
+	void FilterNode::uninit() {
+		ma_node_uninit(&mNode.base, nullptr);
+	}
+
+	void FilterNode::sweepFrom(float hz, std::uint64_t startFrame) {
+		mSweepCutoff.store(hz, std::memory_order_relaxed);
+		mSweepFrame.store(startFrame, std::memory_order_relaxed);
+		mSweepSequence.fetch_add(1, std::memory_order_release);
+	}
+
+	void FilterNode::onProcess(ma_node* pNode, float const** ppFramesIn, ma_uint32* pFrameCountIn, float** ppFramesOut, ma_uint32* pFrameCountOut) {
+		HB_PROFILE_ZONE("audio.filter");
+		FilterNode& self = *static_cast<Node*>(pNode)->self;
+		std::int64_t begin = now();
+
+		ma_uint32 frames = copyInput(ppFramesIn[0], ppFramesOut[0], pFrameCountIn, pFrameCountOut, self.mChannels);
+		self.process(ppFramesOut[0], frames);
+
+		addTime(self.mNanoseconds, begin);
+	}
+
+	void FilterNode::process(float* samples, ma_uint32 frames) {
+		dsp::FilterShape shape = mShape.load(std::memory_order_relaxed);
+		float resonance = mResonance.load(std::memory_order_relaxed);
+		float target = std::log2(std::max(mCutoff.load(std::memory_order_relaxed), 1.0f));
+		float glideFrames = mGlide.load(std::memory_order_relaxed) * static_cast<float>(mSampleRate);
+		float decay = glideFrames > 0.0f ? std::exp(-static_cast<float>(kFilterBlockFrames) / glideFrames) : 0.0f;
+		float open = std::log2(kOpenCutoff);
+
+		std::uint32_t sequence = mSweepSequence.load(std::memory_order_acquire);
+		if (sequence != mSweepSeen) {
+			mSweepSeen = sequence;
+			mSweepPending = true;
+			mSweepAt = mSweepFrame.load(std::memory_order_relaxed);
+			mSweepTo = std::log2(std::max(mSweepCutoff.load(std::memory_order_relaxed), 1.0f));
+		}
+
+		// Engine time only moves once the endpoint has read a whole mix, which may take several calls.
+		std::uint64_t time = ma_node_graph_get_time(ma_node_get_node_graph(&mNode.base));
+		if (time != mTime) {
+			mTime = time;
+			mTimeOffset = 0;
+		}
+
+		bool reshaped = shape != mAppliedShape || resonance != mAppliedResonance;
+		mAppliedShape = shape;
+		mAppliedResonance = resonance;
+
+		for (ma_uint32 done = 0; done < frames; done += kFilterBlockFrames) {
+			ma_uint32 count = std::min(kFilterBlockFrames, frames - done);
+
+			if (mSweepPending && mSweepAt < mTime + mTimeOffset + done + count) {
+				mSweepPending = false;
+				mLogCutoff = mSweepTo;
+			}
+
+			mLogCutoff = target + (mLogCutoff - target) * decay;
+			if (std::abs(mLogCutoff - target) < kCutoffTolerance)
+				mLogCutoff = target;
+
+			if (shape == dsp::FilterShape::LowPass && mLogCutoff >= open) {
+				std::fill(mStates.begin(), mStates.end(), dsp::BiquadState{});
+				continue;
+			}
+
+			if (reshaped || std::abs(mLogCutoff - mBiquadLogCutoff) >= kCutoffTolerance) {
+				reshaped = false;
+				mBiquadLogCutoff = mLogCutoff;
+				mBiquad = dsp::makeBiquad(shape, std::exp2(mLogCutoff), resonance, static_cast<float>(mSampleRate));
+				mBlock = dsp::makeBiquadBlock(mBiquad);
+			}
+
+			dsp::biquad(mBiquad, mBlock, mStates.data(), samples + static_cast<std::size_t>(done) * mChannels, count, mChannels);
+		}
+
+		mTimeOffset += frames;
+		mApplied.store(std::exp2(mLogCutoff), std::memory_order_relaxed);
+	}
+
+	void GainNode::init(ma_node_graph& graph, ma_uint32 channels) {
+		mChannels = channels;
+		mApplied = mGain.load(std::memory_order_relaxed);
+
+		mNode.self = this;
+		initNode(graph, kVtable, &channels, &channels, mNode.base, "Failed to initialize gain node");
+	}
+
+	void GainNode::uninit() {
+		ma_node_uninit(&mNode.base, nullptr);
+	}
+
+	void GainNode::onProcess(ma_node* pNode, float const** ppFramesIn, ma_uint32* pFrameCountIn, float** ppFramesOut, ma_uint32* pFrameCountOut) {
+		HB_PROFILE_ZONE("audio.gain");
+		GainNode& self = *static_cast<Node*>(pNode)->self;
+		std::int64_t begin = now();
+
+		ma_uint32 frames = copyInput(ppFramesIn[0], ppFramesOut[0], pFrameCountIn, pFrameCountOut, self.mChannels);
+		float target = self.mGain.load(std::memory_order_relaxed);
+		if (target != 1.0f || self.mApplied != 1.0f)
+			dsp::gainRamp(ppFramesOut[0], frames, self.mChannels, self.mApplied, target);
+		self.mApplied = target;
+
+		addTime(self.mNanoseconds, begin);
+	}
+
+	void CompressorNode::init(ma_node_graph& graph, ma_uint32 channels, ma_uint32 sampleRate) {
+		mChannels = channels;
+		mSampleRate = sampleRate;
+		mEnvelope = 0.0f;
+		mApplied = decibelsToGain(mMakeup.load(std::memory_order_relaxed));
+
+		mNode.self = this;
+		ma_uint32 inputChannels[2] = { channels, channels };
+		initNode(graph, kVtable, inputChannels, &channels, mNode.base, "Failed to initialize compressor node");
+	}
+
+	void CompressorNode::uninit() {
+		ma_node_uninit(&mNode.base, nullptr);
+	}
+
+	void CompressorNode::onProcess(ma_node* pNode, float const** ppFramesIn, ma_uint32* pFrameCountIn, float** ppFramesOut, ma_uint32* pFrameCountOut) {
+		HB_PROFILE_ZONE("audio.compressor");
+		CompressorNode& self = *static_cast<Node*>(pNode)->self;
+		std::int64_t begin = now();
+
+		ma_uint32 frames = copyInput(ppFramesIn[0], ppFramesOut[0], pFrameCountIn, pFrameCountOut, self.mChannels);
+		self.process(ppFramesIn[kKeyBus], ppFramesOut[0], frames);
+
+		addTime(self.mNanoseconds, begin);
+	}
+
+	void CompressorNode::process(float const* key, float* samples, ma_uint32 frames) {
+		float threshold = mThreshold.load(std::memory_order_relaxed);
+		float slope = 1.0f - 1.0f / std::max(mRatio.load(std::memory_order_relaxed), 1.0f);
+		float makeup = mMakeup.load(std::memory_order_relaxed);
+		auto coefficient = [&](float seconds) {
+			return 1.0f - std::exp(-static_cast<float>(kBlockFrames) / (std::max(seconds, 1e-4f) * static_cast<float>(mSampleRate)));
+		};
+		float attack = coefficient(mAttack.load(std::memory_order_relaxed));
+		float release = coefficient(mRelease.load(std::memory_order_relaxed));
+
+		float reduction = 0.0f;
+		for (ma_uint32 done = 0; done < frames; done += kBlockFrames) {
+			ma_uint32 count = std::min(kBlockFrames, frames - done);
+			std::size_t offset = static_cast<std::size_t>(done) * mChannels;
+
+			float level = dsp::peak(key + offset, static_cast<std::size_t>(count) * mChannels);
+			mEnvelope += (level - mEnvelope) * (level > mEnvelope ? attack : release);
+
+			float over = 20.0f * std::log10(std::max(mEnvelope, 1e-6f)) - threshold;
+			reduction = std::max(over, 0.0f) * slope;
+			float gain = decibelsToGain(makeup - reduction);
+
+			dsp::gainRamp(samples + offset, count, mChannels, mApplied, gain);
+			mApplied = gain;
+		}
+
+		mReduction.store(reduction, std::memory_order_relaxed);
+	}
+
+	void EffectGraph::init(ma_engine& engine) {
+		ma_node_graph& graph = *ma_engine_get_node_graph(&engine);
+		ma_uint32 channels = ma_engine_get_channels(&engine);
+		ma_uint32 sampleRate = ma_engine_get_sample_rate(&engine);
+
+		// Built from the endpoint back, so nothing is audible before its path is complete. If a step fails, the ones
+		// before it are taken down again in reverse.
+		int ready = 0;
+		try {
+			mMaster.init(graph, channels);
+			++ready;
+			ma_node_attach_output_bus(mMaster.node(), 0, ma_engine_get_endpoint(&engine), 0);
+			mFilter.init(graph, channels, sampleRate);
+			++ready;
+			ma_node_attach_output_bus(mFilter.node(), 0, mMaster.node(), 0);
+			mCompressor.init(graph, channels, sampleRate);
+			++ready;
+			ma_node_attach_output_bus(mCompressor.node(), 0, mFilter.node(), 0);
+
+			ma_splitter_node_config splitterConfig = ma_splitter_node_config_init(channels);
+			if (ma_splitter_node_init(&graph, &splitterConfig, nullptr, &mSplitter) != MA_SUCCESS)
+				throw std::runtime_error("Failed to initialize splitter node");
+			++ready;
+			ma_node_attach_output_bus(&mSplitter, 0, mMaster.node(), 0);
+			ma_node_attach_output_bus(&mSplitter, 1, mCompressor.node(), CompressorNode::kKeyBus);
+
+			if (ma_sound_group_init(&engine, MA_SOUND_FLAG_NO_SPATIALIZATION, nullptr, &mMusic) != MA_SUCCESS)
+				throw std::runtime_error("Failed to initialize music group");
+			++ready;
+			ma_node_attach_output_bus(&mMusic, 0, mCompressor.node(), 0);
+
+			if (ma_sound_group_init(&engine, MA_SOUND_FLAG_NO_SPATIALIZATION, nullptr, &mSfx) != MA_SUCCESS)
+				throw std::runtime_error("Failed to initialize sfx group");
+			ma_node_attach_output_bus(&mSfx, 0, &mSplitter, 0);
+		}
+		catch (...) {
+			if (ready >= 5) ma_sound_group_uninit(&mMusic);
+			if (ready >= 4) ma_splitter_node_uninit(&mSplitter, nullptr);
+			if (ready >= 3) mCompressor.uninit();
+			if (ready >= 2) mFilter.uninit();
+			if (ready >= 1) mMaster.uninit();
+			throw;
+		}
+
+		mEngine = &engine;
+	}
+
+	void EffectGraph::uninit() {
+		if (!mEngine) return;
+
+		ma_sound_group_uninit(&mSfx);
+		ma_sound_group_uninit(&mMusic);
+		ma_splitter_node_uninit(&mSplitter, nullptr);
+		mCompressor.uninit();
+		mFilter.uninit();
+		mMaster.uninit();
+		mEngine = nullptr;
+	}
+
+	std::int64_t EffectGraph::processNanoseconds() const {
+		return mCompressor.processNanoseconds() + mFilter.processNanoseconds() + mMaster.processNanoseconds();
+	}
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "hb_dsp.hpp"
+
+#include <miniaudio.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace hyperbeetle {
+	// Custom nodes of the effect graph. Parameters are atomics any thread can set without locking, the audio thread
+	// glides towards them so a change never clicks. Processing runs the kernels of hb_dsp.hpp on the node's buffers.
+
+	// A resonant filter whose cutoff glides in octaves, for sweeps.
+	class FilterNode final {
+	public:
+		// A low pass at or above this is bypassed.
+		static constexpr float kOpenCutoff = 20000.0f;
+
+		FilterNode() = default;
+		FilterNode(FilterNode const&) = delete;
+		FilterNode& operator=(FilterNode const&) = delete;
+
+		void init(ma_node_graph& graph, ma_uint32 channels, ma_uint32 sampleRate);
+		void uninit();
+		inline ma_node* node() { return &mNode.base; }
+
+		// Any thread.
+		inline void setShape(dsp::FilterShape shape) { mShape.store(shape, std::memory_order_relaxed); }
+		inline void setCutoff(float hz) { mCutoff.store(hz, std::memory_order_relaxed); }
+		inline void setResonance(float q) { mResonance.store(q, std::memory_order_relaxed); }
+		// Seconds the cutoff takes to cover about two thirds of the octaves to its target.
+		inline void setGlide(float seconds) { mGlide.store(seconds, std::memory_order_relaxed); }
+		// Jumps the cutoff to `hz` at the absolute engine frame `startFrame`, or on the next mix if that has passed, and
+		// glides back to the set cutoff from there. From one thread at a time.
+		void sweepFrom(float hz, std::uint64_t startFrame = 0);
+
+		// The cutoff the audio thread last applied.
+		inline float currentCutoff() const { return mApplied.load(std::memory_order_relaxed); }
+		// Time the audio thread spent processing.
+		inline std::int64_t processNanoseconds() const { return mNanoseconds.load(std::memory_order_relaxed); }
+	private:
+		struct Node final {
+			ma_node_base base;
+			FilterNode* self = nullptr;
+		};
+
+		static void onProcess(ma_node* pNode, float const** ppFramesIn, ma_uint32* pFrameCountIn, float** ppFramesOut, ma_uint32* pFrameCountOut);
+		static ma_node_vtable const kVtable;
+
+		void process(float* samples, ma_uint32 frames);
+
+		Node mNode;
+		ma_uint32 mChannels = 0;
+		ma_uint32 mSampleRate = 0;
+
+		std::atomic<dsp::FilterShape> mShape = dsp::FilterShape::LowPass;
+		std::atomic<float> mCutoff = kOpenCutoff;
+		std::atomic<float> mResonance = 0.7071f;
+		std::atomic<float> mGlide = 0.25f;
+		std::atomic<float> mSweepCutoff = 0.0f;
+		std::atomic<std::uint64_t> mSweepFrame = 0;
+		std::atomic<std::uint32_t> mSweepSequence = 0;
+		std::atomic<float> mApplied = kOpenCutoff;
+		std::atomic<std::int64_t> mNanoseconds = 0;
+
+		// Audio thread only.
+		std::uint32_t mSweepSeen = 0;
+		bool mSweepPending = false;
+		std::uint64_t mSweepAt = 0;
+		float mSweepTo = 0.0f;
+		std::uint64_t mTime = 0; // engine frame of the first frame of this mix
+		std::uint64_t mTimeOffset = 0; // frames processed since
+		float mLogCutoff = 0.0f; // log2 of the applied cutoff
+		float mBiquadLogCutoff = 0.0f; // the cutoff the coefficients are for
+		dsp::FilterShape mAppliedShape = dsp::FilterShape::LowPass;
+		float mAppliedResonance = 0.0f;
+		dsp::Biquad mBiquad;
+		dsp::BiquadBlock mBlock;
+		std::vector<dsp::BiquadState> mStates;
+	};
+
+	// A gain that ramps to a new value over one mix.
+	class GainNode final {
+	public:
+		GainNode() = default;
+		GainNode(GainNode const&) = delete;
+		GainNode& operator=(GainNode const&) = delete;
+
+		void init(ma_node_graph& graph, ma_uint32 channels);
+		void uninit();
+		inline ma_node* node() { return &mNode.base; }
+
+		// Any thread. Linear.
+		inline void setGain(float gain) { mGain.store(gain, std::memory_order_relaxed); }
+
+		inline std::int64_t processNanoseconds() const { return mNanoseconds.load(std::memory_order_relaxed); }
+	private:
+		struct Node final {
+			ma_node_base base;
+			GainNode* self = nullptr;
+		};
+
+		static void onProcess(ma_node* pNode, float const** ppFramesIn, ma_uint32* pFrameCountIn, float** ppFramesOut, ma_uint32* pFrameCountOut);
+		static ma_node_vtable const kVtable;
+
+		Node mNode;
+		ma_uint32 mChannels = 0;
+		std::atomic<float> mGain = 1.0f;
+		std::atomic<std::int64_t> mNanoseconds = 0;
+		float mApplied = 1.0f; // audio thread only
+	};
+
+	// A peak compressor on input bus 0 keyed by input bus 1, the sidechain, which is only listened to. With sound effects
+	// as the key the music ducks under hits.
+	class CompressorNode final {
+	public:
+		static constexpr ma_uint32 kKeyBus = 1;
+		// Frames between updates of the envelope, the gain ramps linearly across them.
+		static constexpr ma_uint32 kBlockFrames = 32;
+
+		CompressorNode() = default;
+		CompressorNode(CompressorNode const&) = delete;
+		CompressorNode& operator=(CompressorNode const&) = delete;
+
+		void init(ma_node_graph& graph, ma_uint32 channels, ma_uint32 sampleRate);
+		void uninit();
+		inline ma_node* node() { return &mNode.base; }
+
+		// Any thread.
+		inline void setThreshold(float db) { mThreshold.store(db, std::memory_order_relaxed); }
+		inline void setRatio(float ratio) { mRatio.store(ratio, std::memory_order_relaxed); }
+		inline void setAttack(float seconds) { mAttack.store(seconds, std::memory_order_relaxed); }
+		inline void setRelease(float seconds) { mRelease.store(seconds, std::memory_order_relaxed); }
+		inline void setMakeup(float db) { mMakeup.store(db, std::memory_order_relaxed); }
+
+		// Decibels taken off by the last block, for meters.
+		inline float reduction() const { return mReduction.load(std::memory_order_relaxed); }
+		inline std::int64_t processNanoseconds() const { return mNanoseconds.load(std::memory_order_relaxed); }
+	private:
+		struct Node final {
+			ma_node_base base;
+			CompressorNode* self = nullptr;
+		};
+
+		static void onProcess(ma_node* pNode, float const** ppFramesIn, ma_uint32* pFrameCountIn, float** ppFramesOut, ma_uint32* pFrameCountOut);
+		static ma_node_vtable const kVtable;
+
+		void process(float const* key, float* samples, ma_uint32 frames);
+
+		Node mNode;
+		ma_uint32 mChannels = 0;
+		ma_uint32 mSampleRate = 0;
+
+		std::atomic<float> mThreshold = -30.0f;
+		std::atomic<float> mRatio = 4.0f;
+		std::atomic<float> mAttack = 0.005f;
+		std::atomic<float> mRelease = 0.2f;
+		std::atomic<float> mMakeup = 0.0f;
+		std::atomic<float> mReduction = 0.0f;
+		std::atomic<std::int64_t> mNanoseconds = 0;
+
+		// Audio thread only.
+		float mEnvelope = 0.0f;
+		float mApplied = 1.0f;
+	};
+
+	// Sits between the engine's sounds and its endpoint:
+	//   music group -> compressor -> filter -> master -> endpoint
+	//   sfx group -> splitter -> master
+	//                         -> compressor key
+	// Gameplay feedback plays through it: the filter sweeps on a miss and the music ducks under hit sounds.
+	class EffectGraph final {
+	public:
+		EffectGraph() = default;
+		EffectGraph(EffectGraph const&) = delete;
+		EffectGraph& operator=(EffectGraph const&) = delete;
+		~EffectGraph() noexcept { uninit(); }
+
+		// Builds the graph on `engine`, which must outlive it. Throws std::runtime_error.
+		void init(ma_engine& engine);
+		void uninit();
+		inline bool isInit() const { return mEngine != nullptr; }
+
+		// Groups for sounds to be initialized in.
+		inline ma_sound_group& music() { return mMusic; }
+		inline ma_sound_group& sfx() { return mSfx; }
+
+		inline FilterNode& filter() { return mFilter; }
+		inline CompressorNode& compressor() { return mCompressor; }
+		inline GainNode& master() { return mMaster; }
+
+		// Time the audio thread spent in the nodes, which the device callback includes.
+		std::int64_t processNanoseconds() const;
+	private:
+		ma_engine* mEngine = nullptr;
+		ma_sound_group mMusic;
+		ma_sound_group mSfx;
+		ma_splitter_node mSplitter;
+		CompressorNode mCompressor;
+		FilterNode mFilter;
+		GainNode mMaster;
+	};
+}
@@ -1,18 +1,47 @@
 #include "hb_window.hpp"
+#include "hb_allocations.hpp"
+#include "hb_audio.hpp"
+#include "hb_audio_devices.hpp"
+#include "hb_audio_switch.hpp"
+#include "hb_config.hpp"
+#include "hb_file_watcher.hpp"
+#include "hb_hash.hpp"
+#include "hb_frame_arena.hpp"
+#include "hb_frame_pacer.hpp"
+#include "hb_sound_bank.hpp"
+#include "hb_pack.hpp"
+#include "hb_pack_vfs.hpp"
+#include "hb_input_queue.hpp"
+#include "hb_jobs.hpp"
+#include "hb_clock.hpp"
+#include "hb_latency_calibration.hpp"
+#include "hb_latency_trace.hpp"
+#include "hb_level_library.hpp"
+#include "hb_simulation.hpp"
+#include "hb_world.hpp"
+#include "hb_headless.hpp"
+#include "hb_profiler.hpp"
+#include "hb_ui.hpp"
 
 #include <atomic>
 #include <thread>
 #include <string_view>
 #include <iostream>
-#include <sstream>
 #include <array>
 #include <vector>
 #include <algorithm>
 #include <cmath>
 #include <vector>
+#include <string>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <chrono>
+#include <filesystem>
+#include <optional>
 #include <fstream>
+#include <iterator>
 #include <mutex>
-#include <string>
 
 #include <yaml-cpp/yaml.h>
 
@@ -20,11 +49,6 @@
 
 #include <glad/gl.h>
 
-#define STB_VORBIS_HEADER_ONLY
-#include <stb_vorbis.c>
-#define MINIAUDIO_IMPLEMENTATION
-#include <miniaudio.h>
-
 #include <GLFW/glfw3.h>
 
 #define HB_VERSION "v0.0.1-a.4+" __DATE__ " " __TIME__
@@ -37,6 +61,12 @@
 namespace {
 	std::atomic_bool kRunning = true;
 
+	// Built by `hbpak build assets.hbpak <files>` from the files the game would otherwise read from the working directory.
+	constexpr char const* kAssetPack = "assets.hbpak";
+	// What the last scan of the levels directory found, so the next startup only reads the levels that changed.
+	constexpr char const* kLibraryIndex = "levels.hbli";
+	constexpr char const* kConfigPath = "config.yaml";
+
 	std::string_view glEnumToString(unsigned int val) {
 		switch (val) {
 		case GL_DEBUG_SOURCE_API: return "API";
@@ -65,79 +95,21 @@ namespace {
 	void message_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar const* message, void const* user_param) {
 		std::cout << glEnumToString(source) << ", " << glEnumToString(type) << ", " << glEnumToString(severity) << ", " << (void*)(intptr_t)id << ": " << message << std::endl;
 	}
-}
-
-struct AudioEngine final {
-
-	void init(std::string_view preferredDevice) {
-		if (ma_context_init(nullptr, 0, nullptr, &mContext) != MA_SUCCESS) {
-			// Error.
-		}
 
-		ma_device_info* pPlaybackInfos;
-		ma_uint32 playbackCount;
-		if (ma_context_get_devices(&mContext, &pPlaybackInfos, &playbackCount, nullptr, nullptr) != MA_SUCCESS) {
-			// Error.
-		}
-
-		bool isDeviceChosen = false;
-		ma_uint32 chosenPlaybackDeviceIndex = 0;
-
-		for (ma_uint32 iDevice = 0; iDevice < playbackCount; iDevice += 1) {
-			if (std::string_view(pPlaybackInfos[iDevice].name) == preferredDevice) {
-				chosenPlaybackDeviceIndex = iDevice;
-				isDeviceChosen = true;
-			}
-		}
+	// Latency is a property of the output device, so it is stored per device name.
+	void applyLatencyConfig(YAML::Node const& config, hyperbeetle::AudioEngine& audioEngine) {
+		double output = 0.0, input = 0.0;
 
-		if (!isDeviceChosen) {
-			for (ma_uint32 iDevice = 0; iDevice < playbackCount; iDevice += 1) {
-				if (pPlaybackInfos[iDevice].isDefault) {
-					chosenPlaybackDeviceIndex = iDevice;
-					isDeviceChosen = true;
-					break;
-				}
+		if (YAML::Node latency = config["latency"]; latency && latency.IsMap()) {
+			if (YAML::Node device = latency[audioEngine.mDeviceName]; device && device.IsMap()) {
+				output = device["output"].as<double>(0.0);
+				input = device["input"].as<double>(0.0);
 			}
 		}
 
-		mDeviceName = pPlaybackInfos[chosenPlaybackDeviceIndex].name;
-
-		ma_device_config deviceConfig = ma_device_config_init(ma_device_type_playback);
-		deviceConfig.playback.pDeviceID = &pPlaybackInfos[chosenPlaybackDeviceIndex].id;
-		deviceConfig.pUserData = &mEngine;
-
-		deviceConfig.dataCallback = [](ma_device* pDevice, void* pOutput, void const* pInput, ma_uint32 frameCount) {
-			ma_engine_read_pcm_frames(static_cast<ma_engine*>(pDevice->pUserData), pOutput, frameCount, nullptr);
-		};
-
-		if (ma_device_init(&mContext, &deviceConfig, &mDevice) != MA_SUCCESS) {
-			// Error.
-		}
-
-		ma_engine_config engineConfig = ma_engine_config_init();
-		engineConfig.pDevice = &mDevice;
-
-		if (ma_engine_init(&engineConfig, &mEngine) != MA_SUCCESS) {
-			// Error.
-		}
-	}
-
-	void uninit() {
-		ma_engine_uninit(&mEngine);
-		ma_device_uninit(&mDevice);
-		ma_context_uninit(&mContext);
+		audioEngine.mClock->setLatency(output, input);
 	}
-
-	std::string mDeviceName;
-	ma_context mContext;
-	ma_device mDevice;
-	ma_engine mEngine;
-};
-
-struct EventKey final {
-	GLFWwindow* window;
-	int key, scancode, action, mods;
-};
+}
 
 #include <renderdoc_app.h>
 
@@ -182,9 +154,6 @@ void setupRenderdoc() {
 void setupRenderdoc() {}
 #endif
 
-#if 0
-struct StateManager;
-
 struct State {
 	State() = default;
 	virtual ~State() = default;
@@ -193,38 +162,138 @@ struct State {
 	State(State&&) = delete;
 	State& operator=(State&&) = delete;
 
+	virtual void enter() {}
+	virtual void exit() {}
 	virtual void update() = 0;
+	virtual void onKey(hyperbeetle::EventKey const&) {}
 };
 
+// Screens of the game, only the top one is updated and receives input.
+// Changes are queued and applied between frames so a state can push or pop from inside its own update.
 struct StateManager final {
-	std::vector<std::unique_ptr<State>> mStates;
-
 	template<class T, class... Args, std::enable_if_t<std::is_base_of_v<State, T>, bool> = true>
 	void push(Args&&... args) {
-		mStates.push_back(std::make_unique<T>(std::forward<Args>(args)...));
+		mPending.push_back(std::make_unique<T>(std::forward<Args>(args)...));
 	}
 
+	void pop() {
+		mPending.push_back(nullptr);
+	}
+
+	void applyPending();
+	void clear();
+
 	void update() {
-		for (auto& state : mStates)
-			state->update();
+		if (!mStates.empty())
+			mStates.back()->update();
+	}
+
+	void onKey(hyperbeetle::EventKey const& e) {
+		if (!mStates.empty())
+			mStates.back()->onKey(e);
 	}
+
+	std::vector<std::unique_ptr<State>> mStates;
+	std::vector<std::unique_ptr<State>> mPending; // nullptr pops
 };
-#endif
 
-struct MenuState final {
-	void init();
-	void update();
-	void destroy();
+// Options are built once and kept until the owner marks the menu dirty, so drawing only issues NanoVG calls.
+struct Menu final {
+	using Option = hyperbeetle::ui::MenuOption;
+
+	void onKey(hyperbeetle::EventKey const& e);
+	// Draws the options and runs the chosen one.
+	void draw();
+
+	std::vector<Option> mOptions;
+	int mSelected = 0;
+	bool mPerformAction = false;
+	std::int64_t mPerformActionAt = 0; // tracedAt of the key that chose
+};
+
+struct MenuState : State {
+	void update() final;
+	void onKey(hyperbeetle::EventKey const& e) final { mMenu.onKey(e); }
+
+	virtual void build(std::vector<Menu::Option>& options) = 0;
+	// Marks the menu dirty if what it was built from changed.
+	virtual void poll() {}
+
+	Menu mMenu;
+	bool mDirty = true;
+};
+
+// Shown until the startup jobs have finished, draws their progress without waiting on them.
+struct LoadingState final : State {
+	void update() override;
+};
+
+struct MainMenuState final : MenuState {
+	void build(std::vector<Menu::Option>& options) override;
+};
+
+struct OptionsState final : MenuState {
+	void enter() override;
+	void poll() override;
+	void build(std::vector<Menu::Option>& options) override;
+
+	std::uint64_t mDeviceVersion = 0;
+};
 
-	void onKey(EventKey const& e);
+// The levels in the library, filtered by a query typed on the keyboard. Only the rows that fit on screen are formatted
+// and drawn, so the list costs the same for ten levels as for fifty thousand.
+struct LibraryState final : State {
+	void update() override;
+	void onKey(hyperbeetle::EventKey const& e) override;
 
+	std::shared_ptr<hyperbeetle::LevelIndex const> mIndex;
+	std::uint64_t mVersion = 0;
+	hyperbeetle::LevelSearch mSearch;
+	std::string mQuery;
+	double mSearchSeconds = 0.0;
+	bool mDirty = true;
+
+	hyperbeetle::ui::LibraryList mList; // selection and scrolling, the rows that fit as of the last frame
 	bool mPerformAction = false;
-	int mSelectedOption = 0;
+	std::int64_t mPerformActionAt = 0; // tracedAt of the key that chose
+};
+
+struct CalibrationState final : State {
+	void enter() override;
+	void update() override;
+	void onKey(hyperbeetle::EventKey const& e) override;
+
+	bool mSave = false;
+	hyperbeetle::LatencyCalibration mCalibration;
+	int mNextClick = 0;
 };
 
 struct Application final {
 	void runMainThread();
 	void runRenderThread();
+	void drawOverlay();
+	// Render thread. Saves the choice.
+	void setFramePacing(hyperbeetle::FramePacer::Mode mode, double cap);
+	// Keys that work in every state.
+	void onKey(hyperbeetle::EventKey const& e);
+
+	// Main thread, queues everything the menu needs on the loader.
+	void startLoading(std::string const& audioDevice);
+	// Render thread, once every startup job has finished. Hands the results to NanoVG and the sound bank.
+	void finishLoading();
+	// Main or render thread. Rescans the levels directory on the loader unless a scan is running.
+	void scanLevels();
+	// Main thread. Parses the config on the loader whenever someone else saves it.
+	void watchConfig();
+	// Render thread, between frames. Applies the settings that changed in the last config parsed.
+	void applyConfigReload();
+
+	// Render thread once it runs. The file is written in the background.
+	template<class Fn>
+	void updateConfig(Fn&& fn) {
+		fn(mConfig);
+		mConfigWriter.write(mConfig);
+	}
 
 	int mFramebufferWidth, mFramebufferHeight;
 	float mContentScaleX, mContentScaleY;
@@ -232,33 +301,115 @@ struct Application final {
 	float mUiWidth, mUiHeight;
 
 	double mDeltaTime = 1.;
+	hyperbeetle::FramePacer mFramePacer;
+	// Render thread, reset after every nvgEndFrame.
+	hyperbeetle::FrameArena mFrameArena;
+	hyperbeetle::allocations::Counts mFrameAllocations; // render thread, last frame
+	std::uint64_t mFrames = 0;
+	std::uint64_t mAllocatingFrames = 0;
+	// Collected on the render thread every frame.
+	hyperbeetle::LatencyTrace mLatency;
+	std::uint64_t mDisplayedInputs = 0; // render thread, of SimulationState::heldInputs
 
 	hyperbeetle::Window mWindow;
-	AudioEngine mAudioEngine;
+	hyperbeetle::AudioDeviceList mAudioDevices;
+	hyperbeetle::SongClock mSongClock;
+	// Assets come from here when the game ships a pack, from loose files otherwise.
+	hyperbeetle::Pack mPack;
+	hyperbeetle::PackVfs mPackVfs{ mPack };
+	std::unique_ptr<hyperbeetle::AudioEngine> mAudioEngine = std::make_unique<hyperbeetle::AudioEngine>();
+	hyperbeetle::AudioSwitcher mAudioSwitcher{ mSongClock, &mAudioDevices };
+	hyperbeetle::SoundBank mSoundBank;
+	hyperbeetle::SoundBank::SoundId mSfxCursor = hyperbeetle::SoundBank::kInvalidSound;
+	hyperbeetle::SoundBank::SoundId mSfxSelect = hyperbeetle::SoundBank::kInvalidSound;
 	NVGcontext* mVg = nullptr;
 
-	std::mutex mDispatcherMtx;
+	hyperbeetle::InputQueue mInputQueue;
+	hyperbeetle::World mWorld;
+	hyperbeetle::Simulation mSimulation{ mInputQueue };
 	entt::dispatcher mDispatcher{};
 
-	MenuState mState;
+	StateManager mStates;
+
+	YAML::Node mConfig;
+	hyperbeetle::ConfigWriter mConfigWriter{ kConfigPath };
+	hyperbeetle::FileWatcher mConfigWatcher;
+	struct ConfigReload final {
+		YAML::Node config;
+		std::int64_t changedAt = 0;
+	};
+	hyperbeetle::JobHandle mConfigReload; // watcher thread
+	std::mutex mConfigReloadMutex;
+	std::optional<ConfigReload> mConfigReloaded;
+	std::atomic_bool mConfigReloadPending = false;
+
+	std::optional<hyperbeetle::JobSystem> mJobs;
+	struct Startup final {
+		std::int64_t begin = 0;
+		hyperbeetle::JobHandle audio;
+		std::vector<hyperbeetle::JobHandle> jobs; // every startup job, for the loading screen
+		hyperbeetle::JobHandle font;
+		std::array<hyperbeetle::SoundBank::Decoded, 2> sounds;
+		double seconds = 0.0; // from startup to the menu
+		bool loaded = false; // finishLoading has run, the loader no longer touches the device or mConfig
+	} mStartup;
+	hyperbeetle::PackAsset mFont; // NanoVG reads the font from here
+
+	std::optional<hyperbeetle::LevelLibrary> mLibrary;
+	hyperbeetle::JobHandle mLibraryScan;
 };
 
 Application& getApplication();
 
 void Application::runMainThread() {
+	mStartup.begin = hyperbeetle::now();
+
 	setupRenderdoc();
 
 	// Read config
-	std::string configuredAudioDevice = "";
-	try {
-		YAML::Node config = YAML::LoadFile("config.yaml");
-		configuredAudioDevice = config["audioDevice"].as<std::string>("");
+	mConfig = hyperbeetle::loadConfig(kConfigPath);
+	std::string configuredAudioDevice = mConfig["audioDevice"].as<std::string>("");
+	double configuredSimulationRate = mConfig["simulationRate"].as<double>(hyperbeetle::Simulation::kDefaultTickRate);
+	hyperbeetle::profiler::setEnabled(mConfig["profiler"].as<bool>(true));
+	int loaderThreads = mConfig["loaderThreads"].as<int>(-1);
+	mLibrary.emplace(mConfig["levels"].as<std::string>("levels"), kLibraryIndex);
+	mConfigWriter.start();
+
+	mJobs.emplace(loaderThreads < 0 ? hyperbeetle::JobSystem::defaultThreadCount() : static_cast<unsigned>(loaderThreads));
+
+	// A pack that is damaged or from another version is skipped, everything then comes from loose files.
+	std::error_code ec;
+	if (std::filesystem::exists(kAssetPack, ec)) {
+		try {
+			mPack = hyperbeetle::Pack::open(kAssetPack);
+		}
+		catch (std::exception const& e) {
+			std::cout << kAssetPack << ": " << e.what() << ", using loose files\n";
+		}
 	}
-	catch (YAML::BadFile const& e) {}
+
+	mAudioDevices.start();
+	mAudioEngine->mDeviceList = &mAudioDevices;
+	startLoading(configuredAudioDevice);
+	scanLevels();
+	watchConfig();
 
 	mWindow = hyperbeetle::Window({ .width = 1280, .height = 720, .title = "HyperBeetle" });
 
-	mAudioEngine.init(configuredAudioDevice);
+	// The simulation and the render thread need the device, the rest finishes behind the loading screen. Without
+	// loader threads everything runs here one after the other, the way startup used to.
+	mJobs->wait(mStartup.audio);
+	if (!mJobs->threadCount()) {
+		for (auto const& job : mStartup.jobs) {
+			try {
+				mJobs->wait(job);
+			}
+			catch (std::exception const&) {}
+		}
+	}
+	// Sounds are decoded at a new device's format before the swap, the swap itself only moves them over.
+	mAudioSwitcher.setPrepare([this](hyperbeetle::AudioEngine& engine) { mSoundBank.prepare(engine.mEngine); });
+	mAudioSwitcher.start();
 
 	glfwSetWindowUserPointer(mWindow.handle(), this);
 
@@ -266,9 +417,9 @@ void Application::runMainThread() {
 	glfwGetFramebufferSize(mWindow.handle(), &mFramebufferWidth, &mFramebufferHeight);
 
 	glfwSetKeyCallback(mWindow.handle(), [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+		std::int64_t timestamp = hyperbeetle::now();
 		auto& application = *static_cast<Application*>(glfwGetWindowUserPointer(window));
-		std::lock_guard lck{ application.mDispatcherMtx };
-		application.mDispatcher.enqueue<EventKey>(window, key, scancode, action, mods);
+		application.mInputQueue.push({ window, key, scancode, action, mods, timestamp, timestamp });
 	});
 
 	glfwSetFramebufferSizeCallback(mWindow.handle(), [](GLFWwindow* window, int width, int height) {
@@ -283,9 +434,20 @@ void Application::runMainThread() {
 		application.mContentScaleY = yscale;
 	});
 
+	mSimulation.setTickRate(configuredSimulationRate);
+	mSimulation.setSongClock(&mSongClock);
+	mLatency.setDisplayed(true);
+	mSimulation.setLatencyTrace(&mLatency);
+	mWorld.setJobs(&*mJobs);
+	mSimulation.setWorld(&mWorld);
+	mSimulation.start();
+
 	std::jthread thread = std::jthread(&Application::runRenderThread, this);
 
+	HB_PROFILE_THREAD("main");
+
 	while (kRunning) {
+		HB_PROFILE_ZONE("main.events");
 		glfwWaitEvents();
 
 		if (glfwWindowShouldClose(mWindow.handle()))
@@ -293,11 +455,24 @@ void Application::runMainThread() {
 	}
 
 	thread.join();
-
-	mAudioEngine.uninit();
+	mConfigWatcher.stop();
+
+	// The simulation may be splitting the world across the loader threads, and the window may close before loading
+	// has finished.
+	mSimulation.stop();
+	mJobs.reset();
+
+	// Finishes a switch in progress first, the switcher may still be starting the active engine.
+	mAudioSwitcher.stop();
+	mSoundBank.uninit();
+	mAudioEngine->uninit();
+	mAudioDevices.stop();
+	mConfigWriter.stop();
 }
 
 void Application::runRenderThread() {
+	HB_PROFILE_THREAD("render");
+
 	mWindow.makeContextCurrent();
 
 	if (!gladLoadGL(&glfwGetProcAddress))
@@ -314,42 +489,124 @@ void Application::runRenderThread() {
 
 	mVg = nvgCreateGL3(NVG_STENCIL_STROKES | NVG_ANTIALIAS);
 
-	int id = nvgCreateFont(mVg, "notosans-regular", "NotoSans-Regular.ttf");
-	if (id != -1)
-		nvgFontFaceId(mVg, id);
-
 	unsigned int vao;
 	glGenVertexArrays(1, &vao);
 
 	glClearColor(0, 0, 0, 0);
 
-	mState.init();
+	auto pacing = hyperbeetle::FramePacer::parseMode(mConfig["framePacing"].as<std::string>(""));
+	mFramePacer.setMode(pacing.value_or(hyperbeetle::FramePacer::Mode::Vsync), mConfig["frameCap"].as<double>(hyperbeetle::FramePacer::kDefaultCap));
+	mWindow.setSwapInterval(mFramePacer.swapInterval());
+	std::string frameStatsPath = mConfig["frameStats"].as<std::string>("");
+	std::string latencyStatsPath = mConfig["latencyStats"].as<std::string>("");
+
+	mDispatcher.sink<hyperbeetle::EventKey>().connect<&Application::onKey>(this);
+	mDispatcher.sink<hyperbeetle::EventKey>().connect<&StateManager::onKey>(&mStates);
+	mStates.push<LoadingState>();
 
 	double lastTime = glfwGetTime();
 	double currentTime;
 
 	while (kRunning) {
+		HB_PROFILE_ZONE("render.frame");
+		auto allocations = hyperbeetle::allocations::thisThread();
+
 		{
-			std::lock_guard lck{ mDispatcherMtx };
-			mDispatcher.update();
+			HB_PROFILE_ZONE("render.dispatch");
+
+			hyperbeetle::EventKey event;
+			while (mSimulation.uiEvents().pop(event))
+				mDispatcher.trigger(event);
+			mLatency.collect();
+
+			mStates.applyPending();
+			applyConfigReload();
 		}
 
+		mAudioSwitcher.poll(mAudioEngine, [this](hyperbeetle::AudioEngine&, hyperbeetle::AudioEngine& next) {
+			mSoundBank.uninit();
+			mSoundBank.setGroup(&next.mEffects.sfx());
+			mSoundBank.init(next.mEngine);
+
+			updateConfig([&](YAML::Node& config) {
+				applyLatencyConfig(config, next);
+				config["audioDevice"] = next.mDeviceName;
+			});
+		});
+
+		mSimulation.frames().update();
+
 		currentTime = glfwGetTime();
 		mDeltaTime = currentTime - lastTime;
 		lastTime = currentTime;
 
 		mUiWidth = static_cast<float>(mFramebufferWidth) / mContentScaleX;
 		mUiHeight = static_cast<float>(mFramebufferHeight) / mContentScaleY;
+
+		glViewport(0, 0, mFramebufferWidth, mFramebufferHeight);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
 		nvgBeginFrame(mVg, mUiWidth, mUiHeight, fmaxf(mContentScaleX, mContentScaleY));
 
-		mState.update();
+		{
+			HB_PROFILE_ZONE("render.ui");
+			drawOverlay();
+			mStates.update();
+		}
+
+		{
+			HB_PROFILE_ZONE("render.submit");
+			nvgEndFrame(mVg);
+			mFrameArena.reset();
+		}
+
+		{
+			HB_PROFILE_ZONE("render.pace");
+			mFramePacer.wait();
+		}
+
+		{
+			HB_PROFILE_ZONE("render.swap");
+			mWindow.swapBuffers();
+		}
+
+		mFramePacer.endFrame();
+		HB_PROFILE_FRAME();
 
-		nvgEndFrame(mVg);
-		
-		mWindow.swapBuffers();
+		// Every input the simulation frame drawn had consumed is on screen now, including those of ticks never drawn.
+		if (std::uint64_t held = mSimulation.frames().read().current.heldInputs; held > mDisplayedInputs) {
+			mLatency.release(held - mDisplayedInputs);
+			mDisplayedInputs = held;
+		}
+
+		mFrameAllocations = hyperbeetle::allocations::thisThread() - allocations;
+		++mFrames;
+		if (mFrameAllocations.allocations)
+			++mAllocatingFrames;
 	}
 
-	mState.destroy();
+	if (!frameStatsPath.empty()) {
+		try {
+			mFramePacer.writeStats(frameStatsPath, HB_VERSION_FULL);
+		}
+		catch (std::exception const& e) {
+			std::cout << e.what() << '\n';
+		}
+	}
+
+	if (!latencyStatsPath.empty()) {
+		try {
+			mLatency.collect();
+			mLatency.writeStats(latencyStatsPath, HB_VERSION_FULL);
+		}
+		catch (std::exception const& e) {
+			std::cout << e.what() << '\n';
+		}
+	}
+
+	mStates.clear();
+	mDispatcher.disconnect(&mStates);
+	mDispatcher.disconnect(this);
 
 	glDeleteVertexArrays(1, &vao);
 
@@ -360,143 +617,550 @@ void Application::runRenderThread() {
 	glfwPostEmptyEvent();
 }
 
-void MenuState::onKey(EventKey const& e) {
+void Application::startLoading(std::string const& audioDevice) {
+	// The device opens while the window does, sounds are decoded at its format once it is open.
+	mStartup.audio = mJobs->submit([this, audioDevice]() {
+		mAudioEngine->init(audioDevice, mSongClock);
+		applyLatencyConfig(mConfig, *mAudioEngine);
+		mAudioEngine->start();
+		mSoundBank.setVfs(mPackVfs.vfs());
+		mSoundBank.setGroup(&mAudioEngine->mEffects.sfx());
+		mSoundBank.setLatencyTrace(&mLatency);
+		mSoundBank.init(mAudioEngine->mEngine);
+	});
+	mStartup.jobs.push_back(mStartup.audio);
+
+	constexpr std::array<char const*, 2> kSounds = { "cursor1.ogg", "select1.ogg" };
+	for (std::size_t i = 0; i < kSounds.size(); ++i) {
+		mStartup.jobs.push_back(mJobs->submit([this, i, path = kSounds[i]]() {
+			mStartup.sounds[i] = hyperbeetle::SoundBank::decode(path, mSoundBank.channels(), mSoundBank.sampleRate(), mPackVfs.vfs());
+		}, { mStartup.audio }));
+	}
+
+	// Served in place from the pack's mapping unless it was compressed.
+	mStartup.font = mJobs->submit([this]() { mFont = mPack.load("NotoSans-Regular.ttf"); });
+	mStartup.jobs.push_back(mStartup.font);
+}
+
+void Application::finishLoading() {
+	if (!mStartup.font->error()) {
+		// NanoVG only reads the data and doesn't free it.
+		auto data = const_cast<unsigned char*>(reinterpret_cast<unsigned char const*>(mFont.data()));
+		int id = nvgCreateFontMem(mVg, "notosans-regular", data, static_cast<int>(mFont.size()), 0);
+		if (id != -1)
+			nvgFontFaceId(mVg, id);
+	}
+
+	mSfxCursor = mSoundBank.add(std::move(mStartup.sounds[0]));
+	mSfxSelect = mSoundBank.add(std::move(mStartup.sounds[1]));
+
+	mStartup.seconds = hyperbeetle::nanosecondsToSeconds(hyperbeetle::now() - mStartup.begin);
+	mStartup.loaded = true;
+	std::cout << "Startup " << mStartup.seconds * 1000.0 << "ms to the menu, " << mJobs->threadCount() << " loader threads, assets from " << (mPack.empty() ? "loose files" : kAssetPack) << "\n";
+}
+
+void Application::scanLevels() {
+	if (mLibraryScan && !mLibraryScan->finished()) return;
+
+	// The first scan starts from the saved index, so the menu lists levels before it has looked at any file.
+	bool first = !mLibraryScan;
+	mLibraryScan = mJobs->submit([this, first]() {
+		try {
+			if (first)
+				mLibrary->load();
+			auto scan = mLibrary->scan(&*mJobs);
+			std::cout << "Library scan " << scan.seconds * 1000.0 << "ms, " << scan.files << " levels, " << scan.read << " read, " << scan.broken << " broken, " << scan.removed << " removed\n";
+		}
+		catch (std::exception const& e) {
+			std::cout << e.what() << '\n';
+		}
+	});
+
+	// Without loader threads the scan only runs once something waits for it.
+	if (!mJobs->threadCount())
+		mJobs->wait(mLibraryScan);
+}
+
+void Application::watchConfig() {
+	mConfigWatcher.watch(kConfigPath);
+	mConfigWatcher.start([this](std::filesystem::path const& path, std::int64_t changedAt) {
+		auto parse = [this, path, changedAt]() {
+			std::string text;
+			{
+				std::ifstream file(path, std::ios::binary);
+				text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			}
+			// The game saving a setting.
+			if (hyperbeetle::hash64(text) == mConfigWriter.lastWrite()) return;
+
+			YAML::Node config;
+			try {
+				config = YAML::Load(text);
+			}
+			catch (YAML::Exception const& e) {
+				std::cout << path.string() << ": " << e.what() << ", keeping the config from before\n";
+				return;
+			}
+			if (!config.IsMap() && !config.IsNull()) {
+				std::cout << path.string() << " isn't a map of settings, keeping the config from before\n";
+				return;
+			}
+
+			{
+				std::lock_guard lock(mConfigReloadMutex);
+				mConfigReloaded = ConfigReload{ config, changedAt };
+			}
+			mConfigReloadPending.store(true, std::memory_order_release);
+		};
+
+		// One parse at a time, in the order of the saves.
+		mConfigReload = mConfigReload ? mJobs->submit(parse, { mConfigReload }) : mJobs->submit(parse);
+		if (!mJobs->threadCount())
+			mJobs->wait(mConfigReload);
+	});
+}
+
+void Application::applyConfigReload() {
+	// Startup jobs still read mConfig and open the device behind the loading screen, the reload waits for them.
+	if (!mStartup.loaded || !mConfigReloadPending.load(std::memory_order_acquire)) return;
+
+	ConfigReload reload;
+	{
+		std::lock_guard lock(mConfigReloadMutex);
+		reload = std::move(*mConfigReloaded);
+		mConfigReloaded.reset();
+		mConfigReloadPending.store(false, std::memory_order_relaxed);
+	}
+
+	// Only settings whose text changed are applied, the file is usually saved with one edit at a time.
+	YAML::Node const& before = mConfig;
+	YAML::Node const& after = reload.config;
+	auto text = [](YAML::Node const& node) { return node.IsDefined() ? YAML::Dump(node) : std::string(); };
+	std::vector<std::string> keys;
+	for (YAML::Node const* config : { &before, &after }) {
+		if (!config->IsMap()) continue;
+		for (auto const& entry : *config) {
+			std::string key = entry.first.as<std::string>("");
+			if (std::find(keys.begin(), keys.end(), key) == keys.end() && text(before[key]) != text(after[key]))
+				keys.push_back(key);
+		}
+	}
+	if (keys.empty()) return;
+
+	std::string applied, restart;
+	bool pacing = false;
+	for (std::string const& key : keys) {
+		if (key == "framePacing" || key == "frameCap")
+			pacing = true;
+		else if (key == "profiler")
+			hyperbeetle::profiler::setEnabled(after["profiler"].as<bool>(true));
+		else if (key == "latency")
+			applyLatencyConfig(after, *mAudioEngine);
+		else {
+			// The device, the loader and the simulation are set up once, switching devices has its own menu.
+			restart += restart.empty() ? key : ", " + key;
+			continue;
+		}
+		applied += applied.empty() ? key : ", " + key;
+	}
+
+	if (pacing) {
+		auto mode = hyperbeetle::FramePacer::parseMode(after["framePacing"].as<std::string>(""));
+		mFramePacer.setMode(mode.value_or(hyperbeetle::FramePacer::Mode::Vsync), after["frameCap"].as<double>(hyperbeetle::FramePacer::kDefaultCap));
+		mWindow.setSwapInterval(mFramePacer.swapInterval());
+	}
+
+	// Later changes from the game are written on top of the edited file.
+	mConfig = reload.config;
+
+	std::cout << "Reloaded " << kConfigPath << " " << hyperbeetle::nanosecondsToSeconds(hyperbeetle::now() - reload.changedAt) * 1000.0 << "ms after the save";
+	if (!applied.empty()) std::cout << ", applied " << applied;
+	if (!restart.empty()) std::cout << ", after a restart " << restart;
+	std::cout << '\n';
+}
+
+void Application::onKey(hyperbeetle::EventKey const& e) {
+	if (e.key != GLFW_KEY_F9 || e.action != GLFW_PRESS) return;
+
+	// Stalls this one frame, which shows up at the end of the trace it writes.
+	auto path = "trace-" + std::to_string(std::chrono::system_clock::now().time_since_epoch() / std::chrono::seconds(1)) + ".json";
+	std::int64_t events = hyperbeetle::profiler::writeChromeTrace(path);
+	if (events < 0)
+		std::cout << "Couldn't write " << path << "\n";
+	else
+		std::cout << "Wrote " << events << " zones to " << path << "\n";
+}
+
+void Application::drawOverlay() {
+	hyperbeetle::ui::OverlayStats stats;
+	stats.build = HB_VERSION_FULL;
+	stats.deltaTime = mDeltaTime;
+	stats.framebufferWidth = mFramebufferWidth;
+	stats.framebufferHeight = mFramebufferHeight;
+	stats.contentScaleX = mContentScaleX;
+	stats.contentScaleY = mContentScaleY;
+
+	stats.device = mAudioEngine->mDeviceName;
+	stats.switchingDevice = mAudioSwitcher.busy();
+	stats.audioClock = mSongClock.engineTime();
+	stats.outputLatency = mSongClock.outputLatency();
+	stats.inputLatency = mSongClock.inputLatency();
+	stats.switching = mAudioSwitcher.timings();
+	stats.audioCallbacks = mAudioEngine->mCallbackCount.load(std::memory_order_relaxed);
+	if (stats.audioCallbacks) {
+		auto& effects = mAudioEngine->mEffects;
+		stats.effectsNanoseconds = effects.processNanoseconds();
+		stats.ducking = effects.compressor().reduction();
+		stats.cutoff = effects.filter().currentCutoff();
+	}
+	stats.voicesInUse = mSoundBank.voicesInUse();
+	stats.voiceCount = mSoundBank.voiceCount();
+	stats.voicesStolen = mSoundBank.voicesStolen();
+
+	stats.startupSeconds = mStartup.seconds;
+	stats.loaderThreads = mJobs->threadCount();
+	stats.assets = mPack.empty() ? "loose files" : kAssetPack;
+	stats.libraryScan = mLibrary->lastScan();
+
+	stats.inputPeak = mInputQueue.maxDepth();
+	stats.inputDropped = mInputQueue.overflows();
+	stats.uiEventsDropped = mSimulation.frames().read().current.uiEventsDropped;
+	stats.frameAllocations = mFrameAllocations;
+	stats.frames = mFrames;
+	stats.allocatingFrames = mAllocatingFrames;
+	stats.totalAllocations = hyperbeetle::allocations::total().allocations;
+
+	{
+		auto const& frame = mSimulation.frames().read();
+		double alpha = mSimulation.alpha(frame, hyperbeetle::now());
+		stats.tickRate = mSimulation.tickRate();
+		stats.tick = frame.current.tick;
+		stats.simulationTime = std::lerp(frame.previous.time, frame.current.time, alpha);
+		stats.stepSeconds = frame.stepSeconds;
+	}
+	stats.renderdoc = kRdocApi != nullptr;
+
+	hyperbeetle::ui::drawOverlay(mVg, mFrameArena, mUiWidth, mUiHeight, stats, mFramePacer, mLatency);
+}
+
+void Application::setFramePacing(hyperbeetle::FramePacer::Mode mode, double cap) {
+	mFramePacer.setMode(mode, cap);
+	mWindow.setSwapInterval(mFramePacer.swapInterval());
+
+	updateConfig([&](YAML::Node& config) {
+		config["framePacing"] = std::string(hyperbeetle::FramePacer::modeName(mode));
+		config["frameCap"] = mFramePacer.cap();
+	});
+}
+
+void StateManager::applyPending() {
+	// Moved out first, entering a state may queue more changes for the next frame.
+	auto pending = std::move(mPending);
+	mPending.clear();
+
+	for (auto& state : pending) {
+		if (state) {
+			mStates.push_back(std::move(state));
+			mStates.back()->enter();
+		}
+		else if (!mStates.empty()) {
+			mStates.back()->exit();
+			mStates.pop_back();
+		}
+	}
+}
+
+void StateManager::clear() {
+	mPending.clear();
+	while (!mStates.empty()) {
+		mStates.back()->exit();
+		mStates.pop_back();
+	}
+}
+
+void Menu::onKey(hyperbeetle::EventKey const& e) {
 	auto& application = getApplication();
 
 	if (e.action != GLFW_PRESS) return;
 
-	if (e.key == GLFW_KEY_ENTER)
+	if (e.key == GLFW_KEY_ENTER) {
 		mPerformAction = true;
+		mPerformActionAt = e.tracedAt;
+	}
 
 	if (e.key == GLFW_KEY_DOWN) {
-		++mSelectedOption;
-		ma_engine_play_sound(&application.mAudioEngine.mEngine, "cursor1.ogg", nullptr);
+		++mSelected;
+		application.mSoundBank.play(application.mSfxCursor, 0, e.tracedAt);
 	}
 
 	if (e.key == GLFW_KEY_UP) {
-		--mSelectedOption;
-		ma_engine_play_sound(&application.mAudioEngine.mEngine, "cursor1.ogg", nullptr);
+		--mSelected;
+		application.mSoundBank.play(application.mSfxCursor, 0, e.tracedAt);
 	}
 }
 
-void MenuState::init() {
+void Menu::draw() {
 	auto& application = getApplication();
-	std::lock_guard lck{ application.mDispatcherMtx };
-	application.mDispatcher.sink<EventKey>().connect<&MenuState::onKey>(this);
+
+	if (mOptions.empty()) return;
+
+	mSelected = std::clamp(mSelected, 0, static_cast<int>(mOptions.size()) - 1);
+	hyperbeetle::ui::drawMenu(application.mVg, application.mUiWidth, application.mUiHeight, mOptions, mSelected);
+
+	if (mPerformAction) {
+		mPerformAction = false;
+		application.mSoundBank.play(application.mSfxSelect, 0, mPerformActionAt);
+		mOptions[mSelected].action();
+	}
 }
 
 void MenuState::update() {
+	poll();
+
+	if (mDirty) {
+		mMenu.mOptions.clear();
+		build(mMenu.mOptions);
+		mDirty = false;
+	}
+
+	mMenu.draw();
+}
+
+void LoadingState::update() {
 	auto& application = getApplication();
 
-	glViewport(0, 0, application.mFramebufferWidth, application.mFramebufferHeight);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	auto const& jobs = application.mStartup.jobs;
+	auto finished = std::count_if(jobs.begin(), jobs.end(), [](hyperbeetle::JobHandle const& job) { return job->finished(); });
 
-	std::stringstream stream;
-	stream << HB_VERSION_FULL << '\n';
-	stream << application.mDeltaTime << '\n';
-	stream << static_cast<int>(1.0 / application.mDeltaTime) << '\n';
-	stream << application.mFramebufferWidth << 'x' << application.mFramebufferHeight << '\n';
-	stream << application.mContentScaleX << 'x' << application.mContentScaleY << '\n';
-	stream << application.mAudioEngine.mDeviceName;
+	float width = application.mUiWidth / 2;
+	float x = (application.mUiWidth - width) / 2;
+	float y = application.mUiHeight / 2;
 
-	if (kRdocApi) {
-		stream << "\nRenderdoc attached";
+	nvgBeginPath(application.mVg);
+	nvgRect(application.mVg, x, y - 4, width, 8);
+	nvgFillColor(application.mVg, nvgRGBA(255, 255, 255, 64));
+	nvgFill(application.mVg);
+
+	nvgBeginPath(application.mVg);
+	nvgRect(application.mVg, x, y - 4, width * static_cast<float>(finished) / static_cast<float>(jobs.size()), 8);
+	nvgFillColor(application.mVg, nvgRGBf(1, 1, 1));
+	nvgFill(application.mVg);
+
+	if (finished == static_cast<std::ptrdiff_t>(jobs.size())) {
+		application.finishLoading();
+		application.mStates.pop();
+		application.mStates.push<MainMenuState>();
 	}
+}
 
-	std::string str = stream.str();
+void MainMenuState::build(std::vector<Menu::Option>& options) {
+	auto& application = getApplication();
 
-	
+	options.emplace_back("Play", [&]() { application.mStates.push<LibraryState>(); });
+	options.emplace_back("Options", [&]() { application.mStates.push<OptionsState>(); });
+	options.emplace_back("Quit", []() { kRunning = false; });
+}
 
-	nvgTextAlign(application.mVg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
-	nvgTextBox(application.mVg, 8, 8, application.mUiWidth - 16, str.c_str(), nullptr);
+void OptionsState::enter() {
+	getApplication().mAudioDevices.requestRefresh();
+}
 
+void OptionsState::poll() {
+	if (getApplication().mAudioDevices.version() != mDeviceVersion)
+		mDirty = true;
+}
 
-	nvgTextAlign(application.mVg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+void OptionsState::build(std::vector<Menu::Option>& options) {
+	auto& application = getApplication();
 
-	struct MenuOption final {
-		std::string text;
-		std::function<void()> action;
-	};
+	auto devices = application.mAudioDevices.snapshot();
+	mDeviceVersion = devices->version;
+
+	for (std::string const& device : devices->playback) {
+		// Opened in the background, the render loop swaps it in and saves the choice once it's ready.
+		options.emplace_back(device, [&application, device]() { application.mAudioSwitcher.request(device); });
+	}
+
+	{
+		using Mode = hyperbeetle::FramePacer::Mode;
+
+		auto& pacer = application.mFramePacer;
+		std::string text = "Frame pacing: " + std::string(hyperbeetle::FramePacer::modeName(pacer.mode()));
+		if (pacer.mode() == Mode::Capped)
+			text += ' ' + std::to_string(static_cast<int>(pacer.cap()));
+
+		options.emplace_back(std::move(text), [&application, this]() {
+			auto& pacer = application.mFramePacer;
+			auto next = static_cast<Mode>((static_cast<int>(pacer.mode()) + 1) % 3);
+			application.setFramePacing(next, pacer.cap());
+			mDirty = true;
+		});
+	}
+
+	options.emplace_back("Calibrate latency", [&]() { application.mStates.push<CalibrationState>(); });
+	options.emplace_back("Back", [&]() { application.mStates.pop(); });
+}
+
+void LibraryState::onKey(hyperbeetle::EventKey const& e) {
+	auto& application = getApplication();
+
+	if (e.action != GLFW_PRESS && e.action != GLFW_REPEAT) return;
 
-	static int menuId = 0;
-	std::vector<MenuOption> options;
-
-	auto populateMenuOptions = [&](std::vector<MenuOption>& options, int id) {
-		if (id == 0) {
-			options.emplace_back("Play", []() {});
-			options.emplace_back("Options", [&]() {
-				menuId = 1;
-				mSelectedOption = 0;
-				});
-			options.emplace_back("Quit", [&]() { kRunning = false; });
+	int selected = mList.selected;
+	switch (e.key) {
+	case GLFW_KEY_ESCAPE: application.mStates.pop(); return;
+	case GLFW_KEY_ENTER:
+		mPerformAction = true;
+		mPerformActionAt = e.tracedAt;
+		return;
+	case GLFW_KEY_F5: application.scanLevels(); return;
+	case GLFW_KEY_UP: --selected; break;
+	case GLFW_KEY_DOWN: ++selected; break;
+	case GLFW_KEY_PAGE_UP: selected -= mList.rows; break;
+	case GLFW_KEY_PAGE_DOWN: selected += mList.rows; break;
+	case GLFW_KEY_HOME: selected = 0; break;
+	case GLFW_KEY_END: selected = static_cast<int>(mSearch.results.size()) - 1; break;
+	case GLFW_KEY_BACKSPACE:
+		if (!mQuery.empty()) {
+			mQuery.pop_back();
+			mDirty = true;
+		}
+		return;
+	default: {
+		char c = 0;
+		if (e.key >= GLFW_KEY_A && e.key <= GLFW_KEY_Z) c = static_cast<char>('a' + e.key - GLFW_KEY_A);
+		else if (e.key >= GLFW_KEY_0 && e.key <= GLFW_KEY_9) c = static_cast<char>('0' + e.key - GLFW_KEY_0);
+		else if (e.key == GLFW_KEY_SPACE) c = ' ';
+		if (c && mQuery.size() < 64) {
+			mQuery.push_back(c);
+			mDirty = true;
+			mList.selected = 0;
 		}
+		return;
+	}
+	}
 
-		if (id == 1) {
-			ma_device_info* pPlaybackInfos;
-			ma_uint32 playbackCount;
-			if (ma_context_get_devices(&application.mAudioEngine.mContext, &pPlaybackInfos, &playbackCount, nullptr, nullptr) != MA_SUCCESS) {
-				// Error.
-			}
+	selected = std::clamp(selected, 0, std::max(static_cast<int>(mSearch.results.size()) - 1, 0));
+	if (selected != mList.selected)
+		application.mSoundBank.play(application.mSfxCursor, 0, e.tracedAt);
+	mList.selected = selected;
+}
+
+void LibraryState::update() {
+	auto& application = getApplication();
+	auto& library = *application.mLibrary;
+
+	if (library.version() != mVersion || !mIndex) {
+		mVersion = library.version();
+		mIndex = library.snapshot();
+		mDirty = true;
+	}
+	if (mDirty) {
+		std::int64_t begin = hyperbeetle::now();
+		mIndex->search(mQuery, mSearch);
+		mSearchSeconds = hyperbeetle::nanosecondsToSeconds(hyperbeetle::now() - begin);
+		mDirty = false;
+	}
 
-			for (ma_uint32 iDevice = 0; iDevice < playbackCount; ++iDevice) {
+	mList.query = mQuery;
+	mList.searchSeconds = mSearchSeconds;
+	mList.scanning = application.mLibraryScan && !application.mLibraryScan->finished();
+	hyperbeetle::ui::drawLibrary(application.mVg, application.mFrameArena, application.mUiWidth, application.mUiHeight, *mIndex, mSearch, mList);
 
-				options.emplace_back(pPlaybackInfos[iDevice].name, [&]() {
-					application.mAudioEngine.uninit();
-					application.mAudioEngine.init(options[mSelectedOption].text);
+	// Levels can't be played from the menu yet, choosing one only confirms it.
+	if (mPerformAction) {
+		mPerformAction = false;
+		if (!mSearch.results.empty())
+			application.mSoundBank.play(application.mSfxSelect, 0, mPerformActionAt);
+	}
+}
 
-					// Save choice
+void CalibrationState::enter() {
+	mCalibration.start(getApplication().mSongClock.engineTime());
+}
 
-					YAML::Node config = YAML::Node();
+void CalibrationState::onKey(hyperbeetle::EventKey const& e) {
+	auto& application = getApplication();
 
-					try {
-						config = YAML::LoadFile("config.yaml");
-					}
-					catch (YAML::BadFile const& e) {}
+	if (e.action != GLFW_PRESS) return;
 
-					config["audioDevice"] = options[mSelectedOption].text;
+	if (e.key == GLFW_KEY_SPACE)
+		mCalibration.tap(application.mSongClock.engineTimeAt(e.timestamp));
 
-					std::ofstream myfile;
-					myfile.open("config.yaml", std::ios::binary | std::ios::out);
-					myfile << config;
-					myfile.close();
-					});
-			}
+	if (e.key == GLFW_KEY_ENTER && mCalibration.phase() == hyperbeetle::LatencyCalibration::Phase::Done)
+		mSave = true;
 
+	if (e.key == GLFW_KEY_ESCAPE)
+		application.mStates.pop();
+}
 
-			options.emplace_back("Back", [&]() {
-				mSelectedOption = 0;
-				menuId = 0;
-			});
-		}
-	};
+void CalibrationState::update() {
+	using hyperbeetle::LatencyCalibration;
 
-	populateMenuOptions(options, menuId);
+	auto& application = getApplication();
+	auto& clock = application.mSongClock;
 
-	{
-		nvgFontSize(application.mVg, std::min(application.mUiHeight / options.size() / 2, 64.0f));
+	double engineTime = clock.engineTime();
+	float centerX = application.mUiWidth / 2;
+	float centerY = application.mUiHeight / 2;
+
+	nvgTextAlign(application.mVg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
 
-		if (mSelectedOption < 0) mSelectedOption = 0;
-		if (mSelectedOption >= options.size()) mSelectedOption = options.size() - 1;
+	char const* text = "";
 
-		for (int i = 0; i < options.size(); ++i) {
-			if (i == mSelectedOption) nvgFillColor(application.mVg, nvgRGBf(1, 0, 0));
-			else nvgFillColor(application.mVg, nvgRGBf(1, 1, 1));
+	switch (mCalibration.phase()) {
+	case LatencyCalibration::Phase::Audio: {
+		text = "Tap SPACE along with the clicks";
 
-			nvgText(application.mVg, application.mUiWidth / 2, application.mUiHeight / (options.size() + 1) * (i + 1), options[i].text.c_str(), nullptr);
+		// Schedule clicks slightly ahead so they land on the exact engine frame regardless of frame rate.
+		for (int beat = std::max(mNextClick, mCalibration.beatAfter(engineTime)); mCalibration.beatTime(beat) < engineTime + 0.25; ++beat) {
+			application.mSoundBank.play(application.mSfxCursor, static_cast<std::uint64_t>(mCalibration.beatTime(beat) * clock.sampleRate()));
+			mNextClick = beat + 1;
 		}
-
-		if (mPerformAction) {
-			options[mSelectedOption].action();
-			ma_engine_play_sound(&application.mAudioEngine.mEngine, "select1.ogg", nullptr);
-			mPerformAction = false;
+		break;
+	}
+	case LatencyCalibration::Phase::Visual: {
+		text = "Tap SPACE along with the flashes";
+
+		int beat = mCalibration.beatAfter(engineTime) - 1;
+		if (beat >= 0 && engineTime - mCalibration.beatTime(beat) < 0.1) {
+			nvgBeginPath(application.mVg);
+			nvgRect(application.mVg, centerX - 32, centerY + 48, 64, 64);
+			nvgFillColor(application.mVg, nvgRGBf(1, 1, 1));
+			nvgFill(application.mVg);
 		}
+		break;
 	}
-}
+	case LatencyCalibration::Phase::Done: {
+		hyperbeetle::FrameText result(&application.mFrameArena);
+		result << "Output " << static_cast<int>(mCalibration.outputLatency() * 1000.0) << "ms, input " << static_cast<int>(mCalibration.inputLatency() * 1000.0) << "ms";
 
-void MenuState::destroy() {
-	auto& application = getApplication();
-	std::lock_guard lck{ application.mDispatcherMtx };
-	application.mDispatcher.disconnect(this);
+		nvgFontSize(application.mVg, 32.0f);
+		nvgFillColor(application.mVg, nvgRGBf(1, 1, 1));
+		nvgText(application.mVg, centerX, centerY + 64, result.c_str(), nullptr);
+
+		text = "ENTER to save, ESC to discard";
+		break;
+	}
+	}
+
+	nvgFontSize(application.mVg, 32.0f);
+	nvgFillColor(application.mVg, nvgRGBf(1, 1, 1));
+	nvgText(application.mVg, centerX, centerY, text, nullptr);
+
+	if (mSave) {
+		clock.setLatency(mCalibration.outputLatency(), mCalibration.inputLatency());
+
+		application.updateConfig([&](YAML::Node& config) {
+			YAML::Node latency = config["latency"][application.mAudioEngine->mDeviceName];
+			latency["output"] = mCalibration.outputLatency();
+			latency["input"] = mCalibration.inputLatency();
+		});
+
+		application.mSoundBank.play(application.mSfxSelect);
+		mSave = false;
+		application.mStates.pop();
+	}
 }
 
 static Application* kApplication;
@@ -506,6 +1170,11 @@ Application& getApplication() {
 }
 
 int main(int argc, char* argv[]) {
+	if (argc > 1 && std::string_view(argv[1]) == "--headless") {
+		auto options = hyperbeetle::parseHeadlessOptions(std::span<char* const>(argv + 2, argc - 2));
+		return options ? hyperbeetle::runHeadless(*options) : hyperbeetle::kHeadlessUsage;
+	}
+
 	Application application;
 	kApplication = &application;
 	application.runMainThread();
@@ -0,0 +1,153 @@
+#include "hb_file_watcher.hpp"
+
+#include "hb_clock.hpp"
+#include "hb_profiler.hpp"
+
+#include <algorithm>
+
+#ifdef __linux__
+#	include <cerrno>
+#	include <poll.h>
+#	include <sys/eventfd.h>
+#	include <sys/inotify.h>
+#	include <unistd.h>
+#endif
+
+namespace hyperbeetle {
+	void FileWatcher::watch(std::filesystem::path path) {
+		std::filesystem::path absolute = std::filesystem::absolute(path).lexically_normal();
+		mWatched.push_back({ std::move(path), absolute.parent_path(), absolute.filename() });
+	}
+
+	void FileWatcher::start(Callback callback) {
+		if (mThread.joinable()) return;
+		mCallback = std::move(callback);
+
+		// Changes from before the start aren't reported.
+		for (Watched& watched : mWatched) {
+			std::error_code error;
+			watched.modified = std::filesystem::last_write_time(watched.path, error);
+			watched.size = error ? 0 : std::filesystem::file_size(watched.path, error);
+		}
+
+		if (openNotify())
+			mThread = std::jthread([this](std::stop_token stopToken) { notify(stopToken); });
+		else
+			mThread = std::jthread([this](std::stop_token stopToken) { poll(stopToken); });
+	}
+
+	void FileWatcher::stop() {
+		if (!mThread.joinable()) return;
+		mThread.request_stop();
+#ifdef __linux__
+		if (mStop >= 0) {
+			std::uint64_t one = 1;
+			[[maybe_unused]] ssize_t written = ::write(mStop, &one, sizeof(one));
+		}
+#endif
+		mThread.join();
+		closeNotify();
+	}
+
+	void FileWatcher::poll(std::stop_token stopToken) {
+		HB_PROFILE_THREAD("file watcher");
+
+		std::unique_lock lock(mMutex);
+		for (;;) {
+			mWake.wait_for(lock, stopToken, kPollInterval, []() { return false; });
+			if (stopToken.stop_requested())
+				break;
+
+			std::int64_t changedAt = now();
+			for (Watched& watched : mWatched) {
+				std::error_code error;
+				auto modified = std::filesystem::last_write_time(watched.path, error);
+				if (error) continue;
+				auto size = std::filesystem::file_size(watched.path, error);
+				if (error || (modified == watched.modified && size == watched.size)) continue;
+
+				watched.modified = modified;
+				watched.size = size;
+				mCallback(watched.path, changedAt);
+			}
+		}
+	}
+
+#ifdef __linux__
+	bool FileWatcher::openNotify() {
+		mInotify = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+		mStop = ::eventfd(0, EFD_CLOEXEC);
+		if (mInotify < 0 || mStop < 0) {
+			closeNotify();
+			return false;
+		}
+
+		// Writes in place close the file, saves through a temporary rename it over the old one.
+		for (Watched const& watched : mWatched) {
+			auto known = std::find_if(mDirectories.begin(), mDirectories.end(), [&](auto const& entry) { return entry.second == watched.directory; });
+			if (known != mDirectories.end()) continue;
+
+			int descriptor = ::inotify_add_watch(mInotify, watched.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+			if (descriptor < 0) {
+				closeNotify();
+				return false;
+			}
+			mDirectories.emplace_back(descriptor, watched.directory);
+		}
+		return true;
+	}
+
+	void FileWatcher::closeNotify() {
+		if (mInotify >= 0) ::close(mInotify);
+		if (mStop >= 0) ::close(mStop);
+		mInotify = mStop = -1;
+		mDirectories.clear();
+	}
+
+	void FileWatcher::notify(std::stop_token stopToken) {
+		HB_PROFILE_THREAD("file watcher");
+
+		alignas(inotify_event) char buffer[4096];
+		std::vector<bool> changed(mWatched.size());
+
+		while (!stopToken.stop_requested()) {
+			pollfd descriptors[2] = { { mInotify, POLLIN, 0 }, { mStop, POLLIN, 0 } };
+			if (::poll(descriptors, 2, -1) < 0) {
+				if (errno == EINTR) continue;
+				break;
+			}
+			if (descriptors[1].revents)
+				break;
+
+			ssize_t length = ::read(mInotify, buffer, sizeof(buffer));
+			if (length <= 0) continue;
+			std::int64_t changedAt = now();
+
+			// One callback per file for everything read at once, a save is often a write and a rename.
+			std::fill(changed.begin(), changed.end(), false);
+			for (ssize_t offset = 0; offset < length;) {
+				auto const& event = *reinterpret_cast<inotify_event const*>(buffer + offset);
+				offset += static_cast<ssize_t>(sizeof(inotify_event) + event.len);
+				if (!event.len) continue;
+
+				auto directory = std::find_if(mDirectories.begin(), mDirectories.end(), [&](auto const& entry) { return entry.first == event.wd; });
+				if (directory == mDirectories.end()) continue;
+
+				for (std::size_t i = 0; i < mWatched.size(); ++i) {
+					if (mWatched[i].directory == directory->second && mWatched[i].name == event.name)
+						changed[i] = true;
+				}
+			}
+
+			for (std::size_t i = 0; i < mWatched.size(); ++i) {
+				if (changed[i])
+					mCallback(mWatched[i].path, changedAt);
+			}
+		}
+	}
+#else
+	bool FileWatcher::openNotify() { return false; }
+	void FileWatcher::closeNotify() {}
+	void FileWatcher::notify(std::stop_token) {}
+#endif
+}
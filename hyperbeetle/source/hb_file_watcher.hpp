@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace hyperbeetle {
+	// Calls back on a thread of its own when a watched file is written or replaced. On Linux it asks inotify about the
+	// directories the files are in, so editors that save by renaming a new file over the old one are seen too.
+	// Elsewhere, or if inotify can't be set up, it polls modification times.
+	class FileWatcher final {
+	public:
+		// `changedAt` is hyperbeetle::now() when the change was seen.
+		using Callback = std::function<void(std::filesystem::path const& path, std::int64_t changedAt)>;
+
+		static constexpr std::chrono::milliseconds kPollInterval{ 100 };
+
+		FileWatcher() = default;
+		FileWatcher(FileWatcher const&) = delete;
+		FileWatcher& operator=(FileWatcher const&) = delete;
+		~FileWatcher() noexcept { stop(); }
+
+		// Only while stopped. A file that doesn't exist yet is seen once it is created. Callbacks get `path` as given.
+		void watch(std::filesystem::path path);
+
+		void start(Callback callback);
+		void stop();
+
+		// Whether changes come from inotify rather than polling, once started.
+		inline bool notified() const { return mInotify >= 0; }
+	private:
+		struct Watched final {
+			std::filesystem::path path; // as given
+			std::filesystem::path directory, name; // absolute
+			std::filesystem::file_time_type modified{};
+			std::uintmax_t size = 0;
+		};
+
+		void poll(std::stop_token stopToken);
+		void notify(std::stop_token stopToken);
+		// Sets up inotify, returns false if it isn't available.
+		bool openNotify();
+		void closeNotify();
+
+		std::vector<Watched> mWatched;
+		Callback mCallback;
+
+		// Linux. The inotify descriptor, its watch descriptors by directory and an eventfd that wakes it to stop.
+		int mInotify = -1;
+		std::vector<std::pair<int, std::filesystem::path>> mDirectories;
+		int mStop = -1;
+
+		std::mutex mMutex;
+		std::condition_variable_any mWake;
+		std::jthread mThread;
+	};
+}
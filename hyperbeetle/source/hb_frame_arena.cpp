@@ -0,0 +1,45 @@
+#include "hb_frame_arena.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace hyperbeetle {
+	void* FrameArena::Overflow::do_allocate(std::size_t bytes, std::size_t alignment) {
+		mBytes += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void FrameArena::Overflow::do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) {
+		std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+	}
+
+	FrameArena::FrameArena(std::size_t capacity)
+		: mBuffer(std::make_unique<std::byte[]>(capacity))
+		, mCapacity(capacity) {
+		mResource.emplace(mBuffer.get(), mCapacity, &mOverflow);
+	}
+
+	void FrameArena::reset() {
+		// Hands the overflow blocks back and rewinds to the start of the buffer.
+		mResource->release();
+
+		if (mOverflow.mBytes) {
+			++mOverflows;
+
+			// With room for alignment padding, so the frame that overflowed would fit.
+			mCapacity = std::bit_ceil(mUsed + mUsed / 2);
+			mResource.reset();
+			mBuffer = std::make_unique<std::byte[]>(mCapacity);
+			mResource.emplace(mBuffer.get(), mCapacity, &mOverflow);
+			mOverflow.mBytes = 0;
+		}
+
+		mPeak = std::max(mPeak, mUsed);
+		mUsed = 0;
+	}
+
+	void* FrameArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+		mUsed += bytes;
+		return mResource->allocate(bytes, alignment);
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace hyperbeetle {
+	// Memory for temporaries that live until the end of the frame, for pmr containers:
+	// `std::pmr::string text(&arena);`. Allocating bumps a pointer through a buffer that is reused every frame,
+	// deallocating does nothing and `reset` frees everything at once. A frame that outgrows the buffer takes the rest
+	// from the heap, and the next reset grows the buffer to fit. One thread.
+	class FrameArena final : public std::pmr::memory_resource {
+	public:
+		static constexpr std::size_t kDefaultCapacity = std::size_t(64) << 10;
+
+		explicit FrameArena(std::size_t capacity = kDefaultCapacity);
+		FrameArena(FrameArena const&) = delete;
+		FrameArena& operator=(FrameArena const&) = delete;
+
+		// Nothing allocated from the arena may be used afterwards.
+		void reset();
+
+		// Bytes requested since the last reset.
+		inline std::size_t used() const { return mUsed; }
+		inline std::size_t capacity() const { return mCapacity; }
+		// Most bytes any frame requested.
+		inline std::size_t peak() const { return mPeak; }
+		// Frames that didn't fit in the buffer.
+		inline std::uint64_t overflows() const { return mOverflows; }
+	private:
+		// Counts what the buffer resource takes from the heap once the buffer is full.
+		class Overflow final : public std::pmr::memory_resource {
+		public:
+			std::size_t mBytes = 0;
+		private:
+			void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+			void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+			bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+		};
+
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+		void do_deallocate(void*, std::size_t, std::size_t) override {}
+		bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+
+		std::unique_ptr<std::byte[]> mBuffer;
+		std::size_t mCapacity = 0;
+		Overflow mOverflow;
+		std::optional<std::pmr::monotonic_buffer_resource> mResource;
+
+		std::size_t mUsed = 0;
+		std::size_t mPeak = 0;
+		std::uint64_t mOverflows = 0;
+	};
+
+	// Builds text in frame memory with stream syntax. Numbers are formatted like an ostream's defaults, without the
+	// allocations of constructing a std::stringstream.
+	class FrameText final {
+	public:
+		explicit FrameText(std::pmr::memory_resource* arena, std::size_t reserve = 256) : mText(arena) { mText.reserve(reserve); }
+
+		inline FrameText& operator<<(std::string_view text) { mText.append(text); return *this; }
+		inline FrameText& operator<<(char c) { mText.push_back(c); return *this; }
+
+		template<std::integral T> requires (!std::same_as<T, bool> && !std::same_as<T, char>)
+		FrameText& operator<<(T value) {
+			char buffer[24];
+			auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+			mText.append(buffer, result.ptr);
+			return *this;
+		}
+
+		inline FrameText& operator<<(double value) {
+			char buffer[32];
+			auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+			mText.append(buffer, result.ptr);
+			return *this;
+		}
+
+		inline char const* c_str() const { return mText.c_str(); }
+		inline std::pmr::string const& str() const { return mText; }
+	private:
+		std::pmr::string mText;
+	};
+}
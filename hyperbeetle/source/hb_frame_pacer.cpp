@@ -0,0 +1,118 @@
+#include "hb_frame_pacer.hpp"
+
+#include "hb_clock.hpp"
+
+#include <yaml-cpp/yaml.h>
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace hyperbeetle {
+	namespace {
+		constexpr std::string_view kModeNames[] = { "vsync", "capped", "uncapped" };
+
+		double milliseconds(std::int64_t ns) { return nanosecondsToSeconds(ns) * 1e3; }
+	}
+
+	std::string_view FramePacer::modeName(Mode mode) {
+		return kModeNames[static_cast<std::size_t>(mode)];
+	}
+
+	std::optional<FramePacer::Mode> FramePacer::parseMode(std::string_view name) {
+		for (std::size_t i = 0; i < std::size(kModeNames); ++i) {
+			if (kModeNames[i] == name)
+				return static_cast<Mode>(i);
+		}
+		return std::nullopt;
+	}
+
+	void FramePacer::setMode(Mode mode, double cap) {
+		mMode = mode;
+		mCap = cap > 0.0 ? cap : kDefaultCap;
+		mPeriod = static_cast<std::int64_t>(1e9 / mCap);
+		mDeadline = 0;
+		mLastFrame = 0;
+
+		mFrameTimes.reset();
+		mWakeErrors.reset();
+		mMissed = 0;
+		mGraphCount = 0;
+	}
+
+	void FramePacer::wait() {
+		if (mMode != Mode::Capped) return;
+
+		std::int64_t time = now();
+		if (mDeadline == 0) {
+			mDeadline = time;
+			return;
+		}
+
+		if (time > mDeadline + mPeriod / 2) {
+			// Running behind, start the schedule over from here instead of rushing frames out to catch up.
+			++mMissed;
+			mDeadline = time;
+			return;
+		}
+
+		using namespace std::chrono;
+
+		if (mDeadline - time > kSpinNanoseconds)
+			std::this_thread::sleep_until(Clock::time_point(duration_cast<Clock::duration>(nanoseconds(mDeadline - kSpinNanoseconds))));
+
+		while ((time = now()) < mDeadline)
+			std::this_thread::yield();
+
+		mWakeErrors.record(time - mDeadline);
+	}
+
+	void FramePacer::endFrame() {
+		std::int64_t time = now();
+
+		if (mMode == Mode::Capped)
+			mDeadline += mPeriod;
+
+		if (mLastFrame != 0) {
+			std::int64_t frame = time - mLastFrame;
+			mFrameTimes.record(frame);
+			mGraph[mGraphCount % kGraphFrames] = static_cast<float>(nanosecondsToSeconds(frame));
+			++mGraphCount;
+		}
+		mLastFrame = time;
+	}
+
+	void FramePacer::writeStats(std::filesystem::path const& path, std::string_view build) const {
+		YAML::Emitter out;
+		out.SetDoublePrecision(6);
+		out << YAML::BeginMap;
+		out << YAML::Key << "build" << YAML::Value << std::string(build);
+		out << YAML::Key << "mode" << YAML::Value << std::string(modeName(mMode));
+		if (mMode == Mode::Capped) {
+			out << YAML::Key << "cap" << YAML::Value << mCap;
+			out << YAML::Key << "missed" << YAML::Value << mMissed;
+			out << YAML::Key << "wake_error_p99_us" << YAML::Value << nanosecondsToSeconds(mWakeErrors.percentile(0.99)) * 1e6;
+		}
+
+		out << YAML::Key << "frames" << YAML::Value << mFrameTimes.count();
+		out << YAML::Key << "mean_ms" << YAML::Value << mFrameTimes.mean() * 1e-6;
+		out << YAML::Key << "p50_ms" << YAML::Value << milliseconds(mFrameTimes.percentile(0.5));
+		out << YAML::Key << "p99_ms" << YAML::Value << milliseconds(mFrameTimes.percentile(0.99));
+		out << YAML::Key << "p999_ms" << YAML::Value << milliseconds(mFrameTimes.percentile(0.999));
+		out << YAML::Key << "max_ms" << YAML::Value << milliseconds(mFrameTimes.max());
+
+		// [lower bound in microseconds, frames] of every bucket that has frames.
+		out << YAML::Key << "buckets" << YAML::Value << YAML::BeginSeq;
+		mFrameTimes.forEachBucket([&](std::int64_t lower, std::int64_t, std::uint64_t count) {
+			out << YAML::Flow << YAML::BeginSeq << static_cast<double>(lower) * 1e-3 << count << YAML::EndSeq;
+		});
+		out << YAML::EndSeq;
+		out << YAML::EndMap;
+
+		std::ofstream file(path, std::ios::binary | std::ios::out | std::ios::trunc);
+		file << out.c_str() << '\n';
+		if (!file)
+			throw std::runtime_error("Failed to write " + path.string());
+	}
+}
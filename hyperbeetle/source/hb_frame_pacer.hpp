@@ -0,0 +1,72 @@
+#pragma once
+
+#include "hb_histogram.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+namespace hyperbeetle {
+	// Decides when the render thread starts its next frame and keeps statistics of how long frames took.
+	// Capped mode sleeps until shortly before the deadline, where the OS may oversleep, and spins the rest of the way.
+	// Render thread only.
+	class FramePacer final {
+	public:
+		enum class Mode { Vsync, Capped, Uncapped };
+
+		static constexpr double kDefaultCap = 240.0;
+		// Sleeping wakes up to a scheduler tick late, so the last stretch before a deadline is spun instead.
+		static constexpr std::int64_t kSpinNanoseconds = 2'000'000;
+		static constexpr std::size_t kGraphFrames = 240;
+
+		static std::string_view modeName(Mode mode);
+		static std::optional<Mode> parseMode(std::string_view name);
+
+		// Clears the statistics, they only make sense for one mode.
+		void setMode(Mode mode, double cap = kDefaultCap);
+		inline Mode mode() const { return mMode; }
+		inline double cap() const { return mCap; }
+		// For the window, vsync is the driver blocking in the swap.
+		inline int swapInterval() const { return mMode == Mode::Vsync ? 1 : 0; }
+
+		// Right before swapping buffers. In capped mode returns at the next deadline.
+		void wait();
+		// Right after swapping buffers, records the time since the previous swap.
+		void endFrame();
+
+		inline Histogram const& frameTimes() const { return mFrameTimes; }
+		// Frames that started more than half a period after their deadline, capped mode only.
+		inline std::uint64_t missedDeadlines() const { return mMissed; }
+		// Nanoseconds past the deadline that `wait` returned at, how precise the spin is.
+		inline Histogram const& wakeErrors() const { return mWakeErrors; }
+
+		// Oldest first, in seconds.
+		template<class Fn>
+		void forEachRecentFrame(Fn&& fn) const {
+			std::size_t count = mGraphCount < kGraphFrames ? mGraphCount : kGraphFrames;
+			for (std::size_t i = mGraphCount - count; i < mGraphCount; ++i)
+				fn(mGraph[i % kGraphFrames]);
+		}
+		inline std::size_t recentFrameCount() const { return mGraphCount < kGraphFrames ? mGraphCount : kGraphFrames; }
+
+		// Writes the statistics as YAML, with the non-empty histogram buckets so runs can be compared. Throws
+		// std::runtime_error.
+		void writeStats(std::filesystem::path const& path, std::string_view build) const;
+	private:
+		Mode mMode = Mode::Vsync;
+		double mCap = kDefaultCap;
+		std::int64_t mPeriod = 0;
+		std::int64_t mDeadline = 0;
+		std::int64_t mLastFrame = 0;
+
+		Histogram mFrameTimes;
+		Histogram mWakeErrors;
+		std::uint64_t mMissed = 0;
+
+		std::array<float, kGraphFrames> mGraph{};
+		std::size_t mGraphCount = 0;
+	};
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace hyperbeetle {
+	// Fast non-cryptographic 64 bit hash for checksums and hash tables. Stable across platforms with the same endianness.
+	inline std::uint64_t hash64(void const* data, std::size_t size, std::uint64_t seed = 0) noexcept {
+		constexpr std::uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+		constexpr std::uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+
+		auto bytes = static_cast<unsigned char const*>(data);
+		std::uint64_t hash = seed ^ (size * kPrime1);
+
+		std::size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			std::uint64_t word;
+			std::memcpy(&word, bytes + i, 8);
+			hash = std::rotl(hash ^ (word * kPrime2), 31) * kPrime1;
+		}
+
+		std::uint64_t tail = 0;
+		std::memcpy(&tail, bytes + i, size - i);
+		hash = std::rotl(hash ^ (tail * kPrime2), 31) * kPrime1;
+
+		hash ^= hash >> 33;
+		hash *= kPrime2;
+		hash ^= hash >> 29;
+		return hash;
+	}
+
+	inline std::uint64_t hash64(std::string_view str, std::uint64_t seed = 0) noexcept {
+		return hash64(str.data(), str.size(), seed);
+	}
+}
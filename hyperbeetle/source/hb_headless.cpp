@@ -0,0 +1,568 @@
+#include "hb_headless.hpp"
+
+#include "hb_allocations.hpp"
+#include "hb_audio.hpp"
+#include "hb_chart_reloader.hpp"
+#include "hb_clock.hpp"
+#include "hb_file_watcher.hpp"
+#include "hb_jobs.hpp"
+#include "hb_latency_trace.hpp"
+#include "hb_music_stream.hpp"
+#include "hb_pack.hpp"
+#include "hb_profiler.hpp"
+#include "hb_simulation.hpp"
+#include "hb_sound_bank.hpp"
+#include "hb_track.hpp"
+#include "hb_world.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <numbers>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace hyperbeetle {
+	namespace {
+		// Where the filter sweeps up from after a miss.
+		constexpr float kMissSweepCutoff = 400.0f;
+
+		int usage() {
+			std::cout << "Usage: hyperbeetle --headless [options]\n";
+			std::cout << "  --chart <path>         chart to autoplay, .yaml, compiled .hbc or a level .hbpak\n";
+			std::cout << "  --music <path>         Ogg Vorbis track to stream, defaults to the chart's audio\n";
+			std::cout << "  --tick-rate <hz>       simulation rate\n";
+			std::cout << "  --duration <seconds>   time to simulate without a chart\n";
+			std::cout << "  --seed <n>             autoplay timing seed\n";
+			std::cout << "  --jitter <ms>          autoplay timing spread\n";
+			std::cout << "  --min-speedup <x>      exit with " << kHeadlessTooSlow << " when simulating slower than x times realtime\n";
+			std::cout << "  --record <path>        save a replay of the autoplay\n";
+			std::cout << "  --jobs <n>             loader threads, 0 loads the level serially\n";
+			std::cout << "  --trace <path>         write the profiler's zones as a Chrome trace\n";
+			std::cout << "  --max-allocations <n>  exit with " << kHeadlessAllocated << " when the simulation loop allocates more than n times\n";
+			std::cout << "  --watch                play in real time and reload a .yaml chart whenever it is saved\n";
+			std::cout << "  --latency <path>       play in real time and write input latency histograms as YAML\n";
+			return kHeadlessUsage;
+		}
+
+		template<class T>
+		bool parseNumber(std::string_view text, T& value) {
+			auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+			return ec == std::errc() && end == text.data() + text.size();
+		}
+
+		// A short decaying tone for presses to play, headless runs have no sound files to rely on.
+		SoundBank::Decoded makeClick(ma_uint32 channels, ma_uint32 sampleRate) {
+			SoundBank::Decoded click;
+			click.path = "headless click";
+			click.channels = channels;
+			click.sampleRate = sampleRate;
+			click.frameCount = sampleRate / 50;
+			click.frames.reset(static_cast<float*>(ma_malloc(click.frameCount * channels * sizeof(float), nullptr)));
+			if (!click.frames)
+				throw std::bad_alloc();
+			for (ma_uint64 frame = 0; frame < click.frameCount; ++frame) {
+				double t = static_cast<double>(frame) / sampleRate;
+				auto value = static_cast<float>(0.25 * std::sin(2.0 * std::numbers::pi * 1000.0 * t) * std::exp(-t / 0.004));
+				for (ma_uint32 channel = 0; channel < channels; ++channel)
+					click.frames.get()[frame * channels + channel] = value;
+			}
+			return click;
+		}
+
+		void printStage(std::string_view name, double seconds, std::uint64_t count = 0) {
+			std::cout << "  " << std::left << std::setw(20) << name << std::right << std::setw(12) << std::fixed << std::setprecision(3) << seconds * 1e3 << " ms";
+			if (count) std::cout << std::setw(12) << seconds * 1e9 / static_cast<double>(count) << " ns avg";
+			std::cout << '\n';
+		}
+	}
+
+	std::optional<HeadlessOptions> parseHeadlessOptions(std::span<char* const> args) {
+		HeadlessOptions options;
+
+		for (std::size_t i = 0; i < args.size(); ++i) {
+			std::string_view arg = args[i];
+			if (arg == "--watch") {
+				options.watch = true;
+				continue;
+			}
+			if (i + 1 >= args.size()) {
+				usage();
+				return std::nullopt;
+			}
+
+			std::string_view value = args[++i];
+			bool valid = true;
+			double jitterMs = 0.0;
+
+			if (arg == "--chart") options.chart = value;
+			else if (arg == "--music") options.music = value;
+			else if (arg == "--tick-rate") valid = parseNumber(value, options.tickRate);
+			else if (arg == "--duration") valid = parseNumber(value, options.duration);
+			else if (arg == "--seed") valid = parseNumber(value, options.seed);
+			else if (arg == "--jitter") {
+				valid = parseNumber(value, jitterMs);
+				options.jitter = jitterMs * 1e-3;
+			}
+			else if (arg == "--min-speedup") valid = parseNumber(value, options.minSpeedup);
+			else if (arg == "--record") options.record = value;
+			else if (arg == "--jobs") valid = parseNumber(value, options.jobs);
+			else if (arg == "--trace") options.trace = value;
+			else if (arg == "--latency") options.latency = value;
+			else if (arg == "--max-allocations") valid = parseNumber(value, options.maxAllocations);
+			else valid = false;
+
+			if (!valid) {
+				std::cout << "Bad headless argument " << arg << ' ' << value << '\n';
+				usage();
+				return std::nullopt;
+			}
+		}
+
+		if (options.watch && options.chart.extension() != ".yaml") {
+			std::cout << "--watch needs a .yaml chart\n";
+			usage();
+			return std::nullopt;
+		}
+
+		return options;
+	}
+
+	std::vector<EventKey> makeAutoplayInput(Chart const& chart, double songStart, double jitter, std::uint32_t seed) {
+		constexpr std::int64_t kTapLength = 30'000'000;
+
+		auto times = chart.noteTimes();
+		auto durations = chart.noteDurations();
+		auto lanes = chart.noteLanes();
+
+		std::mt19937 rng(seed);
+		std::normal_distribution<double> error(0.0, jitter * 1e9);
+
+		std::int64_t origin = static_cast<std::int64_t>(songStart * 1e9);
+
+		// Key presses per lane, so a release never lands after the next press of the same key.
+		struct Press final {
+			std::int64_t at;
+			std::int64_t holdUntil;
+		};
+		std::vector<std::vector<Press>> presses(chart.header().lanes);
+
+		for (std::size_t i = 0; i < times.size(); ++i) {
+			if (lanes[i] >= presses.size()) presses.resize(lanes[i] + 1);
+
+			std::int64_t at = origin + times[i] * 1000 + static_cast<std::int64_t>(error(rng));
+			std::int64_t holdUntil = durations[i] > 0 ? origin + (times[i] + durations[i]) * 1000 : at + kTapLength;
+			presses[lanes[i]].push_back({ at, holdUntil });
+		}
+
+		std::vector<EventKey> events;
+		events.reserve(times.size() * 2);
+
+		for (std::size_t lane = 0; lane < presses.size(); ++lane) {
+			int key = Simulation::laneKey(static_cast<std::uint32_t>(lane));
+			auto& lanePresses = presses[lane];
+			std::sort(lanePresses.begin(), lanePresses.end(), [](Press const& a, Press const& b) { return a.at < b.at; });
+
+			for (std::size_t i = 0; i < lanePresses.size(); ++i) {
+				std::int64_t release = lanePresses[i].holdUntil;
+				if (i + 1 < lanePresses.size())
+					release = std::min(release, lanePresses[i + 1].at - 1);
+				release = std::max(release, lanePresses[i].at);
+
+				events.push_back({ nullptr, key, 0, GLFW_PRESS, 0, lanePresses[i].at });
+				events.push_back({ nullptr, key, 0, GLFW_RELEASE, 0, release });
+			}
+		}
+
+		std::stable_sort(events.begin(), events.end(), [](EventKey const& a, EventKey const& b) { return a.timestamp < b.timestamp; });
+		return events;
+	}
+
+	int runHeadless(HeadlessOptions const& options) {
+		HB_PROFILE_THREAD("headless");
+		std::int64_t start = now();
+
+		// Everything a level needs is loaded by a job graph. The chart and the device open in parallel, the music waits
+		// for both and the autoplay input and note store only for the chart.
+		JobSystem jobs(options.jobs < 0 ? JobSystem::defaultThreadCount() : static_cast<unsigned>(options.jobs));
+
+		SongClock clock;
+		AudioEngine audio;
+		Pack level; // a level packed into one file with its chart and audio
+		PackAsset chartAsset, musicAsset;
+		Chart chart;
+		std::filesystem::path musicPath = options.music;
+		MusicStream music;
+		InputQueue input;
+		World world;
+		world.setJobs(&jobs);
+		Simulation simulation{ input };
+		if (options.tickRate > 0.0)
+			simulation.setTickRate(options.tickRate);
+		simulation.setWorld(&world);
+		TrackGenerator track;
+		std::vector<EventKey> events;
+		// With --watch the chart is loaded by the reloader, which keeps it alive.
+		ChartReloader reloader(options.chart);
+		std::shared_ptr<Chart const> watched;
+		// With --latency presses play a click on the null device, the way the game's menus play their sounds.
+		bool traced = !options.latency.empty();
+		bool realTime = options.watch || traced;
+		auto latency = std::make_unique<LatencyTrace>();
+		SoundBank sounds;
+		SoundBank::SoundId click = SoundBank::kInvalidSound;
+		if (traced) {
+			simulation.setLatencyTrace(latency.get());
+			sounds.setLatencyTrace(latency.get());
+		}
+
+		std::int64_t audioTime = 0, chartTime = 0, musicTime = 0, inputTime = 0;
+		auto timed = [](std::int64_t& duration, auto fn) {
+			return [&duration, fn]() {
+				std::int64_t begin = now();
+				fn();
+				duration = now() - begin;
+			};
+		};
+
+		JobHandle audioJob = jobs.submit(timed(audioTime, [&]() {
+			audio.init("", clock, AudioEngine::Backend::Null);
+			audio.start();
+			if (traced) {
+				sounds.setGroup(&audio.mEffects.sfx());
+				sounds.init(audio.mEngine);
+				click = sounds.add(makeClick(sounds.channels(), sounds.sampleRate()));
+			}
+		}));
+
+		JobHandle chartJob = jobs.submit(timed(chartTime, [&]() {
+			if (options.chart.extension() == ".hbpak") {
+				level = Pack::open(options.chart);
+				PackEntry const* entry = level.find(kPackChartName);
+				if (!entry)
+					throw PackError("Pack has no " + std::string(kPackChartName));
+				chartAsset = level.load(*entry);
+				chart = Chart::view(chartAsset.bytes());
+			}
+			else if (options.watch) {
+				watched = reloader.load(&jobs);
+				chart = Chart::view(watched->bytes(), false);
+			}
+			else if (!options.chart.empty())
+				chart = options.chart.extension() == ".yaml" ? Chart::openSource(options.chart) : Chart::open(options.chart);
+		}));
+
+		// Streamed on the null device while the simulation runs, to see how soon a level would be audible.
+		JobHandle musicJob = jobs.submit(timed(musicTime, [&]() {
+			if (audioJob->error() || chartJob->error()) return;
+
+			if (musicPath.empty() && !chart.empty() && !chart.audio().empty()) {
+				if (PackEntry const* entry = level.find(chart.audio()))
+					musicAsset = level.load(*entry);
+				else {
+					musicPath = options.chart.parent_path() / std::filesystem::path(std::string(chart.audio()));
+					if (!std::filesystem::exists(musicPath)) musicPath.clear();
+				}
+			}
+
+			music.setGroup(&audio.mEffects.music());
+			if (!musicAsset.empty()) {
+				music.open(musicAsset.bytes(), audio.mEngine);
+				music.play();
+			}
+			else if (!musicPath.empty()) {
+				music.open(musicPath, audio.mEngine);
+				music.play();
+			}
+		}), { audioJob, chartJob });
+
+		JobHandle inputJob = jobs.submit(timed(inputTime, [&]() {
+			if (chart.empty()) return;
+			simulation.loadChart(chart, options.leadIn);
+			track.load(chart);
+			events = makeAutoplayInput(chart, options.leadIn, options.jitter, options.seed);
+		}), { chartJob });
+
+		for (JobHandle const& job : { audioJob, chartJob, musicJob, inputJob }) {
+			try {
+				jobs.wait(job);
+			}
+			catch (std::exception const&) {}
+		}
+		std::int64_t levelReady = now();
+
+		auto failed = [&](std::filesystem::path const& path, JobHandle const& job) {
+			try {
+				std::rethrow_exception(job->error());
+			}
+			catch (std::exception const& e) {
+				std::cout << path.string() << ": " << e.what() << '\n';
+			}
+			music.close();
+			sounds.uninit();
+			audio.uninit();
+			return kHeadlessFailed;
+		};
+
+		if (audioJob->error()) return failed("null device", audioJob);
+		if (chartJob->error()) return failed(options.chart, chartJob);
+		if (musicJob->error()) return failed(musicAsset.empty() ? musicPath : options.chart, musicJob);
+		bool hasMusic = !musicAsset.empty() || !musicPath.empty();
+
+		double duration = options.duration;
+		if (!chart.empty())
+			duration = options.leadIn + static_cast<double>(chart.header().length) * 1e-6 + 1.0;
+
+		// Saves are parsed on the loader one after the other, and swapped in by the tick after.
+		FileWatcher watcher;
+		JobHandle reload;
+		if (options.watch) {
+			watcher.watch(options.chart);
+			watcher.start([&](std::filesystem::path const& path, std::int64_t changedAt) {
+				auto load = [&, changedAt]() {
+					try {
+						std::shared_ptr<Chart const> next = reloader.load(&jobs);
+						ChartReloader::Stats const& stats = reloader.lastLoad();
+						std::cout << "Reloaded " << path.string() << ", " << stats.parsed << " of " << stats.sections << " sections parsed" << (stats.whole ? " as a whole" : "") << " in " << stats.seconds * 1e3 << " ms\n";
+						simulation.swapChart(std::move(next), changedAt);
+					}
+					catch (std::exception const& e) {
+						std::cout << e.what() << '\n';
+					}
+				};
+				reload = reload ? jobs.submit(load, { reload }) : jobs.submit(load);
+				if (!jobs.threadCount())
+					jobs.wait(reload);
+			});
+			std::cout << "Watching " << options.chart.string() << (watcher.notified() ? "" : ", polling") << '\n';
+		}
+		std::uint32_t swaps = 0;
+		std::int64_t swapLatencies = 0, worstSwapLatency = 0;
+
+		allocations::Counts loopAllocations = allocations::thisThread();
+		allocations::Counts runAllocations = allocations::total();
+
+		// Feed each tick the input stamped before its end, the same way the window thread would in real time.
+		std::size_t nextEvent = 0;
+		std::uint32_t misses = 0, sweeps = 0;
+		std::uint64_t lastTick = static_cast<std::uint64_t>(duration * simulation.tickRate());
+		std::int64_t wallOrigin = now() - static_cast<std::int64_t>(simulation.state().time * 1e9);
+		while (simulation.state().tick < lastTick && !simulation.state().finished) {
+			std::uint64_t tick = simulation.state().tick + 1;
+			std::int64_t tickEnd = static_cast<std::int64_t>(static_cast<double>(tick) / simulation.tickRate() * 1e9);
+
+			if (realTime)
+				std::this_thread::sleep_until(Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(wallOrigin + tickEnd))));
+
+			// Traced as if the key went down when it was due, in wall time.
+			for (; nextEvent < events.size() && events[nextEvent].timestamp <= tickEnd; ++nextEvent) {
+				EventKey event = events[nextEvent];
+				if (traced) event.tracedAt = wallOrigin + event.timestamp;
+				if (!input.push(event)) break;
+			}
+
+			simulation.advanceTo(static_cast<double>(tick) / simulation.tickRate());
+
+			// An edit took over, the track and the autoplay follow the new chart from here.
+			if (simulation.state().chartSwaps != swaps) {
+				swaps = simulation.state().chartSwaps;
+				swapLatencies += simulation.state().swapLatency;
+				worstSwapLatency = std::max(worstSwapLatency, simulation.state().swapLatency);
+				std::cout << "Swapped in at " << static_cast<double>(simulation.state().songTime) * 1e-6 << " s, " << nanosecondsToSeconds(simulation.state().swapLatency) * 1e3 << " ms after the save\n";
+
+				chart = Chart::view(simulation.chart()->bytes(), false);
+				track.load(chart);
+				events = makeAutoplayInput(chart, options.leadIn, options.jitter, options.seed);
+				nextEvent = std::upper_bound(events.begin(), events.end(), tickEnd, [](std::int64_t time, EventKey const& e) { return time < e.timestamp; }) - events.begin();
+				duration = options.leadIn + static_cast<double>(chart.header().length) * 1e-6 + 1.0;
+				lastTick = static_cast<std::uint64_t>(duration * simulation.tickRate());
+			}
+
+			// The renderer would build the track once a frame, here it keeps up with every tick.
+			track.update(simulation.state().songTime);
+
+			// A miss muffles the music and lets it open up again, the same feedback the game would give.
+			if (simulation.state().score.grades[3] > misses) {
+				misses = simulation.state().score.grades[3];
+				audio.mEffects.filter().sweepFrom(kMissSweepCutoff);
+				++sweeps;
+			}
+
+			EventKey event;
+			while (simulation.uiEvents().pop(event)) {
+				if (traced && event.action == GLFW_PRESS)
+					sounds.play(click, 0, event.tracedAt);
+			}
+			if (traced)
+				latency->collect();
+		}
+		std::int64_t simulated = now();
+		loopAllocations = allocations::thisThread() - loopAllocations;
+		runAllocations = allocations::total() - runAllocations;
+
+		watcher.stop();
+		if (reload) {
+			try {
+				jobs.wait(reload);
+			}
+			catch (std::exception const&) {}
+		}
+
+		// The simulation usually outruns the first mix of the device.
+		while (music.isOpen() && music.stats().firstAudio == 0.0 && now() - levelReady < 1'000'000'000)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		MusicStream::Stats musicStats = music.stats();
+		music.close();
+
+		// The last presses' clicks start a callback or so after the simulation stopped.
+		while (traced && sounds.voicesInUse() && now() - simulated < 1'000'000'000)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		sounds.uninit();
+		latency->collect();
+
+		std::uint64_t callbacks = audio.mCallbackCount.load(std::memory_order_relaxed);
+		double callbackSeconds = nanosecondsToSeconds(audio.mCallbackNanoseconds.load(std::memory_order_relaxed));
+		std::string deviceName = audio.mDeviceName;
+		double effectsSeconds = nanosecondsToSeconds(audio.mEffects.processNanoseconds());
+		audio.uninit();
+
+		SimulationState const& state = simulation.state();
+		SimulationTimings const& timings = simulation.timings();
+		double wallSeconds = nanosecondsToSeconds(simulated - levelReady);
+		double speedup = wallSeconds > 0.0 ? state.time / wallSeconds : 0.0;
+
+		std::cout << "Headless run\n";
+		std::cout << "  audio               " << deviceName << '\n';
+		if (!chart.empty())
+			std::cout << "  chart               " << chart.title() << ", " << chart.noteCount() << " notes\n";
+		std::cout << "  simulated           " << state.time << " s, " << state.tick << " ticks at " << simulation.tickRate() << " Hz\n";
+		std::cout << "  wall                " << wallSeconds << " s, " << speedup << "x realtime\n";
+		std::cout << "  loader              " << jobs.threadCount() << " threads, " << jobs.stats().jobs << " jobs, " << jobs.stats().steals << " stolen\n";
+
+		std::cout << "Stages\n";
+		printStage("level_load", nanosecondsToSeconds(levelReady - start));
+		printStage("audio_init", nanosecondsToSeconds(audioTime));
+		printStage("chart_load", nanosecondsToSeconds(chartTime));
+		if (hasMusic) {
+			printStage("music_open", nanosecondsToSeconds(musicTime));
+			printStage("music_first_audio", musicStats.firstAudio);
+		}
+		printStage("autoplay_input", nanosecondsToSeconds(inputTime), events.size());
+		printStage("simulation", wallSeconds, timings.ticks);
+		printStage("tick_input", nanosecondsToSeconds(timings.input), timings.ticks);
+		printStage("tick_judge", nanosecondsToSeconds(timings.judge), timings.ticks);
+		printStage("tick_world", nanosecondsToSeconds(timings.world), timings.ticks);
+		printStage("tick_publish", nanosecondsToSeconds(timings.publish), timings.ticks);
+		printStage("track_build", nanosecondsToSeconds(track.stats().nanoseconds), track.stats().segments);
+		printStage("audio_callback", callbackSeconds, callbacks);
+		printStage("audio_effects", effectsSeconds, callbacks);
+
+		if (hasMusic) {
+			std::cout << "Music\n";
+			if (musicAsset.empty())
+				std::cout << "  track               " << musicPath.string() << '\n';
+			else
+				std::cout << "  track               " << chart.audio() << " in " << options.chart.string() << '\n';
+			std::cout << "  resident            " << musicStats.residentBytes / 1024 << " KB, " << musicStats.decodedBytes / 1024 << " KB decoded up front\n";
+			std::cout << "  underruns           " << musicStats.underruns << '\n';
+			std::cout << "  miss sweeps         " << sweeps << '\n';
+		}
+
+		if (!chart.empty()) {
+			World::Stats worldStats = world.stats();
+			std::cout << "World\n";
+			std::cout << "  live entities       " << worldStats.peak << " peak, " << worldStats.reserved << " pooled\n";
+			std::cout << "  spawned             " << worldStats.spawned << ", " << worldStats.parallelRuns << " system runs split across the loader\n";
+		}
+
+		if (!chart.empty()) {
+			TrackGenerator::Stats const& trackStats = track.stats();
+			double trackSeconds = static_cast<double>(trackStats.chunks) * static_cast<double>(track.settings().chunkDuration) * 1e-6;
+			std::cout << "Track\n";
+			std::cout << "  chunks              " << trackStats.chunks << " built, " << track.slotCount() << " slots, " << track.residentBytes() / 1024 << " KB resident\n";
+			std::cout << "  segments            " << static_cast<double>(trackStats.segments) / nanosecondsToSeconds(trackStats.nanoseconds) << " per second built\n";
+			std::cout << "  vertices            " << static_cast<double>(trackStats.bytes) / trackSeconds / 1024 << " KB per second of track\n";
+		}
+
+		if (options.watch) {
+			std::cout << "Reloads\n";
+			std::cout << "  swapped             " << swaps << '\n';
+			if (swaps)
+				std::cout << "  save to live        " << nanosecondsToSeconds(swapLatencies / swaps) * 1e3 << " ms average, " << nanosecondsToSeconds(worstSwapLatency) * 1e3 << " ms worst\n";
+		}
+
+		if (traced) {
+			// From when each key was due, no frames are drawn here so there is no display stage.
+			std::cout << "Latency\n";
+			for (LatencyTrace::Stage stage : { LatencyTrace::Stage::Dequeue, LatencyTrace::Stage::Judge, LatencyTrace::Stage::Sound }) {
+				Histogram const& latencies = latency->histogram(stage);
+				std::cout << "  " << std::left << std::setw(20) << LatencyTrace::stageName(stage) << std::right << std::setw(12)
+					<< nanosecondsToSeconds(latencies.percentile(0.5)) * 1e3 << " ms p50" << std::setw(12) << nanosecondsToSeconds(latencies.percentile(0.99)) * 1e3
+					<< " ms p99" << std::setw(12) << nanosecondsToSeconds(latencies.max()) * 1e3 << " ms max, " << latencies.count() << " inputs\n";
+			}
+			if (latency->dropped())
+				std::cout << "  dropped             " << latency->dropped() << '\n';
+		}
+
+		std::cout << "Allocations\n";
+		std::cout << "  simulation loop     " << loopAllocations.allocations << ", " << loopAllocations.bytes / 1024 << " KB\n";
+		std::cout << "  all threads         " << runAllocations.allocations << ", " << runAllocations.bytes / 1024 << " KB\n";
+
+		if (!chart.empty()) {
+			auto const& score = state.score;
+			std::cout << "Score\n";
+			std::cout << "  perfect " << score.grades[0] << ", great " << score.grades[1] << ", good " << score.grades[2] << ", miss " << score.grades[3] << '\n';
+			std::cout << "  max combo " << score.maxCombo << ", holds " << score.holdsCompleted << " completed, " << score.holdsBroken << " broken\n";
+		}
+
+		if (!chart.empty() && !options.record.empty()) {
+			try {
+				saveReplay(simulation.replay(), chart, options.record);
+			}
+			catch (std::exception const& e) {
+				std::cout << options.record.string() << ": " << e.what() << '\n';
+				return kHeadlessFailed;
+			}
+			std::cout << "Replay " << options.record.string() << ", " << simulation.replay().inputs.size() << " inputs, " << std::filesystem::file_size(options.record) << " bytes\n";
+		}
+
+		if (!options.trace.empty()) {
+			std::int64_t events = profiler::writeChromeTrace(options.trace);
+			if (events < 0) {
+				std::cout << options.trace.string() << ": couldn't write the trace\n";
+				return kHeadlessFailed;
+			}
+			std::cout << "Trace " << options.trace.string() << ", " << events << " zones\n";
+		}
+
+		if (traced) {
+			try {
+				latency->writeStats(options.latency, "headless");
+			}
+			catch (std::exception const& e) {
+				std::cout << e.what() << '\n';
+				return kHeadlessFailed;
+			}
+			std::cout << "Latency " << options.latency.string() << '\n';
+		}
+
+		if (options.maxAllocations >= 0 && loopAllocations.allocations > static_cast<std::uint64_t>(options.maxAllocations)) {
+			std::cout << "Allocated more than the allowed " << options.maxAllocations << " times in the simulation loop\n";
+			return kHeadlessAllocated;
+		}
+
+		if (options.minSpeedup > 0.0 && speedup < options.minSpeedup) {
+			std::cout << "Slower than the required " << options.minSpeedup << "x realtime\n";
+			return kHeadlessTooSlow;
+		}
+
+		return kHeadlessOk;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "hb_chart.hpp"
+#include "hb_input_queue.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace hyperbeetle {
+	// Exit codes of a headless run, for scripts checking for regressions.
+	enum HeadlessExitCode : int {
+		kHeadlessOk = 0,
+		kHeadlessUsage = 1,
+		kHeadlessFailed = 2, // the chart or music couldn't be loaded or the replay or trace saved
+		kHeadlessTooSlow = 3, // ran slower than --min-speedup
+		kHeadlessAllocated = 4, // the simulation loop allocated more than --max-allocations
+	};
+
+	struct HeadlessOptions final {
+		std::filesystem::path chart; // .yaml is compiled on demand, .hbpak opened as a level pack, anything else as a compiled chart
+		std::filesystem::path music; // Ogg Vorbis track to stream, the chart's audio if empty
+		double tickRate = 0.0; // 0 for Simulation::kDefaultTickRate
+		double duration = 60.0; // seconds to simulate without a chart
+		double leadIn = 1.0;
+		std::uint32_t seed = 1;
+		double jitter = 0.02; // standard deviation of autoplay timing, seconds
+		double minSpeedup = 0.0; // simulated seconds per wall second, 0 disables the check
+		std::filesystem::path record; // where to save the replay of the run, if anywhere
+		int jobs = -1; // loader threads, 0 loads serially and -1 picks from the core count
+		std::filesystem::path trace; // where to write the profiler's zones, if anywhere
+		std::int64_t maxAllocations = -1; // heap allocations allowed in the simulation loop, -1 for any
+		bool watch = false; // play in real time and swap in edits to a .yaml chart as they are saved
+		std::filesystem::path latency; // where to write the input latency histograms, if anywhere, plays in real time
+	};
+
+	// Parses the arguments after --headless, prints usage and returns nothing if they are wrong.
+	std::optional<HeadlessOptions> parseHeadlessOptions(std::span<char* const> args);
+
+	// Presses for every note of `chart` with normally distributed timing error, releases at the end of holds.
+	// Timestamps are nanoseconds of simulation time with song time zero at `songStart` seconds, sorted.
+	std::vector<EventKey> makeAutoplayInput(Chart const& chart, double songStart, double jitter, std::uint32_t seed);
+
+	// Runs the game without a window or sound card, stepping the simulation from a virtual clock as fast as possible,
+	// and prints where the time went. Returns a HeadlessExitCode.
+	int runHeadless(HeadlessOptions const& options);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace hyperbeetle {
+	// Counts durations in log-linear buckets: every power of two is split into 32 buckets, so a bucket is within about
+	// 3% of the values in it and percentiles come from a fixed size array however many samples are recorded.
+	// One thread at a time.
+	class Histogram final {
+	public:
+		static constexpr unsigned kSubBucketBits = 5;
+		static constexpr std::size_t kSubBuckets = std::size_t(1) << kSubBucketBits;
+		static constexpr std::size_t kBuckets = (64 - kSubBucketBits) * kSubBuckets;
+
+		// Nanoseconds, negative values count as zero.
+		void record(std::int64_t value) noexcept {
+			std::uint64_t v = value > 0 ? static_cast<std::uint64_t>(value) : 0;
+			++mCounts[bucketOf(v)];
+			++mCount;
+			mSum += static_cast<double>(v);
+			mMin = std::min(mMin, v);
+			mMax = std::max(mMax, v);
+		}
+
+		void reset() noexcept { *this = Histogram(); }
+
+		inline std::uint64_t count() const { return mCount; }
+		inline std::int64_t min() const { return mCount ? static_cast<std::int64_t>(mMin) : 0; }
+		inline std::int64_t max() const { return static_cast<std::int64_t>(mMax); }
+		inline double mean() const { return mCount ? mSum / static_cast<double>(mCount) : 0.0; }
+
+		// The value `fraction` of the samples are at or below, the middle of its bucket clamped to the recorded range.
+		std::int64_t percentile(double fraction) const noexcept {
+			if (mCount == 0) return 0;
+
+			auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(mCount)));
+			rank = std::max<std::uint64_t>(rank, 1);
+
+			std::uint64_t seen = 0;
+			for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+				seen += mCounts[bucket];
+				if (seen >= rank) {
+					std::uint64_t middle = bucketLower(bucket) + (bucketUpper(bucket) - bucketLower(bucket)) / 2;
+					return static_cast<std::int64_t>(std::clamp(middle, mMin, mMax));
+				}
+			}
+			return max();
+		}
+
+		// Calls `fn(lower, upper, count)` for every bucket holding samples, in increasing order. Bounds are inclusive.
+		template<class Fn>
+		void forEachBucket(Fn&& fn) const {
+			for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+				if (mCounts[bucket])
+					fn(static_cast<std::int64_t>(bucketLower(bucket)), static_cast<std::int64_t>(std::min<std::uint64_t>(bucketUpper(bucket), std::numeric_limits<std::int64_t>::max())), mCounts[bucket]);
+			}
+		}
+
+		static constexpr std::size_t bucketOf(std::uint64_t value) noexcept {
+			if (value < 2 * kSubBuckets) return static_cast<std::size_t>(value);
+			unsigned shift = static_cast<unsigned>(std::bit_width(value)) - kSubBucketBits - 1;
+			return (shift + 1) * kSubBuckets + static_cast<std::size_t>(value >> shift) - kSubBuckets;
+		}
+
+		static constexpr std::uint64_t bucketLower(std::size_t bucket) noexcept {
+			if (bucket < 2 * kSubBuckets) return bucket;
+			unsigned shift = static_cast<unsigned>(bucket / kSubBuckets) - 1;
+			return static_cast<std::uint64_t>(bucket % kSubBuckets + kSubBuckets) << shift;
+		}
+
+		static constexpr std::uint64_t bucketUpper(std::size_t bucket) noexcept {
+			if (bucket < 2 * kSubBuckets) return bucket;
+			unsigned shift = static_cast<unsigned>(bucket / kSubBuckets) - 1;
+			return bucketLower(bucket) + ((std::uint64_t(1) << shift) - 1);
+		}
+	private:
+		std::array<std::uint64_t, kBuckets> mCounts{};
+		std::uint64_t mCount = 0;
+		double mSum = 0.0;
+		std::uint64_t mMin = std::numeric_limits<std::uint64_t>::max();
+		std::uint64_t mMax = 0;
+	};
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "hb_spsc_queue.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+extern "C" typedef struct GLFWwindow GLFWwindow;
+
+namespace hyperbeetle {
+	struct EventKey final {
+		GLFWwindow* window;
+		int key, scancode, action, mods;
+		std::int64_t timestamp; // hyperbeetle::now() when the window system handed us the key
+		std::int64_t tracedAt = 0; // hyperbeetle::now() when it entered the game, for LatencyTrace, 0 if not traced
+	};
+
+	// Carries input from the window thread to the game thread without either side blocking.
+	class InputQueue final {
+	public:
+		static constexpr std::size_t kCapacity = 1024;
+
+		// Window thread.
+		bool push(EventKey const& event) noexcept {
+			if (mQueue.push(event)) return true;
+			mOverflows.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		// Game thread. Calls `fn` for every queued event in the order they were pushed.
+		template<class Fn>
+		std::size_t drain(Fn&& fn) {
+			std::size_t depth = mQueue.size();
+			if (depth > mMaxDepth.load(std::memory_order_relaxed))
+				mMaxDepth.store(depth, std::memory_order_relaxed);
+
+			std::size_t count = 0;
+			EventKey event;
+			while (mQueue.pop(event)) {
+				fn(event);
+				++count;
+			}
+
+			return count;
+		}
+
+		inline std::size_t depth() const noexcept { return mQueue.size(); }
+		inline std::size_t maxDepth() const noexcept { return mMaxDepth.load(std::memory_order_relaxed); }
+		inline std::uint64_t overflows() const noexcept { return mOverflows.load(std::memory_order_relaxed); }
+	private:
+		SpscQueue<EventKey, kCapacity> mQueue;
+		std::atomic<std::size_t> mMaxDepth = 0;
+		std::atomic<std::uint64_t> mOverflows = 0;
+	};
+}
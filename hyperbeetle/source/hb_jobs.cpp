@@ -0,0 +1,242 @@
+#include "hb_jobs.hpp"
+
+#include "hb_profiler.hpp"
+
+#include <algorithm>
+
+namespace hyperbeetle {
+	namespace {
+		// The pool the calling thread works for and its queue.
+		thread_local JobSystem const* tSystem = nullptr;
+		thread_local std::size_t tQueue = 0;
+	}
+
+	unsigned JobSystem::defaultThreadCount() {
+		unsigned cores = std::thread::hardware_concurrency();
+		return std::max(cores, 2u) - 1;
+	}
+
+	JobSystem::JobSystem(unsigned threads) {
+		for (unsigned i = 0; i <= threads; ++i)
+			mQueues.push_back(std::make_unique<Queue>());
+
+		mThreads.reserve(threads);
+		for (unsigned i = 0; i < threads; ++i)
+			mThreads.emplace_back([this, i](std::stop_token stopToken) { run(stopToken, i); });
+	}
+
+	JobSystem::~JobSystem() noexcept {
+		while (mUnfinished.load(std::memory_order_acquire) != 0) {
+			if (!runOne(queueIndex()))
+				std::this_thread::yield();
+		}
+
+		for (auto& thread : mThreads)
+			thread.request_stop();
+		{
+			std::lock_guard lock(mSleepMutex);
+		}
+		mWake.notify_all();
+		mThreads.clear();
+	}
+
+	JobHandle JobSystem::submit(std::function<void()> fn, std::span<JobHandle const> dependencies) {
+		auto job = std::make_shared<Job>();
+		job->mFn = std::move(fn);
+		job->mWaiting.store(static_cast<std::uint32_t>(dependencies.size()) + 1, std::memory_order_relaxed);
+		mUnfinished.fetch_add(1, std::memory_order_relaxed);
+
+		for (JobHandle const& dependency : dependencies) {
+			std::lock_guard lock(dependency->mMutex);
+			if (dependency->mFinished.load(std::memory_order_relaxed))
+				job->mWaiting.fetch_sub(1, std::memory_order_relaxed);
+			else
+				dependency->mDependents.push_back(job);
+		}
+
+		if (job->mWaiting.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			schedule(job);
+
+		return job;
+	}
+
+	void JobSystem::wait(JobHandle const& job) {
+		std::size_t self = queueIndex();
+
+		while (!job->finished()) {
+			if (runOne(self)) continue;
+
+			// Nothing to help with, the job is running on another thread.
+			if (!threadCount()) break;
+			job->mFinished.wait(false, std::memory_order_acquire);
+		}
+
+		if (job->mError)
+			std::rethrow_exception(job->mError);
+	}
+
+	void JobSystem::waitAll(std::span<JobHandle const> jobs) {
+		std::exception_ptr error;
+		for (JobHandle const& job : jobs) {
+			try {
+				wait(job);
+			}
+			catch (...) {
+				if (!error) error = std::current_exception();
+			}
+		}
+		if (error) std::rethrow_exception(error);
+	}
+
+	void JobSystem::splitRanges(std::size_t count, std::size_t ranges, RangeFn fn, void const* context) {
+		if (!count) return;
+		ranges = std::clamp<std::size_t>(ranges, 1, count);
+		std::size_t size = (count + ranges - 1) / ranges;
+		ranges = (count + size - 1) / size; // rounding up the size can leave fewer
+
+		std::unique_lock lock(mSplitMutex, std::try_to_lock);
+		if (!threadCount() || ranges == 1 || !lock.owns_lock()) {
+			for (std::size_t first = 0; first < count; first += size)
+				fn(context, first, std::min(first + size, count));
+			return;
+		}
+
+		mSplit.fn = fn;
+		mSplit.context = context;
+		mSplit.count = count;
+		mSplit.size = size;
+		mSplit.ranges.store(ranges, std::memory_order_relaxed);
+		mSplit.next.store(0, std::memory_order_relaxed);
+		mSplit.done.store(0, std::memory_order_relaxed);
+		mSplit.open.store(true);
+		{
+			std::lock_guard sleep(mSleepMutex);
+		}
+		mWake.notify_all();
+
+		runSplit();
+		for (std::size_t done; (done = mSplit.done.load(std::memory_order_acquire)) != ranges; )
+			mSplit.done.wait(done, std::memory_order_acquire);
+
+		// A worker that saw the split open may not have noticed yet that every range is taken.
+		mSplit.open.store(false);
+		while (mSplit.helpers.load() != 0)
+			std::this_thread::yield();
+	}
+
+	bool JobSystem::runSplit() {
+		bool ran = false;
+
+		mSplit.helpers.fetch_add(1);
+		if (mSplit.open.load()) {
+			std::size_t ranges = mSplit.ranges.load(std::memory_order_relaxed);
+			for (std::size_t range; (range = mSplit.next.fetch_add(1, std::memory_order_relaxed)) < ranges; ) {
+				std::size_t first = range * mSplit.size;
+				mSplit.fn(mSplit.context, first, std::min(first + mSplit.size, mSplit.count));
+				ran = true;
+
+				if (mSplit.done.fetch_add(1, std::memory_order_acq_rel) + 1 == ranges)
+					mSplit.done.notify_all();
+			}
+		}
+		mSplit.helpers.fetch_sub(1, std::memory_order_release);
+
+		return ran;
+	}
+
+	JobSystem::Stats JobSystem::stats() const {
+		return { mJobs.load(std::memory_order_relaxed), mSteals.load(std::memory_order_relaxed) };
+	}
+
+	std::size_t JobSystem::queueIndex() const {
+		return tSystem == this ? tQueue : mQueues.size() - 1;
+	}
+
+	void JobSystem::run(std::stop_token stopToken, std::size_t index) {
+		HB_PROFILE_THREAD("job");
+
+		tSystem = this;
+		tQueue = index;
+
+		while (!stopToken.stop_requested()) {
+			if (runSplit() || runOne(index)) continue;
+
+			std::unique_lock lock(mSleepMutex);
+			mWake.wait(lock, stopToken, [&]() { return mQueued.load(std::memory_order_acquire) != 0 || splitPending(); });
+		}
+	}
+
+	bool JobSystem::runOne(std::size_t self) {
+		JobHandle job;
+
+		{
+			Queue& own = *mQueues[self];
+			std::lock_guard lock(own.mutex);
+			if (!own.jobs.empty()) {
+				job = std::move(own.jobs.back());
+				own.jobs.pop_back();
+			}
+		}
+
+		for (std::size_t i = 1; !job && i < mQueues.size(); ++i) {
+			Queue& victim = *mQueues[(self + i) % mQueues.size()];
+			std::lock_guard lock(victim.mutex);
+			if (!victim.jobs.empty()) {
+				job = std::move(victim.jobs.front());
+				victim.jobs.pop_front();
+				mSteals.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		if (!job) return false;
+		mQueued.fetch_sub(1, std::memory_order_relaxed);
+
+		{
+			HB_PROFILE_ZONE("job.run");
+			try {
+				job->mFn();
+			}
+			catch (...) {
+				job->mError = std::current_exception();
+			}
+		}
+		job->mFn = nullptr;
+
+		mJobs.fetch_add(1, std::memory_order_relaxed);
+		finish(*job);
+		return true;
+	}
+
+	void JobSystem::schedule(JobHandle job) {
+		// Counted first so a thief that takes the job right away can't take the count below zero.
+		mQueued.fetch_add(1, std::memory_order_release);
+		{
+			Queue& queue = *mQueues[queueIndex()];
+			std::lock_guard lock(queue.mutex);
+			queue.jobs.push_back(std::move(job));
+		}
+
+		{
+			// Orders the count before a worker that is about to sleep checks it.
+			std::lock_guard lock(mSleepMutex);
+		}
+		mWake.notify_one();
+	}
+
+	void JobSystem::finish(Job& job) {
+		std::vector<JobHandle> dependents;
+		{
+			std::lock_guard lock(job.mMutex);
+			job.mFinished.store(true, std::memory_order_release);
+			dependents = std::move(job.mDependents);
+		}
+		job.mFinished.notify_all();
+
+		for (JobHandle& dependent : dependents) {
+			if (dependent->mWaiting.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				schedule(std::move(dependent));
+		}
+
+		mUnfinished.fetch_sub(1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace hyperbeetle {
+	class JobSystem;
+
+	// A unit of work that starts once every job it depends on has finished.
+	class Job final {
+	public:
+		inline bool finished() const { return mFinished.load(std::memory_order_acquire); }
+		// What the job threw, once it finished. Jobs that depend on it run anyway and may check.
+		inline std::exception_ptr error() const { return mError; }
+	private:
+		friend class JobSystem;
+
+		std::function<void()> mFn;
+		// Unfinished dependencies, plus one that `submit` holds until every dependency has been looked at.
+		std::atomic<std::uint32_t> mWaiting = 1;
+		std::atomic_bool mFinished = false;
+		std::exception_ptr mError;
+
+		std::mutex mMutex;
+		std::vector<std::shared_ptr<Job>> mDependents; // until finished
+	};
+
+	using JobHandle = std::shared_ptr<Job>;
+
+	// A work stealing thread pool that runs a graph of jobs.
+	// Every worker has a queue of ready jobs. A worker runs the newest job of its own queue, which is usually the one
+	// that just became ready through a job it finished, and steals the oldest job from another queue when its own is
+	// empty. Jobs submitted from outside the pool go to a shared queue that workers steal from.
+	class JobSystem final {
+	public:
+		struct Stats final {
+			std::uint64_t jobs = 0;
+			std::uint64_t steals = 0; // jobs run by a thread other than the one whose queue they were on
+		};
+
+		// One less than the cores, the thread that submits work is usually busy too.
+		static unsigned defaultThreadCount();
+
+		// Without threads every job runs on the thread that waits for it, which is the serial path to compare with.
+		explicit JobSystem(unsigned threads = defaultThreadCount());
+		JobSystem(JobSystem const&) = delete;
+		JobSystem& operator=(JobSystem const&) = delete;
+		// Finishes every job that was submitted.
+		~JobSystem() noexcept;
+
+		// Any thread, jobs included. `fn` runs on a worker once every job in `dependencies` has finished.
+		JobHandle submit(std::function<void()> fn, std::span<JobHandle const> dependencies);
+		inline JobHandle submit(std::function<void()> fn, std::initializer_list<JobHandle> dependencies = {}) {
+			return submit(std::move(fn), std::span<JobHandle const>(dependencies.begin(), dependencies.size()));
+		}
+
+		// Runs other jobs until `job` has finished, so waiting inside a job doesn't deadlock. Rethrows what it threw.
+		void wait(JobHandle const& job);
+		// Waits for every one of `jobs` before rethrowing the first error, for jobs that use memory the caller owns.
+		void waitAll(std::span<JobHandle const> jobs);
+
+		// Calls `fn(first, last)` for `ranges` ranges that split [0, count) and returns once all have run. The calling
+		// thread takes ranges too, and workers join in as they become free. Unlike `submit` this doesn't allocate, which
+		// suits splitting work every tick. One split runs at a time, a second one that starts meanwhile (or from inside
+		// `fn`) runs all of its ranges on its own thread. `fn` must not throw.
+		template<class Fn>
+		void split(std::size_t count, std::size_t ranges, Fn const& fn) {
+			splitRanges(count, ranges, [](void const* context, std::size_t first, std::size_t last) {
+				(*static_cast<Fn const*>(context))(first, last);
+			}, &fn);
+		}
+
+		inline unsigned threadCount() const { return static_cast<unsigned>(mThreads.size()); }
+		Stats stats() const;
+	private:
+		struct Queue final {
+			std::mutex mutex;
+			std::deque<JobHandle> jobs;
+		};
+
+		using RangeFn = void(*)(void const* context, std::size_t first, std::size_t last);
+
+		// The split in progress. Its fields are written while `open` is false and no helper is inside it.
+		struct Split final {
+			RangeFn fn = nullptr;
+			void const* context = nullptr;
+			std::size_t count = 0;
+			std::size_t size = 0; // of a range
+			std::atomic<std::size_t> ranges = 0;
+			std::atomic<std::size_t> next = 0; // range to take
+			std::atomic<std::size_t> done = 0;
+			std::atomic<std::uint32_t> helpers = 0; // threads that may be taking ranges
+			std::atomic_bool open = false;
+		};
+
+		void splitRanges(std::size_t count, std::size_t ranges, RangeFn fn, void const* context);
+		// Takes ranges of the open split until none are left, returns false if it had none to take.
+		bool runSplit();
+		inline bool splitPending() const {
+			return mSplit.open.load(std::memory_order_acquire) && mSplit.next.load(std::memory_order_relaxed) < mSplit.ranges.load(std::memory_order_relaxed);
+		}
+
+		void run(std::stop_token stopToken, std::size_t index);
+		// Takes a job from the thread's own queue or steals one, returns false if every queue is empty.
+		bool runOne(std::size_t self);
+		void schedule(JobHandle job);
+		void finish(Job& job);
+		// The calling thread's queue, the shared one for threads outside the pool.
+		std::size_t queueIndex() const;
+
+		std::vector<std::unique_ptr<Queue>> mQueues; // one per worker, then the shared one
+		std::atomic<std::uint64_t> mQueued = 0;
+		std::atomic<std::uint64_t> mUnfinished = 0;
+		std::atomic<std::uint64_t> mJobs = 0;
+		std::atomic<std::uint64_t> mSteals = 0;
+
+		std::mutex mSplitMutex; // held by the thread running a split
+		Split mSplit;
+
+		std::mutex mSleepMutex;
+		std::condition_variable_any mWake;
+		std::vector<std::jthread> mThreads;
+	};
+
+	// Runs `fn(first, last)` over [0, count) in blocks of `block`, as jobs on `jobs` if there are any and more than one
+	// block. Every block has finished when it returns or rethrows the first error, `fn` may hold the caller's memory.
+	template<class Fn>
+	void forBlocks(JobSystem* jobs, std::size_t count, std::size_t block, Fn const& fn) {
+		if (!jobs || count <= block) {
+			fn(std::size_t{ 0 }, count);
+			return;
+		}
+
+		std::vector<JobHandle> handles;
+		try {
+			for (std::size_t first = 0; first < count; first += block)
+				handles.push_back(jobs->submit([&fn, first, last = std::min(count, first + block)]() { fn(first, last); }));
+		}
+		catch (...) {
+			try {
+				jobs->waitAll(handles);
+			}
+			catch (...) {}
+			throw;
+		}
+		jobs->waitAll(handles);
+	}
+}
@@ -0,0 +1,49 @@
+#include "hb_latency_calibration.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace hyperbeetle {
+	void LatencyCalibration::start(double engineTime) {
+		mPhase = Phase::Audio;
+		mPhaseStart = engineTime + kLeadIn;
+		mOffsets.clear();
+		mOffsets.reserve(kTapsPerPhase);
+	}
+
+	int LatencyCalibration::beatAfter(double engineTime) const {
+		return std::max(0, static_cast<int>(std::ceil((engineTime - mPhaseStart) / kBeatInterval)));
+	}
+
+	void LatencyCalibration::tap(double engineTime) {
+		if (mPhase == Phase::Done) return;
+
+		int beat = static_cast<int>(std::lround((engineTime - mPhaseStart) / kBeatInterval));
+
+		// The first few beats are for the player to find the rhythm.
+		if (beat < kWarmupBeats) return;
+
+		mOffsets.push_back(engineTime - beatTime(beat));
+		if (taps() < kTapsPerPhase) return;
+
+		double offset = median(mOffsets);
+		mOffsets.clear();
+
+		if (mPhase == Phase::Audio) {
+			mAudioOffset = offset;
+			mPhase = Phase::Visual;
+			mPhaseStart = beatTime(beat) + kLeadIn;
+		}
+		else {
+			mInputLatency = std::max(0.0, offset);
+			mOutputLatency = std::max(0.0, mAudioOffset - offset);
+			mPhase = Phase::Done;
+		}
+	}
+
+	double LatencyCalibration::median(std::vector<double>& values) {
+		auto middle = values.begin() + values.size() / 2;
+		std::nth_element(values.begin(), middle, values.end());
+		return *middle;
+	}
+}
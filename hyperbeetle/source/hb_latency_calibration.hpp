@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+namespace hyperbeetle {
+	// Measures output and input latency by having the player tap along to a metronome.
+	// The audio phase plays clicks, taps land late by output + input latency. The visual phase flashes instead,
+	// taps land late by input latency alone. All times are engine times from SongClock::engineTimeAt.
+	class LatencyCalibration final {
+	public:
+		enum class Phase { Audio, Visual, Done };
+
+		static constexpr double kBeatInterval = 0.5;
+		static constexpr double kLeadIn = 1.0;
+		static constexpr int kWarmupBeats = 4;
+		static constexpr int kTapsPerPhase = 16;
+
+		void start(double engineTime);
+		void tap(double engineTime);
+
+		inline Phase phase() const { return mPhase; }
+		inline int taps() const { return static_cast<int>(mOffsets.size()); }
+
+		// Engine time of beat `index` of the current phase.
+		inline double beatTime(int index) const { return mPhaseStart + index * kBeatInterval; }
+		// Index of the first beat at or after `engineTime`.
+		int beatAfter(double engineTime) const;
+
+		inline double outputLatency() const { return mOutputLatency; }
+		inline double inputLatency() const { return mInputLatency; }
+	private:
+		static double median(std::vector<double>& values);
+
+		Phase mPhase = Phase::Done;
+		double mPhaseStart = 0.0;
+		double mAudioOffset = 0.0;
+		double mOutputLatency = 0.0;
+		double mInputLatency = 0.0;
+		std::vector<double> mOffsets;
+	};
+}
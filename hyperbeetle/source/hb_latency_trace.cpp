@@ -0,0 +1,67 @@
+#include "hb_latency_trace.hpp"
+
+#include <yaml-cpp/yaml.h>
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace hyperbeetle {
+	namespace {
+		constexpr std::string_view kStageNames[] = { "dequeue", "judge", "sound", "display" };
+
+		double milliseconds(std::int64_t ns) { return nanosecondsToSeconds(ns) * 1e3; }
+	}
+
+	std::string_view LatencyTrace::stageName(Stage stage) {
+		return kStageNames[static_cast<std::size_t>(stage)];
+	}
+
+	void LatencyTrace::collect() {
+		for (std::size_t stage = 0; stage < kStages; ++stage) {
+			std::int64_t latency;
+			while (mQueues[stage].pop(latency))
+				mHistograms[stage].record(latency);
+		}
+	}
+
+	void LatencyTrace::reset() {
+		collect();
+		for (Histogram& histogram : mHistograms)
+			histogram.reset();
+	}
+
+	void LatencyTrace::writeStats(std::filesystem::path const& path, std::string_view build) const {
+		YAML::Emitter out;
+		out.SetDoublePrecision(6);
+		out << YAML::BeginMap;
+		out << YAML::Key << "build" << YAML::Value << std::string(build);
+		out << YAML::Key << "dropped" << YAML::Value << dropped();
+
+		// Milliseconds from the key reaching the game, [lower bound in microseconds, inputs] for the buckets.
+		out << YAML::Key << "stages" << YAML::Value << YAML::BeginMap;
+		for (std::size_t stage = 0; stage < kStages; ++stage) {
+			Histogram const& histogram = mHistograms[stage];
+			out << YAML::Key << std::string(kStageNames[stage]) << YAML::Value << YAML::BeginMap;
+			out << YAML::Key << "inputs" << YAML::Value << histogram.count();
+			out << YAML::Key << "mean_ms" << YAML::Value << histogram.mean() * 1e-6;
+			out << YAML::Key << "p50_ms" << YAML::Value << milliseconds(histogram.percentile(0.5));
+			out << YAML::Key << "p99_ms" << YAML::Value << milliseconds(histogram.percentile(0.99));
+			out << YAML::Key << "max_ms" << YAML::Value << milliseconds(histogram.max());
+
+			out << YAML::Key << "buckets" << YAML::Value << YAML::BeginSeq;
+			histogram.forEachBucket([&](std::int64_t lower, std::int64_t, std::uint64_t count) {
+				out << YAML::Flow << YAML::BeginSeq << static_cast<double>(lower) * 1e-3 << count << YAML::EndSeq;
+			});
+			out << YAML::EndSeq;
+			out << YAML::EndMap;
+		}
+		out << YAML::EndMap;
+		out << YAML::EndMap;
+
+		std::ofstream file(path, std::ios::binary | std::ios::out | std::ios::trunc);
+		file << out.c_str() << '\n';
+		if (!file)
+			throw std::runtime_error("Failed to write " + path.string());
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "hb_clock.hpp"
+#include "hb_histogram.hpp"
+#include "hb_spsc_queue.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+namespace hyperbeetle {
+	// Follows key presses from the window system to what the player hears and sees. Each stage is recorded as the time
+	// since the input entered the game (EventKey::tracedAt) by the one thread that reaches it, and handed to the thread
+	// that reads the histograms through a queue of its own. Recording never blocks or allocates, so the audio thread
+	// can do it. Inputs whose stage is reached on a later thread (Display) are held in order until it gets there.
+	class LatencyTrace final {
+	public:
+		enum class Stage : std::uint8_t {
+			Dequeue, // the simulation took it off the input queue
+			Judge, // judged against the chart, only while one plays
+			Sound, // the audio callback started the sound effect it triggered
+			Display, // the buffer swap of the first frame drawn from that tick or a later one
+		};
+		static constexpr std::size_t kStages = 4;
+		// Samples a stage holds between two collects, more are dropped.
+		static constexpr std::size_t kQueueCapacity = 1024;
+
+		static std::string_view stageName(Stage stage);
+
+		// The thread that owns `stage`. Does nothing for inputs that aren't traced, a `tracedAt` of 0.
+		void record(Stage stage, std::int64_t tracedAt, std::int64_t at = now()) noexcept {
+			if (!tracedAt) return;
+			if (!mQueues[static_cast<std::size_t>(stage)].push(at - tracedAt))
+				mDropped.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// Before any thread records. Whether something draws frames and releases the held inputs, hold() holds nothing
+		// otherwise.
+		inline void setDisplayed(bool displayed) { mDisplayed = displayed; }
+
+		// The thread that consumes inputs. Holds a traced input for the Display stage, returns false and counts it as
+		// dropped if too many are held already.
+		bool hold(std::int64_t tracedAt) noexcept {
+			if (!tracedAt || !mDisplayed) return false;
+			if (mHeld.push(tracedAt)) return true;
+			mDropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		// The thread that owns the Display stage. Records the `count` oldest held inputs as displayed at `at`.
+		void release(std::uint64_t count, std::int64_t at = now()) noexcept {
+			std::int64_t tracedAt;
+			for (; count && mHeld.pop(tracedAt); --count)
+				record(Stage::Display, tracedAt, at);
+		}
+
+		// Reader thread. Moves the recorded samples into the histograms.
+		void collect();
+		// Reader thread. Clears the histograms, the samples not collected yet go too.
+		void reset();
+
+		inline Histogram const& histogram(Stage stage) const { return mHistograms[static_cast<std::size_t>(stage)]; }
+		inline std::uint64_t dropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+		// Reader thread. Writes the histograms as YAML with their non-empty buckets, like FramePacer::writeStats.
+		// Throws std::runtime_error.
+		void writeStats(std::filesystem::path const& path, std::string_view build) const;
+	private:
+		std::array<SpscQueue<std::int64_t, kQueueCapacity>, kStages> mQueues;
+		SpscQueue<std::int64_t, kQueueCapacity> mHeld;
+		std::array<Histogram, kStages> mHistograms;
+		std::atomic<std::uint64_t> mDropped = 0;
+		bool mDisplayed = false;
+	};
+}
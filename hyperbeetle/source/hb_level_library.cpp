@@ -0,0 +1,427 @@
+#include "hb_level_library.hpp"
+
+#include "hb_chart_compiler.hpp"
+#include "hb_clock.hpp"
+#include "hb_hash.hpp"
+#include "hb_jobs.hpp"
+#include "hb_mapped_file.hpp"
+#include "hb_pack.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+namespace hyperbeetle {
+	namespace {
+		std::atomic<std::uint64_t> gNextIndexId = 1;
+
+		// Files one scan job reads.
+		constexpr std::size_t kScanBlock = 64;
+		// Scores a tier's matches fall within, a better tier beats every score of a worse one.
+		constexpr std::uint32_t kTierScores = 256;
+		constexpr std::uint32_t kScores = 4 * kTierScores;
+
+		inline char lower(char c) {
+			return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+		}
+
+		inline bool isWordCharacter(char c) {
+			return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || static_cast<unsigned char>(c) >= 0x80;
+		}
+
+		// Letters and digits get a bit each, everything else shares the rest. A key can only match a query whose bits
+		// it has all of, which rules out most keys before looking at them.
+		inline std::uint64_t letterBit(char c) {
+			auto byte = static_cast<unsigned char>(c);
+			if (byte >= 'a' && byte <= 'z') return 1ull << (byte - 'a');
+			if (byte >= '0' && byte <= '9') return 1ull << (26 + byte - '0');
+			return 1ull << (36 + byte % 28);
+		}
+
+		std::uint64_t letterMask(std::string_view text) {
+			std::uint64_t mask = 0;
+			for (char c : text)
+				mask |= letterBit(c);
+			return mask;
+		}
+
+		inline bool isWordStart(std::string_view key, std::size_t i) {
+			return i == 0 || !isWordCharacter(key[i - 1]);
+		}
+
+		// 0 if `key` doesn't match the lowercased `query`, which isn't empty.
+		std::uint32_t score(std::string_view key, std::string_view query) {
+			if (key.starts_with(query))
+				return 4 * kTierScores - 1;
+
+			// Earlier words are the title's, then the artist's and the author's.
+			for (std::size_t at = key.find(query, 1); at != std::string_view::npos; at = key.find(query, at + 1)) {
+				if (isWordStart(key, at))
+					return 3 * kTierScores - 1 - static_cast<std::uint32_t>(std::min<std::size_t>(at, kTierScores - 1));
+			}
+
+			// The characters in order, better the closer together they are and the more of them start words or follow
+			// the one before.
+			std::size_t next = 0, first = 0, last = 0;
+			int bonus = 0;
+			// Jumping from one character to the next with find is what keeps scanning keys that don't match cheap.
+			for (std::size_t i = 0; next < query.size(); ++i, ++next) {
+				i = key.find(query[next], i);
+				if (i == std::string_view::npos) return 0;
+
+				if (next == 0) first = i;
+				else if (last + 1 == i) bonus += 2;
+				if (isWordStart(key, i)) ++bonus;
+				last = i;
+			}
+
+			auto gaps = static_cast<int>(last - first + 1 - query.size());
+			return kTierScores + static_cast<std::uint32_t>(std::clamp(static_cast<int>(kTierScores) - 1 - 4 * gaps + 8 * bonus, 1, static_cast<int>(kTierScores) - 1));
+		}
+
+		bool lessCaseInsensitive(std::string_view a, std::string_view b) {
+			return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+				return static_cast<unsigned char>(lower(x)) < static_cast<unsigned char>(lower(y));
+			});
+		}
+
+		bool isLevelFile(std::filesystem::path const& path) {
+			return path.extension() == ".yaml" || path.extension() == ".hbpak";
+		}
+
+		std::int64_t modifiedTicks(std::filesystem::path const& path, std::error_code& ec) {
+			return std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+		}
+
+		// One file of a scan. Its strings are the previous index's if the file hasn't changed.
+		struct Scanned final {
+			LevelRecord record;
+			LevelRecord const* previous = nullptr;
+			std::string path, title, artist, author;
+			bool read = false;
+		};
+
+		void readChart(Chart const& chart, Scanned& scanned) {
+			ChartHeader const& header = chart.header();
+			scanned.record.bpm = header.bpm;
+			scanned.record.length = header.length;
+			scanned.record.difficulty = header.difficulty;
+			scanned.record.lanes = header.lanes;
+			scanned.record.notes = static_cast<std::uint32_t>(chart.noteCount());
+			scanned.title = chart.title();
+			scanned.artist = chart.artist();
+			scanned.author = chart.author();
+		}
+
+		// A level pack's compiled chart, or a YAML chart compiled in memory without leaving a compiled file behind.
+		void readLevel(std::filesystem::path const& path, Scanned& scanned) {
+			if (path.extension() == ".hbpak") {
+				Pack pack = Pack::open(path);
+				PackEntry const* entry = pack.find(kPackChartName);
+				if (!entry)
+					throw LibraryError(path.string() + ": Not a level pack");
+				PackAsset asset = pack.load(*entry);
+				readChart(Chart::view(asset.bytes()), scanned);
+			}
+			else
+				readChart(Chart::fromBytes(compileChart(loadChartSource(path)), false), scanned);
+		}
+	}
+
+	LevelIndex::LevelIndex() : mId(gNextIndexId.fetch_add(1, std::memory_order_relaxed)), mKeyOffsets{ 0 } {}
+
+	LevelIndex::LevelIndex(std::vector<LevelRecord> records, std::string strings)
+		: mId(gNextIndexId.fetch_add(1, std::memory_order_relaxed)), mRecords(std::move(records)), mStrings(std::move(strings)) {
+		mKeyOffsets.reserve(mRecords.size() + 1);
+		mLetters.reserve(mRecords.size());
+		for (LevelRecord const& record : mRecords) {
+			mKeyOffsets.push_back(static_cast<std::uint32_t>(mKeys.size()));
+			for (std::string_view part : { title(record), artist(record), author(record) }) {
+				if (mKeys.size() > mKeyOffsets.back())
+					mKeys.push_back(' ');
+				std::transform(part.begin(), part.end(), std::back_inserter(mKeys), lower);
+			}
+			mLetters.push_back(letterMask(std::string_view(mKeys).substr(mKeyOffsets.back())));
+		}
+		mKeyOffsets.push_back(static_cast<std::uint32_t>(mKeys.size()));
+	}
+
+	LevelIndex LevelIndex::load(std::filesystem::path const& path) {
+		MappedFile file(path);
+		auto bytes = file.bytes();
+
+		LibraryHeader header;
+		if (bytes.size() < sizeof(LibraryHeader))
+			throw LibraryError(path.string() + ": Too small to be a level index");
+		std::memcpy(&header, bytes.data(), sizeof(header));
+		if (header.magic != kLibraryMagic)
+			throw LibraryError(path.string() + ": Not a level index");
+		if (header.version != kLibraryVersion)
+			throw LibraryError(path.string() + ": Level index version " + std::to_string(header.version) + ", expected " + std::to_string(kLibraryVersion));
+		if (header.fileSize != bytes.size())
+			throw LibraryError(path.string() + ": Level index is truncated");
+		if (hash64(bytes.data() + sizeof(header), bytes.size() - sizeof(header)) != header.checksum)
+			throw LibraryError(path.string() + ": Level index checksum mismatch");
+
+		std::size_t end = bytes.size();
+		if (header.records < sizeof(header) || header.records > end || header.records % alignof(LevelRecord) != 0 || header.recordCount > (end - header.records) / sizeof(LevelRecord))
+			throw LibraryError(path.string() + ": Level index records are out of bounds");
+		if (header.strings < sizeof(header) || header.strings > end || header.stringsSize > end - header.strings || (header.stringsSize && bytes[header.strings + header.stringsSize - 1] != std::byte{ 0 }))
+			throw LibraryError(path.string() + ": Level index strings are out of bounds");
+
+		std::vector<LevelRecord> records(header.recordCount);
+		if (!records.empty())
+			std::memcpy(records.data(), bytes.data() + header.records, records.size() * sizeof(LevelRecord));
+		for (LevelRecord const& record : records) {
+			for (std::uint32_t offset : { record.path, record.title, record.artist, record.author }) {
+				if (offset >= header.stringsSize)
+					throw LibraryError(path.string() + ": Level index string is out of bounds");
+			}
+		}
+
+		std::string strings(reinterpret_cast<char const*>(bytes.data() + header.strings), header.stringsSize);
+		return LevelIndex(std::move(records), std::move(strings));
+	}
+
+	void LevelIndex::save(std::filesystem::path const& path) const {
+		LibraryHeader header;
+		header.records = sizeof(LibraryHeader);
+		header.recordCount = mRecords.size();
+		header.strings = header.records + mRecords.size() * sizeof(LevelRecord);
+		header.stringsSize = mStrings.size();
+		header.fileSize = header.strings + header.stringsSize;
+
+		std::vector<std::byte> bytes(header.fileSize);
+		if (!mRecords.empty())
+			std::memcpy(bytes.data() + header.records, mRecords.data(), mRecords.size() * sizeof(LevelRecord));
+		if (!mStrings.empty())
+			std::memcpy(bytes.data() + header.strings, mStrings.data(), mStrings.size());
+		header.checksum = hash64(bytes.data() + sizeof(header), bytes.size() - sizeof(header));
+		std::memcpy(bytes.data(), &header, sizeof(header));
+
+		std::filesystem::path temporaryPath = path;
+		temporaryPath += ".tmp";
+
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::out | std::ios::trunc);
+			file.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+			if (!file)
+				throw LibraryError("Failed to write " + temporaryPath.string());
+		}
+
+		std::filesystem::rename(temporaryPath, path);
+	}
+
+	std::string_view LevelIndex::string(std::uint32_t offset) const {
+		return mStrings.c_str() + offset;
+	}
+
+	void LevelIndex::search(std::string_view query, LevelSearch& search) const {
+		char lowered[256];
+		std::size_t length = std::min(query.size(), sizeof(lowered));
+		std::transform(query.begin(), query.begin() + length, lowered, lower);
+		std::string_view needle(lowered, length);
+
+		// Whatever matches the longer query matched the shorter one, in the same tier or a better one.
+		bool narrow = search.index == mId && !search.query.empty() && needle.starts_with(search.query);
+		search.index = mId;
+		search.query = needle;
+		search.results.clear();
+
+		if (needle.empty()) {
+			search.matches.clear();
+			for (std::uint32_t i = 0; i < mRecords.size(); ++i) {
+				if (!(mRecords[i].flags & kLevelBroken))
+					search.results.push_back(i);
+			}
+			return;
+		}
+
+		std::uint64_t mask = letterMask(needle);
+		std::array<std::uint32_t, kScores> counts{};
+		std::size_t matched = 0;
+		auto match = [&](std::uint32_t i) {
+			if ((mLetters[i] & mask) != mask || (mRecords[i].flags & kLevelBroken)) return;
+
+			std::string_view key(mKeys.data() + mKeyOffsets[i], mKeyOffsets[i + 1] - mKeyOffsets[i]);
+			if (std::uint32_t value = score(key, needle)) {
+				// Never ahead of the candidate being read, so narrowing writes in place.
+				if (narrow)
+					search.matches[matched++] = static_cast<std::uint64_t>(value) << 32 | i;
+				else
+					search.matches.push_back(static_cast<std::uint64_t>(value) << 32 | i);
+				++counts[value];
+			}
+		};
+
+		if (narrow) {
+			std::size_t candidates = search.matches.size();
+			for (std::size_t j = 0; j < candidates; ++j)
+				match(static_cast<std::uint32_t>(search.matches[j]));
+			search.matches.resize(matched);
+		}
+		else {
+			search.matches.clear();
+			for (std::uint32_t i = 0; i < mRecords.size(); ++i)
+				match(i);
+		}
+
+		// Counting sort from the best score down, stable so ties stay in title order.
+		std::uint32_t offset = 0;
+		for (std::uint32_t value = kScores; value-- > 0;) {
+			std::uint32_t count = counts[value];
+			counts[value] = offset;
+			offset += count;
+		}
+		search.results.resize(search.matches.size());
+		for (std::uint64_t packed : search.matches)
+			search.results[counts[packed >> 32]++] = static_cast<std::uint32_t>(packed);
+	}
+
+	LevelLibrary::LevelLibrary(std::filesystem::path directory, std::filesystem::path indexPath)
+		: mDirectory(std::move(directory)), mIndexPath(std::move(indexPath)) {}
+
+	void LevelLibrary::load() {
+		std::error_code ec;
+		if (!std::filesystem::exists(mIndexPath, ec)) return;
+
+		try {
+			publish(std::make_shared<LevelIndex>(LevelIndex::load(mIndexPath)));
+		}
+		catch (std::exception const&) {}
+	}
+
+	LevelLibrary::ScanStats LevelLibrary::scan(JobSystem* jobs) {
+		std::scoped_lock scanLock(mScanMutex);
+		std::int64_t begin = now();
+		std::shared_ptr<LevelIndex const> current = snapshot();
+
+		// Listing is a readdir per directory, the stats and reads are what's worth spreading over the jobs.
+		std::vector<Scanned> scanned;
+		std::error_code ec;
+		if (std::filesystem::is_directory(mDirectory, ec)) {
+			for (auto it = std::filesystem::recursive_directory_iterator(mDirectory, std::filesystem::directory_options::skip_permission_denied, ec);
+				!ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+				if (it->is_regular_file(ec) && isLevelFile(it->path()))
+					scanned.emplace_back().path = it->path().lexically_relative(mDirectory).generic_string();
+			}
+		}
+
+		std::unordered_map<std::string_view, LevelRecord const*> previous;
+		previous.reserve(current->size());
+		for (LevelRecord const& record : current->records())
+			previous.emplace(current->path(record), &record);
+
+		forBlocks(jobs, scanned.size(), kScanBlock, [&](std::size_t first, std::size_t last) {
+			for (std::size_t i = first; i < last; ++i) {
+				Scanned& file = scanned[i];
+				std::filesystem::path path = mDirectory / file.path;
+				std::error_code fileError;
+				file.record.size = std::filesystem::file_size(path, fileError);
+				file.record.modified = modifiedTicks(path, fileError);
+
+				auto found = previous.find(file.path);
+				LevelRecord const* before = found != previous.end() ? found->second : nullptr;
+				if (before && before->size == file.record.size && before->modified == file.record.modified) {
+					file.record = *before;
+					file.previous = before;
+					continue;
+				}
+
+				file.read = true;
+				try {
+					MappedFile mapped(path);
+					file.record.hash = hash64(mapped.data(), mapped.size());
+					// Touched without changing, so only the file times are new.
+					if (before && before->hash == file.record.hash) {
+						LevelRecord record = *before;
+						record.modified = file.record.modified;
+						file.record = record;
+						file.previous = before;
+						continue;
+					}
+					readLevel(path, file);
+				}
+				catch (std::exception const&) {
+					file.record.flags |= kLevelBroken;
+					file.title = std::filesystem::path(file.path).stem().string();
+				}
+			}
+		});
+
+		ScanStats stats;
+		stats.files = scanned.size();
+		std::size_t kept = 0;
+		std::vector<LevelRecord> records;
+		records.reserve(scanned.size());
+		std::string strings;
+		auto addString = [&](std::string_view text) {
+			auto offset = static_cast<std::uint32_t>(strings.size());
+			strings.append(text);
+			strings.push_back('\0');
+			return offset;
+		};
+
+		for (Scanned& file : scanned) {
+			LevelRecord& record = records.emplace_back(file.record);
+			kept += previous.contains(file.path);
+			if (file.previous) {
+				record.path = addString(file.path);
+				record.title = addString(current->title(*file.previous));
+				record.artist = addString(current->artist(*file.previous));
+				record.author = addString(current->author(*file.previous));
+			}
+			else {
+				record.path = addString(file.path);
+				record.title = addString(file.title);
+				record.artist = addString(file.artist);
+				record.author = addString(file.author);
+			}
+
+			stats.unchanged += !file.read;
+			stats.read += file.read;
+			stats.broken += (record.flags & kLevelBroken) != 0;
+		}
+		stats.removed = current->size() - kept;
+
+		auto string = [&](std::uint32_t offset) { return std::string_view(strings.c_str() + offset); };
+		std::sort(records.begin(), records.end(), [&](LevelRecord const& a, LevelRecord const& b) {
+			std::string_view titleA = string(a.title), titleB = string(b.title);
+			if (lessCaseInsensitive(titleA, titleB)) return true;
+			if (lessCaseInsensitive(titleB, titleA)) return false;
+			return string(a.path) < string(b.path);
+		});
+
+		auto index = std::make_shared<LevelIndex>(std::move(records), std::move(strings));
+		stats.seconds = nanosecondsToSeconds(now() - begin);
+		{
+			std::scoped_lock lock(mMutex);
+			mLastScan = stats;
+		}
+		publish(index);
+
+		// Published either way, only the next startup has to read the changed files again.
+		index->save(mIndexPath);
+		return stats;
+	}
+
+	std::shared_ptr<LevelIndex const> LevelLibrary::snapshot() const {
+		std::scoped_lock lock(mMutex);
+		return mIndex;
+	}
+
+	LevelLibrary::ScanStats LevelLibrary::lastScan() const {
+		std::scoped_lock lock(mMutex);
+		return mLastScan;
+	}
+
+	void LevelLibrary::publish(std::shared_ptr<LevelIndex const> index) {
+		std::scoped_lock lock(mMutex);
+		mIndex = std::move(index);
+		mVersion.store(mVersion.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "hb_chart.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hyperbeetle {
+	class JobSystem;
+
+	class LibraryError final : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	// Level index layout. A header, a record per level file sorted by title, then the strings the records point into.
+	// The records are plain values so the index loads with two copies. Bump kLibraryVersion on any change.
+	inline constexpr std::array<char, 4> kLibraryMagic = { 'H', 'B', 'L', 'I' };
+	inline constexpr std::uint32_t kLibraryVersion = 1;
+
+	struct LibraryHeader final {
+		std::array<char, 4> magic = kLibraryMagic;
+		std::uint32_t version = kLibraryVersion;
+		std::uint64_t checksum = 0; // hash64 of every byte after the header
+		std::uint64_t fileSize = 0;
+
+		std::uint64_t records = 0; // offset of LevelRecord[recordCount]
+		std::uint64_t recordCount = 0;
+		std::uint64_t strings = 0; // offset of the strings, NUL terminated UTF-8
+		std::uint64_t stringsSize = 0;
+	};
+
+	enum LevelFlags : std::uint32_t {
+		kLevelBroken = 1 << 0, // didn't load, kept so rescans don't read it again until it changes
+	};
+
+	struct LevelRecord final {
+		std::uint64_t hash = 0; // hash64 of the file
+		std::int64_t modified = 0; // file time ticks
+		std::uint64_t size = 0;
+
+		double bpm = 0.0;
+		ChartTime length = 0;
+		std::uint32_t difficulty = 0;
+		std::uint32_t lanes = 0;
+		std::uint32_t notes = 0;
+		std::uint32_t flags = 0; // LevelFlags
+
+		// Offsets into the strings. The path is relative to the library's directory, '/' separated.
+		std::uint32_t path = 0, title = 0, artist = 0, author = 0;
+	};
+
+	// The results of a search and the memory it reuses, so searching every frame doesn't allocate. A query that extends
+	// the last one only looks at what that matched, which is what makes typing a query cheap.
+	struct LevelSearch final {
+		std::vector<std::uint32_t> results; // indices of records, best first
+
+		// The last search's, in record order.
+		std::vector<std::uint64_t> matches; // score << 32 | index
+		std::string query; // lowercased
+		std::uint64_t index = 0; // LevelIndex::id
+	};
+
+	// An immutable set of levels. Besides the records it keeps a lowercased "title artist author" key per level and
+	// the letters in it, which is what searches scan.
+	class LevelIndex final {
+	public:
+		LevelIndex();
+		LevelIndex(std::vector<LevelRecord> records, std::string strings);
+
+		// Throws LibraryError if the file is not an index of this version or fails validation.
+		static LevelIndex load(std::filesystem::path const& path);
+		// Writes through a temporary file so a reader never sees a partially written index.
+		void save(std::filesystem::path const& path) const;
+
+		// Unique to this index in the process, searches remember which index they ran on by it.
+		inline std::uint64_t id() const { return mId; }
+		inline std::span<LevelRecord const> records() const { return mRecords; }
+		inline std::size_t size() const { return mRecords.size(); }
+		std::string_view string(std::uint32_t offset) const;
+		inline std::string_view path(LevelRecord const& record) const { return string(record.path); }
+		inline std::string_view title(LevelRecord const& record) const { return string(record.title); }
+		inline std::string_view artist(LevelRecord const& record) const { return string(record.artist); }
+		inline std::string_view author(LevelRecord const& record) const { return string(record.author); }
+
+		// The levels matching `query`, case insensitive. Titles starting with it come first, then levels with a word
+		// starting with it, then those that contain its characters in order. Ties keep title order, and an empty query
+		// lists every level. Broken levels are never listed.
+		void search(std::string_view query, LevelSearch& search) const;
+	private:
+		std::uint64_t mId;
+		std::vector<LevelRecord> mRecords;
+		std::string mStrings;
+		std::string mKeys;
+		std::vector<std::uint32_t> mKeyOffsets; // size() + 1
+		std::vector<std::uint64_t> mLetters; // the characters in each key, as in letterMask
+	};
+
+	// Levels as `.yaml` charts and `.hbpak` level packs under a directory, indexed to a file so startup doesn't read
+	// every level. Scans publish a new index that readers pick up by comparing versions.
+	class LevelLibrary final {
+	public:
+		struct ScanStats final {
+			std::size_t files = 0;
+			std::size_t unchanged = 0; // same size and modification time, not opened
+			std::size_t read = 0; // hashed, and parsed unless the hash matched
+			std::size_t broken = 0;
+			std::size_t removed = 0;
+			double seconds = 0.0;
+		};
+
+		LevelLibrary(std::filesystem::path directory, std::filesystem::path indexPath);
+
+		// Starts from the index the last scan saved, a missing or outdated one only means the next scan reads everything.
+		void load();
+		// Any thread, one scan at a time. Opens only the files whose size or modification time changed since the
+		// current index, on `jobs` if there are any, then publishes and saves the new index. A file that fails to load
+		// is indexed as broken.
+		ScanStats scan(JobSystem* jobs = nullptr);
+
+		// Bumped whenever a new index is published, cheap enough to poll every frame.
+		inline std::uint64_t version() const noexcept { return mVersion.load(std::memory_order_acquire); }
+		std::shared_ptr<LevelIndex const> snapshot() const;
+		ScanStats lastScan() const;
+
+		inline std::filesystem::path const& directory() const { return mDirectory; }
+	private:
+		void publish(std::shared_ptr<LevelIndex const> index);
+
+		std::filesystem::path mDirectory;
+		std::filesystem::path mIndexPath;
+
+		std::mutex mScanMutex;
+		mutable std::mutex mMutex;
+		std::shared_ptr<LevelIndex const> mIndex = std::make_shared<LevelIndex>();
+		ScanStats mLastScan;
+		std::atomic<std::uint64_t> mVersion = 0;
+	};
+}
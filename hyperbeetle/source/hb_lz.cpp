@@ -0,0 +1,136 @@
+#include "hb_lz.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace hyperbeetle {
+	namespace {
+		constexpr std::size_t kMinMatch = 4;
+		constexpr std::size_t kMaxOffset = 65535;
+		constexpr unsigned kHashBits = 16;
+		constexpr std::uint32_t kNoPosition = ~std::uint32_t(0);
+
+		inline std::uint32_t load32(std::byte const* p) {
+			std::uint32_t value;
+			std::memcpy(&value, p, 4);
+			return value;
+		}
+
+		inline std::uint32_t hashSequence(std::uint32_t sequence) {
+			return (sequence * 2654435761u) >> (32 - kHashBits);
+		}
+
+		void writeLength(std::vector<std::byte>& out, std::size_t length) {
+			for (; length >= 255; length -= 255)
+				out.push_back(std::byte{ 255 });
+			out.push_back(static_cast<std::byte>(length));
+		}
+
+		// Literals since the last match, then the match unless this is the last sequence.
+		void writeSequence(std::vector<std::byte>& out, std::byte const* literals, std::size_t literalCount, std::size_t offset, std::size_t matchLength) {
+			std::size_t matchCode = matchLength ? matchLength - kMinMatch : 0;
+			auto token = static_cast<unsigned>(std::min<std::size_t>(literalCount, 15) << 4 | std::min<std::size_t>(matchCode, 15));
+			out.push_back(static_cast<std::byte>(token));
+
+			if (literalCount >= 15)
+				writeLength(out, literalCount - 15);
+			out.insert(out.end(), literals, literals + literalCount);
+
+			if (!matchLength) return;
+
+			out.push_back(static_cast<std::byte>(offset & 0xFF));
+			out.push_back(static_cast<std::byte>(offset >> 8));
+			if (matchCode >= 15)
+				writeLength(out, matchCode - 15);
+		}
+
+		// Adds continuation bytes to a length nibble of 15.
+		bool readLength(std::span<std::byte const> input, std::size_t& position, std::size_t& length) {
+			unsigned byte;
+			do {
+				if (position >= input.size()) return false;
+				byte = static_cast<unsigned>(input[position++]);
+				length += byte;
+			} while (byte == 255);
+			return true;
+		}
+	}
+
+	std::vector<std::byte> compressLz(std::span<std::byte const> input) {
+		std::vector<std::byte> out;
+		out.reserve(input.size() + input.size() / 255 + 16);
+
+		std::vector<std::uint32_t> table(std::size_t(1) << kHashBits, kNoPosition);
+		std::byte const* data = input.data();
+		std::size_t size = input.size();
+		std::size_t anchor = 0;
+		std::size_t i = 0;
+
+		while (i + kMinMatch <= size) {
+			std::uint32_t sequence = load32(data + i);
+			std::uint32_t& slot = table[hashSequence(sequence)];
+			std::size_t candidate = slot;
+			slot = static_cast<std::uint32_t>(i);
+
+			if (candidate == kNoPosition || i - candidate > kMaxOffset || load32(data + candidate) != sequence) {
+				++i;
+				continue;
+			}
+
+			std::size_t length = kMinMatch;
+			while (i + length < size && data[candidate + length] == data[i + length])
+				++length;
+
+			writeSequence(out, data + anchor, i - anchor, i - candidate, length);
+			i += length;
+			anchor = i;
+		}
+
+		writeSequence(out, data + anchor, size - anchor, 0, 0);
+		return out;
+	}
+
+	bool decompressLz(std::span<std::byte const> input, std::span<std::byte> output) {
+		std::size_t in = 0;
+		std::size_t out = 0;
+
+		while (in < input.size()) {
+			auto token = static_cast<unsigned>(input[in++]);
+
+			std::size_t literalCount = token >> 4;
+			if (literalCount == 15 && !readLength(input, in, literalCount)) return false;
+			if (literalCount > input.size() - in || literalCount > output.size() - out) return false;
+
+			if (literalCount)
+				std::memcpy(output.data() + out, input.data() + in, literalCount);
+			in += literalCount;
+			out += literalCount;
+
+			// The last sequence has no match.
+			if (in == input.size()) break;
+
+			if (input.size() - in < 2) return false;
+			std::size_t offset = static_cast<std::size_t>(input[in]) | static_cast<std::size_t>(input[in + 1]) << 8;
+			in += 2;
+			if (offset == 0 || offset > out) return false;
+
+			std::size_t length = token & 15;
+			if (length == 15 && !readLength(input, in, length)) return false;
+			length += kMinMatch;
+			if (length > output.size() - out) return false;
+
+			// Matches may overlap what they write, a run repeats its first bytes.
+			std::byte* dst = output.data() + out;
+			std::byte const* src = dst - offset;
+			if (offset >= length)
+				std::memcpy(dst, src, length);
+			else
+				for (std::size_t j = 0; j < length; ++j)
+					dst[j] = src[j];
+			out += length;
+		}
+
+		return out == output.size();
+	}
+}
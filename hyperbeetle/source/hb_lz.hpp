@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace hyperbeetle {
+	// Small LZ77 byte codec for asset packs, in the block format of LZ4: a token of literal and match length nibbles,
+	// the literals, a two byte little endian offset and length continuations of 255. Compression is a single greedy
+	// pass over a hash table of 4 byte sequences, decompression is a bounds-checked copy loop.
+	std::vector<std::byte> compressLz(std::span<std::byte const> input);
+
+	// Fills `output`, which must be exactly the decompressed size. Returns false if `input` is malformed.
+	bool decompressLz(std::span<std::byte const> input, std::span<std::byte> output);
+}
@@ -0,0 +1,93 @@
+#include "hb_mapped_file.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace hyperbeetle {
+#ifdef _WIN32
+	MappedFile::MappedFile(std::filesystem::path const& path) {
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("Failed to open " + path.string());
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size)) {
+			CloseHandle(file);
+			throw std::runtime_error("Failed to stat " + path.string());
+		}
+
+		mSize = static_cast<std::size_t>(size.QuadPart);
+		if (mSize == 0) {
+			CloseHandle(file);
+			return;
+		}
+
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!mapping)
+			throw std::runtime_error("Failed to map " + path.string());
+
+		// The view keeps the mapping alive.
+		mData = static_cast<std::byte const*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		CloseHandle(mapping);
+		if (!mData)
+			throw std::runtime_error("Failed to map " + path.string());
+	}
+
+	MappedFile::~MappedFile() noexcept {
+		if (mData)
+			UnmapViewOfFile(mData);
+	}
+#else
+	MappedFile::MappedFile(std::filesystem::path const& path) {
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd == -1)
+			throw std::runtime_error("Failed to open " + path.string());
+
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			close(fd);
+			throw std::runtime_error("Failed to stat " + path.string());
+		}
+
+		mSize = static_cast<std::size_t>(info.st_size);
+		if (mSize == 0) {
+			close(fd);
+			return;
+		}
+
+		int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+		// Fault everything in now rather than during gameplay.
+		flags |= MAP_POPULATE;
+#endif
+
+		// The mapping keeps the file alive.
+		void* data = mmap(nullptr, mSize, PROT_READ, flags, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED)
+			throw std::runtime_error("Failed to map " + path.string());
+
+		mData = static_cast<std::byte const*>(data);
+	}
+
+	MappedFile::~MappedFile() noexcept {
+		if (mData)
+			munmap(const_cast<std::byte*>(mData), mSize);
+	}
+#endif
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+		std::swap(mData, other.mData);
+		std::swap(mSize, other.mSize);
+		return *this;
+	}
+}
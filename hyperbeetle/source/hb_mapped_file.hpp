@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <utility>
+
+namespace hyperbeetle {
+	// Read-only memory mapping of a whole file.
+	class MappedFile final {
+	public:
+		constexpr MappedFile() noexcept = default;
+		explicit MappedFile(std::filesystem::path const& path);
+		MappedFile(MappedFile const&) = delete;
+		MappedFile& operator=(MappedFile const&) = delete;
+		inline MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		~MappedFile() noexcept;
+
+		inline std::byte const* data() const { return mData; }
+		inline std::size_t size() const { return mSize; }
+		inline std::span<std::byte const> bytes() const { return { mData, mSize }; }
+	private:
+		std::byte const* mData = nullptr;
+		std::size_t mSize = 0;
+	};
+}
@@ -0,0 +1,425 @@
+#include "hb_music_stream.hpp"
+#include "hb_clock.hpp"
+
+#define STB_VORBIS_HEADER_ONLY
+#include <stb_vorbis.c>
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+namespace hyperbeetle {
+	namespace {
+		constexpr std::size_t kOggPageHeaderSize = 27;
+
+		template<class T>
+		T readLittleEndian(std::byte const* p) {
+			T value = 0;
+			for (std::size_t i = 0; i < sizeof(T); ++i)
+				value |= static_cast<T>(std::to_integer<std::uint8_t>(p[i])) << (8 * i);
+			return value;
+		}
+	}
+
+	ma_data_source_vtable const MusicStream::kVtable = {
+		&MusicStream::onRead,
+		&MusicStream::onSeek,
+		&MusicStream::onGetDataFormat,
+		&MusicStream::onGetCursor,
+		&MusicStream::onGetLength,
+		nullptr, // onSetLooping
+		0
+	};
+
+	void MusicStream::open(std::filesystem::path const& path, ma_engine& engine, double aheadSeconds) {
+		close();
+
+		mOpenTime = now();
+		mFile = MappedFile(path);
+		mBytes = mFile.bytes();
+		start(engine, aheadSeconds);
+	}
+
+	void MusicStream::open(std::span<std::byte const> bytes, ma_engine& engine, double aheadSeconds) {
+		close();
+
+		mOpenTime = now();
+		mBytes = bytes;
+		start(engine, aheadSeconds);
+	}
+
+	void MusicStream::start(ma_engine& engine, double aheadSeconds) {
+		buildIndex();
+		openDecoder();
+
+		stb_vorbis_info info = stb_vorbis_get_info(mDecoder);
+		mSampleRate = info.sample_rate;
+		mChannels = static_cast<std::uint32_t>(info.channels);
+		mDecoderBytes = info.setup_memory_required + info.temp_memory_required;
+		mMaxFrameSize = static_cast<std::uint32_t>(info.max_frame_size);
+
+		// Room for at least a few of the largest frames, the worker only writes whole frames.
+		auto aheadFrames = static_cast<std::uint64_t>(aheadSeconds * mSampleRate);
+		mRingFrames = std::bit_ceil(std::max<std::uint64_t>(aheadFrames, 4 * static_cast<std::uint64_t>(mMaxFrameSize)));
+		mRing = std::make_unique<float[]>(mRingFrames * mChannels);
+
+		mWrite.store(0, std::memory_order_relaxed);
+		mRead.store(0, std::memory_order_relaxed);
+		mCursor.store(0, std::memory_order_relaxed);
+		mSeekRequested.store(0, std::memory_order_relaxed);
+		mSeekServed.store(0, std::memory_order_relaxed);
+		mFirstAudio.store(0, std::memory_order_relaxed);
+		mUnderruns.store(0, std::memory_order_relaxed);
+		mLastSeekNanoseconds.store(0, std::memory_order_relaxed);
+		mMaxSeekNanoseconds.store(0, std::memory_order_relaxed);
+		mSeeks.store(0, std::memory_order_relaxed);
+
+		mSource.stream = this;
+
+		ma_data_source_config config = ma_data_source_config_init();
+		config.vtable = &kVtable;
+
+		if (ma_data_source_init(&config, &mSource.base) != MA_SUCCESS)
+			throw std::runtime_error("Failed to initialize music data source");
+
+		if (ma_sound_init_from_data_source(&engine, &mSource, MA_SOUND_FLAG_NO_PITCH | MA_SOUND_FLAG_NO_SPATIALIZATION, mGroup, &mSound) != MA_SUCCESS) {
+			ma_data_source_uninit(&mSource.base);
+			throw std::runtime_error("Failed to initialize music sound");
+		}
+
+		mEngine = &engine;
+		mThread = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+	}
+
+	void MusicStream::close() {
+		if (mThread.joinable()) {
+			mThread.request_stop();
+			mThread.join();
+		}
+
+		if (mEngine) {
+			ma_sound_uninit(&mSound);
+			ma_data_source_uninit(&mSource.base);
+			mEngine = nullptr;
+		}
+
+		if (mDecoder) {
+			stb_vorbis_close(mDecoder);
+			mDecoder = nullptr;
+		}
+
+		mOutputFrames = 0;
+		mRing.reset();
+		mPages.clear();
+		mFile = MappedFile();
+		mBytes = {};
+	}
+
+	void MusicStream::play(std::uint64_t startFrame) {
+		ma_sound_set_start_time_in_pcm_frames(&mSound, startFrame);
+		ma_sound_start(&mSound);
+	}
+
+	void MusicStream::stop() {
+		ma_sound_stop(&mSound);
+	}
+
+	void MusicStream::seek(std::uint64_t frame) {
+		requestSeek(frame);
+
+		// Takes the lock so the worker can't miss the wakeup between checking for a seek and going to sleep.
+		{ std::lock_guard lock(mMutex); }
+		mWake.notify_one();
+	}
+
+	bool MusicStream::seeking() const {
+		return mSeekRequested.load(std::memory_order_acquire) != mSeekServed.load(std::memory_order_acquire);
+	}
+
+	void MusicStream::requestSeek(std::uint64_t frame) {
+		mSeekFrame.store(std::min(frame, mLength), std::memory_order_relaxed);
+		mSeekTime.store(now(), std::memory_order_relaxed);
+		mSeekRequested.fetch_add(1, std::memory_order_seq_cst);
+	}
+
+	MusicStream::Stats MusicStream::stats() const {
+		Stats stats;
+		stats.residentBytes = mRingFrames * mChannels * sizeof(float) + mPages.capacity() * sizeof(Page) + mDecoderBytes;
+		stats.decodedBytes = mLength * mChannels * sizeof(float);
+
+		std::int64_t firstAudio = mFirstAudio.load(std::memory_order_relaxed);
+		stats.firstAudio = firstAudio ? nanosecondsToSeconds(firstAudio - mOpenTime) : 0.0;
+
+		stats.lastSeek = nanosecondsToSeconds(mLastSeekNanoseconds.load(std::memory_order_relaxed));
+		stats.maxSeek = nanosecondsToSeconds(mMaxSeekNanoseconds.load(std::memory_order_relaxed));
+		stats.seeks = mSeeks.load(std::memory_order_relaxed);
+		stats.underruns = mUnderruns.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	void MusicStream::buildIndex() {
+		auto bytes = mBytes;
+
+		mPages.clear();
+
+		std::size_t offset = 0;
+		while (offset + kOggPageHeaderSize <= bytes.size() && std::memcmp(bytes.data() + offset, "OggS", 4) == 0) {
+			std::byte const* header = bytes.data() + offset;
+			std::size_t segmentCount = std::to_integer<std::size_t>(header[26]);
+			if (offset + kOggPageHeaderSize + segmentCount > bytes.size())
+				break;
+
+			std::byte const* segments = header + kOggPageHeaderSize;
+			std::size_t size = kOggPageHeaderSize + segmentCount;
+			for (std::size_t i = 0; i < segmentCount; ++i)
+				size += std::to_integer<std::size_t>(segments[i]);
+
+			// A decoder only knows where it is after a page whose last packet ends on it.
+			auto granule = readLittleEndian<std::uint64_t>(header + 6);
+			bool continued = segmentCount == 0 || std::to_integer<std::uint8_t>(segments[segmentCount - 1]) == 255;
+			if (granule != ~std::uint64_t(0) && !continued)
+				mPages.push_back({ granule, offset });
+
+			offset += size;
+		}
+
+		if (mPages.empty())
+			throw std::runtime_error("Not an Ogg Vorbis file");
+
+		mPages.shrink_to_fit();
+		mLength = mPages.back().granule;
+	}
+
+	void MusicStream::openDecoder() {
+		if (mDecoder) stb_vorbis_close(mDecoder);
+
+		auto bytes = mBytes;
+		int used = 0, error = 0;
+		mDecoder = stb_vorbis_open_pushdata(reinterpret_cast<unsigned char const*>(bytes.data()), static_cast<int>(std::min<std::size_t>(bytes.size(), INT_MAX)), &used, &error, nullptr);
+		if (!mDecoder)
+			throw std::runtime_error("Failed to open Vorbis stream, error " + std::to_string(error));
+
+		mAudioOffset = static_cast<std::size_t>(used);
+		mPosition = mAudioOffset;
+		mOutputFrames = 0;
+		mOutputFrame = 0;
+		mEndOfStream = false;
+	}
+
+	void MusicStream::seekDecoder(std::uint64_t frame) {
+		mOutputFrames = 0;
+
+		if (frame >= mLength) {
+			mEndOfStream = true;
+			return;
+		}
+
+		// A flushed decoder resyncs on the page it is fed and discards the first packet on it, so it starts output up
+		// to a frame past the start of that page. Feed it the page holding the target unless the target is that close
+		// to its start, then step back further in the rare case that still overshoots.
+		auto page = std::upper_bound(mPages.begin(), mPages.end(), frame, [](std::uint64_t target, Page const& entry) { return target < entry.granule; });
+		std::ptrdiff_t first = page - mPages.begin();
+		if (first > 0 && frame < mPages[first - 1].granule + mMaxFrameSize)
+			--first;
+
+		for (std::ptrdiff_t start = first; ; --start) {
+			if (start < 0 || mPages[start].offset < mAudioOffset) {
+				openDecoder();
+				decode();
+				break;
+			}
+
+			stb_vorbis_flush_pushdata(mDecoder);
+			mPosition = mPages[start].offset;
+			mEndOfStream = false;
+			mOutputFrame = ~std::uint64_t(0); // unknown until the decoder has synced
+
+			if (decode() && mOutputFrame <= frame) break;
+		}
+
+		// Drop what lies before the target, the held frame is then trimmed to start on it.
+		while (mOutputFrames && mOutputFrame + mOutputFrames <= frame) {
+			if (!decode()) return;
+		}
+
+		if (mOutputFrames && mOutputFrame < frame) {
+			auto skip = static_cast<std::uint32_t>(frame - mOutputFrame);
+			mOutputOffset += skip;
+			mOutputFrames -= skip;
+			mOutputFrame = frame;
+		}
+	}
+
+	bool MusicStream::decode() {
+		auto bytes = mBytes;
+		auto const* data = reinterpret_cast<unsigned char const*>(bytes.data());
+
+		// Where the previous output ended, in case the decoder can't tell.
+		std::uint64_t next = mOutputFrame + mOutputFrames;
+		mOutputFrames = 0;
+
+		while (!mEndOfStream) {
+			int channels = 0, samples = 0;
+			float** output = nullptr;
+			int length = static_cast<int>(std::min<std::size_t>(bytes.size() - mPosition, INT_MAX));
+			int used = stb_vorbis_decode_frame_pushdata(mDecoder, data + mPosition, length, &channels, &output, &samples);
+
+			// The whole file is mapped, so needing more data means there is none.
+			if (used == 0 && samples == 0) {
+				mEndOfStream = true;
+				break;
+			}
+
+			mPosition += static_cast<std::size_t>(used);
+			if (mPosition >= bytes.size())
+				mEndOfStream = true;
+
+			if (samples == 0) continue;
+
+			// The sample offset points past the frame that was just returned.
+			int offset = stb_vorbis_get_sample_offset(mDecoder);
+			mOutput = output;
+			mOutputOffset = 0;
+			mOutputFrames = static_cast<std::uint32_t>(samples);
+			mOutputFrame = offset >= samples ? static_cast<std::uint64_t>(offset - samples) : next;
+			return true;
+		}
+
+		return false;
+	}
+
+	void MusicStream::write() {
+		std::uint64_t write = mWrite.load(std::memory_order_relaxed);
+		std::uint64_t mask = mRingFrames - 1;
+
+		for (std::uint32_t i = 0; i < mOutputFrames; ++i) {
+			float* frame = &mRing[((write + i) & mask) * mChannels];
+			for (std::uint32_t channel = 0; channel < mChannels; ++channel)
+				frame[channel] = mOutput[channel][mOutputOffset + i];
+		}
+
+		mWrite.store(write + mOutputFrames, std::memory_order_release);
+		mOutputFrame += mOutputFrames;
+		mOutputFrames = 0;
+	}
+
+	void MusicStream::run(std::stop_token stopToken) {
+		// Wakes often enough to top the ring up long before it runs dry.
+		auto interval = std::chrono::microseconds(static_cast<std::int64_t>(mRingFrames * 1e6 / mSampleRate / 4));
+
+		std::uint64_t served = 0;
+
+		while (!stopToken.stop_requested()) {
+			std::uint64_t requested = mSeekRequested.load(std::memory_order_seq_cst);
+
+			if (requested != served) {
+				// A mix that started before the request may still be copying out of the ring, wait it out. Every mix
+				// after this sees the request and stays silent, so the ring can be reset from this side.
+				while (mReading.load(std::memory_order_seq_cst))
+					std::this_thread::yield();
+
+				std::uint64_t frame = mSeekFrame.load(std::memory_order_relaxed);
+				seekDecoder(frame);
+
+				mRead.store(mWrite.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				mCursor.store(frame, std::memory_order_relaxed);
+				if (mOutputFrames) write();
+
+				// Recorded first, so whoever sees the seek served also sees its latency.
+				std::int64_t latency = now() - mSeekTime.load(std::memory_order_relaxed);
+				mLastSeekNanoseconds.store(latency, std::memory_order_relaxed);
+				mMaxSeekNanoseconds.store(std::max(mMaxSeekNanoseconds.load(std::memory_order_relaxed), latency), std::memory_order_relaxed);
+				mSeeks.fetch_add(1, std::memory_order_relaxed);
+
+				served = requested;
+				mSeekServed.store(served, std::memory_order_release);
+				continue;
+			}
+
+			while (mSeekRequested.load(std::memory_order_relaxed) == served) {
+				if (!mOutputFrames && !decode()) break;
+
+				std::uint64_t used = mWrite.load(std::memory_order_relaxed) - mRead.load(std::memory_order_acquire);
+				if (mRingFrames - used < mOutputFrames) break;
+
+				write();
+			}
+
+			std::unique_lock lock(mMutex);
+			mWake.wait_for(lock, stopToken, interval, [&]() { return mSeekRequested.load(std::memory_order_relaxed) != served; });
+		}
+	}
+
+	ma_result MusicStream::onRead(ma_data_source* pDataSource, void* pFramesOut, ma_uint64 frameCount, ma_uint64* pFramesRead) {
+		MusicStream& stream = *static_cast<Source*>(pDataSource)->stream;
+		auto* out = static_cast<float*>(pFramesOut);
+		std::uint32_t channels = stream.mChannels;
+
+		ma_uint64 framesRead = 0;
+
+		stream.mReading.store(true, std::memory_order_seq_cst);
+
+		if (stream.mSeekRequested.load(std::memory_order_seq_cst) == stream.mSeekServed.load(std::memory_order_acquire)) {
+			std::uint64_t read = stream.mRead.load(std::memory_order_relaxed);
+			std::uint64_t write = stream.mWrite.load(std::memory_order_acquire);
+			std::uint64_t mask = stream.mRingFrames - 1;
+
+			framesRead = std::min<std::uint64_t>(frameCount, write - read);
+
+			// At most two copies, the second one after wrapping around.
+			std::uint64_t first = std::min<std::uint64_t>(framesRead, stream.mRingFrames - (read & mask));
+			std::memcpy(out, &stream.mRing[(read & mask) * channels], first * channels * sizeof(float));
+			std::memcpy(out + first * channels, &stream.mRing[0], (framesRead - first) * channels * sizeof(float));
+
+			stream.mRead.store(read + framesRead, std::memory_order_release);
+
+			std::uint64_t cursor = stream.mCursor.load(std::memory_order_relaxed) + framesRead;
+			stream.mCursor.store(cursor, std::memory_order_relaxed);
+
+			bool started = stream.mFirstAudio.load(std::memory_order_relaxed) != 0;
+			if (framesRead && !started)
+				stream.mFirstAudio.store(now(), std::memory_order_relaxed);
+			else if (framesRead < frameCount && started && cursor < stream.mLength)
+				stream.mUnderruns.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		stream.mReading.store(false, std::memory_order_release);
+
+		// Silence through seeks, underruns and past the end, the sound keeps running so a seek can resume it.
+		std::memset(out + framesRead * channels, 0, (frameCount - framesRead) * channels * sizeof(float));
+
+		if (pFramesRead)
+			*pFramesRead = frameCount;
+
+		return MA_SUCCESS;
+	}
+
+	ma_result MusicStream::onSeek(ma_data_source* pDataSource, ma_uint64 frameIndex) {
+		// Called from the mixer, the worker picks the request up on its next wakeup.
+		static_cast<Source*>(pDataSource)->stream->requestSeek(frameIndex);
+		return MA_SUCCESS;
+	}
+
+	ma_result MusicStream::onGetDataFormat(ma_data_source* pDataSource, ma_format* pFormat, ma_uint32* pChannels, ma_uint32* pSampleRate, ma_channel* pChannelMap, size_t channelMapCap) {
+		MusicStream& stream = *static_cast<Source*>(pDataSource)->stream;
+
+		if (pFormat) *pFormat = ma_format_f32;
+		if (pChannels) *pChannels = stream.mChannels;
+		if (pSampleRate) *pSampleRate = stream.mSampleRate;
+		if (pChannelMap) ma_channel_map_init_standard(ma_standard_channel_map_default, pChannelMap, channelMapCap, stream.mChannels);
+
+		return MA_SUCCESS;
+	}
+
+	ma_result MusicStream::onGetCursor(ma_data_source* pDataSource, ma_uint64* pCursor) {
+		*pCursor = static_cast<Source*>(pDataSource)->stream->cursor();
+		return MA_SUCCESS;
+	}
+
+	ma_result MusicStream::onGetLength(ma_data_source* pDataSource, ma_uint64* pLength) {
+		*pLength = static_cast<Source*>(pDataSource)->stream->mLength;
+		return MA_SUCCESS;
+	}
+}
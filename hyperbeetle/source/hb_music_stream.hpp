@@ -0,0 +1,151 @@
+#pragma once
+
+#include "hb_mapped_file.hpp"
+#include "hb_spsc_queue.hpp"
+
+#include <miniaudio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+struct stb_vorbis;
+
+namespace hyperbeetle {
+	// A music track streamed from a memory mapped Ogg Vorbis file instead of being decoded up front.
+	// A worker decodes ahead into a bounded ring of interleaved PCM that the mixer reads as a data source, so a track
+	// costs a fraction of a second of PCM no matter how long it is. Opening builds an index of the Ogg pages' granule
+	// positions, so a seek only decodes from the page holding the target instead of from the start of the file.
+	class MusicStream final {
+	public:
+		static constexpr double kDefaultAheadSeconds = 0.5;
+
+		struct Stats final {
+			std::uint64_t residentBytes = 0; // ring, page index and decoder, fixed while the track is open
+			std::uint64_t decodedBytes = 0; // the whole track as PCM, what decoding it up front would take
+			double firstAudio = 0.0; // seconds from `open` to the first frame handed to the mixer, 0 until then
+			double lastSeek = 0.0; // seconds from `seek` to the target being decoded
+			double maxSeek = 0.0;
+			std::uint64_t seeks = 0;
+			std::uint64_t underruns = 0; // mixer reads that ran out of decoded frames
+		};
+
+		MusicStream() = default;
+		MusicStream(MusicStream const&) = delete;
+		MusicStream& operator=(MusicStream const&) = delete;
+		~MusicStream() noexcept { close(); }
+
+		// Starts decoding from the beginning right away, playback waits for `play`. Throws std::runtime_error.
+		void open(std::filesystem::path const& path, ma_engine& engine, double aheadSeconds = kDefaultAheadSeconds);
+		// Streams from bytes someone else owns, such as an asset pack's mapping. They must stay alive until `close`.
+		void open(std::span<std::byte const> bytes, ma_engine& engine, double aheadSeconds = kDefaultAheadSeconds);
+		void close();
+		inline bool isOpen() const { return mEngine != nullptr; }
+		// Group the track plays through from the next `open`, the engine's endpoint if null. It must outlive the stream.
+		inline void setGroup(ma_sound_group* group) { mGroup = group; }
+
+		// Starts at the absolute engine frame `startFrame`, or on the next mix if that has passed.
+		void play(std::uint64_t startFrame = 0);
+		void stop();
+		// Any thread. Plays silence until the worker has decoded `frame`, counted in the track's sample rate.
+		void seek(std::uint64_t frame);
+		bool seeking() const;
+
+		inline std::uint32_t sampleRate() const { return mSampleRate; }
+		inline std::uint32_t channels() const { return mChannels; }
+		inline std::uint64_t length() const { return mLength; }
+		// The next frame the mixer reads.
+		inline std::uint64_t cursor() const { return mCursor.load(std::memory_order_relaxed); }
+		inline bool finished() const { return cursor() >= mLength; }
+
+		Stats stats() const;
+	private:
+		struct Page final {
+			std::uint64_t granule; // frames decoded by the end of the page
+			std::size_t offset;
+		};
+
+		// Lets the data source callbacks find the stream, miniaudio requires the base to come first.
+		struct Source final {
+			ma_data_source_base base;
+			MusicStream* stream = nullptr;
+		};
+
+		static ma_result onRead(ma_data_source* pDataSource, void* pFramesOut, ma_uint64 frameCount, ma_uint64* pFramesRead);
+		static ma_result onSeek(ma_data_source* pDataSource, ma_uint64 frameIndex);
+		static ma_result onGetDataFormat(ma_data_source* pDataSource, ma_format* pFormat, ma_uint32* pChannels, ma_uint32* pSampleRate, ma_channel* pChannelMap, size_t channelMapCap);
+		static ma_result onGetCursor(ma_data_source* pDataSource, ma_uint64* pCursor);
+		static ma_result onGetLength(ma_data_source* pDataSource, ma_uint64* pLength);
+		static ma_data_source_vtable const kVtable;
+
+		void start(ma_engine& engine, double aheadSeconds);
+		void buildIndex();
+		void requestSeek(std::uint64_t frame);
+
+		// Worker.
+		void run(std::stop_token stopToken);
+		void openDecoder();
+		void seekDecoder(std::uint64_t frame);
+		// Decodes until a frame produces output, which is held until `write` copies it into the ring.
+		bool decode();
+		void write();
+
+		MappedFile mFile; // unless streaming from borrowed bytes
+		std::span<std::byte const> mBytes;
+		std::vector<Page> mPages; // pages a decoder can resume after, at most a few KB per minute of audio
+		std::size_t mAudioOffset = 0; // first byte after the Vorbis headers
+
+		std::uint32_t mSampleRate = 0;
+		std::uint32_t mChannels = 0;
+		std::uint32_t mMaxFrameSize = 0;
+		std::uint64_t mLength = 0;
+		std::uint64_t mDecoderBytes = 0;
+
+		// Worker only once it runs.
+		stb_vorbis* mDecoder = nullptr;
+		std::size_t mPosition = 0; // next byte to feed the decoder
+		float** mOutput = nullptr; // planar, owned by the decoder
+		std::uint32_t mOutputOffset = 0;
+		std::uint32_t mOutputFrames = 0;
+		std::uint64_t mOutputFrame = 0; // track frame of the first held frame
+		bool mEndOfStream = false;
+
+		// Interleaved frames. Positions count frames since `open` and only ever grow. The worker writes, the mixer reads,
+		// and the worker only moves the read position while it holds the mixer off during a seek.
+		std::unique_ptr<float[]> mRing;
+		std::uint64_t mRingFrames = 0;
+		alignas(kCacheLineSize) std::atomic<std::uint64_t> mWrite = 0;
+		alignas(kCacheLineSize) std::atomic<std::uint64_t> mRead = 0;
+		std::atomic<std::uint64_t> mCursor = 0;
+		std::atomic_bool mReading = false;
+
+		// The mixer plays silence while `mSeekServed` lags `mSeekRequested`.
+		alignas(kCacheLineSize) std::atomic<std::uint64_t> mSeekRequested = 0;
+		std::atomic<std::uint64_t> mSeekFrame = 0;
+		std::atomic<std::int64_t> mSeekTime = 0;
+		std::atomic<std::uint64_t> mSeekServed = 0;
+
+		std::atomic<std::int64_t> mFirstAudio = 0;
+		std::atomic<std::uint64_t> mUnderruns = 0;
+		std::atomic<std::int64_t> mLastSeekNanoseconds = 0;
+		std::atomic<std::int64_t> mMaxSeekNanoseconds = 0;
+		std::atomic<std::uint64_t> mSeeks = 0;
+
+		std::int64_t mOpenTime = 0;
+		ma_engine* mEngine = nullptr;
+		ma_sound_group* mGroup = nullptr;
+		Source mSource;
+		ma_sound mSound;
+
+		std::mutex mMutex;
+		std::condition_variable_any mWake;
+		std::jthread mThread;
+	};
+}
@@ -0,0 +1,162 @@
+#include "hb_note_store.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace hyperbeetle {
+	namespace {
+		// Index of the first time at or after `limit`, starting from `cursor`. `times` is sorted and padded with sentinels
+		// larger than any limit, so whole blocks of four are read without a bounds check. Within a block the times below the
+		// limit are a prefix, so its length is the count of trailing ones in the comparison mask.
+		std::size_t skipBefore(ChartTime const* times, std::size_t cursor, ChartTime limit) {
+#if defined(__AVX2__)
+			__m256i const bound = _mm256_set1_epi64x(limit);
+			for (;;) {
+				__m256i block = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(times + cursor));
+				unsigned mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(bound, block))));
+				if (mask != 0xF) return cursor + std::countr_one(mask);
+				cursor += 4;
+			}
+#else
+			for (;;) {
+				unsigned mask = unsigned(times[cursor] < limit) | unsigned(times[cursor + 1] < limit) << 1 | unsigned(times[cursor + 2] < limit) << 2 | unsigned(times[cursor + 3] < limit) << 3;
+				if (mask != 0xF) return cursor + std::countr_one(mask);
+				cursor += 4;
+			}
+#endif
+		}
+
+		// Perfect, Great, Good, or Miss when outside every window, without branching on the offset.
+		HitGrade classify(ChartTime offset, HitWindows const& windows) {
+			ChartTime distance = std::abs(offset);
+			unsigned tier = unsigned(distance > windows.perfect) + unsigned(distance > windows.great) + unsigned(distance > windows.good);
+			return static_cast<HitGrade>(tier);
+		}
+	}
+
+	void NoteStore::build(Chart const& chart, HitWindows const& windows) {
+		build(chart.noteTimes(), chart.noteDurations(), chart.noteLanes(), chart.header().lanes, windows);
+	}
+
+	void NoteStore::build(std::span<ChartTime const> times, std::span<ChartTime const> durations, std::span<std::uint8_t const> lanes, std::uint32_t laneCount, HitWindows const& windows) {
+		mWindows = windows;
+		mNoteCount = times.size();
+		mStats = {};
+
+		for (std::uint8_t lane : lanes)
+			laneCount = std::max(laneCount, std::uint32_t(lane) + 1);
+
+		std::vector<std::size_t> counts(laneCount);
+		for (std::uint8_t lane : lanes)
+			++counts[lane];
+
+		mLanes.clear();
+		mLanes.resize(laneCount);
+		for (std::uint32_t i = 0; i < laneCount; ++i) {
+			mLanes[i].times.reserve(counts[i] + kPadding);
+			mLanes[i].ends.reserve(counts[i]);
+			mLanes[i].notes.reserve(counts[i]);
+		}
+
+		// Chart notes are sorted by time, so each lane comes out sorted too.
+		for (std::size_t i = 0; i < times.size(); ++i) {
+			Lane& lane = mLanes[lanes[i]];
+			lane.times.push_back(times[i]);
+			lane.ends.push_back(times[i] + durations[i]);
+			lane.notes.push_back(static_cast<std::uint32_t>(i));
+		}
+
+		for (Lane& lane : mLanes)
+			lane.times.insert(lane.times.end(), kPadding, kSentinel);
+	}
+
+	Judgment NoteStore::press(std::uint32_t lane, ChartTime time) {
+		if (lane >= mLanes.size()) return {};
+		Lane& l = mLanes[lane];
+
+		missUntil(l, time - mWindows.good);
+
+		ChartTime offset = time - l.times[l.cursor];
+		HitGrade grade = classify(offset, mWindows);
+		if (grade == HitGrade::Miss) return {}; // Next note is still too far ahead
+
+		std::size_t index = l.cursor++;
+		record(grade);
+
+		if (l.ends[index] > l.times[index]) {
+			l.holdNote = l.notes[index];
+			l.holdEnd = l.ends[index];
+		}
+
+		return { grade, l.notes[index], offset };
+	}
+
+	Judgment NoteStore::release(std::uint32_t lane, ChartTime time) {
+		if (lane >= mLanes.size()) return {};
+		Lane& l = mLanes[lane];
+		if (l.holdNote == Judgment::kNoNote) return {};
+
+		Judgment judgment{ HitGrade::Perfect, l.holdNote, time - l.holdEnd };
+		if (time < l.holdEnd - mWindows.good) {
+			judgment.grade = HitGrade::Miss;
+			++mStats.holdsBroken;
+			mStats.combo = 0;
+		}
+		else {
+			++mStats.holdsCompleted;
+		}
+
+		l.holdNote = Judgment::kNoNote;
+		return judgment;
+	}
+
+	void NoteStore::advance(ChartTime time) {
+		for (Lane& lane : mLanes) {
+			missUntil(lane, time - mWindows.good);
+
+			if (lane.holdNote != Judgment::kNoNote && time >= lane.holdEnd) {
+				++mStats.holdsCompleted;
+				lane.holdNote = Judgment::kNoNote;
+			}
+		}
+	}
+
+	void NoteStore::seek(ChartTime time) {
+		seek(time, Stats{});
+	}
+
+	void NoteStore::seek(ChartTime time, Stats const& stats) {
+		for (Lane& lane : mLanes) {
+			lane.cursor = std::lower_bound(lane.times.begin(), lane.times.end() - kPadding, time) - lane.times.begin();
+			lane.holdNote = Judgment::kNoNote;
+		}
+		mStats = stats;
+	}
+
+	std::size_t NoteStore::resolvedCount() const {
+		std::size_t count = 0;
+		for (Lane const& lane : mLanes)
+			count += lane.cursor;
+		return count;
+	}
+
+	void NoteStore::record(HitGrade grade) {
+		++mStats.grades[static_cast<std::size_t>(grade)];
+		++mStats.combo;
+		mStats.maxCombo = std::max(mStats.maxCombo, mStats.combo);
+	}
+
+	void NoteStore::missUntil(Lane& lane, ChartTime time) {
+		std::size_t cursor = skipBefore(lane.times.data(), lane.cursor, time);
+		if (cursor == lane.cursor) return;
+
+		mStats.grades[static_cast<std::size_t>(HitGrade::Miss)] += static_cast<std::uint32_t>(cursor - lane.cursor);
+		mStats.combo = 0;
+		lane.cursor = cursor;
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "hb_chart.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace hyperbeetle {
+	enum class HitGrade : std::uint8_t {
+		Perfect,
+		Great,
+		Good,
+		Miss,
+		None, // Nothing to judge, e.g. a press with no note in reach
+	};
+
+	// Largest distance from the note for each grade, anything further is a miss.
+	struct HitWindows final {
+		ChartTime perfect = 25'000;
+		ChartTime great = 50'000;
+		ChartTime good = 100'000;
+
+		bool operator==(HitWindows const&) const = default;
+	};
+
+	struct Judgment final {
+		static constexpr std::uint32_t kNoNote = ~std::uint32_t(0);
+
+		HitGrade grade = HitGrade::None;
+		std::uint32_t note = kNoNote; // index into the chart's note tables
+		ChartTime offset = 0; // input time minus note time, negative when early
+	};
+
+	// Gameplay view of a chart's notes for judging input.
+	// Each lane keeps its note times in one sorted contiguous array with a cursor on the first unresolved note, so
+	// every press and every miss sweep starts where the last one stopped and work per input is O(1) amortized.
+	// Not thread-safe, owned by the simulation.
+	class NoteStore final {
+	public:
+		struct Stats final {
+			std::array<std::uint32_t, 4> grades{}; // indexed by HitGrade, Perfect to Miss
+			std::uint32_t combo = 0;
+			std::uint32_t maxCombo = 0;
+			std::uint32_t holdsCompleted = 0;
+			std::uint32_t holdsBroken = 0;
+
+			bool operator==(Stats const&) const = default;
+		};
+
+		void build(Chart const& chart, HitWindows const& windows = {});
+		void build(std::span<ChartTime const> times, std::span<ChartTime const> durations, std::span<std::uint8_t const> lanes, std::uint32_t laneCount, HitWindows const& windows = {});
+
+		// Judges a press on `lane` against the earliest unresolved note, anything it passes by is a miss.
+		Judgment press(std::uint32_t lane, ChartTime time);
+		// Ends a hold on `lane`. Letting go early breaks the hold.
+		Judgment release(std::uint32_t lane, ChartTime time);
+		// Misses every note whose window closed before `time` and completes holds that ended. Call once per tick.
+		void advance(ChartTime time);
+
+		// Puts every lane back before the first note at or after `time`, for restarts and practice seeks.
+		void seek(ChartTime time);
+		// The same, but the score carries on from `stats`, as it does for a chart swapped in mid-song.
+		void seek(ChartTime time, Stats const& stats);
+
+		inline Stats const& stats() const { return mStats; }
+		inline HitWindows const& windows() const { return mWindows; }
+		inline std::uint32_t laneCount() const { return static_cast<std::uint32_t>(mLanes.size()); }
+		inline std::size_t noteCount() const { return mNoteCount; }
+		// Notes that are resolved, hit or missed.
+		std::size_t resolvedCount() const;
+	private:
+		// Times are padded with this so block scans never need a bounds check. Leaves headroom so differences can't overflow.
+		static constexpr ChartTime kSentinel = std::numeric_limits<ChartTime>::max() / 4;
+		static constexpr std::size_t kPadding = 4;
+
+		struct Lane final {
+			std::vector<ChartTime> times; // sorted, followed by kPadding sentinels
+			std::vector<ChartTime> ends; // end of hold, equal to the time for other notes
+			std::vector<std::uint32_t> notes;
+			std::size_t cursor = 0;
+
+			std::uint32_t holdNote = Judgment::kNoNote;
+			ChartTime holdEnd = 0;
+		};
+
+		void record(HitGrade grade);
+		void missUntil(Lane& lane, ChartTime time);
+
+		HitWindows mWindows;
+		std::vector<Lane> mLanes;
+		std::size_t mNoteCount = 0;
+		Stats mStats;
+	};
+}
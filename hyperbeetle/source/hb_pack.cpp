@@ -0,0 +1,253 @@
+#include "hb_pack.hpp"
+
+#include "hb_hash.hpp"
+#include "hb_lz.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <unordered_set>
+
+namespace hyperbeetle {
+	namespace {
+		template<class T>
+		void validateTable(std::uint64_t offset, std::uint64_t count, std::size_t end, char const* name) {
+			if (offset < sizeof(PackHeader) || offset > end || offset % alignof(T) != 0 || count > (end - offset) / sizeof(T))
+				throw PackError(std::string("Pack table '") + name + "' is out of bounds");
+		}
+
+		// Entries have checksums of their own, the pack's covers its header and directory.
+		std::uint64_t directoryChecksum(std::byte const* pack, std::uint64_t dataOffset) {
+			constexpr std::size_t kFirst = offsetof(PackHeader, fileSize);
+			return hash64(pack + kFirst, static_cast<std::size_t>(dataOffset) - kFirst);
+		}
+
+		inline std::size_t alignUp(std::size_t offset, std::size_t alignment) {
+			return (offset + alignment - 1) & ~(alignment - 1);
+		}
+
+		template<class T>
+		std::size_t append(std::vector<std::byte>& bytes, std::span<T const> values) {
+			std::size_t offset = alignUp(bytes.size(), alignof(std::uint64_t));
+			bytes.resize(offset + values.size_bytes());
+			if (!values.empty())
+				std::memcpy(bytes.data() + offset, values.data(), values.size_bytes());
+			return offset;
+		}
+	}
+
+	Pack Pack::open(std::filesystem::path const& path) {
+		Pack pack;
+		pack.mFile = MappedFile(path);
+		pack.validate();
+		return pack;
+	}
+
+	std::string_view Pack::name(PackEntry const& entry) const {
+		return reinterpret_cast<char const*>(mFile.data() + header().names + entry.name);
+	}
+
+	PackEntry const* Pack::find(std::string_view name) const {
+		if (empty()) return nullptr;
+
+		PackHeader const& h = header();
+		auto slots = reinterpret_cast<std::uint32_t const*>(mFile.data() + h.slots);
+		auto entries = this->entries();
+		std::uint64_t hash = hash64(name);
+		std::uint32_t mask = h.slotCount - 1;
+
+		// The table is at most half full, so a probe ends at an empty slot soon.
+		for (std::uint64_t i = hash;; ++i) {
+			std::uint32_t slot = slots[i & mask];
+			if (slot == 0) return nullptr;
+
+			PackEntry const& entry = entries[slot - 1];
+			if (entry.hash == hash && this->name(entry) == name)
+				return &entry;
+		}
+	}
+
+	PackAsset Pack::load(PackEntry const& entry) const {
+		PackAsset asset;
+		std::span<std::byte const> stored(mFile.data() + entry.offset, entry.storedSize);
+
+		if (entry.compression == PackCompression::None) {
+			asset.mBytes = stored;
+			return asset;
+		}
+
+		asset.mOwned.resize(entry.size);
+		if (!decompressLz(stored, asset.mOwned) || hash64(asset.mOwned.data(), asset.mOwned.size()) != entry.checksum)
+			throw PackError("Pack entry '" + std::string(name(entry)) + "' is corrupt");
+		asset.mBytes = asset.mOwned;
+		return asset;
+	}
+
+	PackAsset Pack::load(std::string_view name) const {
+		if (PackEntry const* entry = find(name))
+			return load(*entry);
+
+		PackAsset asset;
+		asset.mFile = MappedFile(std::filesystem::path(name));
+		asset.mBytes = asset.mFile.bytes();
+		return asset;
+	}
+
+	std::vector<std::string> Pack::verify() const {
+		std::vector<std::string> corrupt;
+		for (PackEntry const& entry : entries()) {
+			try {
+				PackAsset asset = load(entry);
+				if (hash64(asset.data(), asset.size()) != entry.checksum)
+					corrupt.emplace_back(name(entry));
+			}
+			catch (PackError const&) {
+				corrupt.emplace_back(name(entry));
+			}
+		}
+		return corrupt;
+	}
+
+	void Pack::validate() const {
+		std::size_t size = mFile.size();
+		if (size < sizeof(PackHeader))
+			throw PackError("Pack is truncated");
+
+		PackHeader const& h = header();
+
+		if (h.magic != kPackMagic)
+			throw PackError("Not an asset pack");
+
+		if (h.version != kPackVersion)
+			throw PackError("Pack version " + std::to_string(h.version) + " is not supported, expected " + std::to_string(kPackVersion));
+
+		if (h.fileSize != size)
+			throw PackError("Pack is truncated");
+
+		if (h.dataOffset < sizeof(PackHeader) || h.dataOffset > size)
+			throw PackError("Pack directory is out of bounds");
+
+		std::size_t end = static_cast<std::size_t>(h.dataOffset);
+		validateTable<PackEntry>(h.entries, h.entryCount, end, "entries");
+		validateTable<std::uint32_t>(h.slots, h.slotCount, end, "slots");
+		validateTable<char>(h.names, h.namesSize, end, "names");
+
+		if (!std::has_single_bit(h.slotCount) || h.slotCount <= h.entryCount)
+			throw PackError("Pack hash table is malformed");
+
+		if (h.namesSize == 0 || static_cast<char>(mFile.data()[h.names + h.namesSize - 1]) != '\0')
+			throw PackError("Pack name table is not terminated");
+
+		if (h.checksum != directoryChecksum(mFile.data(), h.dataOffset))
+			throw PackError("Pack checksum mismatch");
+
+		auto slots = reinterpret_cast<std::uint32_t const*>(mFile.data() + h.slots);
+		for (std::uint32_t i = 0; i < h.slotCount; ++i) {
+			if (slots[i] > h.entryCount)
+				throw PackError("Pack hash table is malformed");
+		}
+
+		for (PackEntry const& entry : entries()) {
+			if (entry.name >= h.namesSize || entry.offset % kPackAlignment != 0 || entry.offset < h.dataOffset || entry.offset > size || entry.storedSize > size - entry.offset)
+				throw PackError("Pack entry is out of bounds");
+
+			if (entry.compression == PackCompression::None ? entry.storedSize != entry.size : entry.compression != PackCompression::Lz)
+				throw PackError("Pack entry '" + std::string(name(entry)) + "' has an unknown compression");
+		}
+	}
+
+	std::vector<std::byte> buildPack(std::span<PackInput const> inputs) {
+		struct Stored final {
+			std::vector<std::byte> compressed; // empty if stored as is
+		};
+
+		std::vector<PackEntry> entries(inputs.size());
+		std::vector<Stored> stored(inputs.size());
+		std::vector<char> names = { '\0' }; // offset zero is the empty string
+		std::unordered_set<std::string_view> seen;
+
+		for (std::size_t i = 0; i < inputs.size(); ++i) {
+			PackInput const& input = inputs[i];
+			if (!seen.insert(input.name).second)
+				throw PackError("Pack entry '" + input.name + "' appears twice");
+
+			PackEntry& entry = entries[i];
+			entry.hash = hash64(input.name);
+			entry.size = input.bytes.size();
+			entry.storedSize = entry.size;
+			entry.checksum = hash64(input.bytes.data(), input.bytes.size());
+			entry.name = static_cast<std::uint32_t>(names.size());
+			names.insert(names.end(), input.name.begin(), input.name.end());
+			names.push_back('\0');
+
+			if (input.compress && !input.bytes.empty()) {
+				std::vector<std::byte> compressed = compressLz(input.bytes);
+				if (compressed.size() <= input.bytes.size() - input.bytes.size() / 8) {
+					entry.compression = PackCompression::Lz;
+					entry.storedSize = compressed.size();
+					stored[i].compressed = std::move(compressed);
+				}
+			}
+		}
+
+		std::uint32_t slotCount = std::bit_ceil(static_cast<std::uint32_t>(inputs.size() * 2 + 1));
+		std::vector<std::uint32_t> slots(slotCount, 0);
+		for (std::uint32_t i = 0; i < entries.size(); ++i) {
+			std::uint64_t probe = entries[i].hash;
+			while (slots[probe & (slotCount - 1)] != 0)
+				++probe;
+			slots[probe & (slotCount - 1)] = i + 1;
+		}
+
+		// The directory goes first, then the entries' bytes once their offsets are known.
+		std::vector<std::byte> bytes(sizeof(PackHeader));
+		PackHeader header;
+		header.entryCount = static_cast<std::uint32_t>(entries.size());
+		header.slotCount = slotCount;
+		header.entries = append(bytes, std::span<PackEntry const>(entries));
+		header.slots = append(bytes, std::span<std::uint32_t const>(slots));
+		header.names = append(bytes, std::span<char const>(names));
+		header.namesSize = names.size();
+		header.dataOffset = alignUp(bytes.size(), kPackAlignment);
+
+		std::size_t offset = header.dataOffset;
+		for (PackEntry& entry : entries) {
+			entry.offset = offset;
+			offset = alignUp(offset + entry.storedSize, kPackAlignment);
+		}
+		// The last entry ends the file, it needs no padding after it.
+		std::size_t fileSize = entries.empty() ? header.dataOffset : entries.back().offset + entries.back().storedSize;
+
+		if (!entries.empty())
+			std::memcpy(bytes.data() + header.entries, entries.data(), entries.size() * sizeof(PackEntry));
+		bytes.resize(fileSize);
+		for (std::size_t i = 0; i < entries.size(); ++i) {
+			std::span<std::byte const> data = stored[i].compressed.empty() ? std::span<std::byte const>(inputs[i].bytes) : stored[i].compressed;
+			if (!data.empty())
+				std::memcpy(bytes.data() + entries[i].offset, data.data(), data.size());
+		}
+
+		header.fileSize = fileSize;
+		std::memcpy(bytes.data(), &header, sizeof(header));
+		header.checksum = directoryChecksum(bytes.data(), header.dataOffset);
+		std::memcpy(bytes.data(), &header, sizeof(header));
+		return bytes;
+	}
+
+	void writePack(std::span<PackInput const> inputs, std::filesystem::path const& path) {
+		std::vector<std::byte> bytes = buildPack(inputs);
+
+		std::filesystem::path temporaryPath = path;
+		temporaryPath += ".tmp";
+
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::out | std::ios::trunc);
+			file.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+			if (!file)
+				throw PackError("Failed to write " + temporaryPath.string());
+		}
+
+		std::filesystem::rename(temporaryPath, path);
+	}
+}
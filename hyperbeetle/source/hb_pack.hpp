@@ -0,0 +1,125 @@
+#pragma once
+
+#include "hb_mapped_file.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hyperbeetle {
+	class PackError final : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	// Asset pack layout. A header and a directory of entries, names and a hash table, then every entry's bytes on a page
+	// boundary so the mapped pack serves each one in place. Lookups hash the name with hash64 and probe an open
+	// addressing table of entry indices, at most half full. Entries are stored as they are or compressed with the LZ
+	// codec, which only pays off for assets that aren't compressed already. Bump kPackVersion on any change.
+	inline constexpr std::array<char, 4> kPackMagic = { 'H', 'B', 'P', 'K' };
+	inline constexpr std::uint32_t kPackVersion = 2;
+	inline constexpr std::size_t kPackAlignment = 4096;
+
+	// A level shipped as one pack holds its compiled chart under this name, next to the audio the chart names.
+	inline constexpr std::string_view kPackChartName = "chart.hbc";
+
+	enum class PackCompression : std::uint32_t {
+		None,
+		Lz,
+	};
+
+	struct PackHeader final {
+		std::array<char, 4> magic = kPackMagic;
+		std::uint32_t version = kPackVersion;
+		std::uint64_t checksum = 0; // hash64 from the field after it to the first entry, the rest of the header and the directory
+		std::uint64_t fileSize = 0;
+
+		std::uint32_t entryCount = 0;
+		std::uint32_t slotCount = 0; // power of two
+		std::uint64_t entries = 0; // offset of PackEntry[entryCount]
+		std::uint64_t slots = 0; // offset of std::uint32_t[slotCount], an entry index + 1 or 0 for an empty slot
+		std::uint64_t names = 0; // offset of the names, NUL terminated UTF-8
+		std::uint64_t namesSize = 0;
+		std::uint64_t dataOffset = 0; // first entry's bytes, page aligned
+	};
+
+	struct PackEntry final {
+		std::uint64_t hash = 0; // hash64 of the name
+		std::uint64_t offset = 0; // page aligned
+		std::uint64_t storedSize = 0;
+		std::uint64_t size = 0; // decompressed
+		std::uint64_t checksum = 0; // hash64 of the decompressed bytes
+		std::uint32_t name = 0; // offset into the names
+		PackCompression compression = PackCompression::None;
+	};
+
+	// Bytes of one asset: a view of the pack's mapping if the entry is stored as is, of a mapped loose file if the pack
+	// doesn't have it, or a buffer the entry was decompressed into. Views stay valid while the pack is open.
+	class PackAsset final {
+	public:
+		PackAsset() = default;
+
+		inline std::span<std::byte const> bytes() const { return mBytes; }
+		inline std::byte const* data() const { return mBytes.data(); }
+		inline std::size_t size() const { return mBytes.size(); }
+		inline bool empty() const { return mBytes.empty(); }
+		// Whether the bytes were copied out of the pack instead of being served in place.
+		inline bool owned() const { return !mOwned.empty(); }
+	private:
+		friend class Pack;
+
+		MappedFile mFile;
+		std::vector<std::byte> mOwned;
+		std::span<std::byte const> mBytes;
+	};
+
+	// A validated pack mapped from disk. An empty pack finds nothing, so every load falls through to loose files.
+	class Pack final {
+	public:
+		Pack() = default;
+
+		// Throws PackError if the file is not a pack of this version or its directory fails validation.
+		static Pack open(std::filesystem::path const& path);
+
+		inline bool empty() const { return mFile.data() == nullptr; }
+		inline PackHeader const& header() const { return *reinterpret_cast<PackHeader const*>(mFile.data()); }
+		inline std::span<PackEntry const> entries() const {
+			if (empty()) return {};
+			return { reinterpret_cast<PackEntry const*>(mFile.data() + header().entries), header().entryCount };
+		}
+		std::string_view name(PackEntry const& entry) const;
+
+		// nullptr if the pack has no entry called `name`. Doesn't touch the entries' bytes.
+		PackEntry const* find(std::string_view name) const;
+
+		// Throws PackError if a compressed entry is corrupt. Stored entries are served as they are, `verify` checks them.
+		PackAsset load(PackEntry const& entry) const;
+		// The asset called `name` from the pack, or from the file of that name if the pack doesn't have it, so the game
+		// runs from loose files without a pack. Throws std::runtime_error if neither has it.
+		PackAsset load(std::string_view name) const;
+
+		// Reads every entry and compares checksums, returns the names of those that don't match.
+		std::vector<std::string> verify() const;
+	private:
+		void validate() const;
+
+		MappedFile mFile;
+	};
+
+	struct PackInput final {
+		std::string name; // '/' separated
+		std::vector<std::byte> bytes;
+		bool compress = true; // kept only if it saves at least an eighth
+	};
+
+	// Throws PackError if two inputs have the same name.
+	std::vector<std::byte> buildPack(std::span<PackInput const> inputs);
+	// Writes through a temporary file so a reader never sees a partially written pack.
+	void writePack(std::span<PackInput const> inputs, std::filesystem::path const& path);
+}
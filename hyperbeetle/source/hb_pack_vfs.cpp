@@ -0,0 +1,125 @@
+#include "hb_pack_vfs.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+namespace hyperbeetle {
+	static_assert(std::is_standard_layout_v<PackVfs>, "miniaudio reaches the VFS through a pointer to its first member");
+
+	PackVfs::PackVfs(Pack const& pack) : mPack(&pack) {
+		mCallbacks.onOpen = &PackVfs::onOpen;
+		mCallbacks.onOpenW = &PackVfs::onOpenW;
+		mCallbacks.onClose = &PackVfs::onClose;
+		mCallbacks.onRead = &PackVfs::onRead;
+		mCallbacks.onWrite = &PackVfs::onWrite;
+		mCallbacks.onSeek = &PackVfs::onSeek;
+		mCallbacks.onTell = &PackVfs::onTell;
+		mCallbacks.onInfo = &PackVfs::onInfo;
+		ma_default_vfs_init(&mDefault, nullptr);
+	}
+
+	PackVfs& PackVfs::self(ma_vfs* pVFS) {
+		return *reinterpret_cast<PackVfs*>(pVFS);
+	}
+
+	ma_result PackVfs::onOpen(ma_vfs* pVFS, char const* pFilePath, ma_uint32 openMode, ma_vfs_file* pFile) {
+		if (openMode & MA_OPEN_MODE_WRITE) return MA_ACCESS_DENIED;
+
+		PackVfs& vfs = self(pVFS);
+		auto* file = new (std::nothrow) File();
+		if (!file) return MA_OUT_OF_MEMORY;
+
+		if (PackEntry const* entry = vfs.mPack->find(pFilePath)) {
+			try {
+				file->asset = vfs.mPack->load(*entry);
+			}
+			catch (std::exception const&) {
+				delete file;
+				return MA_INVALID_FILE;
+			}
+		}
+		else {
+			ma_result result = ma_vfs_open(&vfs.mDefault, pFilePath, openMode, &file->fallback);
+			if (result != MA_SUCCESS) {
+				delete file;
+				return result;
+			}
+		}
+
+		*pFile = file;
+		return MA_SUCCESS;
+	}
+
+	// Pack names are UTF-8, wide paths only ever name loose files.
+	ma_result PackVfs::onOpenW(ma_vfs* pVFS, wchar_t const* pFilePath, ma_uint32 openMode, ma_vfs_file* pFile) {
+		if (openMode & MA_OPEN_MODE_WRITE) return MA_ACCESS_DENIED;
+
+		auto* file = new (std::nothrow) File();
+		if (!file) return MA_OUT_OF_MEMORY;
+
+		ma_result result = ma_vfs_open_w(&self(pVFS).mDefault, pFilePath, openMode, &file->fallback);
+		if (result != MA_SUCCESS) {
+			delete file;
+			return result;
+		}
+
+		*pFile = file;
+		return MA_SUCCESS;
+	}
+
+	ma_result PackVfs::onClose(ma_vfs* pVFS, ma_vfs_file file) {
+		auto* f = static_cast<File*>(file);
+		ma_result result = f->fallback ? ma_vfs_close(&self(pVFS).mDefault, f->fallback) : MA_SUCCESS;
+		delete f;
+		return result;
+	}
+
+	ma_result PackVfs::onRead(ma_vfs* pVFS, ma_vfs_file file, void* pDst, size_t sizeInBytes, size_t* pBytesRead) {
+		auto* f = static_cast<File*>(file);
+		if (f->fallback) return ma_vfs_read(&self(pVFS).mDefault, f->fallback, pDst, sizeInBytes, pBytesRead);
+
+		std::size_t count = std::min(sizeInBytes, f->asset.size() - f->cursor);
+		if (count)
+			std::memcpy(pDst, f->asset.data() + f->cursor, count);
+		f->cursor += count;
+
+		if (pBytesRead) *pBytesRead = count;
+		return count == 0 && sizeInBytes > 0 ? MA_AT_END : MA_SUCCESS;
+	}
+
+	ma_result PackVfs::onWrite(ma_vfs*, ma_vfs_file, void const*, size_t, size_t* pBytesWritten) {
+		if (pBytesWritten) *pBytesWritten = 0;
+		return MA_ACCESS_DENIED;
+	}
+
+	ma_result PackVfs::onSeek(ma_vfs* pVFS, ma_vfs_file file, ma_int64 offset, ma_seek_origin origin) {
+		auto* f = static_cast<File*>(file);
+		if (f->fallback) return ma_vfs_seek(&self(pVFS).mDefault, f->fallback, offset, origin);
+
+		auto size = static_cast<ma_int64>(f->asset.size());
+		ma_int64 base = origin == ma_seek_origin_start ? 0 : origin == ma_seek_origin_current ? static_cast<ma_int64>(f->cursor) : size;
+		ma_int64 target = base + offset;
+		if (target < 0 || target > size) return MA_BAD_SEEK;
+
+		f->cursor = static_cast<std::size_t>(target);
+		return MA_SUCCESS;
+	}
+
+	ma_result PackVfs::onTell(ma_vfs* pVFS, ma_vfs_file file, ma_int64* pCursor) {
+		auto* f = static_cast<File*>(file);
+		if (f->fallback) return ma_vfs_tell(&self(pVFS).mDefault, f->fallback, pCursor);
+
+		*pCursor = static_cast<ma_int64>(f->cursor);
+		return MA_SUCCESS;
+	}
+
+	ma_result PackVfs::onInfo(ma_vfs* pVFS, ma_vfs_file file, ma_file_info* pInfo) {
+		auto* f = static_cast<File*>(file);
+		if (f->fallback) return ma_vfs_info(&self(pVFS).mDefault, f->fallback, pInfo);
+
+		pInfo->sizeInBytes = f->asset.size();
+		return MA_SUCCESS;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "hb_pack.hpp"
+
+#include <miniaudio.h>
+
+namespace hyperbeetle {
+	// miniaudio file system serving a pack's entries, so decoders read assets straight out of the mapping instead of
+	// going through a file handle and a syscall per read. Names the pack doesn't have fall through to the default file
+	// system. Files are read-only, the pack must outlive the VFS and every file opened through it.
+	class PackVfs final {
+	public:
+		explicit PackVfs(Pack const& pack);
+		PackVfs(PackVfs const&) = delete;
+		PackVfs& operator=(PackVfs const&) = delete;
+
+		inline ma_vfs* vfs() { return &mCallbacks; }
+	private:
+		// An entry being read, or a file of the default file system.
+		struct File final {
+			PackAsset asset;
+			std::size_t cursor = 0;
+			ma_vfs_file fallback = nullptr;
+		};
+
+		static PackVfs& self(ma_vfs* pVFS);
+		static ma_result onOpen(ma_vfs* pVFS, char const* pFilePath, ma_uint32 openMode, ma_vfs_file* pFile);
+		static ma_result onOpenW(ma_vfs* pVFS, wchar_t const* pFilePath, ma_uint32 openMode, ma_vfs_file* pFile);
+		static ma_result onClose(ma_vfs* pVFS, ma_vfs_file file);
+		static ma_result onRead(ma_vfs* pVFS, ma_vfs_file file, void* pDst, size_t sizeInBytes, size_t* pBytesRead);
+		static ma_result onWrite(ma_vfs* pVFS, ma_vfs_file file, void const* pSrc, size_t sizeInBytes, size_t* pBytesWritten);
+		static ma_result onSeek(ma_vfs* pVFS, ma_vfs_file file, ma_int64 offset, ma_seek_origin origin);
+		static ma_result onTell(ma_vfs* pVFS, ma_vfs_file file, ma_int64* pCursor);
+		static ma_result onInfo(ma_vfs* pVFS, ma_vfs_file file, ma_file_info* pInfo);
+
+		// miniaudio casts the VFS to its callbacks, they must come first.
+		ma_vfs_callbacks mCallbacks;
+		Pack const* mPack = nullptr;
+		ma_default_vfs mDefault;
+	};
+}
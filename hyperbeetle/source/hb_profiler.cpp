@@ -0,0 +1,210 @@
+#include "hb_profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace hyperbeetle::profiler {
+	// Single producer ring that overwrites its oldest zones. Slots are atomics so a dump can read them while the
+	// owning thread keeps writing, and throws away whatever was overwritten during the copy.
+	struct ThreadEvents final {
+		struct Slot final {
+			std::atomic<char const*> name = nullptr;
+			std::atomic<std::int64_t> begin = 0;
+			std::atomic<std::int64_t> end = 0;
+		};
+
+		std::uint32_t id = 0; // guarded by gThreadsMutex, like `free`
+		bool free = false; // released, dumps still show its zones until it is taken again
+		std::atomic<char const*> name = nullptr;
+		std::atomic<std::uint64_t> head = 0;
+		Slot slots[kEventsPerThread];
+	};
+
+	namespace {
+		struct Event final {
+			char const* name;
+			std::int64_t begin;
+			std::int64_t end;
+		};
+
+		std::mutex gThreadsMutex;
+		std::vector<std::unique_ptr<ThreadEvents>> gThreads;
+		std::uint32_t gLastId = 0;
+
+		// Trivial, so recording with a ring set by setThreadEvents never touches `tOwned`.
+		thread_local ThreadEvents* tEvents = nullptr;
+
+		// The ring a thread took on its first zone, released when the thread exits.
+		struct OwnedEvents final {
+			ThreadEvents* events = nullptr;
+
+			~OwnedEvents() {
+				if (!events) return;
+				if (tEvents == events) tEvents = nullptr;
+				releaseThreadEvents(events);
+			}
+		};
+
+		thread_local OwnedEvents tOwned;
+
+		ThreadEvents& threadEvents() {
+			if (tEvents) return *tEvents;
+
+			tEvents = tOwned.events = acquireThreadEvents(nullptr);
+			return *tEvents;
+		}
+
+		void writeString(std::ostream& stream, char const* text) {
+			stream << '"';
+			for (; *text; ++text) {
+				if (*text == '"' || *text == '\\') stream << '\\';
+				stream << *text;
+			}
+			stream << '"';
+		}
+	}
+
+	ThreadEvents* acquireThreadEvents(char const* name) {
+		// Rings are large, so a new one is allocated outside the lock and only when none is free.
+		std::unique_ptr<ThreadEvents> created;
+		while (true) {
+			{
+				std::lock_guard lock(gThreadsMutex);
+
+				ThreadEvents* events = nullptr;
+				if (auto found = std::find_if(gThreads.begin(), gThreads.end(), [](auto const& ring) { return ring->free; }); found != gThreads.end())
+					events = found->get();
+				else if (created)
+					events = gThreads.emplace_back(std::move(created)).get();
+
+				if (events) {
+					events->id = ++gLastId;
+					events->free = false;
+					events->name.store(name, std::memory_order_relaxed);
+					events->head.store(0, std::memory_order_relaxed);
+					return events;
+				}
+			}
+
+			created = std::make_unique<ThreadEvents>();
+		}
+	}
+
+	void releaseThreadEvents(ThreadEvents* events) noexcept {
+		if (!events) return;
+
+		std::lock_guard lock(gThreadsMutex);
+		events->free = true;
+	}
+
+	void setThreadEvents(ThreadEvents* events) noexcept {
+		tEvents = events;
+	}
+
+	void setEnabled(bool enabled) noexcept {
+		detail::gEnabled.store(enabled, std::memory_order_relaxed);
+	}
+
+	void setThreadName(char const* name) {
+		ThreadEvents& events = threadEvents();
+		if (events.name.load(std::memory_order_relaxed) == name) return;
+
+		events.name.store(name, std::memory_order_relaxed);
+#if HB_PROFILE_TRACY
+		tracy::SetThreadName(name);
+#endif
+	}
+
+	void record(char const* name, std::int64_t begin, std::int64_t end) noexcept {
+		ThreadEvents& events = threadEvents();
+
+		std::uint64_t head = events.head.load(std::memory_order_relaxed);
+		ThreadEvents::Slot& slot = events.slots[head & (kEventsPerThread - 1)];
+
+		// Pairs with the fence in `writeChromeTrace`: a dump that sees any of these stores also sees `head` as it was
+		// before them, so it knows this slot is being overwritten.
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.name.store(name, std::memory_order_relaxed);
+		slot.begin.store(begin, std::memory_order_relaxed);
+		slot.end.store(end, std::memory_order_relaxed);
+
+		events.head.store(head + 1, std::memory_order_release);
+	}
+
+	std::int64_t writeChromeTrace(std::filesystem::path const& path) {
+		struct Thread final {
+			std::uint32_t id;
+			char const* name;
+			std::vector<Event> events;
+		};
+
+		std::vector<Thread> threads;
+		{
+			std::lock_guard lock(gThreadsMutex);
+			threads.reserve(gThreads.size());
+
+			for (auto const& ring : gThreads) {
+				Thread& thread = threads.emplace_back(ring->id, ring->name.load(std::memory_order_relaxed));
+
+				std::uint64_t head = ring->head.load(std::memory_order_acquire);
+				std::uint64_t first = head > kEventsPerThread ? head - kEventsPerThread : 0;
+
+				thread.events.reserve(head - first);
+				for (std::uint64_t i = first; i < head; ++i) {
+					auto const& slot = ring->slots[i & (kEventsPerThread - 1)];
+					thread.events.push_back({ slot.name.load(std::memory_order_relaxed), slot.begin.load(std::memory_order_relaxed), slot.end.load(std::memory_order_relaxed) });
+				}
+
+				// Anything the owner started writing since then has overwritten the oldest slots.
+				std::atomic_thread_fence(std::memory_order_acquire);
+				std::uint64_t after = ring->head.load(std::memory_order_relaxed);
+				std::uint64_t valid = after >= kEventsPerThread ? after - kEventsPerThread + 1 : 0;
+				if (valid > first)
+					thread.events.erase(thread.events.begin(), thread.events.begin() + static_cast<std::ptrdiff_t>(std::min(valid - first, head - first)));
+			}
+		}
+
+		std::int64_t origin = INT64_MAX;
+		for (auto const& thread : threads) {
+			for (auto const& event : thread.events)
+				origin = std::min(origin, event.begin);
+		}
+
+		std::ofstream file(path, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!file) return -1;
+
+		file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+		std::int64_t count = 0;
+		bool first = true;
+		auto separator = [&]() {
+			if (!first) file << ",\n";
+			first = false;
+		};
+
+		for (auto const& thread : threads) {
+			if (thread.name) {
+				separator();
+				file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.id << ",\"args\":{\"name\":";
+				writeString(file, thread.name);
+				file << "}}";
+			}
+
+			for (auto const& event : thread.events) {
+				separator();
+				file << "{\"name\":";
+				writeString(file, event.name);
+				file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.id
+					<< ",\"ts\":" << static_cast<double>(event.begin - origin) * 1e-3
+					<< ",\"dur\":" << static_cast<double>(event.end - event.begin) * 1e-3 << '}';
+				++count;
+			}
+		}
+
+		file << "\n]}\n";
+		return file ? count : -1;
+	}
+}
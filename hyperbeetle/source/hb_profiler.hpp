@@ -0,0 +1,89 @@
+#pragma once
+
+#include "hb_clock.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Zones are compiled in everywhere but dist, where defining HB_PROFILE brings them back.
+#if !defined(HB_DIST) || defined(HB_PROFILE)
+#	define HB_PROFILE_COMPILED 1
+#else
+#	define HB_PROFILE_COMPILED 0
+#endif
+
+// Tracy is an optional second backend, used when it is vendored (see premake/tracy.lua).
+#if HB_PROFILE_COMPILED && defined(TRACY_ENABLE) && __has_include(<tracy/Tracy.hpp>)
+#	include <tracy/Tracy.hpp>
+#	define HB_PROFILE_TRACY 1
+#else
+#	define HB_PROFILE_TRACY 0
+#endif
+
+namespace hyperbeetle::profiler {
+	// Every thread that records a zone gets a ring this long that keeps its most recent zones.
+	inline constexpr std::size_t kEventsPerThread = std::size_t(1) << 15;
+
+	namespace detail {
+		inline std::atomic_bool gEnabled = true;
+	}
+
+	// A thread's ring of zones.
+	struct ThreadEvents;
+
+	// A disabled zone costs a relaxed load and a branch.
+	inline bool enabled() noexcept { return detail::gEnabled.load(std::memory_order_relaxed); }
+	void setEnabled(bool enabled) noexcept;
+
+	// `name` must outlive the program, e.g. a string literal. Cheap enough to call every time a callback runs.
+	void setThreadName(char const* name);
+
+	// Calling thread only, never blocks. The first zone of a thread takes a ring, allocating it unless the ring of a
+	// thread that exited is free, and the ring is freed again when the thread exits.
+	void record(char const* name, std::int64_t begin, std::int64_t end) noexcept;
+
+	// For threads that can't allocate or lock when they first record, such as an audio callback: a ring taken ahead of
+	// time, which the thread switches to with HB_PROFILE_THREAD_EVENTS. Release it once no thread records into it.
+	ThreadEvents* acquireThreadEvents(char const* name);
+	void releaseThreadEvents(ThreadEvents* events) noexcept;
+	// Calling thread only, never blocks or allocates.
+	void setThreadEvents(ThreadEvents* events) noexcept;
+
+	// Writes what is left in every ring as Chrome trace event JSON, for Perfetto or chrome://tracing. Any thread, the
+	// rings keep recording meanwhile. Returns the number of zones written or -1 if the file couldn't be written.
+	std::int64_t writeChromeTrace(std::filesystem::path const& path);
+
+	class Zone final {
+	public:
+		explicit Zone(char const* name) noexcept : mName(name), mBegin(enabled() ? now() : 0) {}
+		Zone(Zone const&) = delete;
+		Zone& operator=(Zone const&) = delete;
+		~Zone() noexcept { if (mBegin) record(mName, mBegin, now()); }
+	private:
+		char const* mName;
+		std::int64_t mBegin;
+	};
+}
+
+#define HB_PROFILE_CONCAT_IMPL(a, b) a##b
+#define HB_PROFILE_CONCAT(a, b) HB_PROFILE_CONCAT_IMPL(a, b)
+
+// HB_PROFILE_ZONE times the rest of the enclosing scope, zone names are dotted ("render.frame").
+#if HB_PROFILE_COMPILED && HB_PROFILE_TRACY
+#	define HB_PROFILE_ZONE(name) ZoneScopedN(name); ::hyperbeetle::profiler::Zone HB_PROFILE_CONCAT(hbProfileZone, __LINE__)(name)
+#	define HB_PROFILE_THREAD(name) ::hyperbeetle::profiler::setThreadName(name)
+#	define HB_PROFILE_THREAD_EVENTS(events) ::hyperbeetle::profiler::setThreadEvents(events)
+#	define HB_PROFILE_FRAME() FrameMark
+#elif HB_PROFILE_COMPILED
+#	define HB_PROFILE_ZONE(name) ::hyperbeetle::profiler::Zone HB_PROFILE_CONCAT(hbProfileZone, __LINE__)(name)
+#	define HB_PROFILE_THREAD(name) ::hyperbeetle::profiler::setThreadName(name)
+#	define HB_PROFILE_THREAD_EVENTS(events) ::hyperbeetle::profiler::setThreadEvents(events)
+#	define HB_PROFILE_FRAME()
+#else
+#	define HB_PROFILE_ZONE(name)
+#	define HB_PROFILE_THREAD(name)
+#	define HB_PROFILE_THREAD_EVENTS(events)
+#	define HB_PROFILE_FRAME()
+#endif
@@ -0,0 +1,229 @@
+#include "hb_replay.hpp"
+
+#include "hb_hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace hyperbeetle {
+	namespace {
+		// Chart note indices of every lane, in time order.
+		class LaneNotes final {
+		public:
+			explicit LaneNotes(Chart const& chart) : mTimes(chart.noteTimes()), mDurations(chart.noteDurations()) {
+				auto lanes = chart.noteLanes();
+				mLanes.resize(chart.header().lanes);
+				for (std::size_t i = 0; i < lanes.size(); ++i) {
+					if (lanes[i] >= mLanes.size()) mLanes.resize(lanes[i] + 1);
+					mLanes[lanes[i]].push_back(static_cast<std::uint32_t>(i));
+				}
+			}
+
+			inline std::span<std::uint32_t const> lane(std::uint8_t lane) const {
+				if (lane >= mLanes.size()) return {};
+				return mLanes[lane];
+			}
+
+			// What an input on `lane` is measured from: the note's time for a press, its end for a release. Zero for an empty lane.
+			ChartTime reference(std::uint8_t lane, std::size_t index, bool release) const {
+				auto notes = this->lane(lane);
+				if (notes.empty()) return 0;
+				std::uint32_t note = notes[index];
+				return release ? mTimes[note] + mDurations[note] : mTimes[note];
+			}
+
+			// The note a press is closest to, or for a release the last note that started before it.
+			std::size_t nearest(std::uint8_t lane, ChartTime time, bool release) const {
+				auto notes = this->lane(lane);
+				if (notes.empty()) return 0;
+
+				auto after = std::upper_bound(notes.begin(), notes.end(), time, [&](ChartTime t, std::uint32_t note) { return t < mTimes[note]; });
+				std::size_t index = after - notes.begin();
+
+				if (release || index == notes.size())
+					return index > 0 ? index - 1 : 0;
+				if (index > 0 && time - mTimes[notes[index - 1]] <= mTimes[notes[index]] - time)
+					return index - 1;
+				return index;
+			}
+		private:
+			std::span<ChartTime const> mTimes;
+			std::span<ChartTime const> mDurations;
+			std::vector<std::vector<std::uint32_t>> mLanes;
+		};
+
+		void writeVarint(std::vector<std::byte>& out, std::uint64_t value) {
+			while (value >= 0x80) {
+				out.push_back(static_cast<std::byte>(value | 0x80));
+				value >>= 7;
+			}
+			out.push_back(static_cast<std::byte>(value));
+		}
+
+		void writeSigned(std::vector<std::byte>& out, std::int64_t value) {
+			writeVarint(out, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+		}
+
+		class Reader final {
+		public:
+			explicit Reader(std::span<std::byte const> bytes) : mBytes(bytes) {}
+
+			std::uint64_t varint() {
+				std::uint64_t value = 0;
+				for (int shift = 0; shift < 64; shift += 7) {
+					if (mPosition >= mBytes.size())
+						throw ReplayError("Replay is truncated");
+					auto byte = static_cast<std::uint8_t>(mBytes[mPosition++]);
+					value |= std::uint64_t(byte & 0x7F) << shift;
+					if (!(byte & 0x80)) return value;
+				}
+				throw ReplayError("Replay has a malformed number");
+			}
+
+			std::int64_t signedVarint() {
+				std::uint64_t value = varint();
+				return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+			}
+
+			inline bool done() const { return mPosition == mBytes.size(); }
+		private:
+			std::span<std::byte const> mBytes;
+			std::size_t mPosition = 0;
+		};
+	}
+
+	std::vector<std::byte> encodeReplay(Replay const& replay, Chart const& chart) {
+		LaneNotes notes(chart);
+		std::vector<std::size_t> previous(256);
+
+		std::vector<std::byte> bytes(sizeof(ReplayHeader));
+		bytes.reserve(sizeof(ReplayHeader) + replay.inputs.size() * 8);
+
+		for (ReplayInput const& input : replay.inputs) {
+			std::size_t index = notes.nearest(input.lane, input.time, input.release);
+
+			writeVarint(bytes, std::uint64_t(input.lane) << 1 | std::uint64_t(input.release));
+			writeSigned(bytes, static_cast<std::int64_t>(index) - static_cast<std::int64_t>(previous[input.lane]));
+			writeSigned(bytes, input.time - notes.reference(input.lane, index, input.release));
+			writeSigned(bytes, input.time - input.advancedTo);
+
+			previous[input.lane] = index;
+		}
+
+		ReplayHeader header;
+		header.chartChecksum = replay.chartChecksum;
+		header.windows = replay.windows;
+		header.end = replay.end;
+		header.inputCount = static_cast<std::uint32_t>(replay.inputs.size());
+		header.inputBytes = static_cast<std::uint32_t>(bytes.size() - sizeof(ReplayHeader));
+		header.score = replay.score;
+		header.checksum = hash64(bytes.data() + sizeof(ReplayHeader), header.inputBytes);
+
+		std::memcpy(bytes.data(), &header, sizeof(header));
+		return bytes;
+	}
+
+	ReplayHeader readReplayHeader(std::span<std::byte const> bytes) {
+		ReplayHeader header;
+		if (bytes.size() < sizeof(header))
+			throw ReplayError("Replay is truncated");
+		std::memcpy(&header, bytes.data(), sizeof(header));
+
+		if (header.magic != kReplayMagic)
+			throw ReplayError("Not a replay");
+
+		if (header.version != kReplayVersion)
+			throw ReplayError("Replay version " + std::to_string(header.version) + " is not supported, expected " + std::to_string(kReplayVersion));
+
+		if (header.inputBytes != bytes.size() - sizeof(header))
+			throw ReplayError("Replay is truncated");
+
+		if (header.checksum != hash64(bytes.data() + sizeof(header), header.inputBytes))
+			throw ReplayError("Replay checksum mismatch");
+
+		return header;
+	}
+
+	Replay decodeReplay(std::span<std::byte const> bytes, Chart const& chart) {
+		ReplayHeader header = readReplayHeader(bytes);
+		if (header.chartChecksum != chart.header().checksum)
+			throw ReplayError("Replay was recorded on a different chart");
+
+		Replay replay;
+		replay.chartChecksum = header.chartChecksum;
+		replay.windows = header.windows;
+		replay.end = header.end;
+		replay.score = header.score;
+		replay.inputs.reserve(header.inputCount);
+
+		LaneNotes notes(chart);
+		std::vector<std::size_t> previous(256);
+		Reader reader(bytes.subspan(sizeof(header)));
+
+		for (std::uint32_t i = 0; i < header.inputCount; ++i) {
+			std::uint64_t key = reader.varint();
+			if (key > 0x1FF)
+				throw ReplayError("Replay input has an invalid lane");
+
+			ReplayInput& input = replay.inputs.emplace_back();
+			input.lane = static_cast<std::uint8_t>(key >> 1);
+			input.release = key & 1;
+
+			std::int64_t index = static_cast<std::int64_t>(previous[input.lane]) + reader.signedVarint();
+			std::size_t laneSize = std::max<std::size_t>(notes.lane(input.lane).size(), 1);
+			if (index < 0 || static_cast<std::size_t>(index) >= laneSize)
+				throw ReplayError("Replay input refers to a note that doesn't exist");
+
+			input.time = notes.reference(input.lane, static_cast<std::size_t>(index), input.release) + reader.signedVarint();
+			input.advancedTo = input.time - reader.signedVarint();
+			previous[input.lane] = static_cast<std::size_t>(index);
+		}
+
+		if (!reader.done())
+			throw ReplayError("Replay has trailing data");
+
+		return replay;
+	}
+
+	void saveReplay(Replay const& replay, Chart const& chart, std::filesystem::path const& path) {
+		std::vector<std::byte> bytes = encodeReplay(replay, chart);
+
+		std::filesystem::path temporaryPath = path;
+		temporaryPath += ".tmp";
+
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::out | std::ios::trunc);
+			file.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+			if (!file)
+				throw ReplayError("Failed to write " + temporaryPath.string());
+		}
+
+		std::filesystem::rename(temporaryPath, path);
+	}
+
+	Replay loadReplay(std::filesystem::path const& path, Chart const& chart) {
+		MappedFile file;
+		try {
+			file = MappedFile(path);
+		}
+		catch (std::runtime_error const& e) {
+			throw ReplayError(e.what());
+		}
+		return decodeReplay(file.bytes(), chart);
+	}
+
+	NoteStore::Stats simulateReplay(Replay const& replay, Chart const& chart) {
+		NoteStore notes;
+		notes.build(chart, replay.windows);
+
+		for (ReplayInput const& input : replay.inputs) {
+			notes.advance(input.advancedTo);
+			if (input.release) notes.release(input.lane, input.time);
+			else notes.press(input.lane, input.time);
+		}
+
+		notes.advance(replay.end);
+		return notes.stats();
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "hb_chart.hpp"
+#include "hb_note_store.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace hyperbeetle {
+	class ReplayError final : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	// One input as the note store judged it.
+	struct ReplayInput final {
+		ChartTime time = 0; // song time of the input
+		ChartTime advancedTo = 0; // song time the notes had been advanced to before it was judged
+		std::uint8_t lane = 0;
+		bool release = false;
+	};
+
+	// Everything needed to judge a session again: feeding the inputs in order to a fresh note store, advancing it to
+	// `advancedTo` before each one and to `end` after the last, reproduces the score exactly.
+	struct Replay final {
+		std::uint64_t chartChecksum = 0; // ChartHeader::checksum of the chart that was played
+		HitWindows windows;
+		std::vector<ReplayInput> inputs;
+		ChartTime end = 0;
+		NoteStore::Stats score; // as recorded
+	};
+
+	// Replay file layout: the header followed by `inputBytes` of varints. Each input is stored relative to the chart,
+	// as the distance in notes from the previous input on its lane and the offset from that note's time (its end for a
+	// release), so a well played chart costs a few bytes per input. Bump kReplayVersion on any change.
+	inline constexpr std::array<char, 4> kReplayMagic = { 'H', 'B', 'R', 'P' };
+	inline constexpr std::uint32_t kReplayVersion = 1;
+
+	struct ReplayHeader final {
+		std::array<char, 4> magic = kReplayMagic;
+		std::uint32_t version = kReplayVersion;
+		std::uint64_t checksum = 0; // hash64 of the input bytes
+		std::uint64_t chartChecksum = 0;
+		HitWindows windows;
+		ChartTime end = 0;
+		std::uint32_t inputCount = 0;
+		std::uint32_t inputBytes = 0;
+		NoteStore::Stats score;
+	};
+
+	std::vector<std::byte> encodeReplay(Replay const& replay, Chart const& chart);
+	// Both throw ReplayError if the bytes aren't a replay of this version or don't belong to `chart`.
+	ReplayHeader readReplayHeader(std::span<std::byte const> bytes);
+	Replay decodeReplay(std::span<std::byte const> bytes, Chart const& chart);
+
+	// Writes through a temporary file so a reader never sees a partially written replay.
+	void saveReplay(Replay const& replay, Chart const& chart, std::filesystem::path const& path);
+	Replay loadReplay(std::filesystem::path const& path, Chart const& chart);
+
+	// Judges the inputs again without a simulation, as fast as the note store allows.
+	NoteStore::Stats simulateReplay(Replay const& replay, Chart const& chart);
+	inline bool verifyReplay(Replay const& replay, Chart const& chart) { return simulateReplay(replay, chart) == replay.score; }
+}
@@ -0,0 +1,253 @@
+#include "hb_simulation.hpp"
+
+#include "hb_chart.hpp"
+#include "hb_clock.hpp"
+#include "hb_latency_trace.hpp"
+#include "hb_profiler.hpp"
+#include "hb_song_clock.hpp"
+#include "hb_world.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+
+namespace hyperbeetle {
+	namespace {
+		constexpr std::array<int, 8> kLaneKeys = { GLFW_KEY_D, GLFW_KEY_F, GLFW_KEY_J, GLFW_KEY_K, GLFW_KEY_S, GLFW_KEY_L, GLFW_KEY_A, GLFW_KEY_SEMICOLON };
+
+		ChartTime secondsToChartTime(double seconds) {
+			return static_cast<ChartTime>(std::llround(seconds * 1e6));
+		}
+	}
+
+	void Simulation::setTickRate(double tickRate) {
+		mTickRate = std::clamp(tickRate, 1.0, 100000.0);
+	}
+
+	void Simulation::start() {
+		if (mThread.joinable()) return;
+		mThread = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+	}
+
+	void Simulation::stop() {
+		if (!mThread.joinable()) return;
+		mThread.request_stop();
+		mThread.join();
+	}
+
+	void Simulation::setSongClock(SongClock* clock) {
+		mClock = clock;
+	}
+
+	void Simulation::setWorld(World* world) {
+		if (mWorld) mWorld->unload();
+		mWorld = world;
+	}
+
+	void Simulation::loadChart(Chart const& chart, double leadIn) {
+		mChart = &chart;
+		mSwapped.reset();
+		mNotes.build(chart);
+		if (mWorld) mWorld->load(chart);
+		mSongStart = mState.time + leadIn;
+		if (mClock) mClock->setOriginIn(leadIn);
+
+		mState.playing = true;
+		mState.finished = false;
+		mState.songTime = songTime();
+		mState.score = {};
+		mState.chartSwaps = 0;
+		mState.swapLatency = 0;
+
+		mAdvancedTo = mState.songTime;
+		mReplay = {};
+		mReplay.chartChecksum = chart.header().checksum;
+		mReplay.windows = mNotes.windows();
+		mReplay.end = mAdvancedTo;
+		mReplay.inputs.reserve(chart.noteCount() * 2);
+	}
+
+	void Simulation::unloadChart() {
+		mChart = nullptr;
+		mSwapped.reset();
+		if (mWorld) mWorld->unload();
+		mState.playing = false;
+		mState.finished = false;
+	}
+
+	void Simulation::swapChart(std::shared_ptr<Chart const> chart, std::int64_t changedAt) {
+		ChartSwap swap{ std::move(chart), {}, changedAt };
+		swap.notes.build(*swap.chart);
+
+		{
+			std::lock_guard lock(mSwapMutex);
+			mSwap = std::move(swap);
+		}
+		mSwapPending.store(true, std::memory_order_release);
+	}
+
+	int Simulation::laneKey(std::uint32_t lane) {
+		return lane < kLaneKeys.size() ? kLaneKeys[lane] : -1;
+	}
+
+	int Simulation::keyLane(int key) {
+		auto it = std::find(kLaneKeys.begin(), kLaneKeys.end(), key);
+		return it != kLaneKeys.end() ? static_cast<int>(it - kLaneKeys.begin()) : -1;
+	}
+
+	std::uint64_t Simulation::advanceTo(double time) {
+		// Tolerate rounding so a time computed as tick / rate reaches that tick.
+		std::uint64_t target = static_cast<std::uint64_t>(time * mTickRate + 1e-6);
+		std::uint64_t stepped = 0;
+
+		while (mState.tick < target) {
+			step();
+			++stepped;
+		}
+
+		return stepped;
+	}
+
+	double Simulation::alpha(SimulationFrame const& frame, std::int64_t timestamp) const {
+		return std::clamp(nanosecondsToSeconds(timestamp - frame.publishedAt) * mTickRate, 0.0, 1.0);
+	}
+
+	void Simulation::step() {
+		HB_PROFILE_ZONE("simulation.step");
+
+		std::int64_t begin = now();
+
+		// Between ticks, a tick never judges against two charts.
+		if (mSwapPending.load(std::memory_order_acquire))
+			applySwap();
+
+		SimulationState previous = mState;
+
+		++mState.tick;
+		mState.time = static_cast<double>(mState.tick) / mTickRate;
+
+		mState.inputEvents += mInput.drain([this](EventKey const& e) {
+			if (e.tracedAt && mLatency) {
+				mLatency->record(LatencyTrace::Stage::Dequeue, e.tracedAt);
+				if (mLatency->hold(e.tracedAt))
+					++mState.heldInputs;
+			}
+			if (mState.playing) judge(e);
+			if (!mUiEvents.push(e))
+				++mState.uiEventsDropped;
+		});
+
+		std::int64_t judged = now();
+
+		if (mState.playing) {
+			// The song clock may step back a little when it resyncs, notes only ever move forward.
+			mState.songTime = songTime();
+			mAdvancedTo = std::max(mAdvancedTo, mState.songTime);
+			mNotes.advance(mAdvancedTo);
+			mState.score = mNotes.stats();
+
+			mReplay.end = mAdvancedTo;
+			mReplay.score = mState.score;
+			mState.finished = mNotes.resolvedCount() == mNotes.noteCount() && mState.songTime > mChart->header().length;
+		}
+
+		std::int64_t advanced = now();
+
+		if (mState.playing && mWorld)
+			mWorld->update(mAdvancedTo, tickDuration());
+
+		std::int64_t stepped = now();
+
+		SimulationFrame& frame = mFrames.writeBuffer();
+		frame.previous = previous;
+		frame.current = mState;
+		frame.publishedAt = now();
+		frame.stepSeconds = nanosecondsToSeconds(frame.publishedAt - begin);
+		mFrames.publish();
+
+		++mTimings.ticks;
+		mTimings.input += judged - begin;
+		mTimings.judge += advanced - judged;
+		mTimings.world += stepped - advanced;
+		mTimings.publish += frame.publishedAt - stepped;
+	}
+
+	void Simulation::judge(EventKey const& e) {
+		int lane = keyLane(e.key);
+		if (lane < 0) return;
+
+		if (e.action != GLFW_PRESS && e.action != GLFW_RELEASE) return;
+
+		ReplayInput input{ inputSongTime(e.timestamp), mAdvancedTo, static_cast<std::uint8_t>(lane), e.action == GLFW_RELEASE };
+		mReplay.inputs.push_back(input);
+
+		if (input.release) mNotes.release(input.lane, input.time);
+		else mNotes.press(input.lane, input.time);
+
+		if (mLatency) mLatency->record(LatencyTrace::Stage::Judge, e.tracedAt);
+	}
+
+	void Simulation::applySwap() {
+		HB_PROFILE_ZONE("simulation.swap");
+
+		std::optional<ChartSwap> swap;
+		{
+			std::lock_guard lock(mSwapMutex);
+			swap.swap(mSwap);
+			mSwapPending.store(false, std::memory_order_relaxed);
+		}
+		if (!swap || !mState.playing) return;
+
+		mChart = swap->chart.get();
+		NoteStore::Stats score = mNotes.stats();
+		mNotes = std::move(swap->notes);
+		mNotes.seek(mAdvancedTo, score);
+		// Spawns what is in view again, anything already behind the judgment line stays gone.
+		if (mWorld) mWorld->load(*mChart);
+		// The inputs so far were judged against the chart before, a replay across a swap won't verify.
+		mReplay.chartChecksum = mChart->header().checksum;
+		mSwapped = std::move(swap->chart);
+
+		++mState.chartSwaps;
+		mState.swapLatency = now() - swap->changedAt;
+	}
+
+	ChartTime Simulation::songTime() const {
+		if (mClock) return secondsToChartTime(mClock->songTime());
+		return secondsToChartTime(mState.time - mSongStart);
+	}
+
+	ChartTime Simulation::inputSongTime(std::int64_t timestamp) const {
+		if (mClock) return secondsToChartTime(mClock->inputSongTime(timestamp));
+		return secondsToChartTime(nanosecondsToSeconds(timestamp) - mSongStart);
+	}
+
+	void Simulation::run(std::stop_token stopToken) {
+		using namespace std::chrono;
+
+		HB_PROFILE_THREAD("simulation");
+
+		std::int64_t tickNanoseconds = static_cast<std::int64_t>(1e9 / mTickRate);
+		std::int64_t origin = now() - static_cast<std::int64_t>(mState.tick) * tickNanoseconds;
+
+		while (!stopToken.stop_requested()) {
+			std::int64_t elapsed = now() - origin;
+
+			// After a long stall (debugger, suspended laptop) don't replay every missed tick, move the origin instead.
+			std::uint64_t target = static_cast<std::uint64_t>(elapsed / tickNanoseconds);
+			if (target > mState.tick + kMaxCatchUpTicks) {
+				origin += static_cast<std::int64_t>(target - mState.tick - kMaxCatchUpTicks) * tickNanoseconds;
+				target = mState.tick + kMaxCatchUpTicks;
+			}
+
+			while (mState.tick < target)
+				step();
+
+			std::int64_t wakeAt = origin + static_cast<std::int64_t>(mState.tick + 1) * tickNanoseconds;
+			std::this_thread::sleep_until(Clock::time_point(duration_cast<Clock::duration>(nanoseconds(wakeAt))));
+		}
+	}
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "hb_input_queue.hpp"
+#include "hb_note_store.hpp"
+#include "hb_replay.hpp"
+#include "hb_spsc_queue.hpp"
+#include "hb_triple_buffer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+namespace hyperbeetle {
+	class Chart;
+	class LatencyTrace;
+	class SongClock;
+	class World;
+
+	// Everything the renderer may look at. Copied wholesale every tick, keep it small and trivially copyable.
+	struct SimulationState final {
+		std::uint64_t tick = 0;
+		double time = 0.0;
+		std::uint64_t inputEvents = 0;
+		std::uint64_t uiEventsDropped = 0; // consumed while uiEvents() was full, the UI never saw them
+		std::uint64_t heldInputs = 0; // traced inputs consumed and held in the LatencyTrace for the display stage
+
+		bool playing = false;
+		bool finished = false; // every note of the chart is resolved
+		ChartTime songTime = 0;
+		NoteStore::Stats score;
+
+		std::uint32_t chartSwaps = 0; // since the chart was loaded
+		std::int64_t swapLatency = 0; // nanoseconds from the change behind the last swap to the tick that made it
+	};
+
+	// Time spent in each part of a tick, summed over every tick since the last reset.
+	struct SimulationTimings final {
+		std::uint64_t ticks = 0;
+		std::int64_t input = 0; // nanoseconds draining the input queue and judging presses
+		std::int64_t judge = 0; // advancing the notes with song time
+		std::int64_t world = 0; // streaming and updating the gameplay world
+		std::int64_t publish = 0;
+	};
+
+	struct SimulationFrame final {
+		SimulationState previous, current;
+		std::int64_t publishedAt = 0; // hyperbeetle::now() when `current` was published
+		double stepSeconds = 0.0; // cost of the tick that produced `current`
+	};
+
+	// Steps gameplay at a fixed rate on its own thread, independently of how long frames take to render.
+	// The renderer reads immutable frames through a triple buffer and interpolates between `previous` and `current`.
+	// Without a thread `advanceTo` can be driven by any clock, as fast as the machine allows.
+	//
+	// Song time comes from the song clock when one is set. Without one the simulation is its own clock: song time counts
+	// ticks and input timestamps are read as nanoseconds of simulation time, which keeps headless runs deterministic.
+	class Simulation final {
+	public:
+		static constexpr double kDefaultTickRate = 1000.0;
+		// If the thread falls further behind than this it skips time rather than trying to catch up.
+		static constexpr std::uint64_t kMaxCatchUpTicks = 250;
+
+		using EventQueue = SpscQueue<EventKey, InputQueue::kCapacity>;
+
+		explicit Simulation(InputQueue& input) : mInput(input) {}
+		Simulation(Simulation const&) = delete;
+		Simulation& operator=(Simulation const&) = delete;
+		~Simulation() noexcept { stop(); }
+
+		// Only while stopped.
+		void setTickRate(double tickRate);
+		inline double tickRate() const { return mTickRate; }
+		inline double tickDuration() const { return 1.0 / mTickRate; }
+
+		void start();
+		void stop();
+
+		// Only while stopped.
+		void setSongClock(SongClock* clock);
+		// Records when inputs are dequeued and judged, on the simulation thread. Only while stopped.
+		inline void setLatencyTrace(LatencyTrace* trace) { mLatency = trace; }
+		// World to load with each chart and update every tick, it must outlive the simulation. Only while stopped.
+		void setWorld(World* world);
+		// Starts judging `chart`, which must stay alive until it is unloaded. Song time zero is `leadIn` seconds from
+		// now, on the song clock's origin if there is one and in simulation time otherwise. Only while stopped.
+		void loadChart(Chart const& chart, double leadIn = 1.0);
+		void unloadChart();
+		// Any thread. Replaces the loaded chart at the start of the next tick without restarting the song, for charts
+		// edited while they play. Notes behind song time count as resolved and the score carries on. The notes are
+		// built here, the tick only swaps them in. `changedAt` is hyperbeetle::now() when the edit was seen.
+		void swapChart(std::shared_ptr<Chart const> chart, std::int64_t changedAt);
+		// Simulation thread, or any thread while stopped.
+		inline Chart const* chart() const { return mChart; }
+		// Input of the loaded chart so far, as a replay. Simulation thread, or any thread while stopped.
+		inline Replay const& replay() const { return mReplay; }
+
+		// Keys that play each lane, -1 when the key or lane isn't bound.
+		static int laneKey(std::uint32_t lane);
+		static int keyLane(int key);
+
+		// Steps whole ticks until simulation time reaches `time`, returns the number of ticks stepped. Only while stopped.
+		std::uint64_t advanceTo(double time);
+
+		// Reader side of the published frames, for one thread only.
+		inline TripleBuffer<SimulationFrame>& frames() { return mFrames; }
+		// Input the simulation consumed, passed on in order for the UI thread.
+		inline EventQueue& uiEvents() { return mUiEvents; }
+		// Interpolation factor between `previous` and `current` of `frame` at `timestamp`.
+		double alpha(SimulationFrame const& frame, std::int64_t timestamp) const;
+
+		inline SimulationState const& state() const { return mState; }
+		// Simulation thread, or any thread while stopped.
+		inline SimulationTimings const& timings() const { return mTimings; }
+		inline void resetTimings() { mTimings = {}; }
+	private:
+		void run(std::stop_token stopToken);
+		void step();
+		void judge(EventKey const& e);
+		void applySwap();
+
+		ChartTime songTime() const;
+		ChartTime inputSongTime(std::int64_t timestamp) const;
+
+		InputQueue& mInput;
+		EventQueue mUiEvents;
+		TripleBuffer<SimulationFrame> mFrames;
+
+		double mTickRate = kDefaultTickRate;
+		SimulationState mState;
+		SimulationTimings mTimings;
+
+		SongClock* mClock = nullptr;
+		World* mWorld = nullptr;
+		LatencyTrace* mLatency = nullptr;
+		Chart const* mChart = nullptr;
+		NoteStore mNotes;
+		ChartTime mAdvancedTo = 0;
+		Replay mReplay;
+		double mSongStart = 0.0; // simulation time of song time zero, without a song clock
+
+		struct ChartSwap final {
+			std::shared_ptr<Chart const> chart;
+			NoteStore notes;
+			std::int64_t changedAt = 0;
+		};
+		std::mutex mSwapMutex;
+		std::optional<ChartSwap> mSwap;
+		std::atomic_bool mSwapPending = false;
+		std::shared_ptr<Chart const> mSwapped; // keeps a swapped in chart alive while it is loaded
+
+		std::jthread mThread;
+	};
+}
@@ -0,0 +1,122 @@
+#include "hb_song_clock.hpp"
+
+#include "hb_clock.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace hyperbeetle {
+	void SongClock::onRender(std::uint64_t engineFrame, std::uint32_t sampleRate) noexcept {
+		std::int64_t wall = now();
+		double engine = static_cast<double>(engineFrame) / sampleRate;
+
+		if (mSampleRate.load(std::memory_order_relaxed) != sampleRate)
+			mSampleRate.store(sampleRate, std::memory_order_relaxed);
+
+		if (!mWriterValid) {
+			mWriterModel = { wall, engine, 1.0 };
+			mWriterValid = true;
+
+			// Published with the model, readers see both or neither.
+			if (mCarryOver) {
+				mOrigin.store(engine - mHeld.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				mCarryOver = false;
+			}
+		}
+		else {
+			double predicted = mWriterModel.engine + nanosecondsToSeconds(wall - mWriterModel.wall) * mWriterModel.rate;
+			double error = engine - predicted;
+
+			if (std::abs(error) > kResyncThreshold) {
+				mWriterModel = { wall, engine, 1.0 };
+			}
+			else {
+				// Re-anchor on the prediction so the clock stays continuous and only the slope absorbs the error.
+				mWriterModel = { wall, predicted, 1.0 + std::clamp(error / kCorrectionTime, -kMaxSlew, kMaxSlew) };
+			}
+		}
+
+		publish(mWriterModel);
+	}
+
+	void SongClock::reset() noexcept {
+		if (mValid.load(std::memory_order_acquire))
+			mHeld.store(engineTime() - mOrigin.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		mCarryOver = true;
+
+		mWriterValid = false;
+		mValid.store(false, std::memory_order_release);
+	}
+
+	void SongClock::setOrigin(std::uint64_t engineFrame) noexcept {
+		std::uint32_t sampleRate = mSampleRate.load(std::memory_order_relaxed);
+		mOrigin.store(sampleRate ? static_cast<double>(engineFrame) / sampleRate : 0.0, std::memory_order_relaxed);
+	}
+
+	void SongClock::setOriginIn(double seconds) noexcept {
+		double origin = engineTime() + seconds;
+		mOrigin.store(origin, std::memory_order_relaxed);
+		mHeld.store(-seconds, std::memory_order_relaxed);
+	}
+
+	void SongClock::setLatency(double output, double input) noexcept {
+		mOutputLatency.store(output, std::memory_order_relaxed);
+		mInputLatency.store(input, std::memory_order_relaxed);
+	}
+
+	double SongClock::engineTimeAt(std::int64_t timestamp) const noexcept {
+		if (!mValid.load(std::memory_order_acquire))
+			return 0.0;
+
+		Model model = load();
+		return model.engine + nanosecondsToSeconds(timestamp - model.wall) * model.rate;
+	}
+
+	double SongClock::engineTime() const noexcept {
+		return engineTimeAt(now());
+	}
+
+	double SongClock::songTimeAt(std::int64_t timestamp) const noexcept {
+		if (!mValid.load(std::memory_order_acquire))
+			return mHeld.load(std::memory_order_relaxed) - outputLatency();
+		return engineTimeAt(timestamp) - mOrigin.load(std::memory_order_relaxed) - outputLatency();
+	}
+
+	double SongClock::songTime() const noexcept {
+		return songTimeAt(now());
+	}
+
+	double SongClock::inputSongTime(std::int64_t timestamp) const noexcept {
+		return songTimeAt(timestamp) - inputLatency();
+	}
+
+	SongClock::Model SongClock::load() const noexcept {
+		Model model;
+		std::uint32_t before, after;
+
+		do {
+			before = mSequence.load(std::memory_order_acquire);
+			model.wall = mWall.load(std::memory_order_relaxed);
+			model.engine = mEngine.load(std::memory_order_relaxed);
+			model.rate = mRate.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = mSequence.load(std::memory_order_relaxed);
+		} while (before != after || (before & 1));
+
+		return model;
+	}
+
+	void SongClock::publish(Model const& model) noexcept {
+		std::uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+
+		mSequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		mWall.store(model.wall, std::memory_order_relaxed);
+		mEngine.store(model.engine, std::memory_order_relaxed);
+		mRate.store(model.rate, std::memory_order_relaxed);
+
+		mSequence.store(sequence + 2, std::memory_order_release);
+		mValid.store(true, std::memory_order_release);
+	}
+}
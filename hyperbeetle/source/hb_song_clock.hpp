@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace hyperbeetle {
+	// Song position derived from how many frames the audio device has rendered.
+	// Device callbacks arrive in bursts, so the frame count is turned into a continuous clock by slewing a wall clock
+	// model towards it; the clock never jumps unless the device stalls or restarts.
+	// Song time counts from an origin on that clock. A restart, such as a device switch, holds the song where it was
+	// and the next device's first callback moves the origin so the song carries on from there.
+	// Every reader is lock-free, `onRender` must only be called from the audio thread.
+	class SongClock final {
+	public:
+		// Errors larger than this are treated as a device restart or stall and snap the clock.
+		static constexpr double kResyncThreshold = 0.05;
+		// How long the clock takes to absorb an error, and the maximum it may run fast or slow while doing so.
+		static constexpr double kCorrectionTime = 0.25;
+		static constexpr double kMaxSlew = 0.02;
+
+		// Audio thread, before the engine renders `engineFrame` onwards.
+		void onRender(std::uint64_t engineFrame, std::uint32_t sampleRate) noexcept;
+
+		// Forgets the model, the next callback snaps the clock and carries the song over. Call while no callbacks are
+		// running.
+		void reset() noexcept;
+
+		// The engine frame at which the current song starts, such as the start frame the music was played at.
+		void setOrigin(std::uint64_t engineFrame) noexcept;
+		// The same `seconds` from now.
+		void setOriginIn(double seconds) noexcept;
+		// Seconds between rendering a frame and hearing it, and between pressing a key and its callback firing.
+		void setLatency(double output, double input) noexcept;
+
+		inline double outputLatency() const noexcept { return mOutputLatency.load(std::memory_order_relaxed); }
+		inline double inputLatency() const noexcept { return mInputLatency.load(std::memory_order_relaxed); }
+		inline std::uint32_t sampleRate() const noexcept { return mSampleRate.load(std::memory_order_relaxed); }
+
+		// Smoothed engine time in seconds at a hyperbeetle::now() timestamp, without any latency compensation.
+		double engineTimeAt(std::int64_t timestamp) const noexcept;
+		double engineTime() const noexcept;
+
+		// Position in the song that is audible right now.
+		double songTime() const noexcept;
+		double songTimeAt(std::int64_t timestamp) const noexcept;
+
+		// Position in the song the player was hearing when they pressed a key stamped with `timestamp`.
+		double inputSongTime(std::int64_t timestamp) const noexcept;
+	private:
+		struct Model final {
+			std::int64_t wall = 0;
+			double engine = 0.0;
+			double rate = 1.0;
+		};
+
+		Model load() const noexcept;
+		void publish(Model const& model) noexcept;
+
+		// Seqlock protected model, written by the audio thread only.
+		std::atomic<std::uint32_t> mSequence = 0;
+		std::atomic<std::int64_t> mWall = 0;
+		std::atomic<double> mEngine = 0.0;
+		std::atomic<double> mRate = 1.0;
+		std::atomic_bool mValid = false;
+
+		std::atomic<std::uint32_t> mSampleRate = 0;
+		std::atomic<double> mOrigin = 0.0;
+		std::atomic<double> mHeld = 0.0; // song time while there is no model, before the output latency
+		std::atomic<double> mOutputLatency = 0.0;
+		std::atomic<double> mInputLatency = 0.0;
+
+		// Audio thread only.
+		Model mWriterModel;
+		bool mWriterValid = false;
+		bool mCarryOver = false; // the next callback moves the origin to continue from mHeld
+	};
+}
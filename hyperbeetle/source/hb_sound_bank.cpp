@@ -0,0 +1,277 @@
+#include "hb_sound_bank.hpp"
+
+#include "hb_latency_trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace hyperbeetle {
+	ma_data_source_vtable const SoundBank::kVoiceVtable = {
+		&SoundBank::onRead,
+		&SoundBank::onSeek,
+		&SoundBank::onGetDataFormat,
+		&SoundBank::onGetCursor,
+		&SoundBank::onGetLength,
+		nullptr, // onSetLooping
+		0
+	};
+
+	void SoundBank::init(ma_engine& engine, std::uint32_t voiceCount) {
+		ma_uint32 channels = ma_engine_get_channels(&engine);
+		ma_uint32 sampleRate = ma_engine_get_sample_rate(&engine);
+
+		mEngine = &engine;
+
+		// The device may have changed since the sounds were decoded, the voices only ever mix at the engine rate.
+		if (channels != mChannels || sampleRate != mSampleRate) {
+			Prepared prepared;
+			{
+				std::lock_guard lock(mMutex);
+				mChannels = channels;
+				mSampleRate = sampleRate;
+				if (mPrepared.channels == channels && mPrepared.sampleRate == sampleRate)
+					prepared = std::move(mPrepared);
+				mPrepared = {};
+			}
+
+			for (std::size_t i = 0; i < mSounds.size(); ++i) {
+				Sound& sound = mSounds[i];
+				if (i < prepared.sounds.size() && prepared.sounds[i].path == sound.path) {
+					sound.frames = std::move(prepared.sounds[i].frames);
+					sound.frameCount = prepared.sounds[i].frameCount;
+				}
+				else
+					decode(sound);
+			}
+		}
+
+		{
+			std::lock_guard lock(mMutex);
+			mSounds.reserve(kMaxSounds);
+		}
+
+		mVoiceCount = voiceCount;
+		mVoices = std::make_unique<Voice[]>(voiceCount);
+
+		for (std::uint32_t i = 0; i < voiceCount; ++i) {
+			Voice& voice = mVoices[i];
+			voice.bank = this;
+
+			ma_data_source_config config = ma_data_source_config_init();
+			config.vtable = &kVoiceVtable;
+
+			if (ma_data_source_init(&config, &voice.base) != MA_SUCCESS)
+				throw std::runtime_error("Failed to initialize voice data source");
+
+			if (ma_sound_init_from_data_source(&engine, &voice, MA_SOUND_FLAG_NO_PITCH | MA_SOUND_FLAG_NO_SPATIALIZATION, mGroup, &voice.sound) != MA_SUCCESS)
+				throw std::runtime_error("Failed to initialize voice");
+		}
+	}
+
+	void SoundBank::prepare(ma_engine& engine) {
+		ma_uint32 channels = ma_engine_get_channels(&engine);
+		ma_uint32 sampleRate = ma_engine_get_sample_rate(&engine);
+
+		Prepared prepared{ channels, sampleRate };
+		{
+			std::lock_guard lock(mMutex);
+			if (channels == mChannels && sampleRate == mSampleRate) return;
+			prepared.sounds.reserve(mSounds.size());
+			for (Sound const& sound : mSounds)
+				prepared.sounds.push_back({ .path = sound.path });
+		}
+
+		for (Decoded& decoded : prepared.sounds)
+			decoded = decode(decoded.path, channels, sampleRate, mVfs);
+
+		std::lock_guard lock(mMutex);
+		mPrepared = std::move(prepared);
+	}
+
+	void SoundBank::uninit() {
+		if (!mVoices) return;
+
+		for (std::uint32_t i = 0; i < mVoiceCount; ++i) {
+			ma_sound_uninit(&mVoices[i].sound);
+			ma_data_source_uninit(&mVoices[i].base);
+		}
+
+		mVoices.reset();
+		mVoiceCount = 0;
+		mEngine = nullptr;
+	}
+
+	SoundBank::SoundId SoundBank::load(std::string_view path) {
+		for (SoundId id = 0; id < mSounds.size(); ++id) {
+			if (mSounds[id].path == path)
+				return id;
+		}
+
+		return add(decode(path, mChannels, mSampleRate, mVfs));
+	}
+
+	SoundBank::Decoded SoundBank::decode(std::string_view path, ma_uint32 channels, ma_uint32 sampleRate, ma_vfs* vfs) {
+		Decoded decoded;
+		decoded.path = path;
+		decoded.channels = channels;
+		decoded.sampleRate = sampleRate;
+
+		ma_decoder_config config = ma_decoder_config_init(ma_format_f32, channels, sampleRate);
+
+		void* pFrames = nullptr;
+		ma_uint64 frameCount = 0;
+		if (ma_decode_from_vfs(vfs, decoded.path.c_str(), &config, &frameCount, &pFrames) != MA_SUCCESS) {
+			std::cout << "Failed to decode sound: " << decoded.path << std::endl;
+			return decoded;
+		}
+
+		decoded.frames.reset(static_cast<float*>(pFrames));
+		decoded.frameCount = frameCount;
+		return decoded;
+	}
+
+	SoundBank::SoundId SoundBank::add(Decoded decoded) {
+		for (SoundId id = 0; id < mSounds.size(); ++id) {
+			if (mSounds[id].path == decoded.path)
+				return id;
+		}
+
+		if (mSounds.size() >= kMaxSounds)
+			throw std::runtime_error("Sound bank is full");
+
+		Sound sound;
+		sound.path = std::move(decoded.path);
+
+		// Decoded for a device that has been switched away from in the meantime.
+		if (decoded.channels != mChannels || decoded.sampleRate != mSampleRate) {
+			decode(sound);
+		}
+		else {
+			sound.frames = std::move(decoded.frames);
+			sound.frameCount = decoded.frameCount;
+		}
+
+		{
+			std::lock_guard lock(mMutex);
+			mSounds.push_back(std::move(sound));
+		}
+
+		return static_cast<SoundId>(mSounds.size() - 1);
+	}
+
+	void SoundBank::decode(Sound& sound) {
+		Decoded decoded = decode(sound.path, mChannels, mSampleRate, mVfs);
+		sound.frames = std::move(decoded.frames);
+		sound.frameCount = decoded.frameCount;
+	}
+
+	bool SoundBank::isBusy(Voice const& voice) {
+		// Checks the node state instead of ma_sound_is_playing so voices scheduled to start later count as busy.
+		return ma_node_get_state(&voice.sound) == ma_node_state_started && !ma_sound_at_end(&voice.sound);
+	}
+
+	void SoundBank::play(SoundId sound, std::uint64_t startFrame, std::int64_t tracedAt) {
+		if (!mVoices || sound >= mSounds.size()) return;
+
+		Voice* chosen = nullptr;
+		Voice* oldest = &mVoices[0];
+
+		for (std::uint32_t i = 0; i < mVoiceCount; ++i) {
+			Voice& voice = mVoices[i];
+
+			if (!isBusy(voice)) {
+				chosen = &voice;
+				break;
+			}
+
+			if (voice.startedAt < oldest->startedAt)
+				oldest = &voice;
+		}
+
+		if (!chosen) {
+			chosen = oldest;
+			mVoicesStolen.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		chosen->startedAt = ++mSequence;
+		chosen->tracedAt.store(tracedAt, std::memory_order_relaxed);
+		chosen->request.store((mSequence << 32) | sound, std::memory_order_release);
+
+		// A voice which reached the end but wasn't stopped by the mixer yet still reports as playing and would ignore the start.
+		if (ma_sound_at_end(&chosen->sound))
+			ma_sound_stop(&chosen->sound);
+
+		ma_sound_set_start_time_in_pcm_frames(&chosen->sound, startFrame);
+		ma_sound_start(&chosen->sound);
+	}
+
+	std::uint32_t SoundBank::voicesInUse() const {
+		std::uint32_t count = 0;
+
+		for (std::uint32_t i = 0; i < mVoiceCount; ++i) {
+			if (isBusy(mVoices[i]))
+				++count;
+		}
+
+		return count;
+	}
+
+	ma_result SoundBank::onRead(ma_data_source* pDataSource, void* pFramesOut, ma_uint64 frameCount, ma_uint64* pFramesRead) {
+		Voice& voice = *static_cast<Voice*>(pDataSource);
+
+		std::uint64_t request = voice.request.load(std::memory_order_acquire);
+		if (request != voice.current) {
+			Sound const& sound = voice.bank->mSounds[static_cast<SoundId>(request)];
+
+			voice.current = request;
+			voice.frames = sound.frames.get();
+			voice.frameCount = sound.frameCount;
+			voice.cursor = 0;
+
+			if (voice.bank->mLatency)
+				voice.bank->mLatency->record(LatencyTrace::Stage::Sound, voice.tracedAt.load(std::memory_order_relaxed));
+		}
+
+		ma_uint64 framesRead = std::min(frameCount, voice.frameCount - voice.cursor);
+		ma_uint32 channels = voice.bank->mChannels;
+
+		if (framesRead > 0)
+			std::memcpy(pFramesOut, voice.frames + voice.cursor * channels, framesRead * channels * sizeof(float));
+
+		voice.cursor += framesRead;
+
+		if (pFramesRead)
+			*pFramesRead = framesRead;
+
+		return framesRead < frameCount ? MA_AT_END : MA_SUCCESS;
+	}
+
+	ma_result SoundBank::onSeek(ma_data_source*, ma_uint64) {
+		// ma_sound_start rewinds a sound at its end from the game thread, while the cursor belongs to the audio thread.
+		// Every play is a new request, and onRead starts a new request from the beginning anyway.
+		return MA_SUCCESS;
+	}
+
+	ma_result SoundBank::onGetDataFormat(ma_data_source* pDataSource, ma_format* pFormat, ma_uint32* pChannels, ma_uint32* pSampleRate, ma_channel* pChannelMap, size_t channelMapCap) {
+		Voice& voice = *static_cast<Voice*>(pDataSource);
+
+		if (pFormat) *pFormat = ma_format_f32;
+		if (pChannels) *pChannels = voice.bank->mChannels;
+		if (pSampleRate) *pSampleRate = voice.bank->mSampleRate;
+		if (pChannelMap) ma_channel_map_init_standard(ma_standard_channel_map_default, pChannelMap, channelMapCap, voice.bank->mChannels);
+
+		return MA_SUCCESS;
+	}
+
+	ma_result SoundBank::onGetCursor(ma_data_source* pDataSource, ma_uint64* pCursor) {
+		*pCursor = static_cast<Voice*>(pDataSource)->cursor;
+		return MA_SUCCESS;
+	}
+
+	ma_result SoundBank::onGetLength(ma_data_source* pDataSource, ma_uint64* pLength) {
+		*pLength = static_cast<Voice*>(pDataSource)->frameCount;
+		return MA_SUCCESS;
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <miniaudio.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hyperbeetle {
+	class LatencyTrace;
+
+	// Short sound effects, decoded once into PCM at the engine's format and played back from a fixed pool of voices.
+	// Playing a sound never allocates, touches the filesystem or takes a lock; if every voice is busy the oldest one is stolen.
+	// `load` must only be called while no voice is playing, `play` must only be called from a single thread.
+	class SoundBank final {
+	public:
+		using SoundId = std::uint32_t;
+		static constexpr SoundId kInvalidSound = ~SoundId(0);
+
+		static constexpr std::uint32_t kDefaultVoiceCount = 32;
+		static constexpr std::uint32_t kMaxSounds = 256;
+
+		struct FreePcm final {
+			inline void operator()(float* p) const { ma_free(p, nullptr); }
+		};
+
+		// A sound decoded away from the bank, `load` split in two so the slow half can run on any thread.
+		struct Decoded final {
+			std::string path;
+			std::unique_ptr<float, FreePcm> frames;
+			ma_uint64 frameCount = 0;
+			ma_uint32 channels = 0;
+			ma_uint32 sampleRate = 0;
+		};
+
+		SoundBank() = default;
+		SoundBank(SoundBank const&) = delete;
+		SoundBank& operator=(SoundBank const&) = delete;
+		SoundBank(SoundBank&&) = delete;
+		SoundBank& operator=(SoundBank&&) = delete;
+		~SoundBank() noexcept { uninit(); }
+
+		// Creates the voice pool on `engine`. Sounds loaded before a previous `uninit` are decoded again if the engine format
+		// changed, unless `prepare` already did.
+		void init(ma_engine& engine, std::uint32_t voiceCount = kDefaultVoiceCount);
+		// Any thread, such as the worker that opened `engine`. Decodes every sound at the engine's format if it differs, so
+		// a later `init` on it only swaps the frames in.
+		void prepare(ma_engine& engine);
+		void uninit();
+
+		// File system `load` and decoding again after a format change read through, the default one if null.
+		// It must outlive the bank.
+		inline void setVfs(ma_vfs* vfs) { mVfs = vfs; }
+		// Group the voices play through from the next `init`, the engine's endpoint if null. It must outlive the voices.
+		inline void setGroup(ma_sound_group* group) { mGroup = group; }
+
+		SoundId load(std::string_view path);
+		// Any thread. Decodes to interleaved float PCM at the given format, the engine's for sounds of this bank.
+		static Decoded decode(std::string_view path, ma_uint32 channels, ma_uint32 sampleRate, ma_vfs* vfs = nullptr);
+		// `load` without decoding, unless `decoded` doesn't match the current format.
+		SoundId add(Decoded decoded);
+
+		inline ma_uint32 channels() const { return mChannels; }
+		inline ma_uint32 sampleRate() const { return mSampleRate; }
+		// Starts `sound` on the next mix, or at the absolute engine frame `startFrame` if that lies in the future.
+		// `tracedAt` is the EventKey::tracedAt of the input that played it, the mix that starts it records the sound
+		// stage of the latency trace.
+		void play(SoundId sound, std::uint64_t startFrame = 0, std::int64_t tracedAt = 0);
+		// Only while no voice is playing. It must outlive the voices.
+		inline void setLatencyTrace(LatencyTrace* trace) { mLatency = trace; }
+
+		std::uint32_t voicesInUse() const;
+		inline std::uint32_t voiceCount() const { return mVoiceCount; }
+		inline std::uint64_t voicesStolen() const { return mVoicesStolen.load(std::memory_order_relaxed); }
+	private:
+		struct Sound final {
+			std::string path;
+			std::unique_ptr<float, FreePcm> frames;
+			ma_uint64 frameCount = 0;
+		};
+
+		// A voice is its own data source so the audio thread can pick up a new sound without the game thread touching the read cursor.
+		struct Voice final {
+			ma_data_source_base base;
+			SoundBank* bank = nullptr;
+			ma_sound sound;
+
+			// Written by `play`, consumed by the audio thread. Upper half is a sequence number, lower half the sound id.
+			std::atomic<std::uint64_t> request = 0;
+			// Of the input behind the request, published by it.
+			std::atomic<std::int64_t> tracedAt = 0;
+
+			// Audio thread only.
+			std::uint64_t current = 0;
+			float const* frames = nullptr;
+			ma_uint64 frameCount = 0;
+			ma_uint64 cursor = 0;
+
+			// Game thread only.
+			std::uint64_t startedAt = 0;
+		};
+
+		static ma_result onRead(ma_data_source* pDataSource, void* pFramesOut, ma_uint64 frameCount, ma_uint64* pFramesRead);
+		static ma_result onSeek(ma_data_source* pDataSource, ma_uint64 frameIndex);
+		static ma_result onGetDataFormat(ma_data_source* pDataSource, ma_format* pFormat, ma_uint32* pChannels, ma_uint32* pSampleRate, ma_channel* pChannelMap, size_t channelMapCap);
+		static ma_result onGetCursor(ma_data_source* pDataSource, ma_uint64* pCursor);
+		static ma_result onGetLength(ma_data_source* pDataSource, ma_uint64* pLength);
+		static ma_data_source_vtable const kVoiceVtable;
+
+		static bool isBusy(Voice const& voice);
+
+		void decode(Sound& sound);
+
+		// Sounds decoded by `prepare`, in the order of mSounds.
+		struct Prepared final {
+			ma_uint32 channels = 0;
+			ma_uint32 sampleRate = 0;
+			std::vector<Decoded> sounds;
+		};
+
+		ma_engine* mEngine = nullptr;
+		ma_vfs* mVfs = nullptr;
+		ma_sound_group* mGroup = nullptr;
+		LatencyTrace* mLatency = nullptr;
+		ma_uint32 mChannels = 0;
+		ma_uint32 mSampleRate = 0;
+
+		std::vector<Sound> mSounds;
+		// Guards mSounds growing and the format against `prepare`, and mPrepared.
+		std::mutex mMutex;
+		Prepared mPrepared;
+		std::unique_ptr<Voice[]> mVoices;
+		std::uint32_t mVoiceCount = 0;
+		std::uint64_t mSequence = 0;
+
+		std::atomic<std::uint64_t> mVoicesStolen = 0;
+	};
+}
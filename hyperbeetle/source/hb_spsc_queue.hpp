@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+
+namespace hyperbeetle {
+	inline constexpr std::size_t kCacheLineSize = 64;
+
+	// Bounded wait-free queue for exactly one producer thread and one consumer thread.
+	// Each side caches the other side's index so the shared cache lines are only touched when the queue looks full or empty.
+	template<class T, std::size_t Capacity>
+	class SpscQueue final {
+		static_assert(std::has_single_bit(Capacity), "Capacity must be a power of two");
+	public:
+		static constexpr std::size_t kCapacity = Capacity;
+
+		// Producer only. Returns false and drops the value if the queue is full.
+		bool push(T const& value) noexcept {
+			std::size_t head = mHead.load(std::memory_order_relaxed);
+
+			if (head - mCachedTail == Capacity) {
+				mCachedTail = mTail.load(std::memory_order_acquire);
+				if (head - mCachedTail == Capacity)
+					return false;
+			}
+
+			mBuffer[head & (Capacity - 1)] = value;
+			mHead.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer only.
+		bool pop(T& value) noexcept {
+			std::size_t tail = mTail.load(std::memory_order_relaxed);
+
+			if (tail == mCachedHead) {
+				mCachedHead = mHead.load(std::memory_order_acquire);
+				if (tail == mCachedHead)
+					return false;
+			}
+
+			value = mBuffer[tail & (Capacity - 1)];
+			mTail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Exact when called from either end, a snapshot otherwise.
+		std::size_t size() const noexcept {
+			std::size_t tail = mTail.load(std::memory_order_acquire);
+			return mHead.load(std::memory_order_acquire) - tail;
+		}
+	private:
+		alignas(kCacheLineSize) std::atomic<std::size_t> mHead = 0;
+		std::size_t mCachedTail = 0;
+
+		alignas(kCacheLineSize) std::atomic<std::size_t> mTail = 0;
+		std::size_t mCachedHead = 0;
+
+		alignas(kCacheLineSize) std::array<T, Capacity> mBuffer{};
+	};
+}
@@ -0,0 +1,187 @@
+#include "hb_track.hpp"
+
+#include "hb_clock.hpp"
+#include "hb_profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace hyperbeetle {
+	namespace {
+		constexpr float kRadians = std::numbers::pi_v<float> / 180.0f;
+
+		ChartTime floorTo(ChartTime time, ChartTime step) {
+			ChartTime q = time / step;
+			if (time % step < 0) --q;
+			return q * step;
+		}
+	}
+
+	void TrackGenerator::load(Chart const& chart) {
+		unload();
+		mChart = &chart;
+
+		// Chunks are a whole number of rings long.
+		mSettings.ringsPerChunk = std::max(mSettings.ringsPerChunk, 1u);
+		mRingDuration = std::max<ChartTime>(mSettings.chunkDuration / mSettings.ringsPerChunk, 1);
+		mSettings.chunkDuration = mRingDuration * mSettings.ringsPerChunk;
+		mRingVertices = std::max(chart.header().lanes, 1u) + 1;
+
+		// Every chunk that overlaps the view, plus one for the chunk it is about to give way to.
+		std::size_t slots = static_cast<std::size_t>((mSettings.ahead + mSettings.behind + mSettings.chunkDuration - 1) / mSettings.chunkDuration) + 2;
+		mSlots.assign(slots, {});
+		mVertices.assign(slots * verticesPerChunk(), {});
+
+		mIndices.clear();
+		mIndices.reserve(static_cast<std::size_t>(mSettings.ringsPerChunk) * (mRingVertices - 1) * 6);
+		for (std::uint32_t ring = 0; ring < mSettings.ringsPerChunk; ++ring) {
+			for (std::uint32_t edge = 0; edge + 1 < mRingVertices; ++edge) {
+				std::uint32_t a = ring * static_cast<std::uint32_t>(mRingVertices) + edge;
+				std::uint32_t b = a + 1;
+				std::uint32_t c = a + static_cast<std::uint32_t>(mRingVertices);
+				std::uint32_t d = c + 1;
+				mIndices.insert(mIndices.end(), { a, c, b, b, c, d });
+			}
+		}
+	}
+
+	void TrackGenerator::unload() {
+		mChart = nullptr;
+		mVertices = {};
+		mIndices = {};
+		mSlots = {};
+		mHead = 0;
+		mCount = 0;
+		mSequence = 0;
+		mCursor = {};
+		mStats = {};
+	}
+
+	std::size_t TrackGenerator::update(ChartTime songTime) {
+		if (!mChart) return 0;
+		HB_PROFILE_ZONE("track.update");
+
+		ChartTime from = songTime - mSettings.behind;
+		ChartTime to = songTime + mSettings.ahead;
+
+		// The track starts at the origin, at the chunk boundary before the first song time it sees.
+		if (mSequence == 0)
+			mCursor.time = floorTo(from, mSettings.chunkDuration);
+
+		while (mCount && mSlots[mHead].end <= from) {
+			mHead = (mHead + 1) % mSlots.size();
+			--mCount;
+		}
+
+		// Chunks skipped over are integrated without being written, the track ahead depends on them.
+		while (!mCount && mCursor.time + mSettings.chunkDuration <= from) {
+			for (std::uint32_t ring = 0; ring < mSettings.ringsPerChunk; ++ring)
+				step(nullptr);
+		}
+
+		if (mCursor.time >= to) return 0;
+
+		std::int64_t begin = now();
+		std::size_t built = 0;
+		while (mCursor.time < to && mCount < mSlots.size()) {
+			std::size_t slot = (mHead + mCount) % mSlots.size();
+			build(mSlots[slot], mVertices.data() + slot * verticesPerChunk());
+			++mCount;
+			++built;
+		}
+
+		mStats.nanoseconds += now() - begin;
+		return built;
+	}
+
+	TrackGenerator::Chunk TrackGenerator::chunk(std::size_t i) const {
+		std::size_t index = (mHead + i) % mSlots.size();
+		Slot const& slot = mSlots[index];
+		return { slot.start, slot.end, slot.sequence, { mVertices.data() + index * verticesPerChunk(), verticesPerChunk() } };
+	}
+
+	std::size_t TrackGenerator::residentBytes() const {
+		return mVertices.size() * sizeof(TrackVertex) + mIndices.size() * sizeof(std::uint32_t) + mSlots.size() * sizeof(Slot);
+	}
+
+	TrackGenerator::Heading TrackGenerator::heading(Cursor& cursor, ChartTime time) const {
+		auto times = mChart->curveTimes();
+		if (times.empty()) return {};
+
+		while (cursor.curvePoint + 1 < times.size() && times[cursor.curvePoint + 1] <= time)
+			++cursor.curvePoint;
+
+		std::size_t i = cursor.curvePoint;
+		float yaw = mChart->curveYaw()[i];
+		float pitch = mChart->curvePitch()[i];
+
+		// Eases in and out of every point so the heading, and with it the centre line's tangent, is continuous.
+		if (time > times[i] && i + 1 < times.size()) {
+			float s = static_cast<float>(time - times[i]) / static_cast<float>(times[i + 1] - times[i]);
+			s = s * s * (3.0f - 2.0f * s);
+			yaw += (mChart->curveYaw()[i + 1] - yaw) * s;
+			pitch += (mChart->curvePitch()[i + 1] - pitch) * s;
+		}
+
+		return { yaw * kRadians, pitch * kRadians };
+	}
+
+	void TrackGenerator::step(TrackVertex* ring) {
+		// Midpoint rule, the heading halfway through the ring's span.
+		Heading middle = heading(mCursor, mCursor.time + mRingDuration / 2);
+		float length = mSettings.unitsPerSecond * static_cast<float>(mRingDuration) * 1e-6f;
+		float cosPitch = std::cos(middle.pitch);
+
+		mCursor.x += std::sin(middle.yaw) * cosPitch * length;
+		mCursor.y += std::sin(middle.pitch) * length;
+		mCursor.z += std::cos(middle.yaw) * cosPitch * length;
+		mCursor.distance += length;
+		mCursor.time += mRingDuration;
+
+		if (ring)
+			writeRing(ring, heading(mCursor, mCursor.time));
+	}
+
+	void TrackGenerator::writeRing(TrackVertex* ring, Heading const& heading) const {
+		float sinYaw = std::sin(heading.yaw), cosYaw = std::cos(heading.yaw);
+		float sinPitch = std::sin(heading.pitch), cosPitch = std::cos(heading.pitch);
+
+		// Right stays level, up is forward crossed with right.
+		float forwardX = sinYaw * cosPitch, forwardY = sinPitch, forwardZ = cosYaw * cosPitch;
+		float rightX = cosYaw, rightZ = -sinYaw;
+		float upX = forwardY * rightZ;
+		float upY = forwardZ * rightX - forwardX * rightZ;
+		float upZ = -forwardY * rightX;
+
+		std::size_t edges = mRingVertices - 1;
+		float left = -0.5f * static_cast<float>(edges) * mSettings.laneWidth;
+		for (std::size_t edge = 0; edge < mRingVertices; ++edge) {
+			float offset = left + static_cast<float>(edge) * mSettings.laneWidth;
+			TrackVertex& vertex = ring[edge];
+			vertex.x = mCursor.x + rightX * offset;
+			vertex.y = mCursor.y;
+			vertex.z = mCursor.z + rightZ * offset;
+			vertex.nx = upX;
+			vertex.ny = upY;
+			vertex.nz = upZ;
+			vertex.u = static_cast<float>(edge) / static_cast<float>(edges);
+			vertex.v = mCursor.distance;
+		}
+	}
+
+	void TrackGenerator::build(Slot& slot, TrackVertex* vertices) {
+		slot.start = mCursor.time;
+		slot.sequence = mSequence++;
+
+		writeRing(vertices, heading(mCursor, mCursor.time));
+		for (std::uint32_t ring = 1; ring <= mSettings.ringsPerChunk; ++ring)
+			step(vertices + ring * mRingVertices);
+
+		slot.end = mCursor.time;
+
+		++mStats.chunks;
+		mStats.segments += mSettings.ringsPerChunk;
+		mStats.bytes += verticesPerChunk() * sizeof(TrackVertex);
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "hb_chart.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace hyperbeetle {
+	struct TrackVertex final {
+		float x = 0.0f, y = 0.0f, z = 0.0f;
+		float nx = 0.0f, ny = 1.0f, nz = 0.0f;
+		float u = 0.0f; // 0 on the left edge of the track, 1 on the right
+		float v = 0.0f; // distance along the track
+	};
+
+	// Builds the track's geometry on the CPU from the chart's curve points, only for the stretch around song time.
+	// The heading eases from one curve point's yaw and pitch to the next, which makes the centre line a C1 spline that
+	// is integrated ring by ring: a cross-section across every lane edge, a fixed time apart. Rings are grouped into
+	// chunks of fixed duration that live in a ring buffer of slots sized once from the settings, so memory and the work
+	// per second of song stay the same however long the song is. Chunks that fall behind are recycled for the ones
+	// coming into view. Every chunk has the same layout and shares one index list. Not thread-safe, no OpenGL.
+	class TrackGenerator final {
+	public:
+		struct Settings final {
+			ChartTime ahead = 4'000'000; // how far ahead of song time chunks are built
+			ChartTime behind = 500'000; // how long chunks stay after passing the judgment line
+			ChartTime chunkDuration = 250'000;
+			std::uint32_t ringsPerChunk = 16;
+			float unitsPerSecond = 40.0f; // track scroll speed, the same units as the world's placements
+			float laneWidth = 1.0f;
+		};
+
+		struct Chunk final {
+			ChartTime start = 0;
+			ChartTime end = 0;
+			std::uint64_t sequence = 0; // counts chunks since loading, to tell a recycled slot from the chunk it held
+			// ringsPerChunk + 1 rings of lanes + 1 vertices, the first ring repeats the last of the previous chunk.
+			std::span<TrackVertex const> vertices;
+		};
+
+		struct Stats final {
+			std::uint64_t chunks = 0; // built since loading
+			std::uint64_t segments = 0; // ring to ring spans built
+			std::uint64_t bytes = 0; // vertex bytes written
+			std::int64_t nanoseconds = 0; // building
+		};
+
+		// Takes effect on the next load.
+		inline void setSettings(Settings const& settings) { mSettings = settings; }
+		inline Settings const& settings() const { return mSettings; }
+
+		// Allocates the slots for `chart`'s lanes, which must stay alive until it is unloaded.
+		void load(Chart const& chart);
+		void unload();
+
+		// Recycles the chunks behind `songTime` and builds those coming into view, returns how many were built.
+		// Song time may not go back, load again to rewind.
+		std::size_t update(ChartTime songTime);
+
+		// Resident chunks from the oldest.
+		inline std::size_t chunkCount() const { return mCount; }
+		Chunk chunk(std::size_t i) const;
+		// Triangles of one chunk, indexing its vertices.
+		inline std::span<std::uint32_t const> indices() const { return mIndices; }
+
+		inline std::size_t slotCount() const { return mSlots.size(); }
+		inline std::size_t verticesPerChunk() const { return mRingVertices * (mSettings.ringsPerChunk + 1); }
+		// Vertex and index memory, which doesn't change after loading.
+		std::size_t residentBytes() const;
+		inline Stats const& stats() const { return mStats; }
+	private:
+		// Where the centre line is, integrated up to `time`.
+		struct Cursor final {
+			ChartTime time = 0;
+			float x = 0.0f, y = 0.0f, z = 0.0f;
+			float distance = 0.0f;
+			std::size_t curvePoint = 0; // last curve point at or before `time`
+		};
+
+		struct Slot final {
+			ChartTime start = 0;
+			ChartTime end = 0;
+			std::uint64_t sequence = 0;
+		};
+
+		struct Heading final {
+			float yaw = 0.0f, pitch = 0.0f; // radians
+		};
+
+		Heading heading(Cursor& cursor, ChartTime time) const;
+		// Moves the centre line along by one ring, writing the ring's vertices if `ring` isn't null.
+		void step(TrackVertex* ring);
+		void writeRing(TrackVertex* ring, Heading const& heading) const;
+		void build(Slot& slot, TrackVertex* vertices);
+
+		Settings mSettings;
+		Chart const* mChart = nullptr;
+		std::size_t mRingVertices = 0;
+		ChartTime mRingDuration = 0;
+
+		std::vector<TrackVertex> mVertices; // slot after slot
+		std::vector<std::uint32_t> mIndices;
+		std::vector<Slot> mSlots;
+		std::size_t mHead = 0; // slot of the oldest chunk
+		std::size_t mCount = 0;
+		std::uint64_t mSequence = 0;
+
+		Cursor mCursor; // at the end of the newest chunk
+		Stats mStats;
+	};
+}
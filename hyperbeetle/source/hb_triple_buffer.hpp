@@ -0,0 +1,45 @@
+#pragma once
+
+#include "hb_spsc_queue.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace hyperbeetle {
+	// Hands the latest value from one writer thread to one reader thread without either waiting.
+	// The writer fills `writeBuffer` completely and calls `publish`, the reader always sees the newest complete value.
+	// Values that are published faster than they are read are skipped.
+	template<class T>
+	class TripleBuffer final {
+	public:
+		// Writer only. Holds stale data from an older publish, overwrite all of it.
+		inline T& writeBuffer() noexcept { return mBuffers[mWrite]; }
+
+		// Writer only.
+		void publish() noexcept {
+			mWrite = mShared.exchange(mWrite | kDirty, std::memory_order_acq_rel) & kIndexMask;
+		}
+
+		// Reader only. Returns true if a new value was published since the last call.
+		bool update() noexcept {
+			if ((mShared.load(std::memory_order_relaxed) & kDirty) == 0)
+				return false;
+
+			mRead = mShared.exchange(mRead, std::memory_order_acq_rel) & kIndexMask;
+			return true;
+		}
+
+		// Reader only. The value picked up by the last `update`.
+		inline T const& read() const noexcept { return mBuffers[mRead]; }
+	private:
+		static constexpr std::uint8_t kIndexMask = 0b011;
+		static constexpr std::uint8_t kDirty = 0b100;
+
+		std::array<T, 3> mBuffers{};
+
+		alignas(kCacheLineSize) std::uint8_t mWrite = 0;
+		alignas(kCacheLineSize) std::atomic<std::uint8_t> mShared = 1;
+		alignas(kCacheLineSize) std::uint8_t mRead = 2;
+	};
+}
@@ -0,0 +1,178 @@
+#include "hb_ui.hpp"
+
+#include "hb_frame_arena.hpp"
+#include "hb_frame_pacer.hpp"
+#include "hb_latency_trace.hpp"
+
+#include <nanovg.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace hyperbeetle::ui {
+	namespace {
+		void drawFrameGraph(NVGcontext* vg, FramePacer const& pacer, float x, float y, float width, float height) {
+			// The top of the graph is two frames at the target rate, or 30 fps uncapped.
+			double target = pacer.mode() == FramePacer::Mode::Capped ? 1.0 / pacer.cap() : 1.0 / 60.0;
+			double scale = pacer.mode() == FramePacer::Mode::Uncapped ? 1.0 / 30.0 : 2.0 * target;
+
+			nvgBeginPath(vg);
+			nvgRect(vg, x, y, width, height);
+			nvgFillColor(vg, nvgRGBA(0, 0, 0, 128));
+			nvgFill(vg);
+
+			float targetY = y + height - static_cast<float>(target / scale) * height;
+			nvgBeginPath(vg);
+			nvgMoveTo(vg, x, targetY);
+			nvgLineTo(vg, x + width, targetY);
+			nvgStrokeColor(vg, nvgRGBA(255, 255, 255, 64));
+			nvgStrokeWidth(vg, 1.0f);
+			nvgStroke(vg);
+
+			std::size_t count = pacer.recentFrameCount();
+			if (count < 2) return;
+
+			float step = width / static_cast<float>(FramePacer::kGraphFrames - 1);
+			float px = x + width - step * static_cast<float>(count - 1);
+			bool first = true;
+
+			nvgBeginPath(vg);
+			pacer.forEachRecentFrame([&](float seconds) {
+				float py = y + height - std::min(seconds / static_cast<float>(scale), 1.0f) * height;
+				if (first)
+					nvgMoveTo(vg, px, py);
+				else
+					nvgLineTo(vg, px, py);
+				first = false;
+				px += step;
+			});
+			nvgStrokeColor(vg, nvgRGBA(64, 255, 128, 255));
+			nvgStrokeWidth(vg, 1.0f);
+			nvgStroke(vg);
+		}
+	}
+
+	void drawMenu(NVGcontext* vg, float width, float height, std::span<MenuOption const> options, int selected) {
+		nvgTextAlign(vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+		nvgFontSize(vg, std::min(height / options.size() / 2, 64.0f));
+
+		for (int i = 0; i < options.size(); ++i) {
+			if (i == selected) nvgFillColor(vg, nvgRGBf(1, 0, 0));
+			else nvgFillColor(vg, nvgRGBf(1, 1, 1));
+
+			nvgText(vg, width / 2, height / (options.size() + 1) * (i + 1), options[i].text.c_str(), nullptr);
+		}
+	}
+
+	void drawLibrary(NVGcontext* vg, FrameArena& arena, float width, float height, LevelIndex const& index, LevelSearch const& search,
+		LibraryList& list) {
+		auto const& results = search.results;
+		int count = static_cast<int>(results.size());
+		list.selected = std::clamp(list.selected, 0, std::max(count - 1, 0));
+
+		constexpr float kRowHeight = 28.0f, kTop = 80.0f;
+		float left = width * 0.3f, right = width - 24.0f;
+		list.rows = std::max(1, static_cast<int>((height - kTop - 16.0f) / kRowHeight));
+		list.first = std::clamp(list.first, std::max(0, list.selected - list.rows + 1), list.selected);
+		list.first = std::clamp(list.first, 0, std::max(0, count - list.rows));
+
+		{
+			FrameText header(&arena);
+			header << "Search: " << list.query << "_\n" << count << " of " << index.size() << " levels, " << list.searchSeconds * 1000.0 << "ms"
+				<< (list.scanning ? ", scanning" : "") << ". F5 rescans, ESC goes back";
+
+			nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+			nvgFontSize(vg, 20.0f);
+			nvgFillColor(vg, nvgRGBf(1, 1, 1));
+			nvgTextBox(vg, left, 16.0f, right - left, header.c_str(), nullptr);
+		}
+
+		nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
+		nvgFontSize(vg, 22.0f);
+		for (int row = 0; row < list.rows && list.first + row < count; ++row) {
+			int i = list.first + row;
+			LevelRecord const& record = index.records()[results[i]];
+			auto seconds = static_cast<int>(record.length / 1'000'000);
+
+			FrameText text(&arena);
+			text << index.title(record);
+			if (!index.artist(record).empty())
+				text << " - " << index.artist(record);
+			text << "   " << static_cast<int>(std::lround(record.bpm)) << " BPM, " << seconds / 60 << ':' << (seconds % 60 < 10 ? "0" : "") << seconds % 60
+				<< ", difficulty " << record.difficulty;
+			if (!index.author(record).empty())
+				text << ", by " << index.author(record);
+
+			nvgFillColor(vg, i == list.selected ? nvgRGBf(1, 0, 0) : nvgRGBf(1, 1, 1));
+			nvgText(vg, left, kTop + (static_cast<float>(row) + 0.5f) * kRowHeight, text.c_str(), nullptr);
+		}
+
+		// Where the rows on screen are in the whole list.
+		if (count > list.rows) {
+			float listHeight = static_cast<float>(list.rows) * kRowHeight;
+			nvgBeginPath(vg);
+			nvgRect(vg, right + 8.0f, kTop + listHeight * static_cast<float>(list.first) / static_cast<float>(count), 4.0f,
+				std::max(4.0f, listHeight * static_cast<float>(list.rows) / static_cast<float>(count)));
+			nvgFillColor(vg, nvgRGBA(255, 255, 255, 128));
+			nvgFill(vg);
+		}
+	}
+
+	void drawOverlay(NVGcontext* vg, FrameArena& arena, float width, float height, OverlayStats const& stats, FramePacer const& pacer,
+		LatencyTrace const& latency) {
+		FrameText stream(&arena, 1024);
+		stream << stats.build << '\n';
+		{
+			auto const& frames = pacer.frameTimes();
+			stream << "Frame " << stats.deltaTime * 1000.0 << "ms, " << static_cast<int>(1.0 / stats.deltaTime) << " fps, " << FramePacer::modeName(pacer.mode());
+			if (pacer.mode() == FramePacer::Mode::Capped)
+				stream << ' ' << pacer.cap() << ", " << pacer.missedDeadlines() << " missed";
+			stream << "\nFrame p50 " << frames.percentile(0.5) * 1e-6 << "ms, p99 " << frames.percentile(0.99) * 1e-6 << "ms, p99.9 "
+				<< frames.percentile(0.999) * 1e-6 << "ms, max " << frames.max() * 1e-6 << "ms\n";
+		}
+		{
+			// Each stage from the key reaching the game, the sound leaves the speakers an output latency later.
+			using Stage = LatencyTrace::Stage;
+			stream << "Input latency p50/p99";
+			bool any = false;
+			for (Stage stage : { Stage::Dequeue, Stage::Judge, Stage::Sound, Stage::Display }) {
+				auto const& latencies = latency.histogram(stage);
+				if (!latencies.count()) continue;
+				stream << (any ? ", " : " ") << LatencyTrace::stageName(stage) << ' ' << latencies.percentile(0.5) * 1e-6 << '/' << latencies.percentile(0.99) * 1e-6 << "ms";
+				any = true;
+			}
+			stream << (any ? "\n" : " after a key\n");
+		}
+		stream << stats.framebufferWidth << 'x' << stats.framebufferHeight << '\n';
+		stream << stats.contentScaleX << 'x' << stats.contentScaleY << '\n';
+		stream << stats.device << (stats.switchingDevice ? " (switching)" : "") << '\n';
+		stream << "Audio clock " << stats.audioClock << ", latency " << stats.outputLatency * 1000.0 << "ms out, " << stats.inputLatency * 1000.0 << "ms in\n";
+		if (auto const& switching = stats.switching; switching.switches || switching.failed) {
+			stream << "Audio switch " << switching.switches << ", open " << switching.open * 1000.0 << "ms, swap " << switching.swap * 1e6 << "us (max "
+				<< switching.maxSwap * 1e6 << "us), close " << switching.close * 1000.0 << "ms, " << switching.failed << " failed\n";
+		}
+		if (stats.audioCallbacks) {
+			stream << "Effects " << static_cast<double>(stats.effectsNanoseconds) * 1e-3 / static_cast<double>(stats.audioCallbacks) << "us per callback, ducking "
+				<< stats.ducking << "dB, cutoff " << stats.cutoff << "Hz\n";
+		}
+		stream << "Voices " << stats.voicesInUse << '/' << stats.voiceCount << ", " << stats.voicesStolen << " stolen\n";
+		stream << "Startup " << stats.startupSeconds * 1000.0 << "ms to the menu, " << stats.loaderThreads << " loader threads, assets from " << stats.assets << "\n";
+		if (auto const& scan = stats.libraryScan; scan.files || scan.seconds > 0.0)
+			stream << "Library " << scan.files << " levels, scan " << scan.seconds * 1000.0 << "ms, " << scan.read << " read\n";
+		stream << "Input queue " << stats.inputPeak << " peak, " << stats.inputDropped << " dropped, " << stats.uiEventsDropped << " lost to the UI\n";
+		stream << "Heap " << stats.frameAllocations.allocations << " allocations last frame, " << stats.allocatingFrames << '/' << stats.frames << " frames allocated, "
+			<< stats.totalAllocations << " total\n";
+		stream << "Frame arena " << arena.used() / 1024 << '/' << arena.capacity() / 1024 << " KB, peak " << arena.peak() / 1024 << " KB, "
+			<< arena.overflows() << " overflows\n";
+		stream << "Simulation " << stats.tickRate << "Hz, tick " << stats.tick << ", " << stats.simulationTime << "s, step " << stats.stepSeconds * 1e6 << "us";
+
+		if (stats.renderdoc) {
+			stream << "\nRenderdoc attached";
+		}
+
+		nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+		nvgTextBox(vg, 8, 8, width - 16, stream.c_str(), nullptr);
+
+		drawFrameGraph(vg, pacer, 8, height - 88, static_cast<float>(FramePacer::kGraphFrames) * 2.0f, 80);
+	}
+}
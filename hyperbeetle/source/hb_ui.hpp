@@ -0,0 +1,86 @@
+#pragma once
+
+#include "hb_allocations.hpp"
+#include "hb_audio_switch.hpp"
+#include "hb_level_library.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+
+struct NVGcontext;
+
+namespace hyperbeetle {
+	class FrameArena;
+	class FramePacer;
+	class LatencyTrace;
+
+	// Drawing of the menus, the library and the debug overlay, apart from the game states that own them so the
+	// benchmarks draw the same frames the game does. Everything is laid out in UI units, `width` by `height`, and
+	// formatted into `arena`.
+	namespace ui {
+		struct MenuOption final {
+			std::string text;
+			std::function<void()> action;
+		};
+
+		// The options centred down the screen, the selected one in red.
+		void drawMenu(NVGcontext* vg, float width, float height, std::span<MenuOption const> options, int selected);
+
+		struct LibraryList final {
+			std::string_view query;
+			double searchSeconds = 0.0;
+			bool scanning = false;
+
+			// Kept by the owner between frames, drawing clamps them to the results and the rows that fit.
+			int selected = 0; // into the results
+			int first = 0; // first row on screen
+			int rows = 1;
+		};
+
+		// The search header, the rows on screen and where they are in the whole list. Only the rows that fit are
+		// formatted, so the list costs the same for ten levels as for fifty thousand.
+		void drawLibrary(NVGcontext* vg, FrameArena& arena, float width, float height, LevelIndex const& index, LevelSearch const& search,
+			LibraryList& list);
+
+		// What the overlay shows besides frame pacing and input latency, gathered by the game every frame.
+		struct OverlayStats final {
+			std::string_view build;
+			double deltaTime = 0.0;
+			int framebufferWidth = 0, framebufferHeight = 0;
+			float contentScaleX = 1.0f, contentScaleY = 1.0f;
+
+			std::string_view device;
+			bool switchingDevice = false;
+			double audioClock = 0.0, outputLatency = 0.0, inputLatency = 0.0; // seconds
+			AudioSwitcher::Timings switching;
+			std::uint64_t audioCallbacks = 0;
+			std::int64_t effectsNanoseconds = 0; // over every callback
+			float ducking = 0.0f, cutoff = 0.0f;
+			std::uint32_t voicesInUse = 0, voiceCount = 0;
+			std::uint64_t voicesStolen = 0;
+
+			double startupSeconds = 0.0;
+			unsigned loaderThreads = 0;
+			std::string_view assets;
+			LevelLibrary::ScanStats libraryScan;
+
+			std::size_t inputPeak = 0;
+			std::uint64_t inputDropped = 0, uiEventsDropped = 0;
+			allocations::Counts frameAllocations; // last frame
+			std::uint64_t frames = 0, allocatingFrames = 0, totalAllocations = 0;
+
+			double tickRate = 0.0;
+			std::uint64_t tick = 0;
+			double simulationTime = 0.0, stepSeconds = 0.0;
+			bool renderdoc = false;
+		};
+
+		// The stats in the top left and the recent frame times in the bottom left.
+		void drawOverlay(NVGcontext* vg, FrameArena& arena, float width, float height, OverlayStats const& stats, FramePacer const& pacer,
+			LatencyTrace const& latency);
+	}
+}
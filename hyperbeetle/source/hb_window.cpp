@@ -56,4 +56,8 @@ namespace hyperbeetle {
 		glfwMakeContextCurrent(mHandle);
 	}
 
+	void Window::setSwapInterval(int interval) const {
+		glfwSwapInterval(interval);
+	}
+
 }
\ No newline at end of file
@@ -22,6 +22,8 @@ namespace hyperbeetle {
 
 		void swapBuffers() const;
 		void makeContextCurrent() const;
+		// 1 waits for vertical blank in `swapBuffers`, 0 doesn't. The context must be current.
+		void setSwapInterval(int interval) const;
 
 		inline GLFWwindow* handle() const { return mHandle; }
 	private:
@@ -0,0 +1,297 @@
+#include "hb_world.hpp"
+
+#include "hb_profiler.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <tuple>
+
+namespace hyperbeetle {
+	namespace {
+		// Most of the sorted `times` that fall within `window` of each other.
+		std::size_t mostWithin(std::span<ChartTime const> times, ChartTime window) {
+			std::size_t most = 0;
+			for (std::size_t first = 0, last = 0; last < times.size(); ++last) {
+				while (times[last] - times[first] > window) ++first;
+				most = std::max(most, last - first + 1);
+			}
+			return most;
+		}
+
+		ChartTime segmentEnd(Chart const& chart, std::size_t point) {
+			auto times = chart.curveTimes();
+			if (point + 1 < times.size()) return times[point + 1];
+			return std::max(times[point], chart.header().length);
+		}
+	}
+
+	void World::Fifo::reset(std::size_t capacity) {
+		mEntities.assign(std::bit_ceil(std::max<std::size_t>(capacity, 16)), entt::null);
+		clear();
+	}
+
+	void World::Fifo::push(entt::entity entity) {
+		if (mSize == mEntities.size()) {
+			std::vector<entt::entity> entities(mEntities.size() * 2, entt::null);
+			for (std::size_t i = 0; i < mSize; ++i)
+				entities[i] = (*this)[i];
+			mEntities = std::move(entities);
+			mHead = 0;
+		}
+
+		mEntities[(mHead + mSize) & (mEntities.size() - 1)] = entity;
+		++mSize;
+	}
+
+	template<class Group, class Fn>
+	void World::each(Group const& group, Fn const& fn) {
+		std::size_t count = group.size();
+		unsigned threads = mJobs ? mJobs->threadCount() : 0;
+		if (!threads || count < mSettings.parallelThreshold) {
+			group.each(fn);
+			return;
+		}
+
+		// Nothing is created or destroyed while the ranges run, and each range writes only its own components. One range
+		// per worker and one for this thread.
+		mJobs->split(count, threads + 1, [&group, &fn](std::size_t first, std::size_t last) {
+			for (auto it = group.begin() + first, end = group.begin() + last; it != end; ++it)
+				std::apply(fn, group.get(*it));
+		});
+		++mParallelRuns;
+	}
+
+	World::World() {
+		// Owning groups claim their storages before anything is in them.
+		mRegistry.group<world::Span, world::Placement>();
+		mRegistry.group<world::Particle, world::Lifetime>();
+		mNotes.reset(0);
+		mSegments.reset(0);
+		mParticles.reset(0);
+	}
+
+	void World::load(Chart const& chart) {
+		unload();
+		mChart = &chart;
+
+		// Anything alive is at most `behind` plus its length past the judgment line, or waits behind a note that is.
+		auto times = chart.noteTimes();
+		auto durations = chart.noteDurations();
+		ChartTime longest = durations.empty() ? 0 : *std::max_element(durations.begin(), durations.end());
+		std::size_t notes = mostWithin(times, mSettings.ahead + mSettings.behind + longest);
+
+		ChartTime longestSegment = 0;
+		for (std::size_t i = 0; i < chart.curveTimes().size(); ++i)
+			longestSegment = std::max(longestSegment, segmentEnd(chart, i) - chart.curveTimes()[i]);
+		std::size_t segments = mostWithin(chart.curveTimes(), mSettings.ahead + mSettings.behind + longestSegment);
+
+		// Particles live for a fixed time from the tick their beat crossed, with some slack for the tick.
+		std::vector<ChartTime> beats;
+		beats.reserve(times.size());
+		for (std::size_t i = 0; i < times.size(); ++i) {
+			if (chart.noteKinds()[i] != NoteKind::Obstacle)
+				beats.push_back(times[i]);
+		}
+		std::size_t particles = mostWithin(beats, static_cast<ChartTime>(kParticleLife * 1.1e6)) * kParticlesPerBeat;
+
+		reserve(notes, segments, particles);
+
+		mRails.reserve(chart.header().lanes);
+		for (std::uint32_t lane = 0; lane < chart.header().lanes; ++lane) {
+			entt::entity entity = mRegistry.create();
+			mRegistry.emplace<world::Rail>(entity, static_cast<std::uint8_t>(lane), 0.0f);
+			mRails.push_back(entity);
+		}
+	}
+
+	void World::unload() {
+		mRegistry.clear();
+		mChart = nullptr;
+		mNextNote = 0;
+		mNextCurvePoint = 0;
+
+		mNotes.clear();
+		mCrossed = 0;
+		mSegments.clear();
+		mParticles.clear();
+		mRails.clear();
+
+		mRandom = 1;
+		mPeak = 0;
+		mReserved = 0;
+		mSpawned = 0;
+		mParallelRuns = 0;
+	}
+
+	void World::reserve(std::size_t notes, std::size_t segments, std::size_t particles) {
+		std::size_t total = notes + segments + particles + mChart->header().lanes;
+
+		// Any recycled identifier may end up in any storage, so each storage takes all of them once.
+		std::vector<entt::entity> pool(total);
+		mRegistry.create(pool.begin(), pool.end());
+		mRegistry.insert<world::Span>(pool.begin(), pool.end());
+		mRegistry.insert<world::Placement>(pool.begin(), pool.end());
+		mRegistry.insert<world::Beat>(pool.begin(), pool.end());
+		mRegistry.insert<world::Obstacle>(pool.begin(), pool.end());
+		mRegistry.insert<world::TurnSegment>(pool.begin(), pool.end());
+		mRegistry.insert<world::Rail>(pool.begin(), pool.end());
+		mRegistry.insert<world::Particle>(pool.begin(), pool.end());
+		mRegistry.insert<world::Lifetime>(pool.begin(), pool.end());
+		mRegistry.destroy(pool.begin(), pool.end());
+
+		mNotes.reset(notes);
+		mSegments.reset(segments);
+		mParticles.reset(particles);
+		mReserved = total;
+	}
+
+	void World::update(ChartTime songTime, double dt) {
+		if (!mChart) return;
+		HB_PROFILE_ZONE("world.update");
+
+		spawn(songTime);
+		cross(songTime);
+
+		float seconds = static_cast<float>(dt);
+		float unitsPerMicrosecond = mSettings.unitsPerSecond * 1e-6f;
+
+		each(mRegistry.group<world::Span, world::Placement>(), [songTime, unitsPerMicrosecond](world::Span const& span, world::Placement& placement) {
+			placement.z = static_cast<float>(span.start - songTime) * unitsPerMicrosecond;
+		});
+
+		each(mRegistry.group<world::Particle, world::Lifetime>(), [seconds](world::Particle& particle, world::Lifetime& lifetime) {
+			particle.vy += kGravity * seconds;
+			particle.x += particle.vx * seconds;
+			particle.y = std::max(particle.y + particle.vy * seconds, 0.0f);
+			particle.z += particle.vz * seconds;
+			lifetime.remaining -= seconds;
+		});
+
+		float decay = std::exp(-kGlowDecay * seconds);
+		mRegistry.view<world::Rail>().each([decay](world::Rail& rail) { rail.glow *= decay; });
+
+		despawn(songTime);
+
+		mPeak = std::max(mPeak, mNotes.size() + mSegments.size() + mParticles.size() + mRails.size());
+	}
+
+	World::Stats World::stats() const {
+		Stats stats;
+		stats.notes = mNotes.size();
+		stats.segments = mSegments.size();
+		stats.particles = mParticles.size();
+		stats.live = stats.notes + stats.segments + stats.particles + mRails.size();
+		stats.peak = mPeak;
+		stats.reserved = mReserved;
+		stats.spawned = mSpawned;
+		stats.parallelRuns = mParallelRuns;
+		return stats;
+	}
+
+	void World::spawn(ChartTime songTime) {
+		ChartTime horizon = songTime + mSettings.ahead;
+		float unitsPerMicrosecond = mSettings.unitsPerSecond * 1e-6f;
+
+		auto times = mChart->noteTimes();
+		auto durations = mChart->noteDurations();
+		auto lanes = mChart->noteLanes();
+		auto kinds = mChart->noteKinds();
+		for (; mNextNote < times.size() && times[mNextNote] <= horizon; ++mNextNote) {
+			ChartTime start = times[mNextNote];
+			ChartTime end = start + durations[mNextNote];
+			// On the first tick or after a skip, notes that would be gone already never spawn.
+			if (end + mSettings.behind < songTime) continue;
+
+			entt::entity entity = mRegistry.create();
+			std::uint8_t lane = lanes[mNextNote];
+
+			mRegistry.emplace<world::Span>(entity, start, end);
+			mRegistry.emplace<world::Placement>(entity, laneX(lane), 0.0f, static_cast<float>(end - start) * unitsPerMicrosecond);
+			if (kinds[mNextNote] == NoteKind::Obstacle)
+				mRegistry.emplace<world::Obstacle>(entity, lane);
+			else
+				mRegistry.emplace<world::Beat>(entity, lane, kinds[mNextNote]);
+
+			mNotes.push(entity);
+			++mSpawned;
+		}
+
+		auto curveTimes = mChart->curveTimes();
+		for (; mNextCurvePoint < curveTimes.size() && curveTimes[mNextCurvePoint] <= horizon; ++mNextCurvePoint) {
+			ChartTime start = curveTimes[mNextCurvePoint];
+			ChartTime end = segmentEnd(*mChart, mNextCurvePoint);
+			if (end + mSettings.behind < songTime) continue;
+
+			entt::entity entity = mRegistry.create();
+
+			mRegistry.emplace<world::Span>(entity, start, end);
+			mRegistry.emplace<world::Placement>(entity, 0.0f, 0.0f, static_cast<float>(end - start) * unitsPerMicrosecond);
+			mRegistry.emplace<world::TurnSegment>(entity, mChart->curveYaw()[mNextCurvePoint], mChart->curvePitch()[mNextCurvePoint]);
+
+			mSegments.push(entity);
+			++mSpawned;
+		}
+	}
+
+	void World::cross(ChartTime songTime) {
+		// Beats that crossed before this tick, on the first one or after a skip, burst as if they had on time. Those whose
+		// particles would be gone already don't.
+		ChartTime recent = songTime - static_cast<ChartTime>(kParticleLife * 1e6);
+
+		for (; mCrossed < mNotes.size(); ++mCrossed) {
+			entt::entity entity = mNotes[mCrossed];
+			ChartTime start = mRegistry.get<world::Span>(entity).start;
+			if (start > songTime) break;
+			if (start <= recent) continue;
+
+			if (world::Beat const* beat = mRegistry.try_get<world::Beat>(entity))
+				burst(*beat, static_cast<float>(songTime - start) * 1e-6f);
+		}
+	}
+
+	void World::despawn(ChartTime songTime) {
+		// A long hold at the front keeps the notes after it a little longer, which is cheaper than searching.
+		while (!mNotes.empty() && mRegistry.get<world::Span>(mNotes[0]).end + mSettings.behind < songTime) {
+			mRegistry.destroy(mNotes[0]);
+			mNotes.pop();
+			--mCrossed; // it started before song time, so it crossed
+		}
+
+		while (!mSegments.empty() && mRegistry.get<world::Span>(mSegments[0]).end + mSettings.behind < songTime) {
+			mRegistry.destroy(mSegments[0]);
+			mSegments.pop();
+		}
+
+		while (!mParticles.empty() && mRegistry.get<world::Lifetime>(mParticles[0]).remaining <= 0.0f) {
+			mRegistry.destroy(mParticles[0]);
+			mParticles.pop();
+		}
+	}
+
+	void World::burst(world::Beat const& beat, float age) {
+		if (beat.lane < mRails.size())
+			mRegistry.get<world::Rail>(mRails[beat.lane]).glow = 1.0f;
+
+		float x = laneX(beat.lane);
+		for (std::uint32_t i = 0; i < kParticlesPerBeat; ++i) {
+			entt::entity entity = mRegistry.create();
+			mRegistry.emplace<world::Particle>(entity, x, 0.0f, 0.0f, (random() - 0.5f) * 4.0f, 4.0f + random() * 6.0f, (random() - 0.5f) * 4.0f);
+			mRegistry.emplace<world::Lifetime>(entity, kParticleLife - age);
+			mParticles.push(entity);
+			++mSpawned;
+		}
+	}
+
+	float World::laneX(std::uint8_t lane) const {
+		float center = (static_cast<float>(mChart->header().lanes) - 1.0f) * 0.5f;
+		return (static_cast<float>(lane) - center) * mSettings.laneWidth;
+	}
+
+	float World::random() {
+		mRandom ^= mRandom << 13;
+		mRandom ^= mRandom >> 17;
+		mRandom ^= mRandom << 5;
+		return static_cast<float>(mRandom >> 8) * (1.0f / 16777216.0f);
+	}
+}
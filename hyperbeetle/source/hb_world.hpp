@@ -0,0 +1,170 @@
+#pragma once
+
+#include "hb_chart.hpp"
+#include "hb_jobs.hpp"
+
+#include <entt/entt.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hyperbeetle {
+	// Components of the gameplay world. Plain values, grouped so every system streams through packed arrays.
+	namespace world {
+		// Chart time the entity covers, start and end are the same for anything but holds and turn segments.
+		struct Span final {
+			ChartTime start = 0;
+			ChartTime end = 0;
+		};
+
+		// Track space relative to the judgment line, z is the distance ahead and recomputed every tick.
+		struct Placement final {
+			float x = 0.0f;
+			float z = 0.0f;
+			float length = 0.0f;
+		};
+
+		// A note the player plays: a tap, hold or turn.
+		struct Beat final {
+			std::uint8_t lane = 0;
+			NoteKind kind = NoteKind::Tap;
+		};
+
+		struct Obstacle final {
+			std::uint8_t lane = 0;
+		};
+
+		// Stretch of track from one curve point to the next, with the heading of the first one in degrees.
+		struct TurnSegment final {
+			float yaw = 0.0f;
+			float pitch = 0.0f;
+		};
+
+		// One per lane for the whole chart, lights up as beats cross the judgment line.
+		struct Rail final {
+			std::uint8_t lane = 0;
+			float glow = 0.0f;
+		};
+
+		struct Particle final {
+			float x = 0.0f, y = 0.0f, z = 0.0f;
+			float vx = 0.0f, vy = 0.0f, vz = 0.0f;
+		};
+
+		struct Lifetime final {
+			float remaining = 0.0f; // seconds
+		};
+	}
+
+	// The gameplay world as an EnTT registry, stepped by the simulation every tick.
+	// Notes and curve points of the chart stream in as they come into view and out once they have passed. Both arrive
+	// in time order and leave in about the same order, so each kind waits in a FIFO of entities and streaming never
+	// searches. Particles all live equally long and leave in the order they were spawned.
+	//
+	// Loading sizes the pool for the most entities the chart has alive at once: identifiers are created up front and
+	// every storage is filled once, then destroyed. EnTT recycles destroyed identifiers and storages keep their pages,
+	// so streaming a chart reuses the pool and ticks don't allocate.
+	//
+	// Systems iterate owning groups, whose components sit in the same order at the front of their arrays. Groups at
+	// least `Settings::parallelThreshold` large are split into ranges across the job pool with JobSystem::split, which
+	// doesn't allocate either. Not thread-safe, owned by the simulation.
+	class World final {
+	public:
+		struct Settings final {
+			ChartTime ahead = 4'000'000; // how far ahead of song time entities are spawned
+			ChartTime behind = 500'000; // how long they stay after passing the judgment line
+			float unitsPerSecond = 40.0f; // track scroll speed, in the units of Placement
+			float laneWidth = 1.0f;
+			std::size_t parallelThreshold = 16384; // smallest group that is split across the job pool
+		};
+
+		struct Stats final {
+			std::size_t live = 0;
+			std::size_t notes = 0;
+			std::size_t segments = 0;
+			std::size_t particles = 0;
+			std::size_t peak = 0; // most live entities since loading
+			std::size_t reserved = 0; // entities the pool was sized for
+			std::uint64_t spawned = 0;
+			std::uint64_t parallelRuns = 0; // system runs split across the job pool
+		};
+
+		static constexpr std::uint32_t kParticlesPerBeat = 8;
+		static constexpr float kParticleLife = 0.5f; // seconds
+		static constexpr float kGravity = -30.0f;
+		static constexpr float kGlowDecay = 8.0f; // per second
+
+		World();
+		World(World const&) = delete;
+		World& operator=(World const&) = delete;
+
+		// Between ticks. Takes effect on the next load.
+		inline void setSettings(Settings const& settings) { mSettings = settings; }
+		inline Settings const& settings() const { return mSettings; }
+		// Pool to split large groups across, nullptr runs every system on the calling thread. It must outlive the world.
+		inline void setJobs(JobSystem* jobs) { mJobs = jobs; }
+
+		// Empties the world and sizes its pool for `chart`, which must stay alive until it is unloaded.
+		void load(Chart const& chart);
+		void unload();
+
+		// Spawns what came into view by `songTime`, runs every system for `dt` seconds and despawns what has passed.
+		// Song time may not go back.
+		void update(ChartTime songTime, double dt);
+
+		inline entt::registry& registry() { return mRegistry; }
+		inline entt::registry const& registry() const { return mRegistry; }
+		Stats stats() const;
+	private:
+		// Entities in the order they leave the world, in a ring that only grows if the pool was sized too small.
+		class Fifo final {
+		public:
+			void reset(std::size_t capacity);
+			void push(entt::entity entity);
+			inline void pop() { mHead = (mHead + 1) & (mEntities.size() - 1); --mSize; }
+			inline entt::entity operator[](std::size_t i) const { return mEntities[(mHead + i) & (mEntities.size() - 1)]; }
+			inline std::size_t size() const { return mSize; }
+			inline bool empty() const { return mSize == 0; }
+			inline void clear() { mHead = 0; mSize = 0; }
+		private:
+			std::vector<entt::entity> mEntities; // power of two
+			std::size_t mHead = 0;
+			std::size_t mSize = 0;
+		};
+
+		void reserve(std::size_t notes, std::size_t segments, std::size_t particles);
+		void spawn(ChartTime songTime);
+		void cross(ChartTime songTime);
+		void despawn(ChartTime songTime);
+		// Particles for a beat that crossed `age` seconds ago.
+		void burst(world::Beat const& beat, float age);
+		float laneX(std::uint8_t lane) const;
+		// Uniform in [0, 1), deterministic for a chart.
+		float random();
+
+		// Calls `fn` with the components of every entity in `group`, in ranges across the job pool if it is large.
+		template<class Group, class Fn>
+		void each(Group const& group, Fn const& fn);
+
+		Settings mSettings;
+		JobSystem* mJobs = nullptr;
+
+		entt::registry mRegistry;
+		Chart const* mChart = nullptr;
+		std::size_t mNextNote = 0;
+		std::size_t mNextCurvePoint = 0;
+
+		Fifo mNotes; // by start time
+		std::size_t mCrossed = 0; // notes at the front of mNotes that reached the judgment line
+		Fifo mSegments;
+		Fifo mParticles; // by spawn time
+		std::vector<entt::entity> mRails; // by lane
+
+		std::uint32_t mRandom = 1;
+		std::size_t mPeak = 0;
+		std::size_t mReserved = 0;
+		std::uint64_t mSpawned = 0;
+		std::uint64_t mParallelRuns = 0;
+	};
+}
@@ -0,0 +1,51 @@
+project "hyperbeetle_bench"
+
+debugdir "../working"
+
+kind "ConsoleApp"
+
+defines "YAML_CPP_STATIC_DEFINE"
+
+files
+{
+    "%{prj.location}/**.cpp",
+    "%{prj.location}/**.hpp",
+
+    "%{wks.location}/hyperbeetle/source/**.cpp",
+    "%{wks.location}/hyperbeetle/source/**.hpp",
+    "%{wks.location}/hyperbeetle/vendor/**.c",
+    "%{wks.location}/hyperbeetle/vendor/**.h",
+}
+
+-- Everything but the game's entry point is shared with the benchmarks
+removefiles "%{wks.location}/hyperbeetle/source/hb_entrypoint.cpp"
+
+includedirs
+{
+    "%{prj.location}/source",
+
+    "%{wks.location}/hyperbeetle/source",
+    "%{wks.location}/hyperbeetle/vendor",
+
+    "%{wks.location}/vendor/glfw/include",
+    "%{wks.location}/vendor/glad/include",
+
+    "%{wks.location}/vendor/nanovg/src",
+
+    "%{wks.location}/vendor/entt/single_include",
+
+    "%{wks.location}/vendor/yaml/include",
+}
+
+links
+{
+    "glfw", "glad",
+    "nanovg",
+    "yaml",
+}
+
+filter "system:linux"
+links { "pthread", "dl", "X11", "m" }
+
+filter "system:windows"
+links "opengl32"
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hyperbeetle::bench {
+	struct Measurement final {
+		std::string name;
+		std::size_t iterations = 0;
+		double median = 0.0; // seconds per iteration
+		double min = 0.0;
+	};
+
+	struct Metric final {
+		std::string name;
+		double value = 0.0;
+		std::string unit;
+	};
+
+	class Context final {
+	public:
+		// Times `fn` over `iterations` runs after one untimed warmup run.
+		template<class Fn>
+		Measurement measure(std::string_view name, std::size_t iterations, Fn&& fn) {
+			using Clock = std::chrono::steady_clock;
+
+			fn();
+
+			std::vector<double> samples;
+			samples.reserve(iterations);
+
+			for (std::size_t i = 0; i < iterations; ++i) {
+				auto begin = Clock::now();
+				fn();
+				samples.push_back(std::chrono::duration<double>(Clock::now() - begin).count());
+			}
+
+			std::sort(samples.begin(), samples.end());
+
+			Measurement& measurement = mMeasurements.emplace_back();
+			measurement.name = name;
+			measurement.iterations = iterations;
+			measurement.median = samples.empty() ? 0.0 : samples[samples.size() / 2];
+			measurement.min = samples.empty() ? 0.0 : samples.front();
+			return measurement;
+		}
+
+		inline void metric(std::string_view name, double value, std::string_view unit) {
+			mMetrics.push_back({ std::string(name), value, std::string(unit) });
+		}
+
+		inline std::vector<Measurement> const& measurements() const { return mMeasurements; }
+		inline std::vector<Metric> const& metrics() const { return mMetrics; }
+	private:
+		std::vector<Measurement> mMeasurements;
+		std::vector<Metric> mMetrics;
+	};
+
+	using BenchmarkFn = void(*)(Context&);
+
+	struct Benchmark final {
+		char const* name;
+		BenchmarkFn fn;
+	};
+
+	std::vector<Benchmark>& registry();
+
+	struct Registration final {
+		inline Registration(char const* name, BenchmarkFn fn) { registry().push_back({ name, fn }); }
+	};
+
+	// Keeps the optimizer from discarding a value that is only computed for timing.
+	template<class T>
+	inline void doNotOptimize(T const& value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+		static_cast<void>(*reinterpret_cast<char const volatile*>(&value));
+#else
+		asm volatile("" : : "r,m"(value) : "memory");
+#endif
+	}
+}
+
+#define HB_BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define HB_BENCHMARK_CONCAT(a, b) HB_BENCHMARK_CONCAT_IMPL(a, b)
+
+// Defines and registers a benchmark, the name groups results in the output ("chart.load").
+#define HB_BENCHMARK(name) \
+	static void HB_BENCHMARK_CONCAT(hbBenchmark, __LINE__)(::hyperbeetle::bench::Context& ctx); \
+	static ::hyperbeetle::bench::Registration HB_BENCHMARK_CONCAT(kHbBenchmark, __LINE__)(name, &HB_BENCHMARK_CONCAT(hbBenchmark, __LINE__)); \
+	static void HB_BENCHMARK_CONCAT(hbBenchmark, __LINE__)(::hyperbeetle::bench::Context& ctx)
@@ -0,0 +1,149 @@
+#include "hb_bench.hpp"
+
+#include "hb_audio.hpp"
+#include "hb_dsp.hpp"
+#include "hb_effects.hpp"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	constexpr ma_uint32 kPeriodFrames = 480;
+}
+
+// The effect kernels on one stereo period, vectorized against the scalar reference.
+HB_BENCHMARK("audio.dsp_kernels") {
+	using namespace hyperbeetle;
+
+	constexpr std::uint32_t kChannels = 2;
+	constexpr std::size_t kSamples = kPeriodFrames * kChannels;
+	constexpr std::size_t kIterations = 20'000;
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+	std::vector<float> input(kSamples), buffer(kSamples);
+	for (float& value : input)
+		value = sample(rng);
+
+	dsp::Biquad biquad = dsp::makeBiquad(dsp::FilterShape::LowPass, 800.0f, 2.0f, 48000.0f);
+	dsp::BiquadBlock block = dsp::makeBiquadBlock(biquad);
+	dsp::BiquadState states[kChannels];
+	dsp::DenormalGuard denormals;
+
+	// Every run starts from the same input, the copy is part of both timings.
+	auto perSample = [&](char const* name, auto fn) {
+		bench::Measurement measurement = ctx.measure(name, kIterations, [&]() {
+			buffer = input;
+			fn();
+			bench::doNotOptimize(buffer[0]);
+		});
+		return measurement.median * 1e9 / static_cast<double>(kSamples);
+	};
+
+	double biquadFast = perSample("biquad", [&]() { dsp::biquad(biquad, block, states, buffer.data(), kPeriodFrames, kChannels); });
+	double biquadScalar = perSample("biquad_scalar", [&]() { dsp::biquadScalar(biquad, states, buffer.data(), kPeriodFrames, kChannels); });
+	ctx.metric("biquad_per_sample", biquadFast, "ns");
+	ctx.metric("biquad_speedup", biquadScalar / biquadFast, "x");
+
+	double rampFast = perSample("gain_ramp", [&]() { dsp::gainRamp(buffer.data(), kPeriodFrames, kChannels, 0.25f, 1.0f); });
+	double rampScalar = perSample("gain_ramp_scalar", [&]() { dsp::gainRampScalar(buffer.data(), kPeriodFrames, kChannels, 0.25f, 1.0f); });
+	ctx.metric("gain_ramp_per_sample", rampFast, "ns");
+	ctx.metric("gain_ramp_speedup", rampScalar / rampFast, "x");
+
+	double peakFast = perSample("peak", [&]() { bench::doNotOptimize(dsp::peak(buffer.data(), kSamples)); });
+	double peakScalar = perSample("peak_scalar", [&]() { bench::doNotOptimize(dsp::peakScalar(buffer.data(), kSamples)); });
+	ctx.metric("peak_per_sample", peakFast, "ns");
+	ctx.metric("peak_speedup", peakScalar / peakFast, "x");
+}
+
+// Mixes periods offline from an engine on the null device that is never started, so the benchmark pulls every frame
+// itself. Sine voices alternate between the music and sfx groups, extra filters are chained into the music's path. The
+// cost of a voice and of a node, fitted from a few sizes, gives how many of each would fit in one callback period.
+HB_BENCHMARK("audio.effect_graph") {
+	using namespace hyperbeetle;
+
+	SongClock clock;
+	AudioEngine audio;
+	audio.init("", clock, AudioEngine::Backend::Null);
+	EffectGraph& effects = audio.mEffects;
+	effects.filter().setCutoff(2000.0f);
+
+	ma_uint32 channels = ma_engine_get_channels(&audio.mEngine);
+	ma_uint32 sampleRate = ma_engine_get_sample_rate(&audio.mEngine);
+	std::vector<float> output(static_cast<std::size_t>(kPeriodFrames) * channels);
+
+	struct Voice final {
+		ma_waveform waveform;
+		ma_sound sound;
+	};
+	std::vector<std::unique_ptr<Voice>> voices;
+	auto setVoices = [&](std::size_t count) {
+		while (voices.size() < count) {
+			auto& voice = *voices.emplace_back(std::make_unique<Voice>());
+			ma_waveform_config config = ma_waveform_config_init(ma_format_f32, channels, sampleRate, ma_waveform_type_sine, 0.05, 110.0 * static_cast<double>(voices.size() % 24 + 1));
+			ma_waveform_init(&config, &voice.waveform);
+			ma_sound_group& group = voices.size() % 2 ? effects.music() : effects.sfx();
+			ma_sound_init_from_data_source(&audio.mEngine, &voice.waveform, MA_SOUND_FLAG_NO_PITCH | MA_SOUND_FLAG_NO_SPATIALIZATION, &group, &voice.sound);
+			ma_sound_start(&voice.sound);
+		}
+		while (voices.size() > count) {
+			ma_sound_uninit(&voices.back()->sound);
+			ma_waveform_uninit(&voices.back()->waveform);
+			voices.pop_back();
+		}
+	};
+
+	std::vector<std::unique_ptr<FilterNode>> chain;
+	auto setNodes = [&](std::size_t count) {
+		for (auto& node : chain)
+			node->uninit();
+		chain.clear();
+
+		ma_node* next = effects.filter().node();
+		for (std::size_t i = 0; i < count; ++i) {
+			auto& node = *chain.emplace_back(std::make_unique<FilterNode>());
+			node.init(*ma_engine_get_node_graph(&audio.mEngine), channels, sampleRate);
+			node.setShape(i % 2 ? dsp::FilterShape::HighPass : dsp::FilterShape::LowPass);
+			node.setCutoff(i % 2 ? 40.0f : 8000.0f);
+			ma_node_attach_output_bus(node.node(), 0, next, 0);
+			next = node.node();
+		}
+		ma_node_attach_output_bus(effects.compressor().node(), 0, next, 0);
+	};
+
+	auto period = [&](std::string const& name) {
+		return ctx.measure(name, 500, [&]() {
+			dsp::DenormalGuard denormals;
+			ma_uint64 read = 0;
+			ma_engine_read_pcm_frames(&audio.mEngine, output.data(), kPeriodFrames, &read);
+			bench::doNotOptimize(output[0]);
+		}).median;
+	};
+
+	constexpr std::size_t kFewVoices = 16, kManyVoices = 256, kManyNodes = 64;
+
+	setVoices(kFewVoices);
+	double base = period("voices_16");
+	setVoices(kManyVoices);
+	double manyVoices = period("voices_256");
+	ctx.metric("ducking", effects.compressor().reduction(), "dB");
+
+	setVoices(kFewVoices);
+	setNodes(kManyNodes);
+	double manyNodes = period("voices_16_nodes_64");
+	setNodes(0);
+	setVoices(0);
+
+	double budget = static_cast<double>(kPeriodFrames) / static_cast<double>(sampleRate);
+	double perVoice = (manyVoices - base) / static_cast<double>(kManyVoices - kFewVoices);
+	double perNode = (manyNodes - base) / static_cast<double>(kManyNodes);
+	ctx.metric("period", budget * 1e3, "ms");
+	ctx.metric("per_voice", perVoice * 1e6, "us");
+	ctx.metric("per_node", perNode * 1e6, "us");
+	ctx.metric("voices_per_period", perVoice > 0.0 ? budget / perVoice : 0.0, "");
+	ctx.metric("nodes_per_period", perNode > 0.0 ? budget / perNode : 0.0, "");
+
+	audio.uninit();
+}
@@ -0,0 +1,65 @@
+#include "hb_bench.hpp"
+
+#include "hb_audio.hpp"
+#include "hb_audio_switch.hpp"
+#include "hb_sound_bank.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Switches between null backend devices the way the render loop does, the swap is the only part a frame waits for.
+HB_BENCHMARK("audio.switch") {
+	using namespace hyperbeetle;
+
+	SongClock clock;
+	auto engine = std::make_unique<AudioEngine>();
+	engine->init("", clock, AudioEngine::Backend::Null);
+	engine->start();
+
+	SoundBank sounds;
+	sounds.init(engine->mEngine);
+
+	AudioSwitcher switcher(clock);
+	switcher.setPrepare([&](AudioEngine& next) { sounds.prepare(next.mEngine); });
+	switcher.start();
+
+	std::vector<double> swaps, opens, closes;
+
+	bench::Measurement total = ctx.measure("switch", 20, [&]() {
+		switcher.request("", AudioEngine::Backend::Null);
+
+		// Polled like a frame loop would, without rendering anything in between.
+		while (!switcher.poll(engine, [&](AudioEngine&, AudioEngine& next) {
+			sounds.uninit();
+			sounds.init(next.mEngine);
+		})) {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+
+		while (switcher.busy())
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+		auto timings = switcher.timings();
+		swaps.push_back(timings.swap);
+		opens.push_back(timings.open);
+		closes.push_back(timings.close);
+	});
+
+	switcher.stop();
+	sounds.uninit();
+	engine->uninit();
+
+	auto median = [](std::vector<double>& samples) {
+		std::sort(samples.begin(), samples.end());
+		return samples[samples.size() / 2];
+	};
+
+	ctx.metric("swap_max", switcher.timings().maxSwap * 1e6, "us");
+	ctx.metric("swap_median", median(swaps) * 1e6, "us");
+	ctx.metric("open_median", median(opens) * 1e3, "ms");
+	ctx.metric("close_median", median(closes) * 1e3, "ms");
+	ctx.metric("switch_median", total.median * 1e3, "ms");
+}
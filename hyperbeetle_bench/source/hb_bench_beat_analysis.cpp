@@ -0,0 +1,110 @@
+#include "hb_bench.hpp"
+
+#include "hb_beat_analysis.hpp"
+#include "hb_jobs.hpp"
+#include "hb_mapped_file.hpp"
+
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <random>
+
+namespace {
+	using hyperbeetle::MonoAudio;
+
+	constexpr std::uint32_t kSampleRate = 44100;
+
+	// A drum loop at a known tempo over a quiet chord: kicks on every beat, snares on the off beats, hats on eighths and
+	// bass notes on random sixteenths so not every onset is on the beat.
+	MonoAudio makeBeatSignal(double bpm, double offset, double seconds, std::uint32_t seed) {
+		MonoAudio audio;
+		audio.sampleRate = kSampleRate;
+		audio.samples.assign(static_cast<std::size_t>(seconds * kSampleRate), 0.0f);
+
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+		std::bernoulli_distribution bass(0.2);
+
+		auto add = [&](double start, double length, auto voice) {
+			std::size_t first = static_cast<std::size_t>(start * kSampleRate);
+			std::size_t count = std::min(audio.samples.size() - std::min(audio.samples.size(), first), static_cast<std::size_t>(length * kSampleRate));
+			for (std::size_t i = 0; i < count; ++i)
+				audio.samples[first + i] += voice(static_cast<double>(i) / kSampleRate);
+		};
+
+		double beat = 60.0 / bpm;
+		for (int k = 0; offset + k * beat < seconds; ++k) {
+			double time = offset + k * beat;
+			// The kick's pitch falls from 120 to 50 Hz, its phase is the integral of that.
+			add(time, 0.3, [](double t) { return static_cast<float>(0.8 * std::sin(2.0 * std::numbers::pi * (50.0 * t + 70.0 * 0.03 * (1.0 - std::exp(-t / 0.03)))) * std::exp(-t / 0.12)); });
+			if (k % 2)
+				add(time, 0.2, [&](double t) { return static_cast<float>((0.4 * noise(rng) + 0.3 * std::sin(2.0 * std::numbers::pi * 200.0 * t)) * std::exp(-t / 0.06)); });
+			for (int eighth = 0; eighth < 2; ++eighth) {
+				float last = 0.0f;
+				add(time + eighth * beat / 2.0, 0.05, [&](double t) {
+					float value = noise(rng);
+					float high = value - last;
+					last = value;
+					return static_cast<float>(0.15 * high * std::exp(-t / 0.015));
+				});
+			}
+			for (int sixteenth = 0; sixteenth < 4; ++sixteenth) {
+				if (bass(rng))
+					add(time + sixteenth * beat / 4.0, beat / 4.0, [&](double t) { return static_cast<float>(0.3 * std::sin(2.0 * std::numbers::pi * 82.4 * t) * std::exp(-t / 0.1)); });
+			}
+		}
+
+		for (std::size_t i = 0; i < audio.samples.size(); ++i) {
+			double t = static_cast<double>(i) / kSampleRate;
+			audio.samples[i] += static_cast<float>(0.03 * (std::sin(2.0 * std::numbers::pi * 220.0 * t) + std::sin(2.0 * std::numbers::pi * 261.6 * t) + std::sin(2.0 * std::numbers::pi * 329.6 * t)));
+		}
+		return audio;
+	}
+}
+
+// Generated drum loops at known tempos and offsets: how many tempos are found to within half a BPM, also counting half
+// and double the tempo, and how far the beats land from the real ones, then the time to analyze a five minute song serially and on the job system, and the time to
+// decode the menu music serially and in parallel blocks.
+HB_BENCHMARK("analysis.beats") {
+	using namespace hyperbeetle;
+
+	constexpr std::array<double, 12> kTempos = { 64.0, 75.0, 88.0, 96.0, 105.0, 120.0, 128.0, 136.0, 148.0, 160.0, 174.0, 190.0 };
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<double> offsets(0.0, 0.5);
+	int found = 0, foundOctave = 0;
+	double phaseError = 0.0;
+	for (std::size_t i = 0; i < kTempos.size(); ++i) {
+		double bpm = kTempos[i], offset = offsets(rng);
+		BeatAnalysis analysis = analyzeBeats(makeBeatSignal(bpm, offset, 30.0, static_cast<std::uint32_t>(i)));
+
+		// Kicks and snares alternate, so the loop repeats every two beats and half the tempo is a fair answer too.
+		for (double octave : { 0.5, 1.0, 2.0 }) {
+			if (std::abs(analysis.bpm - bpm * octave) < 0.5)
+				++foundOctave;
+		}
+		if (std::abs(analysis.bpm - bpm) >= 0.5)
+			continue;
+
+		++found;
+		double beat = 60.0 / bpm;
+		double phase = std::fmod(std::abs(analysis.offset - offset), beat);
+		phaseError += std::min(phase, beat - phase);
+	}
+	ctx.metric("tempos_found", found, "of 12");
+	ctx.metric("tempos_found_any_octave", foundOctave, "of 12");
+	ctx.metric("beat_error_mean", found ? phaseError / found * 1e3 : 0.0, "ms");
+
+	MonoAudio song = makeBeatSignal(128.0, 0.2, 300.0, 99);
+	JobSystem jobs;
+	bench::Measurement serial = ctx.measure("song_5min_serial", 5, [&]() { bench::doNotOptimize(analyzeBeats(song).bpm); });
+	bench::Measurement parallel = ctx.measure("song_5min_parallel", 5, [&]() { bench::doNotOptimize(analyzeBeats(song, &jobs).bpm); });
+	ctx.metric("parallel_speedup", serial.median / parallel.median, "x");
+
+	// Run from the working directory.
+	MappedFile music("final_select.ogg");
+	MonoAudio decoded = decodeMono(music.bytes());
+	bench::Measurement decodeSerial = ctx.measure("decode_serial", 5, [&]() { bench::doNotOptimize(decodeMono(music.bytes()).samples.size()); });
+	ctx.measure("decode_parallel", 5, [&]() { bench::doNotOptimize(decodeMono(music.bytes(), &jobs).samples.size()); });
+	ctx.metric("decode_rate", decoded.duration() / decodeSerial.median, "x realtime");
+}
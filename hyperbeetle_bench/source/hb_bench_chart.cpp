@@ -0,0 +1,148 @@
+#include "hb_bench.hpp"
+#include "hb_bench_data.hpp"
+
+#include "hb_chart.hpp"
+#include "hb_chart_compiler.hpp"
+#include "hb_chart_reloader.hpp"
+#include "hb_clock.hpp"
+#include "hb_file_watcher.hpp"
+#include "hb_jobs.hpp"
+#include "hb_simulation.hpp"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+HB_BENCHMARK("chart.load") {
+	using namespace hyperbeetle;
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "hyperbeetle_bench";
+	std::filesystem::create_directories(directory);
+
+	for (std::size_t notes : { 1000u, 50000u }) {
+		std::string suffix = std::to_string(notes);
+		std::filesystem::path yamlPath = directory / ("chart_" + suffix + ".yaml");
+		std::filesystem::path binaryPath = Chart::compiledPath(yamlPath);
+
+		saveChartSource(bench::makeSyntheticChart(notes), yamlPath);
+		compileChartFile(yamlPath, binaryPath);
+
+		ctx.metric("yaml_bytes_" + suffix, static_cast<double>(std::filesystem::file_size(yamlPath)), "B");
+		ctx.metric("binary_bytes_" + suffix, static_cast<double>(std::filesystem::file_size(binaryPath)), "B");
+
+		ctx.measure("yaml_parse_" + suffix, 10, [&]() {
+			ChartSource source = loadChartSource(yamlPath);
+			bench::doNotOptimize(source.sections.size());
+		});
+
+		ctx.measure("yaml_compile_" + suffix, 10, [&]() {
+			auto bytes = compileChart(loadChartSource(yamlPath));
+			bench::doNotOptimize(bytes.size());
+		});
+
+		ctx.measure("binary_open_" + suffix, 100, [&]() {
+			Chart chart = Chart::open(binaryPath);
+			bench::doNotOptimize(chart.noteCount());
+		});
+
+		ctx.measure("binary_open_unverified_" + suffix, 100, [&]() {
+			Chart chart = Chart::open(binaryPath, false);
+			bench::doNotOptimize(chart.noteCount());
+		});
+	}
+}
+
+// A chart being edited while it plays. Reloading it whole and with one section changed, then the time from saving it
+// to the tick that swapped it into a running simulation, through the file watcher and the loader.
+HB_BENCHMARK("chart.reload") {
+	using namespace hyperbeetle;
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "hyperbeetle_bench";
+	std::filesystem::create_directories(directory);
+	std::filesystem::path yamlPath = directory / "chart_reload.yaml";
+
+	// Two versions that differ by one note in one section, saved in turns.
+	ChartSource source = bench::makeSyntheticChart(20000);
+	std::array<std::string, 2> texts;
+	texts[0] = emitChartSource(source);
+	source.sections[source.sections.size() / 2].notes.front().lane ^= 1;
+	texts[1] = emitChartSource(source);
+	std::size_t saves = 0;
+	auto save = [&]() {
+		std::ofstream file(yamlPath, std::ios::binary | std::ios::out | std::ios::trunc);
+		file << texts[saves++ % 2];
+	};
+	save();
+
+	JobSystem jobs;
+	bench::Measurement whole = ctx.measure("parse_whole", 5, [&]() { bench::doNotOptimize(compileChart(loadChartSource(yamlPath)).size()); });
+	ctx.measure("first_load", 5, [&]() { bench::doNotOptimize(ChartReloader(yamlPath).load()->noteCount()); });
+	ctx.measure("first_load_parallel", 5, [&]() { bench::doNotOptimize(ChartReloader(yamlPath).load(&jobs)->noteCount()); });
+
+	// Includes saving the file.
+	ChartReloader reloader(yamlPath);
+	reloader.load();
+	bench::Measurement edited = ctx.measure("one_section_changed", 10, [&]() {
+		save();
+		bench::doNotOptimize(reloader.load()->noteCount());
+	});
+	ctx.metric("sections", static_cast<double>(reloader.lastLoad().sections), "");
+	ctx.metric("sections_parsed", static_cast<double>(reloader.lastLoad().parsed), "");
+	ctx.metric("reload_speedup", whole.median / edited.median, "x");
+
+	InputQueue input;
+	Simulation simulation{ input };
+	std::shared_ptr<Chart const> chart = reloader.load();
+	simulation.loadChart(*chart, 0.0);
+	simulation.start();
+
+	FileWatcher watcher;
+	watcher.watch(yamlPath);
+	JobHandle reload;
+	watcher.start([&](std::filesystem::path const&, std::int64_t changedAt) {
+		auto load = [&, changedAt]() {
+			try {
+				simulation.swapChart(reloader.load(&jobs), changedAt);
+			}
+			catch (ChartError const&) {} // polled halfway through a save
+		};
+		reload = reload ? jobs.submit(load, { reload }) : jobs.submit(load);
+		if (!jobs.threadCount())
+			jobs.wait(reload);
+	});
+
+	std::vector<double> saveToLive, noticeToLive;
+	std::uint32_t swaps = 0;
+	for (int i = 0; i < 20; ++i) {
+		std::int64_t saved = now();
+		save();
+		for (;;) {
+			simulation.frames().update();
+			SimulationState const& state = simulation.frames().read().current;
+			if (state.chartSwaps > swaps) {
+				swaps = state.chartSwaps;
+				saveToLive.push_back(nanosecondsToSeconds(now() - saved) * 1e3);
+				noticeToLive.push_back(nanosecondsToSeconds(state.swapLatency) * 1e3);
+				break;
+			}
+			if (now() - saved > 2'000'000'000) break;
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+	ctx.metric("inotify", watcher.notified() ? 1.0 : 0.0, "");
+	watcher.stop();
+	if (reload) jobs.wait(reload);
+	simulation.stop();
+
+	ctx.metric("swapped", static_cast<double>(saveToLive.size()), "of 20");
+	for (auto [name, values] : { std::pair{ "save_to_live", &saveToLive }, { "notice_to_live", &noticeToLive } }) {
+		if (values->empty()) continue;
+		std::sort(values->begin(), values->end());
+		ctx.metric(std::string(name) + "_median", (*values)[values->size() / 2], "ms");
+		ctx.metric(std::string(name) + "_worst", values->back(), "ms");
+	}
+	std::filesystem::remove(yamlPath);
+}
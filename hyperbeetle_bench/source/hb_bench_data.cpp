@@ -0,0 +1,98 @@
+#include "hb_bench_data.hpp"
+
+#include <array>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+	constexpr std::array<char const*, 16> kWords = { "Neon", "Midnight", "Drive", "Beetle", "Echo", "Horizon", "Pulse", "Static",
+		"Velvet", "Cascade", "Orbit", "Signal", "Ember", "Glass", "Thunder", "Lotus" };
+}
+
+namespace hyperbeetle::bench {
+	ChartSource makeSyntheticChart(std::size_t notes, std::uint32_t seed) {
+		constexpr double kSectionBeats = 256.0;
+
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<int> lane(0, 3);
+		std::uniform_int_distribution<int> roll(0, 99);
+
+		ChartSource source;
+		source.title = "Synthetic " + std::to_string(notes);
+		source.author = "hyperbeetle_bench";
+		source.bpm = 180.0;
+		source.lanes = 4;
+
+		double beat = 0.0;
+		ChartSourceSection* section = nullptr;
+
+		for (std::size_t i = 0; i < notes; ++i) {
+			if (!section || beat - section->start >= kSectionBeats) {
+				section = &source.sections.emplace_back();
+				section->name = "section" + std::to_string(source.sections.size());
+				section->start = beat;
+				section->curve.push_back({ 0.0, static_cast<float>(roll(rng) - 50), static_cast<float>(roll(rng) % 10) });
+			}
+
+			ChartNote& note = section->notes.emplace_back();
+			note.beat = beat - section->start;
+			note.lane = static_cast<std::uint8_t>(lane(rng));
+
+			int r = roll(rng);
+			if (r < 10) {
+				note.kind = NoteKind::Hold;
+				note.length = 1.0;
+			}
+			else if (r < 15) {
+				note.kind = NoteKind::Obstacle;
+			}
+
+			// A quarter of the notes form chords with the next one.
+			if (r % 4 != 0)
+				beat += 0.25;
+		}
+
+		return source;
+	}
+
+	std::string makeLevelName(std::mt19937& rng, int words) {
+		std::uniform_int_distribution<std::size_t> word(0, kWords.size() - 1);
+		std::string name;
+		for (int i = 0; i < words; ++i) {
+			if (i) name += ' ';
+			name += kWords[word(rng)];
+		}
+		return name + ' ' + std::to_string(rng() % 1000);
+	}
+
+	LevelIndex makeLevelIndex(std::size_t levels) {
+		std::mt19937 rng(5);
+		std::vector<std::string> artists, authors;
+		for (int i = 0; i < 300; ++i) {
+			artists.push_back(makeLevelName(rng, 1));
+			authors.push_back("author" + std::to_string(i));
+		}
+
+		std::vector<LevelRecord> records(levels);
+		std::string strings;
+		auto add = [&](std::string const& text) {
+			auto offset = static_cast<std::uint32_t>(strings.size());
+			strings += text;
+			strings += '\0';
+			return offset;
+		};
+		for (std::size_t i = 0; i < levels; ++i) {
+			auto& record = records[i];
+			record.path = add("level" + std::to_string(i) + ".hbpak");
+			record.title = add(makeLevelName(rng, 2 + static_cast<int>(rng() % 2)));
+			record.artist = add(artists[rng() % artists.size()]);
+			record.author = add(authors[rng() % authors.size()]);
+			record.bpm = 90.0 + static_cast<double>(rng() % 100);
+			record.length = static_cast<ChartTime>(90 + i % 240) * 1'000'000;
+			record.difficulty = static_cast<std::uint32_t>(i % 10);
+		}
+		return LevelIndex(std::move(records), std::move(strings));
+	}
+}
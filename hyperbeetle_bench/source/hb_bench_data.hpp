@@ -0,0 +1,19 @@
+#pragma once
+
+#include "hb_chart_compiler.hpp"
+#include "hb_level_library.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace hyperbeetle::bench {
+	// A dense deterministic chart: `notes` notes in sections of 256 beats, mixing taps, chords, holds and obstacles.
+	ChartSource makeSyntheticChart(std::size_t notes, std::uint32_t seed = 1);
+
+	// `words` words from a short list and a number, "Neon Drive 512".
+	std::string makeLevelName(std::mt19937& rng, int words);
+	// Titles of two or three words and a number, artists and authors from a few hundred names.
+	LevelIndex makeLevelIndex(std::size_t levels);
+}
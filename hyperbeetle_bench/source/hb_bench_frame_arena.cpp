@@ -0,0 +1,74 @@
+#include "hb_bench.hpp"
+
+#include "hb_allocations.hpp"
+#include "hb_frame_arena.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+	// Roughly what the debug overlay prints every frame.
+	template<class Stream>
+	void writeOverlay(Stream& stream, int frame) {
+		stream << "HyperBeetle v0.0.1" << '\n';
+		stream << "Frame " << 16.6667 << "ms, " << 60 << " fps, vsync\n";
+		stream << "Frame p50 " << 16.61 << "ms, p99 " << 17.02 << "ms, p99.9 " << 19.4 << "ms\n";
+		stream << 1920 << 'x' << 1080 << '\n';
+		stream << "Audio clock " << frame * 0.0166667 << ", latency " << 10.6667 << "ms out, " << 0.0 << "ms in\n";
+		stream << "Voices " << 3 << '/' << 32 << ", " << 0 << " stolen\n";
+		stream << "Simulation " << 1000.0 << "Hz, tick " << frame * 16 << ", " << frame * 0.016 << "s, step " << 0.4 << "us";
+	}
+}
+
+// Builds the overlay's text 1000 times, as frames would: with a std::stringstream, and in a frame arena that is reset
+// after each one. The allocation metrics are per frame.
+HB_BENCHMARK("frame.arena") {
+	using namespace hyperbeetle;
+
+	constexpr int kFrames = 1000;
+
+	auto before = allocations::thisThread();
+	ctx.measure("stringstream_1000", 20, [&]() {
+		for (int frame = 0; frame < kFrames; ++frame) {
+			std::stringstream stream;
+			writeOverlay(stream, frame);
+			std::string text = stream.str();
+			bench::doNotOptimize(text.data());
+		}
+	});
+	auto stringstreamAllocations = allocations::thisThread() - before;
+
+	FrameArena arena;
+	before = allocations::thisThread();
+	ctx.measure("arena_1000", 20, [&]() {
+		for (int frame = 0; frame < kFrames; ++frame) {
+			FrameText text(&arena, 1024);
+			writeOverlay(text, frame);
+			bench::doNotOptimize(text.c_str());
+			arena.reset();
+		}
+	});
+	auto arenaAllocations = allocations::thisThread() - before;
+
+	// Both ran 21 times counting the warmup.
+	constexpr double kTotalFrames = 21.0 * kFrames;
+	ctx.metric("stringstream_allocations", static_cast<double>(stringstreamAllocations.allocations) / kTotalFrames, "per frame");
+	ctx.metric("arena_allocations", static_cast<double>(arenaAllocations.allocations) / kTotalFrames, "per frame");
+	ctx.metric("arena_peak", static_cast<double>(arena.peak()), "bytes");
+
+	// A frame that outgrows the buffer spills to the heap once, then the buffer fits it.
+	FrameArena small(256);
+	std::uint64_t spills = 0;
+	for (int frame = 0; frame < 4; ++frame) {
+		before = allocations::thisThread();
+		std::pmr::vector<int> values(&small);
+		values.resize(1024);
+		bench::doNotOptimize(values.data());
+		values = std::pmr::vector<int>(&small);
+		small.reset();
+		if ((allocations::thisThread() - before).allocations)
+			++spills;
+	}
+	ctx.metric("growing_frames", static_cast<double>(spills), "of 4");
+}
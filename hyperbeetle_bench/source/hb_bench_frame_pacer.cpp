@@ -0,0 +1,58 @@
+#include "hb_bench.hpp"
+
+#include "hb_clock.hpp"
+#include "hb_frame_pacer.hpp"
+
+#include <chrono>
+#include <random>
+#include <thread>
+
+// Paces empty frames at 240 fps the way the render loop does, without a window. The wake error is how far past the
+// deadline the sleep and spin lands, the frame percentiles are what the overlay would show.
+HB_BENCHMARK("frame.pacer") {
+	using namespace hyperbeetle;
+
+	FramePacer pacer;
+	pacer.setMode(FramePacer::Mode::Capped, 240.0);
+
+	// Uneven work per frame, well under the period.
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<int> work(0, 1500);
+
+	ctx.measure("frames_480", 1, [&]() {
+		pacer.setMode(FramePacer::Mode::Capped, 240.0);
+		for (int i = 0; i < 480; ++i) {
+			std::int64_t until = now() + work(rng) * 1000;
+			while (now() < until) {}
+
+			pacer.wait();
+			pacer.endFrame();
+		}
+	});
+
+	auto const& frames = pacer.frameTimes();
+	ctx.metric("frame_p50", nanosecondsToSeconds(frames.percentile(0.5)) * 1e3, "ms");
+	ctx.metric("frame_p99", nanosecondsToSeconds(frames.percentile(0.99)) * 1e3, "ms");
+	ctx.metric("frame_p999", nanosecondsToSeconds(frames.percentile(0.999)) * 1e3, "ms");
+	ctx.metric("wake_error_p50", nanosecondsToSeconds(pacer.wakeErrors().percentile(0.5)) * 1e6, "us");
+	ctx.metric("wake_error_p99", nanosecondsToSeconds(pacer.wakeErrors().percentile(0.99)) * 1e6, "us");
+	ctx.metric("missed", static_cast<double>(pacer.missedDeadlines()), "frames");
+
+	// What sleeping the whole way would have cost instead of spinning the end.
+	Histogram oversleep;
+	for (int i = 0; i < 200; ++i) {
+		std::int64_t deadline = now() + 2'000'000;
+		std::this_thread::sleep_until(Clock::time_point(std::chrono::nanoseconds(deadline)));
+		oversleep.record(now() - deadline);
+	}
+	ctx.metric("sleep_only_error_p50", nanosecondsToSeconds(oversleep.percentile(0.5)) * 1e6, "us");
+	ctx.metric("sleep_only_error_p99", nanosecondsToSeconds(oversleep.percentile(0.99)) * 1e6, "us");
+
+	Histogram histogram;
+	std::uniform_int_distribution<std::int64_t> sample(1'000'000, 50'000'000);
+	ctx.measure("histogram_record_100k", 20, [&]() {
+		for (int i = 0; i < 100'000; ++i)
+			histogram.record(sample(rng));
+		bench::doNotOptimize(histogram.count());
+	});
+}
@@ -0,0 +1,65 @@
+#include "hb_bench.hpp"
+
+#include "hb_clock.hpp"
+#include "hb_histogram.hpp"
+#include "hb_input_queue.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Pushes and drains key events through the input queue: bursts of up to a full queue on one thread, then a million
+// events from a producer thread to a consumer draining as fast as it can. Full and empty queues yield, the way a
+// window thread waiting on events and a game thread between ticks would give up the core.
+HB_BENCHMARK("input.queue") {
+	using namespace hyperbeetle;
+
+	auto queue = std::make_unique<InputQueue>();
+	std::uint64_t drained = 0;
+	auto count = [&](EventKey const& event) { drained += static_cast<std::uint64_t>(event.key); };
+
+	constexpr std::size_t kBurstEvents = 64 * 1024; // a run
+	for (std::size_t burst : { std::size_t{ 16 }, InputQueue::kCapacity }) {
+		bench::Measurement measurement = ctx.measure("burst_" + std::to_string(burst), 200, [&]() {
+			for (std::size_t pushed = 0; pushed < kBurstEvents; pushed += burst) {
+				for (std::size_t i = 0; i < burst; ++i)
+					queue->push({ nullptr, static_cast<int>(i & 7), 0, 1, 0, 0 });
+				queue->drain(count);
+			}
+		});
+		ctx.metric("burst_" + std::to_string(burst) + "_per_event", measurement.median / static_cast<double>(kBurstEvents) * 1e9, "ns");
+	}
+	bench::doNotOptimize(drained);
+
+	constexpr std::uint64_t kEvents = 1'000'000;
+	Histogram latencies;
+	std::uint64_t overflows = 0;
+	bench::Measurement crossThread = ctx.measure("cross_thread_1m", 5, [&]() {
+		queue = std::make_unique<InputQueue>();
+		latencies.reset();
+
+		std::jthread producer([&queue = *queue]() {
+			for (std::uint64_t i = 0; i < kEvents; ++i) {
+				EventKey event{ nullptr, static_cast<int>(i & 7), 0, 1, 0, now() };
+				while (!queue.push(event))
+					std::this_thread::yield();
+			}
+		});
+
+		std::uint64_t received = 0;
+		while (received < kEvents) {
+			std::size_t got = queue->drain([&](EventKey const& event) { latencies.record(now() - event.timestamp); });
+			if (!got)
+				std::this_thread::yield();
+			received += got;
+		}
+		overflows = queue->overflows();
+	});
+	ctx.metric("cross_thread_events", static_cast<double>(kEvents) / crossThread.median / 1e6, "M/s");
+	ctx.metric("cross_thread_full", static_cast<double>(overflows), "pushes");
+	ctx.metric("cross_thread_latency_p50", static_cast<double>(latencies.percentile(0.5)) * 1e-3, "us");
+	ctx.metric("cross_thread_latency_p99", static_cast<double>(latencies.percentile(0.99)) * 1e-3, "us");
+	ctx.metric("cross_thread_peak_depth", static_cast<double>(queue->maxDepth()), "events");
+}
@@ -0,0 +1,117 @@
+#include "hb_bench.hpp"
+#include "hb_bench_data.hpp"
+
+#include "hb_audio.hpp"
+#include "hb_chart.hpp"
+#include "hb_chart_compiler.hpp"
+#include "hb_headless.hpp"
+#include "hb_jobs.hpp"
+#include "hb_music_stream.hpp"
+#include "hb_simulation.hpp"
+#include "hb_sound_bank.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Scheduling overhead: independent jobs joined by one that depends on all of them, and a chain where every job waits
+// for the previous one.
+HB_BENCHMARK("jobs.graph") {
+	using namespace hyperbeetle;
+
+	JobSystem jobs;
+	ctx.metric("threads", jobs.threadCount(), "");
+
+	ctx.measure("fan_out_10000", 10, [&]() {
+		std::vector<JobHandle> handles;
+		handles.reserve(10000);
+		for (int i = 0; i < 10000; ++i)
+			handles.push_back(jobs.submit([]() {}));
+		jobs.wait(jobs.submit([]() {}, handles));
+	});
+
+	ctx.measure("chain_1000", 10, [&]() {
+		JobHandle previous = jobs.submit([]() {});
+		for (int i = 0; i < 1000; ++i)
+			previous = jobs.submit([]() {}, { previous });
+		jobs.wait(previous);
+	});
+}
+
+// The game's startup and a level load as job graphs, without loader threads (the serial path) and with them.
+// Startup leaves out the window, which opens on the main thread alongside. Run from the working directory.
+HB_BENCHMARK("jobs.load") {
+	using namespace hyperbeetle;
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "hyperbeetle_bench";
+	std::filesystem::create_directories(directory);
+	std::filesystem::path chartPath = directory / "jobs_chart.yaml";
+	saveChartSource(bench::makeSyntheticChart(20000), chartPath);
+
+	for (unsigned threads : { 0u, JobSystem::defaultThreadCount() }) {
+		std::string suffix = threads ? "_parallel" : "_serial";
+
+		ctx.measure("startup" + suffix, 10, [&]() {
+			JobSystem jobs(threads);
+			SongClock clock;
+			AudioEngine audio;
+			SoundBank sounds;
+			SoundBank::Decoded decoded[2];
+			std::vector<unsigned char> font;
+
+			JobHandle device = jobs.submit([&]() {
+				audio.init("", clock, AudioEngine::Backend::Null);
+				audio.start();
+				sounds.init(audio.mEngine);
+			});
+			JobHandle cursor = jobs.submit([&]() { decoded[0] = SoundBank::decode("cursor1.ogg", sounds.channels(), sounds.sampleRate()); }, { device });
+			JobHandle select = jobs.submit([&]() { decoded[1] = SoundBank::decode("select1.ogg", sounds.channels(), sounds.sampleRate()); }, { device });
+			JobHandle fontJob = jobs.submit([&]() {
+				std::ifstream file("NotoSans-Regular.ttf", std::ios::binary);
+				font.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			});
+
+			for (JobHandle const& job : { device, cursor, select, fontJob })
+				jobs.wait(job);
+
+			sounds.add(std::move(decoded[0]));
+			sounds.add(std::move(decoded[1]));
+			sounds.uninit();
+			audio.uninit();
+		});
+
+		// Compiles the chart from YAML every time, as if the binary were missing.
+		ctx.measure("level" + suffix, 10, [&]() {
+			JobSystem jobs(threads);
+			SongClock clock;
+			AudioEngine audio;
+			Chart chart;
+			MusicStream music;
+			InputQueue input;
+			Simulation simulation{ input };
+			std::vector<EventKey> events;
+
+			JobHandle device = jobs.submit([&]() {
+				audio.init("", clock, AudioEngine::Backend::Null);
+				audio.start();
+			});
+			JobHandle chartJob = jobs.submit([&]() {
+				chart = Chart::fromBytes(compileChart(loadChartSource(chartPath)));
+			});
+			JobHandle musicJob = jobs.submit([&]() { music.open("final_select.ogg", audio.mEngine); }, { device });
+			JobHandle inputJob = jobs.submit([&]() {
+				simulation.loadChart(chart);
+				events = makeAutoplayInput(chart, 1.0, 0.02, 1);
+			}, { chartJob });
+
+			for (JobHandle const& job : { device, chartJob, musicJob, inputJob })
+				jobs.wait(job);
+
+			bench::doNotOptimize(events.size());
+			music.close();
+			audio.uninit();
+		});
+	}
+}
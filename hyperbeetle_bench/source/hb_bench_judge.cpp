@@ -0,0 +1,95 @@
+#include "hb_bench.hpp"
+#include "hb_bench_data.hpp"
+
+#include "hb_chart.hpp"
+#include "hb_chart_compiler.hpp"
+#include "hb_note_store.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+HB_BENCHMARK("judge") {
+	using namespace hyperbeetle;
+
+	constexpr std::size_t kNotes = 50000;
+	constexpr ChartTime kTick = 1000; // 1 kHz simulation
+
+	Chart chart = Chart::fromBytes(compileChart(bench::makeSyntheticChart(kNotes)));
+
+	struct Input final {
+		ChartTime time;
+		std::uint8_t lane;
+		bool release;
+	};
+
+	// Presses jittered around every note with some stray taps, releases at the end of holds, sorted like real input.
+	std::vector<Input> inputs;
+	{
+		std::mt19937 rng(7);
+		std::normal_distribution<double> jitter(0.0, 30'000.0);
+		std::uniform_int_distribution<int> roll(0, 99);
+
+		auto times = chart.noteTimes();
+		auto durations = chart.noteDurations();
+		auto lanes = chart.noteLanes();
+		for (std::size_t i = 0; i < times.size(); ++i) {
+			ChartTime press = times[i] + static_cast<ChartTime>(jitter(rng));
+			inputs.push_back({ press, lanes[i], false });
+			if (durations[i] > 0)
+				inputs.push_back({ times[i] + durations[i] - static_cast<ChartTime>(roll(rng)) * 2000, lanes[i], true });
+			if (roll(rng) < 10)
+				inputs.push_back({ press + 40'000, static_cast<std::uint8_t>(roll(rng) % 4), false });
+		}
+		std::stable_sort(inputs.begin(), inputs.end(), [](Input const& a, Input const& b) { return a.time < b.time; });
+	}
+
+	NoteStore store;
+
+	ctx.measure("build", 20, [&]() {
+		store.build(chart);
+		bench::doNotOptimize(store.noteCount());
+	});
+
+	// Plays the chart the way the simulation does, advancing once per tick and judging the inputs of that tick.
+	bench::Measurement play = ctx.measure("play", 20, [&]() {
+		store.seek(0);
+		std::size_t next = 0;
+		ChartTime end = chart.header().length + store.windows().good + kTick;
+		for (ChartTime tick = 0; tick < end; tick += kTick) {
+			for (; next < inputs.size() && inputs[next].time < tick; ++next) {
+				Input const& input = inputs[next];
+				auto judgment = input.release ? store.release(input.lane, input.time) : store.press(input.lane, input.time);
+				bench::doNotOptimize(judgment);
+			}
+			store.advance(tick);
+		}
+		bench::doNotOptimize(store.stats());
+	});
+	NoteStore::Stats played = store.stats();
+
+	bench::Measurement inputsOnly = ctx.measure("inputs", 20, [&]() {
+		store.seek(0);
+		for (Input const& input : inputs) {
+			auto judgment = input.release ? store.release(input.lane, input.time) : store.press(input.lane, input.time);
+			bench::doNotOptimize(judgment);
+		}
+	});
+
+	// No input at all, every note is swept up as a miss.
+	ctx.measure("sweep", 20, [&]() {
+		store.seek(0);
+		store.advance(chart.header().length + store.windows().good + 1);
+		bench::doNotOptimize(store.stats());
+	});
+
+	ctx.metric("inputs", static_cast<double>(inputs.size()), "");
+	ctx.metric("judgments_per_second", static_cast<double>(inputs.size()) / inputsOnly.min, "1/s");
+	ctx.metric("play_realtime_factor", static_cast<double>(chart.header().length) * 1e-6 / play.min, "x");
+
+	ctx.metric("perfect", played.grades[0], "");
+	ctx.metric("great", played.grades[1], "");
+	ctx.metric("good", played.grades[2], "");
+	ctx.metric("miss", played.grades[3], "");
+	ctx.metric("max_combo", played.maxCombo, "");
+}
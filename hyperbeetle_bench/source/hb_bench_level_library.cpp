@@ -0,0 +1,107 @@
+#include "hb_bench.hpp"
+#include "hb_bench_data.hpp"
+
+#include "hb_jobs.hpp"
+#include "hb_level_library.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Searches over 50k levels against a 60 Hz frame: an empty query lists everything, "n" matches almost everything,
+// then a title prefix, a word inside, a fuzzy match and a query nothing matches.
+HB_BENCHMARK("library.search") {
+	using namespace hyperbeetle;
+
+	LevelIndex index = bench::makeLevelIndex(50'000);
+	LevelSearch search;
+	double worst = 0.0;
+	for (auto [name, query] : { std::pair{ "empty", "" }, { "one_letter", "n" }, { "prefix", "neon dr" }, { "word", "cascade" },
+		{ "fuzzy", "mdnt hrzn" }, { "none", "qqq" } }) {
+		bench::Measurement measurement = ctx.measure(std::string("query_") + name, 200, [&]() {
+			search.query.clear(); // not narrowed by the run before
+			index.search(query, search);
+			bench::doNotOptimize(search.results.size());
+		});
+		ctx.metric(std::string("results_") + name, static_cast<double>(search.results.size()), "");
+		worst = std::max(worst, measurement.median);
+	}
+	ctx.metric("worst_frame_share", worst * 60.0 * 100.0, "%");
+
+	// A query typed a key at a time, every search after the first only looks at what the one before matched.
+	constexpr std::string_view kTyped = "neon drive";
+	bench::Measurement typing = ctx.measure("typing", 200, [&]() {
+		search.query.clear();
+		for (std::size_t length = 1; length <= kTyped.size(); ++length)
+			index.search(kTyped.substr(0, length), search);
+		bench::doNotOptimize(search.results.size());
+	});
+	ctx.metric("typing_per_key", typing.median / static_cast<double>(kTyped.size()) * 1e3, "ms");
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "hyperbeetle_bench";
+	std::filesystem::create_directories(directory);
+	std::filesystem::path path = directory / "library.hbli";
+	ctx.measure("save_50k", 10, [&]() { index.save(path); });
+	ctx.measure("load_50k", 10, [&]() { bench::doNotOptimize(LevelIndex::load(path).size()); });
+	ctx.metric("index_size", static_cast<double>(std::filesystem::file_size(path)) / 1024.0, "KB");
+	std::filesystem::remove(path);
+}
+
+// Scans a directory of YAML charts into an empty index serially and on the job system, then rescans after touching
+// a few files and changing a few others, and with nothing changed.
+HB_BENCHMARK("library.scan") {
+	using namespace hyperbeetle;
+
+	constexpr std::size_t kLevels = 2000, kChanged = 20;
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "hyperbeetle_bench" / "levels";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory / "packs");
+	std::filesystem::path indexPath = directory.parent_path() / "levels.hbli";
+
+	std::mt19937 rng(9);
+	std::vector<std::filesystem::path> paths;
+	for (std::size_t i = 0; i < kLevels; ++i) {
+		ChartSource source = bench::makeSyntheticChart(64, static_cast<std::uint32_t>(i));
+		source.title = bench::makeLevelName(rng, 2);
+		paths.push_back(directory / (i % 4 ? "" : "packs") / ("level" + std::to_string(i) + ".yaml"));
+		saveChartSource(source, paths.back());
+	}
+
+	auto fullScan = [&](JobSystem* jobs) {
+		std::filesystem::remove(indexPath);
+		LevelLibrary library(directory, indexPath);
+		return library.scan(jobs).seconds;
+	};
+
+	JobSystem jobs;
+	double serial = 0.0, parallel = 0.0;
+	ctx.measure("full_serial", 3, [&]() { serial = fullScan(nullptr); });
+	ctx.measure("full_parallel", 3, [&]() { parallel = fullScan(&jobs); });
+	ctx.metric("parallel_speedup", serial / parallel, "x");
+
+	LevelLibrary library(directory, indexPath);
+	library.load();
+	ctx.metric("indexed", static_cast<double>(library.snapshot()->size()), "levels");
+
+	ctx.measure("rescan_unchanged", 10, [&]() { bench::doNotOptimize(library.scan(&jobs).read); });
+
+	std::size_t read = 0;
+	ctx.measure("rescan_changed", 5, [&]() {
+		for (std::size_t i = 0; i < kChanged; ++i) {
+			ChartSource source = loadChartSource(paths[i * 7]);
+			source.title += '!';
+			saveChartSource(source, paths[i * 7]);
+			std::filesystem::last_write_time(paths[i * 11], std::filesystem::last_write_time(paths[i * 11]) + std::chrono::seconds(1));
+		}
+		read = library.scan(&jobs).read;
+	});
+	ctx.metric("rescan_read", static_cast<double>(read), "files");
+
+	std::filesystem::remove_all(directory);
+	std::filesystem::remove(indexPath);
+}
@@ -0,0 +1,276 @@
+#include "hb_bench.hpp"
+
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace hyperbeetle::bench {
+	std::vector<Benchmark>& registry() {
+		static std::vector<Benchmark> benchmarks;
+		return benchmarks;
+	}
+}
+
+namespace {
+#if defined(HB_DIST)
+	constexpr char const* kBuild = "dist";
+#elif defined(HB_RELEASE)
+	constexpr char const* kBuild = "release";
+#elif defined(HB_DEBUG)
+	constexpr char const* kBuild = "debug";
+#else
+	constexpr char const* kBuild = "unknown";
+#endif
+
+	// The default for --threshold, in percent.
+	constexpr double kDefaultThreshold = 10.0;
+
+	struct Result final {
+		char const* name;
+		std::vector<hyperbeetle::bench::Measurement> measurements;
+		std::vector<hyperbeetle::bench::Metric> metrics;
+	};
+
+	int usage() {
+		std::cout << "Usage:\n";
+		std::cout << "  hyperbeetle_bench [filter] [--repeat <n>] [--json <results.json>] [--baseline <results.json>] [--threshold <percent>]\n";
+		std::cout << "Runs the benchmarks whose name contains the filter. --repeat keeps each measurement's fastest of n runs. --baseline\n";
+		std::cout << "compares with an earlier --json and exits with 3 if a measurement got slower by more than the threshold, "
+			<< kDefaultThreshold << "% by default.\n";
+		return 1;
+	}
+
+	template<class T>
+	std::optional<T> parse(std::string_view text) {
+		T value{};
+		auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+		if (error != std::errc() || end != text.data() + text.size())
+			return std::nullopt;
+		return value;
+	}
+
+	void printMeasurement(hyperbeetle::bench::Measurement const& measurement) {
+		std::cout << "  " << std::left << std::setw(40) << measurement.name << std::right
+			<< std::setw(12) << std::fixed << std::setprecision(3) << measurement.median * 1e3 << " ms"
+			<< std::setw(12) << measurement.min * 1e3 << " ms min"
+			<< "  (" << measurement.iterations << " runs)\n";
+	}
+
+	void printMetric(hyperbeetle::bench::Metric const& metric) {
+		std::cout << "  " << std::left << std::setw(40) << metric.name << std::right
+			<< std::setw(12) << std::fixed << std::setprecision(3) << metric.value << ' ' << metric.unit << '\n';
+	}
+
+	// Milliseconds, or microseconds below one.
+	void printTime(double seconds) {
+		bool micro = seconds < 1e-3;
+		std::cout << std::setw(10) << std::fixed << std::setprecision(3) << seconds * (micro ? 1e6 : 1e3) << (micro ? " us" : " ms");
+	}
+
+	void writeString(std::ostream& stream, std::string_view text) {
+		stream << '"';
+		for (char c : text) {
+			if (c == '"' || c == '\\') stream << '\\';
+			stream << c;
+		}
+		stream << '"';
+	}
+
+	// JSON has no infinities or NaNs, a metric that divided by zero is written as null.
+	void writeNumber(std::ostream& stream, double value) {
+		if (std::isfinite(value)) stream << value;
+		else stream << "null";
+	}
+
+	void writeJson(std::filesystem::path const& path, std::vector<Result> const& results, int repeat) {
+		std::filesystem::path temporary = path;
+		temporary += ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::out | std::ios::trunc);
+			file << std::setprecision(9);
+			file << "{\n\"build\":";
+			writeString(file, kBuild);
+			file << ",\n\"repeat\":" << repeat << ",\n\"benchmarks\":[";
+			for (std::size_t i = 0; i < results.size(); ++i) {
+				Result const& result = results[i];
+				file << (i ? ",\n" : "\n") << "{\"name\":";
+				writeString(file, result.name);
+				file << ",\"measurements\":[";
+				for (std::size_t j = 0; j < result.measurements.size(); ++j) {
+					auto const& measurement = result.measurements[j];
+					file << (j ? ",\n" : "\n") << "  {\"name\":";
+					writeString(file, measurement.name);
+					file << ",\"iterations\":" << measurement.iterations << ",\"median\":";
+					writeNumber(file, measurement.median);
+					file << ",\"min\":";
+					writeNumber(file, measurement.min);
+					file << '}';
+				}
+				file << "],\"metrics\":[";
+				for (std::size_t j = 0; j < result.metrics.size(); ++j) {
+					auto const& metric = result.metrics[j];
+					file << (j ? ",\n" : "\n") << "  {\"name\":";
+					writeString(file, metric.name);
+					file << ",\"value\":";
+					writeNumber(file, metric.value);
+					file << ",\"unit\":";
+					writeString(file, metric.unit);
+					file << '}';
+				}
+				file << "]}";
+			}
+			file << "\n]}\n";
+			if (!file)
+				throw std::runtime_error("Failed to write " + temporary.string());
+		}
+		std::filesystem::rename(temporary, path);
+	}
+
+	// Compares every measurement that is in both runs and returns how many regressed. A slower median with an
+	// unchanged fastest run is usually a busy machine rather than slower code, so both have to be past the threshold.
+	std::size_t compare(std::filesystem::path const& path, std::vector<Result> const& results, double threshold) {
+		YAML::Node baseline;
+		try {
+			baseline = YAML::LoadFile(path.string());
+		}
+		catch (YAML::Exception const& e) {
+			throw std::runtime_error("Failed to read " + path.string() + ": " + e.what());
+		}
+
+		if (std::string build = baseline["build"].as<std::string>(""); build != kBuild)
+			std::cout << "Baseline is a " << build << " build, this is " << kBuild << "\n";
+
+		struct Timing final {
+			double median, min;
+		};
+		std::map<std::string, Timing, std::less<>> timings; // by "benchmark/measurement"
+		for (auto const& benchmark : baseline["benchmarks"]) {
+			std::string name = benchmark["name"].as<std::string>();
+			for (auto const& measurement : benchmark["measurements"]) {
+				timings[name + '/' + measurement["name"].as<std::string>()] = { measurement["median"].as<double>(0.0),
+					measurement["min"].as<double>(0.0) };
+			}
+		}
+
+		std::cout << "\nCompared with " << path.string() << ", threshold " << std::fixed << std::setprecision(1) << threshold << "%\n";
+		std::size_t regressed = 0, compared = 0;
+		for (Result const& result : results) {
+			for (auto const& measurement : result.measurements) {
+				auto found = timings.find(std::string(result.name) + '/' + measurement.name);
+				if (found == timings.end() || found->second.median <= 0.0 || found->second.min <= 0.0)
+					continue;
+
+				++compared;
+				double change = (measurement.median / found->second.median - 1.0) * 100.0;
+				double minChange = (measurement.min / found->second.min - 1.0) * 100.0;
+				bool slower = change > threshold && minChange > threshold;
+				bool faster = change < -threshold && minChange < -threshold;
+				if (slower) ++regressed;
+
+				std::cout << "  " << std::left << std::setw(52) << std::string(result.name) + '/' + measurement.name << std::right;
+				printTime(found->second.median);
+				std::cout << " ->";
+				printTime(measurement.median);
+				std::cout << std::setw(9) << std::setprecision(1) << std::showpos << change << std::noshowpos << '%'
+					<< (slower ? "  slower" : faster ? "  faster" : "") << '\n';
+			}
+		}
+		std::cout << compared << " compared, " << regressed << " slower\n";
+		return regressed;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	std::string_view filter;
+	std::filesystem::path json, baseline;
+	double threshold = kDefaultThreshold;
+	int repeat = 1;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		if (arg == "--json" && i + 1 < argc)
+			json = argv[++i];
+		else if (arg == "--baseline" && i + 1 < argc)
+			baseline = argv[++i];
+		else if (arg == "--threshold" && i + 1 < argc) {
+			auto value = parse<double>(argv[++i]);
+			if (!value || *value < 0.0) return usage();
+			threshold = *value;
+		}
+		else if (arg == "--repeat" && i + 1 < argc) {
+			auto value = parse<int>(argv[++i]);
+			if (!value || *value < 1) return usage();
+			repeat = *value;
+		}
+		else if (arg.starts_with("-") || !filter.empty())
+			return usage();
+		else
+			filter = arg;
+	}
+
+	std::vector<Result> results;
+	for (auto const& benchmark : hyperbeetle::bench::registry()) {
+		if (std::string_view(benchmark.name).find(filter) == std::string_view::npos)
+			continue;
+
+		std::cout << benchmark.name << '\n';
+
+		Result& result = results.emplace_back(benchmark.name, std::vector<hyperbeetle::bench::Measurement>{}, std::vector<hyperbeetle::bench::Metric>{});
+		for (int run = 0; run < repeat; ++run) {
+			hyperbeetle::bench::Context ctx;
+			try {
+				benchmark.fn(ctx);
+			}
+			catch (std::exception const& e) {
+				std::cout << "  failed: " << e.what() << '\n';
+				return 2;
+			}
+
+			// Every run measures the same things in the same order.
+			if (run == 0)
+				result.measurements = ctx.measurements();
+			for (std::size_t i = 0; i < result.measurements.size() && i < ctx.measurements().size(); ++i) {
+				auto& kept = result.measurements[i];
+				kept.median = std::min(kept.median, ctx.measurements()[i].median);
+				kept.min = std::min(kept.min, ctx.measurements()[i].min);
+			}
+			result.metrics = ctx.metrics();
+		}
+
+		for (auto const& measurement : result.measurements)
+			printMeasurement(measurement);
+
+		for (auto const& metric : result.metrics)
+			printMetric(metric);
+	}
+
+	try {
+		if (!json.empty()) {
+			writeJson(json, results, repeat);
+			std::cout << "Wrote " << json.string() << '\n';
+		}
+
+		if (!baseline.empty() && compare(baseline, results, threshold))
+			return 3;
+	}
+	catch (std::exception const& e) {
+		std::cout << e.what() << '\n';
+		return 2;
+	}
+
+	return 0;
+}
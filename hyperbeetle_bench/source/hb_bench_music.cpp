@@ -0,0 +1,56 @@
+#include "hb_bench.hpp"
+
+#include "hb_audio.hpp"
+#include "hb_music_stream.hpp"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Streams a track from the working directory on the null device: how long opening takes, how long a seek takes until
+// the target is decoded, and what the stream keeps resident compared to decoding the track up front.
+HB_BENCHMARK("music.stream") {
+	using namespace hyperbeetle;
+
+	constexpr char const* kTrack = "final_select.ogg";
+
+	SongClock clock;
+	AudioEngine audio;
+	audio.init("", clock, AudioEngine::Backend::Null);
+	audio.start();
+
+	MusicStream music;
+	ctx.measure("open", 20, [&]() {
+		music.open(kTrack, audio.mEngine);
+	});
+
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<std::uint64_t> target(0, music.length() - 1);
+	std::vector<double> seeks;
+
+	ctx.measure("seek", 200, [&]() {
+		music.seek(target(rng));
+		while (music.seeking())
+			std::this_thread::yield();
+		seeks.push_back(music.stats().lastSeek);
+	});
+
+	// Time from starting playback to the mixer pulling the first decoded frame, bounded by the device period.
+	music.open(kTrack, audio.mEngine);
+	music.play();
+	while (music.stats().firstAudio == 0.0)
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+	MusicStream::Stats stats = music.stats();
+	music.close();
+	audio.uninit();
+
+	std::sort(seeks.begin(), seeks.end());
+
+	ctx.metric("seek_median", seeks[seeks.size() / 2] * 1e3, "ms");
+	ctx.metric("seek_max", seeks.back() * 1e3, "ms");
+	ctx.metric("first_audio", stats.firstAudio * 1e3, "ms");
+	ctx.metric("resident", static_cast<double>(stats.residentBytes) / 1024.0, "KB");
+	ctx.metric("decoded_up_front", static_cast<double>(stats.decodedBytes) / 1024.0, "KB");
+}
@@ -0,0 +1,80 @@
+#include "hb_bench.hpp"
+
+#include "hb_lz.hpp"
+#include "hb_mapped_file.hpp"
+#include "hb_pack.hpp"
+#include "hb_pack_vfs.hpp"
+#include "hb_sound_bank.hpp"
+
+#include <array>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The menu's assets opened and loaded as loose files and out of a pack, lookups in a pack of 10000 entries and the LZ codec on
+// the font. Run from the working directory.
+HB_BENCHMARK("pack.assets") {
+	using namespace hyperbeetle;
+
+	constexpr std::array<char const*, 3> kAssets = { "cursor1.ogg", "select1.ogg", "NotoSans-Regular.ttf" };
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "hyperbeetle_bench";
+	std::filesystem::create_directories(directory);
+	std::filesystem::path packPath = directory / "assets.hbpak";
+
+	std::vector<PackInput> inputs;
+	for (char const* name : kAssets) {
+		MappedFile file(name);
+		// Ogg Vorbis is compressed already, like `hbpak build` the sounds are stored as they are.
+		inputs.push_back({ name, { file.bytes().begin(), file.bytes().end() }, std::string_view(name).ends_with(".ttf") });
+	}
+	writePack(inputs, packPath);
+
+	std::vector<PackInput> storedInputs = inputs;
+	for (PackInput& input : storedInputs)
+		input.compress = false;
+	std::filesystem::path storedPath = directory / "assets_stored.hbpak";
+	writePack(storedInputs, storedPath);
+
+	// Only getting at the bytes: a mapping per file against one for the pack, with the font decompressed.
+	auto open = [&](Pack const& pack) {
+		for (char const* name : kAssets)
+			bench::doNotOptimize(pack.load(name).size());
+	};
+
+	ctx.measure("open_loose", 100, [&]() { open(Pack()); });
+	ctx.measure("open_pack", 100, [&]() { open(Pack::open(packPath)); });
+	ctx.measure("open_pack_stored", 100, [&]() { open(Pack::open(storedPath)); });
+
+	// What startup does with them: the sounds decoded at the engine's format and the font handed to NanoVG.
+	auto load = [&](Pack const& pack) {
+		PackVfs vfs(pack);
+		for (char const* sound : { kAssets[0], kAssets[1] })
+			bench::doNotOptimize(SoundBank::decode(sound, 2, 48000, vfs.vfs()).frameCount);
+		bench::doNotOptimize(pack.load(kAssets[2]).size());
+	};
+
+	ctx.measure("startup_loose", 20, [&]() { load(Pack()); });
+	ctx.measure("startup_pack", 20, [&]() { load(Pack::open(packPath)); });
+
+	std::vector<PackInput> many(10'000);
+	for (std::size_t i = 0; i < many.size(); ++i)
+		many[i].name = "levels/" + std::to_string(i) + "/chart.hbc";
+	writePack(many, directory / "many.hbpak");
+	Pack pack = Pack::open(directory / "many.hbpak");
+
+	ctx.measure("find_10000", 10, [&]() {
+		for (PackInput const& input : many)
+			bench::doNotOptimize(pack.find(input.name));
+	});
+
+	std::vector<std::byte> const& font = inputs[2].bytes;
+	std::vector<std::byte> compressed = compressLz(font);
+	std::vector<std::byte> decompressed(font.size());
+	ctx.metric("font_ratio", static_cast<double>(compressed.size()) / static_cast<double>(font.size()), "");
+	bench::Measurement decompress = ctx.measure("font_decompress", 20, [&]() { bench::doNotOptimize(decompressLz(compressed, decompressed)); });
+	ctx.metric("decompress_rate", static_cast<double>(font.size()) / decompress.median / 1e6, "MB/s");
+	bench::Measurement compress = ctx.measure("font_compress", 5, [&]() { bench::doNotOptimize(compressLz(font).size()); });
+	ctx.metric("compress_rate", static_cast<double>(font.size()) / compress.median / 1e6, "MB/s");
+}
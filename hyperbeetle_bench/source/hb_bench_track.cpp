@@ -0,0 +1,55 @@
+#include "hb_bench.hpp"
+#include "hb_bench_data.hpp"
+
+#include "hb_allocations.hpp"
+#include "hb_chart.hpp"
+#include "hb_clock.hpp"
+#include "hb_histogram.hpp"
+#include "hb_track.hpp"
+
+#include <random>
+#include <string>
+
+// Builds the track through a 2 minute and a 40 minute song at 60 frames a second, on a chart that turns every four
+// beats. Memory, build rate and the cost of a frame should be the same for both, and frames shouldn't allocate.
+HB_BENCHMARK("track.generate") {
+	using namespace hyperbeetle;
+
+	constexpr ChartTime kFrame = 16'667;
+
+	for (std::size_t notes : { 2'000, 40'000 }) {
+		ChartSource source = bench::makeSyntheticChart(notes);
+		std::mt19937 rng(1);
+		std::uniform_real_distribution<float> yaw(-90.0f, 90.0f), pitch(-15.0f, 15.0f);
+		for (ChartSourceSection& section : source.sections) {
+			for (double beat = 4.0; beat < 256.0; beat += 4.0)
+				section.curve.push_back({ beat, yaw(rng), pitch(rng) });
+		}
+		Chart chart = Chart::fromBytes(compileChart(source));
+		std::string suffix = std::to_string(chart.header().length / 60'000'000) + "min";
+
+		TrackGenerator track;
+		Histogram frames;
+		std::uint64_t allocated = 0;
+		ctx.measure("song_" + suffix, 3, [&]() {
+			track.load(chart);
+			allocated = 0;
+			for (ChartTime songTime = -1'000'000; songTime < chart.header().length; songTime += kFrame) {
+				auto before = allocations::thisThread();
+				std::int64_t begin = now();
+				track.update(songTime);
+				frames.record(now() - begin);
+				allocated += (allocations::thisThread() - before).allocations;
+			}
+		});
+
+		TrackGenerator::Stats const& stats = track.stats();
+		double trackSeconds = static_cast<double>(stats.chunks) * static_cast<double>(track.settings().chunkDuration) * 1e-6;
+		ctx.metric("segments_" + suffix, static_cast<double>(stats.segments) / nanosecondsToSeconds(stats.nanoseconds), "per second");
+		ctx.metric("bytes_per_track_second_" + suffix, static_cast<double>(stats.bytes) / trackSeconds, "bytes");
+		ctx.metric("resident_" + suffix, static_cast<double>(track.residentBytes()) / 1024.0, "KB");
+		ctx.metric("frame_p50_" + suffix, nanosecondsToSeconds(frames.percentile(0.5)) * 1e6, "us");
+		ctx.metric("frame_p99_" + suffix, nanosecondsToSeconds(frames.percentile(0.99)) * 1e6, "us");
+		ctx.metric("frame_allocations_" + suffix, static_cast<double>(allocated), "in the last song");
+	}
+}
@@ -0,0 +1,175 @@
+#include "hb_bench.hpp"
+#include "hb_bench_data.hpp"
+
+#include "hb_frame_arena.hpp"
+#include "hb_frame_pacer.hpp"
+#include "hb_latency_trace.hpp"
+#include "hb_level_library.hpp"
+#include "hb_ui.hpp"
+
+#include <nanovg.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+	constexpr float kWidth = 1920.0f, kHeight = 1080.0f;
+
+	// NanoVG without a GPU: paths are flattened and tessellated and text is laid out and rasterized into the font atlas
+	// as in the game, the draw calls are only counted.
+	struct NullRenderer final {
+		std::vector<std::pair<int, int>> textures; // sizes, the id is the index + 1
+		std::size_t calls = 0, vertices = 0;
+
+		static NullRenderer& of(void* user) { return *static_cast<NullRenderer*>(user); }
+	};
+
+	NVGcontext* createNullContext(NullRenderer& renderer) {
+		NVGparams params{};
+		params.userPtr = &renderer;
+		params.edgeAntiAlias = 1;
+		params.renderCreate = [](void*) { return 1; };
+		params.renderCreateTexture = [](void* user, int, int width, int height, int, unsigned char const*) {
+			auto& textures = NullRenderer::of(user).textures;
+			textures.emplace_back(width, height);
+			return static_cast<int>(textures.size());
+		};
+		params.renderDeleteTexture = [](void*, int) { return 1; };
+		params.renderUpdateTexture = [](void*, int, int, int, int, int, unsigned char const*) { return 1; };
+		params.renderGetTextureSize = [](void* user, int image, int* width, int* height) {
+			auto const& textures = NullRenderer::of(user).textures;
+			if (image < 1 || image > static_cast<int>(textures.size())) return 0;
+			*width = textures[image - 1].first;
+			*height = textures[image - 1].second;
+			return 1;
+		};
+		params.renderViewport = [](void*, float, float, float) {};
+		params.renderCancel = [](void*) {};
+		params.renderFlush = [](void*) {};
+		params.renderFill = [](void* user, NVGpaint*, NVGcompositeOperationState, NVGscissor*, float, float const*, NVGpath const* paths, int count) {
+			auto& renderer = NullRenderer::of(user);
+			++renderer.calls;
+			for (int i = 0; i < count; ++i)
+				renderer.vertices += static_cast<std::size_t>(paths[i].nfill + paths[i].nstroke);
+		};
+		params.renderStroke = [](void* user, NVGpaint*, NVGcompositeOperationState, NVGscissor*, float, float, NVGpath const* paths, int count) {
+			auto& renderer = NullRenderer::of(user);
+			++renderer.calls;
+			for (int i = 0; i < count; ++i)
+				renderer.vertices += static_cast<std::size_t>(paths[i].nstroke);
+		};
+		params.renderTriangles = [](void* user, NVGpaint*, NVGcompositeOperationState, NVGscissor*, NVGvertex const*, int count, float) {
+			auto& renderer = NullRenderer::of(user);
+			++renderer.calls;
+			renderer.vertices += static_cast<std::size_t>(count);
+		};
+		params.renderDelete = [](void*) {};
+		return nvgCreateInternal(&params);
+	}
+}
+
+// The CPU side of drawing a frame of the main menu, the options menu, the library and the debug overlay over the
+// menu with the game's own drawing code, 100 frames a run through NanoVG with a renderer that only counts what it is
+// given. The GPU's share isn't included. Needs NotoSans-Regular.ttf, so run from the `working` directory.
+HB_BENCHMARK("frame.ui") {
+	using namespace hyperbeetle;
+
+	constexpr int kFrames = 100;
+
+	NullRenderer renderer;
+	NVGcontext* vg = createNullContext(renderer);
+	if (!vg)
+		throw std::runtime_error("Failed to create a NanoVG context");
+	struct Delete final {
+		NVGcontext* vg;
+		~Delete() { nvgDeleteInternal(vg); }
+	} deleteContext{ vg };
+
+	if (nvgCreateFont(vg, "notosans-regular", "NotoSans-Regular.ttf") < 0)
+		throw std::runtime_error("Failed to load NotoSans-Regular.ttf");
+
+	FrameArena arena;
+	LevelIndex index = bench::makeLevelIndex(2000);
+	LevelSearch search;
+	index.search("", search);
+
+	std::vector<ui::MenuOption> mainMenu = { { "Play", {} }, { "Options", {} }, { "Quit", {} } };
+	std::vector<ui::MenuOption> optionsMenu = { { "Default Playback Device", {} }, { "Speakers (High Definition Audio)", {} },
+		{ "Headphones (USB Audio)", {} }, { "Frame pacing: capped 240", {} }, { "Latency: 10 ms, calibrate", {} }, { "Profiler: on", {} }, { "Back", {} } };
+	ui::LibraryList list;
+	list.query = "neon";
+	list.searchSeconds = 0.000412;
+
+	// The overlay as it usually reads, with every input latency stage and the frame graph full. The pacer times the
+	// frames drawn here.
+	FramePacer pacer;
+	pacer.setMode(FramePacer::Mode::Uncapped);
+	for (std::size_t i = 0; i < FramePacer::kGraphFrames; ++i)
+		pacer.endFrame();
+	LatencyTrace latency;
+	for (std::int64_t i = 1; i <= 64; ++i) {
+		for (std::size_t stage = 0; stage < LatencyTrace::kStages; ++stage)
+			latency.record(static_cast<LatencyTrace::Stage>(stage), 1, 1 + i * 50'000 * static_cast<std::int64_t>(stage + 1));
+	}
+	latency.collect();
+	ui::OverlayStats stats;
+	stats.build = "HyperBeetle v0.0.1";
+	stats.deltaTime = 1.0 / 240.0;
+	stats.framebufferWidth = 1920;
+	stats.framebufferHeight = 1080;
+	stats.device = "Default Playback Device";
+	stats.outputLatency = 0.0106667;
+	stats.audioCallbacks = 24000;
+	stats.effectsNanoseconds = 24000 * 3200;
+	stats.ducking = -2.5f;
+	stats.cutoff = 20000.0f;
+	stats.voicesInUse = 3;
+	stats.voiceCount = 32;
+	stats.startupSeconds = 0.2124;
+	stats.loaderThreads = 3;
+	stats.assets = "assets.hbpak";
+	stats.libraryScan.files = 2000;
+	stats.libraryScan.seconds = 0.0142;
+	stats.inputPeak = 2;
+	stats.totalAllocations = 48211;
+	stats.tickRate = 1000.0;
+	stats.stepSeconds = 0.4e-6;
+
+	auto frames = [&](std::string_view name, auto const& draw) {
+		int frame = 0;
+		renderer.calls = renderer.vertices = 0;
+		bench::Measurement measurement = ctx.measure(std::string(name) + "_100", 20, [&]() {
+			for (int i = 0; i < kFrames; ++i, ++frame) {
+				nvgBeginFrame(vg, kWidth, kHeight, 1.0f);
+				draw(frame);
+				nvgEndFrame(vg);
+				arena.reset();
+			}
+		});
+		double perFrame = measurement.median / kFrames;
+		ctx.metric(std::string(name) + "_per_frame", perFrame * 1e6, "us");
+		ctx.metric(std::string(name) + "_240hz_share", perFrame * 240.0 * 100.0, "%");
+		ctx.metric(std::string(name) + "_draw_calls", static_cast<double>(renderer.calls) / frame, "per frame");
+		ctx.metric(std::string(name) + "_vertices", static_cast<double>(renderer.vertices) / frame, "per frame");
+	};
+
+	frames("main_menu", [&](int frame) { ui::drawMenu(vg, kWidth, kHeight, mainMenu, frame / 60 % 3); });
+	frames("options_menu", [&](int frame) { ui::drawMenu(vg, kWidth, kHeight, optionsMenu, frame / 60 % 7); });
+	frames("library", [&](int frame) {
+		list.selected = frame / 10 % static_cast<int>(search.results.size());
+		ui::drawLibrary(vg, arena, kWidth, kHeight, index, search, list);
+	});
+	frames("menu_overlay", [&](int frame) {
+		stats.frames = static_cast<std::uint64_t>(frame);
+		stats.tick = static_cast<std::uint64_t>(frame) * 4;
+		stats.audioClock = stats.simulationTime = frame / 240.0;
+		ui::drawOverlay(vg, arena, kWidth, kHeight, stats, pacer, latency);
+		ui::drawMenu(vg, kWidth, kHeight, mainMenu, 0);
+		pacer.endFrame();
+	});
+}
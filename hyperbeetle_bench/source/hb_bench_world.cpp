@@ -0,0 +1,71 @@
+#include "hb_bench.hpp"
+#include "hb_bench_data.hpp"
+
+#include "hb_allocations.hpp"
+#include "hb_chart.hpp"
+#include "hb_clock.hpp"
+#include "hb_histogram.hpp"
+#include "hb_jobs.hpp"
+#include "hb_world.hpp"
+
+#include <string>
+
+// Ticks the world at 1000 Hz through charts dense enough to keep 10k, 100k and 200k entities alive, on the calling
+// thread and split across the job pool. Cost per entity and the tick percentiles should stay flat as the world grows,
+// and streaming notes in and out shouldn't allocate.
+HB_BENCHMARK("world.tick") {
+	using namespace hyperbeetle;
+
+	constexpr ChartTime kTick = 1000;
+	constexpr int kTicks = 1000;
+
+	JobSystem jobs;
+	ctx.metric("threads", jobs.threadCount(), "");
+
+	for (std::size_t live : { 10'000, 100'000, 200'000 }) {
+		// The synthetic chart averages 0.1875 beats a note and 95% of its notes are beats. Notes stay alive for the view
+		// and each beat's particles for their lifetime, the tempo makes that about `live` entities.
+		ChartSource source = bench::makeSyntheticChart(live * 3);
+		World::Settings settings;
+		double seconds = static_cast<double>(settings.ahead + settings.behind) * 1e-6 + 0.95 * World::kParticleLife * World::kParticlesPerBeat;
+		source.bpm = static_cast<double>(live) / seconds * 0.1875 * 60.0;
+		Chart chart = Chart::fromBytes(compileChart(source));
+
+		for (bool parallel : { false, true }) {
+			std::string suffix = std::to_string(live / 1000) + "k" + (parallel ? "_parallel" : "_serial");
+
+			World world;
+			world.setJobs(parallel ? &jobs : nullptr);
+			world.load(chart);
+
+			// Fills the view at once, then steps through the dense middle of the chart.
+			ChartTime songTime = settings.ahead + settings.behind;
+			world.update(songTime, 1e-3);
+
+			Histogram ticks;
+			std::size_t entities = 0;
+			std::uint64_t allocated = 0;
+			ctx.measure("ticks_1000_" + suffix, 1, [&]() {
+				for (int i = 0; i < kTicks; ++i) {
+					songTime += kTick;
+					// Every thread, so allocations on the pool's workers count too.
+					auto before = allocations::total();
+					std::int64_t begin = now();
+					world.update(songTime, 1e-3);
+					ticks.record(now() - begin);
+					allocated += (allocations::total() - before).allocations;
+					entities += world.stats().live;
+				}
+			});
+
+			// Both ran twice counting the warmup.
+			double meanLive = static_cast<double>(entities) / (2.0 * kTicks);
+			ctx.metric("live_" + suffix, meanLive, "entities");
+			ctx.metric("tick_p50_" + suffix, nanosecondsToSeconds(ticks.percentile(0.5)) * 1e6, "us");
+			ctx.metric("tick_p99_" + suffix, nanosecondsToSeconds(ticks.percentile(0.99)) * 1e6, "us");
+			ctx.metric("tick_max_" + suffix, nanosecondsToSeconds(ticks.max()) * 1e6, "us");
+			ctx.metric("per_entity_" + suffix, ticks.mean() / meanLive, "ns");
+			ctx.metric("allocations_" + suffix, static_cast<double>(allocated) / (2.0 * kTicks), "per tick");
+		}
+	}
+}
@@ -0,0 +1,11 @@
+-- Optional, the profiler falls back to its own trace files when Tracy isn't checked out into vendor/tracy
+if not os.isfile(path.join(_MAIN_SCRIPT_DIR, "vendor/tracy/public/TracyClient.cpp")) then
+    return
+end
+
+project "tracy"
+
+location "%{wks.location}/vendor/%{prj.name}"
+defines "TRACY_ENABLE"
+files "%{prj.location}/public/TracyClient.cpp"
+includedirs "%{prj.location}/public"
@@ -50,4 +50,11 @@ for _, matchedfile in ipairs(os.matchfiles("premake/*.lua")) do
 end
 group ""
 
-include "hyperbeetle/premake5.lua"
\ No newline at end of file
+include "hyperbeetle/premake5.lua"
+include "hyperbeetle_bench/premake5.lua"
+
+group "tools"
+for _, matchedfile in ipairs(os.matchfiles("tools/*/premake5.lua")) do
+    include(matchedfile)
+end
+group ""
\ No newline at end of file
@@ -0,0 +1,33 @@
+project "hbanalyze"
+
+debugdir "../../working"
+
+kind "ConsoleApp"
+
+defines "YAML_CPP_STATIC_DEFINE"
+
+files
+{
+    "%{prj.location}/**.cpp",
+    "%{prj.location}/**.hpp",
+
+    "%{wks.location}/hyperbeetle/source/hb_beat_analysis.cpp",
+    "%{wks.location}/hyperbeetle/source/hb_chart.cpp",
+    "%{wks.location}/hyperbeetle/source/hb_chart_compiler.cpp",
+    "%{wks.location}/hyperbeetle/source/hb_jobs.cpp",
+    "%{wks.location}/hyperbeetle/source/hb_mapped_file.cpp",
+    "%{wks.location}/hyperbeetle/source/hb_profiler.cpp",
+    "%{wks.location}/hyperbeetle/vendor/stb_vorbis.c",
+}
+
+includedirs
+{
+    "%{wks.location}/hyperbeetle/source",
+    "%{wks.location}/hyperbeetle/vendor",
+    "%{wks.location}/vendor/yaml/include",
+}
+
+links "yaml"
+
+filter "system:linux"
+links "pthread"
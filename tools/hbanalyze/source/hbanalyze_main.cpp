@@ -0,0 +1,106 @@
+#include "hb_beat_analysis.hpp"
+#include "hb_chart_compiler.hpp"
+#include "hb_clock.hpp"
+#include "hb_jobs.hpp"
+#include "hb_mapped_file.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace {
+	int usage() {
+		std::cout << "Usage:\n";
+		std::cout << "  hbanalyze <song.ogg> [-o <chart.yaml>] [--lanes <n>] [--threads <n>] [--bpm <min> <max>]\n";
+		std::cout << "Writes a starter chart next to the song unless -o is given, --threads 0 analyzes on this thread only.\n";
+		return 1;
+	}
+
+	template<class T>
+	std::optional<T> parse(std::string_view text) {
+		T value{};
+		auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+		if (error != std::errc() || end != text.data() + text.size())
+			return std::nullopt;
+		return value;
+	}
+
+	double milliseconds(double seconds) { return seconds * 1e3; }
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) return usage();
+
+	std::filesystem::path input = argv[1];
+	std::filesystem::path output;
+	std::uint32_t lanes = 4;
+	std::optional<unsigned> threads;
+	hyperbeetle::AnalysisOptions options;
+
+	for (int i = 2; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		if (arg == "-o" && i + 1 < argc)
+			output = argv[++i];
+		else if (arg == "--lanes" && i + 1 < argc) {
+			auto value = parse<std::uint32_t>(argv[++i]);
+			if (!value || *value < 1 || *value > 255) return usage();
+			lanes = *value;
+		}
+		else if (arg == "--threads" && i + 1 < argc) {
+			threads = parse<unsigned>(argv[++i]);
+			if (!threads) return usage();
+		}
+		else if (arg == "--bpm" && i + 2 < argc) {
+			auto min = parse<double>(argv[++i]), max = parse<double>(argv[++i]);
+			if (!min || !max || *min <= 0.0 || *max <= *min) return usage();
+			options.minBpm = *min;
+			options.maxBpm = *max;
+			// The prior still decides between octaves if the range spans more than one.
+			options.preferredBpm = std::sqrt(*min * *max);
+		}
+		else
+			return usage();
+	}
+
+	// Never overwrites a chart being authored unless asked to by name.
+	if (output.empty()) {
+		output = input;
+		output.replace_extension(".yaml");
+		if (std::filesystem::exists(output)) {
+			std::cout << output.string() << " exists already, pass -o to overwrite it" << std::endl;
+			return 2;
+		}
+	}
+
+	try {
+		std::unique_ptr<hyperbeetle::JobSystem> jobs;
+		if (!threads || *threads > 0)
+			jobs = threads ? std::make_unique<hyperbeetle::JobSystem>(*threads) : std::make_unique<hyperbeetle::JobSystem>();
+
+		hyperbeetle::MappedFile file(input);
+		std::int64_t start = hyperbeetle::now();
+		hyperbeetle::MonoAudio audio = hyperbeetle::decodeMono(file.bytes(), jobs.get());
+		double decode = hyperbeetle::nanosecondsToSeconds(hyperbeetle::now() - start);
+
+		hyperbeetle::BeatAnalysis analysis = hyperbeetle::analyzeBeats(audio, jobs.get(), options);
+		hyperbeetle::ChartSource source = hyperbeetle::makeStarterChart(analysis, input.stem().string(), input.filename().string(), lanes);
+		hyperbeetle::saveChartSource(source, output);
+
+		std::cout << input.string() << ": " << audio.duration() << " s at " << audio.sampleRate << " Hz\n";
+		std::cout << "  bpm " << source.bpm << ", offset " << source.offset << " s, confidence " << analysis.confidence << '\n';
+		std::cout << "  " << analysis.onsets.size() << " onsets, " << source.sections.front().notes.size() << " notes in " << output.string() << '\n';
+		std::cout << "  decode " << milliseconds(decode) << " ms, spectrum " << milliseconds(analysis.timings.spectrum) << " ms, tempo " << milliseconds(analysis.timings.tempo)
+			<< " ms, onsets " << milliseconds(analysis.timings.onsets) << " ms on " << (jobs ? jobs->threadCount() : 0) << " workers" << std::endl;
+	}
+	catch (std::exception const& e) {
+		std::cout << input.string() << ": " << e.what() << std::endl;
+		return 2;
+	}
+	return 0;
+}
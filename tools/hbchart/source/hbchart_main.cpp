@@ -0,0 +1,75 @@
+#include "hb_chart.hpp"
+#include "hb_chart_compiler.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+
+namespace {
+	int usage() {
+		std::cout << "Usage:\n";
+		std::cout << "  hbchart compile <chart.yaml> [-o <chart.hbc>]\n";
+		std::cout << "  hbchart info <chart.hbc>\n";
+		return 1;
+	}
+
+	int compile(std::filesystem::path const& input, std::filesystem::path output) {
+		if (output.empty())
+			output = hyperbeetle::Chart::compiledPath(input);
+
+		hyperbeetle::compileChartFile(input, output);
+
+		hyperbeetle::Chart chart = hyperbeetle::Chart::open(output);
+		std::cout << output.string() << ": " << chart.noteCount() << " notes, " << chart.sections().size() << " sections, " << chart.bytes().size() << " bytes\n";
+		return 0;
+	}
+
+	int info(std::filesystem::path const& input) {
+		hyperbeetle::Chart chart = hyperbeetle::Chart::open(input);
+		auto const& header = chart.header();
+
+		std::cout << "Title:      " << chart.title() << '\n';
+		std::cout << "Artist:     " << chart.artist() << '\n';
+		std::cout << "Author:     " << chart.author() << '\n';
+		std::cout << "Audio:      " << chart.audio() << '\n';
+		std::cout << "BPM:        " << header.bpm << '\n';
+		std::cout << "Length:     " << header.length / 1e6 << "s\n";
+		std::cout << "Lanes:      " << header.lanes << '\n';
+		std::cout << "Difficulty: " << header.difficulty << '\n';
+		std::cout << "Notes:      " << chart.noteCount() << '\n';
+		std::cout << "Curve:      " << chart.curveTimes().size() << " points\n";
+
+		for (auto const& section : chart.sections())
+			std::cout << "  " << section.start / 1e6 << "s " << chart.string(section.name) << ": " << section.noteCount << " notes\n";
+
+		return 0;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) return usage();
+
+	std::string_view command = argv[1];
+	std::filesystem::path input = argv[2];
+
+	try {
+		if (command == "compile") {
+			std::filesystem::path output;
+			if (argc == 5 && std::string_view(argv[3]) == "-o")
+				output = argv[4];
+			else if (argc != 3)
+				return usage();
+
+			return compile(input, output);
+		}
+
+		if (command == "info" && argc == 3)
+			return info(input);
+	}
+	catch (std::exception const& e) {
+		std::cout << input.string() << ": " << e.what() << std::endl;
+		return 2;
+	}
+
+	return usage();
+}
@@ -0,0 +1,160 @@
+#include "hb_chart.hpp"
+#include "hb_chart_compiler.hpp"
+#include "hb_mapped_file.hpp"
+#include "hb_pack.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+	int usage() {
+		std::cout << "Usage:\n";
+		std::cout << "  hbpak build <output.hbpak> <file or directory>... [--store]\n";
+		std::cout << "  hbpak level <chart.yaml> [-o <level.hbpak>]\n";
+		std::cout << "  hbpak list <pack.hbpak>\n";
+		std::cout << "  hbpak verify <pack.hbpak>\n";
+		return 1;
+	}
+
+	// Formats that are compressed already, LZ would only slow down loading them.
+	bool isCompressed(std::filesystem::path const& path) {
+		for (char const* extension : { ".ogg", ".mp3", ".flac", ".png", ".jpg", ".hbpak" }) {
+			if (path.extension() == extension)
+				return true;
+		}
+		return false;
+	}
+
+	std::vector<std::byte> readFile(std::filesystem::path const& path) {
+		hyperbeetle::MappedFile file(path);
+		return { file.bytes().begin(), file.bytes().end() };
+	}
+
+	// Files keep their name, the files under a directory their path relative to it.
+	void addInputs(std::filesystem::path const& path, bool compress, std::vector<hyperbeetle::PackInput>& inputs) {
+		if (!std::filesystem::is_directory(path)) {
+			inputs.push_back({ path.filename().generic_string(), readFile(path), compress && !isCompressed(path) });
+			return;
+		}
+
+		std::vector<std::filesystem::path> files;
+		for (auto const& entry : std::filesystem::recursive_directory_iterator(path)) {
+			if (entry.is_regular_file())
+				files.push_back(entry.path());
+		}
+		// Sorted so the same files always make the same pack.
+		std::sort(files.begin(), files.end());
+
+		for (auto const& file : files)
+			inputs.push_back({ file.lexically_relative(path).generic_string(), readFile(file), compress && !isCompressed(file) });
+	}
+
+	void printSummary(std::filesystem::path const& output) {
+		hyperbeetle::Pack pack = hyperbeetle::Pack::open(output);
+		std::uint64_t size = 0, stored = 0;
+		for (auto const& entry : pack.entries()) {
+			size += entry.size;
+			stored += entry.storedSize;
+		}
+		std::cout << output.string() << ": " << pack.entries().size() << " entries, " << size << " bytes stored in " << stored << ", " << pack.header().fileSize << " bytes with padding\n";
+	}
+
+	int build(std::filesystem::path const& output, std::vector<std::filesystem::path> const& paths, bool compress) {
+		std::vector<hyperbeetle::PackInput> inputs;
+		for (auto const& path : paths)
+			addInputs(path, compress, inputs);
+
+		hyperbeetle::writePack(inputs, output);
+		printSummary(output);
+		return 0;
+	}
+
+	// The chart compiled as kPackChartName and the audio it names, from next to the chart.
+	int level(std::filesystem::path const& input, std::filesystem::path output) {
+		if (output.empty()) {
+			output = input;
+			output.replace_extension(".hbpak");
+		}
+
+		hyperbeetle::ChartSource source = hyperbeetle::loadChartSource(input);
+		std::vector<hyperbeetle::PackInput> inputs;
+		inputs.push_back({ std::string(hyperbeetle::kPackChartName), hyperbeetle::compileChart(source), true });
+		if (!source.audio.empty())
+			inputs.push_back({ source.audio, readFile(input.parent_path() / source.audio), !isCompressed(source.audio) });
+
+		hyperbeetle::writePack(inputs, output);
+		printSummary(output);
+		return 0;
+	}
+
+	char const* compressionName(hyperbeetle::PackCompression compression) {
+		switch (compression) {
+		case hyperbeetle::PackCompression::None: return "stored";
+		case hyperbeetle::PackCompression::Lz: return "lz";
+		default: return "?";
+		}
+	}
+
+	int list(std::filesystem::path const& input) {
+		hyperbeetle::Pack pack = hyperbeetle::Pack::open(input);
+		for (auto const& entry : pack.entries())
+			std::cout << pack.name(entry) << ": " << entry.size << " bytes, " << compressionName(entry.compression) << " in " << entry.storedSize << " at " << entry.offset << '\n';
+		return 0;
+	}
+
+	int verify(std::filesystem::path const& input) {
+		hyperbeetle::Pack pack = hyperbeetle::Pack::open(input);
+		std::vector<std::string> corrupt = pack.verify();
+		for (auto const& name : corrupt)
+			std::cout << input.string() << ": " << name << " is corrupt\n";
+		std::cout << pack.entries().size() - corrupt.size() << " of " << pack.entries().size() << " entries intact\n";
+		return corrupt.empty() ? 0 : 2;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) return usage();
+
+	std::string_view command = argv[1];
+	std::filesystem::path input = argv[2];
+
+	try {
+		if (command == "build" && argc >= 4) {
+			std::vector<std::filesystem::path> paths;
+			bool compress = true;
+			for (int i = 3; i < argc; ++i) {
+				if (std::string_view(argv[i]) == "--store")
+					compress = false;
+				else
+					paths.emplace_back(argv[i]);
+			}
+			return build(input, paths, compress);
+		}
+
+		if (command == "level") {
+			std::filesystem::path output;
+			if (argc == 5 && std::string_view(argv[3]) == "-o")
+				output = argv[4];
+			else if (argc != 3)
+				return usage();
+
+			return level(input, output);
+		}
+
+		if (command == "list" && argc == 3)
+			return list(input);
+
+		if (command == "verify" && argc == 3)
+			return verify(input);
+	}
+	catch (std::exception const& e) {
+		std::cout << input.string() << ": " << e.what() << std::endl;
+		return 2;
+	}
+
+	return usage();
+}
@@ -0,0 +1,30 @@
+project "hbreplay"
+
+debugdir "../../working"
+
+kind "ConsoleApp"
+
+defines "YAML_CPP_STATIC_DEFINE"
+
+files
+{
+    "%{prj.location}/**.cpp",
+    "%{prj.location}/**.hpp",
+
+    "%{wks.location}/hyperbeetle/source/hb_chart.cpp",
+    "%{wks.location}/hyperbeetle/source/hb_chart_compiler.cpp",
+    "%{wks.location}/hyperbeetle/source/hb_mapped_file.cpp",
+    "%{wks.location}/hyperbeetle/source/hb_note_store.cpp",
+    "%{wks.location}/hyperbeetle/source/hb_replay.cpp",
+}
+
+includedirs
+{
+    "%{wks.location}/hyperbeetle/source",
+    "%{wks.location}/vendor/yaml/include",
+}
+
+links "yaml"
+
+filter "system:linux"
+links "pthread"
@@ -0,0 +1,156 @@
+#include "hb_chart.hpp"
+#include "hb_note_store.hpp"
+#include "hb_replay.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <charconv>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+	int usage() {
+		std::cout << "Usage:\n";
+		std::cout << "  hbreplay info <chart> <replay.hbr>\n";
+		std::cout << "  hbreplay verify <chart> <directory> [-j <threads>]\n";
+		return 1;
+	}
+
+	hyperbeetle::Chart openChart(std::filesystem::path const& path) {
+		return path.extension() == ".yaml" ? hyperbeetle::Chart::openSource(path) : hyperbeetle::Chart::open(path);
+	}
+
+	char const* gradeName(hyperbeetle::HitGrade grade) {
+		switch (grade) {
+		case hyperbeetle::HitGrade::Perfect: return "perfect";
+		case hyperbeetle::HitGrade::Great: return "great";
+		case hyperbeetle::HitGrade::Good: return "good";
+		case hyperbeetle::HitGrade::Miss: return "miss";
+		default: return "-";
+		}
+	}
+
+	void printScore(hyperbeetle::NoteStore::Stats const& score) {
+		std::cout << "perfect " << score.grades[0] << ", great " << score.grades[1] << ", good " << score.grades[2] << ", miss " << score.grades[3]
+			<< ", max combo " << score.maxCombo << ", holds " << score.holdsCompleted << '/' << score.holdsCompleted + score.holdsBroken << '\n';
+	}
+
+	// Judges the replay step by step, printing what every input hit.
+	int info(std::filesystem::path const& chartPath, std::filesystem::path const& replayPath) {
+		hyperbeetle::Chart chart = openChart(chartPath);
+		hyperbeetle::Replay replay = hyperbeetle::loadReplay(replayPath, chart);
+
+		hyperbeetle::NoteStore notes;
+		notes.build(chart, replay.windows);
+
+		std::cout << "Chart:  " << chart.title() << '\n';
+		std::cout << "Inputs: " << replay.inputs.size() << ", " << std::filesystem::file_size(replayPath) << " bytes\n";
+
+		for (auto const& input : replay.inputs) {
+			notes.advance(input.advancedTo);
+			auto judgment = input.release ? notes.release(input.lane, input.time) : notes.press(input.lane, input.time);
+
+			std::cout << "  " << input.time / 1e6 << "s lane " << int(input.lane) << (input.release ? " release " : " press   ") << gradeName(judgment.grade);
+			if (judgment.note != hyperbeetle::Judgment::kNoNote)
+				std::cout << " note " << judgment.note << ' ' << judgment.offset / 1000.0 << "ms";
+			std::cout << '\n';
+		}
+
+		notes.advance(replay.end);
+
+		std::cout << "Recorded:  ";
+		printScore(replay.score);
+		std::cout << "Simulated: ";
+		printScore(notes.stats());
+
+		return notes.stats() == replay.score ? 0 : 3;
+	}
+
+	// Re-simulates every replay in `directory` on all cores. Exits with 3 if any of them doesn't reproduce its score.
+	int verify(std::filesystem::path const& chartPath, std::filesystem::path const& directory, unsigned threadCount) {
+		using Clock = std::chrono::steady_clock;
+
+		hyperbeetle::Chart chart = openChart(chartPath);
+
+		std::vector<std::filesystem::path> paths;
+		for (auto const& entry : std::filesystem::directory_iterator(directory)) {
+			if (entry.is_regular_file() && entry.path().extension() == ".hbr")
+				paths.push_back(entry.path());
+		}
+		std::sort(paths.begin(), paths.end());
+
+		std::vector<std::string> errors(paths.size());
+		std::vector<char> valid(paths.size());
+		std::atomic<std::size_t> next = 0;
+		std::atomic<std::int64_t> songTime = 0;
+
+		auto begin = Clock::now();
+		{
+			std::vector<std::jthread> threads;
+			for (unsigned i = 0; i < threadCount; ++i) {
+				threads.emplace_back([&]() {
+					for (std::size_t index = next++; index < paths.size(); index = next++) {
+						try {
+							hyperbeetle::Replay replay = hyperbeetle::loadReplay(paths[index], chart);
+							valid[index] = hyperbeetle::verifyReplay(replay, chart);
+							if (!valid[index]) errors[index] = "score doesn't match";
+							songTime += replay.end;
+						}
+						catch (std::exception const& e) {
+							errors[index] = e.what();
+						}
+					}
+				});
+			}
+		}
+		double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+		std::size_t failed = 0;
+		for (std::size_t i = 0; i < paths.size(); ++i) {
+			if (valid[i]) continue;
+			std::cout << paths[i].string() << ": " << errors[i] << '\n';
+			++failed;
+		}
+
+		std::cout << paths.size() - failed << '/' << paths.size() << " replays verified in " << seconds << "s on " << threadCount << " threads, "
+			<< songTime / 1e6 / std::max(seconds, 1e-9) << "x realtime\n";
+
+		return failed ? 3 : 0;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 4) return usage();
+
+	std::string_view command = argv[1];
+
+	try {
+		if (command == "info" && argc == 4)
+			return info(argv[2], argv[3]);
+
+		if (command == "verify") {
+			unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+			if (argc == 6 && std::string_view(argv[4]) == "-j") {
+				std::string_view value = argv[5];
+				auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), threads);
+				if (ec != std::errc() || threads == 0) return usage();
+			}
+			else if (argc != 4) {
+				return usage();
+			}
+
+			return verify(argv[2], argv[3], threads);
+		}
+	}
+	catch (std::exception const& e) {
+		std::cout << e.what() << std::endl;
+		return 2;
+	}
+
+	return usage();
+}